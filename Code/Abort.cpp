@@ -6,6 +6,8 @@
 #include <stdio.h>
 #include <windows.h>
 
+#include "Profiler.h"
+
 /// This is the function that actually really does all of the
 /// work of aborting, despite all of the redirections in
 /// the code. Normally we will call this function using the ABORT macro.
@@ -23,6 +25,12 @@ void reallyAbort(const char *fmt, ...){
   va_start(ap, fmt);
   _vsnprintf_s(buffer, sizeof(buffer)-1, fmt, ap);
   va_end(ap);
+
+  #ifdef PROFILE_ON //save whatever led up to this
+    if(g_cProfiler.IsEnabled())
+      g_cProfiler.WriteTrace("abort_trace.json");
+  #endif //PROFILE_ON
+
   //flag the error so the app exits cleanly
   FatalAppExit(0, buffer);
 } //reallyAbort
\ No newline at end of file
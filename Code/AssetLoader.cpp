@@ -0,0 +1,324 @@
+/// \file AssetLoader.cpp
+/// \brief Code for the asset loader class CAssetLoader.
+
+#include <chrono>
+#include <wincodec.h>
+
+#include "AssetLoader.h"
+
+/// Start the worker threads.
+/// \param threads Number of worker threads, 0 for one per hardware thread.
+
+CAssetLoader::CAssetLoader(int threads): m_bQuit(FALSE), m_nQueued(0), m_nDelivered(0){
+  if(threads <= 0)
+    threads = max(1, (int)thread::hardware_concurrency());
+
+  for(int i=0; i<threads; i++)
+    m_vWorkers.push_back(thread(&CAssetLoader::WorkerThread, this));
+} //constructor
+
+/// Tell the workers to quit and wait for them. Jobs that haven't been
+/// started are abandoned.
+
+CAssetLoader::~CAssetLoader(){
+  {
+    lock_guard<mutex> lock(m_mutex);
+    m_bQuit = TRUE;
+    m_stlJobs.clear();
+  }
+
+  m_cvJob.notify_all();
+
+  for(int i=0; i<(int)m_vWorkers.size(); i++)
+    m_vWorkers[i].join();
+} //destructor
+
+/// Queue an image to be read and decoded.
+/// \param tag Caller's identifier for the image, passed back with the result.
+/// \param fname Image file name.
+
+void CAssetLoader::QueueImage(int tag, const char* fname){
+  {
+    lock_guard<mutex> lock(m_mutex);
+    AssetJob job = {IMAGE_ASSET, tag, fname};
+    m_stlJobs.push_back(job);
+    m_nQueued++;
+  }
+
+  m_cvJob.notify_one();
+} //QueueImage
+
+/// Queue a DDS file to be read. Its contents are already in the format that
+/// the texture will have, so there is nothing to decode.
+/// \param tag Caller's identifier for the image, passed back with the result.
+/// \param fname DDS file name.
+
+void CAssetLoader::QueueDDS(int tag, const char* fname){
+  {
+    lock_guard<mutex> lock(m_mutex);
+    AssetJob job = {DDS_ASSET, tag, fname};
+    m_stlJobs.push_back(job);
+    m_nQueued++;
+  }
+
+  m_cvJob.notify_one();
+} //QueueDDS
+
+/// Queue a WAV file to be read and parsed.
+/// \param tag Caller's identifier for the sound, passed back with the result.
+/// \param fname WAV file name.
+
+void CAssetLoader::QueueSound(int tag, const char* fname){
+  {
+    lock_guard<mutex> lock(m_mutex);
+    AssetJob job = {SOUND_ASSET, tag, fname};
+    m_stlJobs.push_back(job);
+    m_nQueued++;
+  }
+
+  m_cvJob.notify_one();
+} //QueueSound
+
+/// Worker thread. Take jobs off the queue, load them, and put them on
+/// the finished queue until told to quit.
+
+void CAssetLoader::WorkerThread(){
+  CoInitializeEx(nullptr, COINIT_MULTITHREADED); //for WIC
+
+  while(TRUE){
+    AssetJob job;
+
+    { //wait for a job
+      unique_lock<mutex> lock(m_mutex);
+      m_cvJob.wait(lock, [this]{return m_bQuit || !m_stlJobs.empty();});
+      if(m_bQuit)break;
+      job = m_stlJobs.front();
+      m_stlJobs.pop_front();
+    }
+
+    unique_ptr<LoadedAsset> asset(new LoadedAsset);
+    asset->nType = job.nType;
+    asset->nTag = job.nTag;
+    asset->strFileName = job.strFileName;
+
+    switch(job.nType){
+      case IMAGE_ASSET: DecodeImage(*asset); break;
+      case DDS_ASSET: ReadDDS(*asset); break;
+      case SOUND_ASSET: DecodeSound(*asset); break;
+    } //switch
+
+    { //hand it over
+      lock_guard<mutex> lock(m_mutex);
+      m_stlFinished.push_back(move(asset));
+    }
+
+    m_cvFinished.notify_one();
+  } //while
+
+  CoUninitialize();
+} //WorkerThread
+
+/// Read a whole file into memory.
+/// \param fname File name.
+/// \param size Receives the file size.
+/// \return Pointer to the file contents, nullptr on failure.
+
+static unique_ptr<uint8_t[]> ReadWholeFile(const string& fname, size_t& size){
+  size = 0;
+
+  FILE* f = nullptr;
+  if(fopen_s(&f, fname.c_str(), "rb") != 0 || f == nullptr)
+    return nullptr;
+
+  fseek(f, 0, SEEK_END);
+  long n = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  unique_ptr<uint8_t[]> data;
+  if(n > 0){
+    data.reset(new uint8_t[n]);
+    if(fread(data.get(), 1, n, f) == (size_t)n)
+      size = n;
+    else data.reset();
+  } //if
+
+  fclose(f);
+  return data;
+} //ReadWholeFile
+
+/// Milliseconds since a given time point.
+/// \param t0 Time point.
+/// \return Elapsed time in ms.
+
+static double MillisecondsSince(chrono::steady_clock::time_point t0){
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+} //MillisecondsSince
+
+/// Read an image file and decode it to 32-bit RGBA using WIC. This runs
+/// on a worker thread, so it uses its own WIC factory.
+/// \param asset The asset, which receives the pixels.
+
+void CAssetLoader::DecodeImage(LoadedAsset& asset){
+  auto t0 = chrono::steady_clock::now();
+
+  size_t size;
+  unique_ptr<uint8_t[]> file = ReadWholeFile(asset.strFileName, size);
+  asset.fReadTime = MillisecondsSince(t0);
+  if(file == nullptr)return; //bail and fail
+
+  t0 = chrono::steady_clock::now();
+
+  IWICImagingFactory* pFactory = nullptr;
+  IWICStream* pStream = nullptr;
+  IWICBitmapDecoder* pDecoder = nullptr;
+  IWICBitmapFrameDecode* pFrame = nullptr;
+  IWICFormatConverter* pConverter = nullptr;
+
+  HRESULT hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER,
+    IID_PPV_ARGS(&pFactory));
+
+  if(SUCCEEDED(hr))hr = pFactory->CreateStream(&pStream);
+  if(SUCCEEDED(hr))hr = pStream->InitializeFromMemory(file.get(), (DWORD)size);
+  if(SUCCEEDED(hr))hr = pFactory->CreateDecoderFromStream(pStream, nullptr,
+    WICDecodeMetadataCacheOnDemand, &pDecoder);
+  if(SUCCEEDED(hr))hr = pDecoder->GetFrame(0, &pFrame);
+  if(SUCCEEDED(hr))hr = pFactory->CreateFormatConverter(&pConverter);
+  if(SUCCEEDED(hr))hr = pConverter->Initialize(pFrame, GUID_WICPixelFormat32bppRGBA,
+    WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom);
+
+  UINT w = 0, h = 0;
+  if(SUCCEEDED(hr))hr = pConverter->GetSize(&w, &h);
+
+  if(SUCCEEDED(hr) && w > 0 && h > 0){
+    asset.pData.reset(new uint8_t[w*h*4]);
+    hr = pConverter->CopyPixels(nullptr, w*4, w*h*4, asset.pData.get());
+    if(SUCCEEDED(hr)){
+      asset.nDataBytes = w*h*4;
+      asset.nWidth = (int)w;
+      asset.nHeight = (int)h;
+      asset.bSucceeded = TRUE;
+    } //if
+    else asset.pData.reset();
+  } //if
+
+  SAFE_RELEASE(pConverter);
+  SAFE_RELEASE(pFrame);
+  SAFE_RELEASE(pDecoder);
+  SAFE_RELEASE(pStream); //must go before the file contents do
+  SAFE_RELEASE(pFactory);
+
+  asset.fDecodeTime = MillisecondsSince(t0);
+} //DecodeImage
+
+/// Read a DDS file and get the image size from its header. The rest is
+/// left to the DDS texture loader on the main thread.
+/// \param asset The asset, which receives the file contents.
+
+void CAssetLoader::ReadDDS(LoadedAsset& asset){
+  auto t0 = chrono::steady_clock::now();
+
+  size_t size;
+  asset.pData = ReadWholeFile(asset.strFileName, size);
+  asset.fReadTime = MillisecondsSince(t0);
+  if(asset.pData == nullptr)return; //bail and fail
+
+  //magic number, then header with height at 12 and width at 16
+  const uint8_t* p = asset.pData.get();
+  if(size < 128 || memcmp(p, "DDS ", 4)){
+    asset.pData.reset(); return; //not a DDS file
+  } //if
+
+  asset.nDataBytes = size;
+  asset.nHeight = *(const int*)(p + 12);
+  asset.nWidth = *(const int*)(p + 16);
+  asset.bSucceeded = TRUE;
+} //ReadDDS
+
+/// Read a WAV file and find its format and sample data chunks. The file
+/// contents are kept so that the sound effect can play directly from them.
+/// \param asset The asset, which receives the file contents.
+
+void CAssetLoader::DecodeSound(LoadedAsset& asset){
+  auto t0 = chrono::steady_clock::now();
+
+  size_t size;
+  asset.pData = ReadWholeFile(asset.strFileName, size);
+  asset.fReadTime = MillisecondsSince(t0);
+  if(asset.pData == nullptr)return; //bail and fail
+
+  t0 = chrono::steady_clock::now();
+
+  asset.nDataBytes = size;
+  const uint8_t* p = asset.pData.get();
+
+  //RIFF header
+  if(size < 12 || memcmp(p, "RIFF", 4) || memcmp(p + 8, "WAVE", 4)){
+    asset.pData.reset(); return; //not a WAV file
+  } //if
+
+  //walk the chunks
+  size_t offset = 12;
+  while(offset + 8 <= size){
+    const uint8_t* chunk = p + offset;
+    const size_t chunksize = *(const uint32_t*)(chunk + 4);
+    if(chunksize > size - offset - 8)break; //truncated
+
+    if(!memcmp(chunk, "fmt ", 4) && chunksize >= sizeof(PCMWAVEFORMAT))
+      asset.pWaveFormat = (const WAVEFORMATEX*)(chunk + 8);
+    else if(!memcmp(chunk, "data", 4)){
+      asset.pSamples = chunk + 8;
+      asset.nSampleBytes = chunksize;
+    } //else if
+
+    offset += 8 + chunksize + (chunksize & 1); //chunks are word aligned
+  } //while
+
+  asset.bSucceeded = asset.pWaveFormat != nullptr && asset.pSamples != nullptr;
+  asset.fDecodeTime = MillisecondsSince(t0);
+} //DecodeSound
+
+/// Hand any finished assets to the main thread without waiting.
+/// \param callback Function to receive each finished asset.
+/// \param progress Function to receive progress, may be null.
+/// \return Number of assets delivered.
+
+int CAssetLoader::Pump(const AssetCallback& callback, const AssetProgressCallback& progress){
+  int count = 0;
+
+  while(TRUE){
+    unique_ptr<LoadedAsset> asset;
+    int total;
+
+    {
+      lock_guard<mutex> lock(m_mutex);
+      if(m_stlFinished.empty())break;
+      asset = move(m_stlFinished.front());
+      m_stlFinished.pop_front();
+      total = m_nQueued;
+    }
+
+    callback(*asset);
+    count++;
+    m_nDelivered++;
+
+    if(progress)
+      progress(m_nDelivered, total);
+  } //while
+
+  return count;
+} //Pump
+
+/// Wait until every queued asset has been loaded, handing each one to
+/// the main thread as soon as it is ready.
+/// \param callback Function to receive each finished asset.
+/// \param progress Function to receive progress, may be null.
+
+void CAssetLoader::Finish(const AssetCallback& callback, const AssetProgressCallback& progress){
+  while(TRUE){
+    Pump(callback, progress);
+
+    unique_lock<mutex> lock(m_mutex);
+    if(m_nDelivered >= m_nQueued)break; //all done
+    m_cvFinished.wait(lock, [this]{return !m_stlFinished.empty();});
+  } //while
+} //Finish
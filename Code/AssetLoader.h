@@ -0,0 +1,106 @@
+/// \file AssetLoader.h
+/// \brief Interface for the asset loader class CAssetLoader.
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "defines.h"
+
+/// Kinds of asset that the asset loader knows how to decode.
+
+enum AssetType{
+  IMAGE_ASSET, ///< PNG, BMP, or anything else that WIC can decode.
+  DDS_ASSET, ///< DDS file, already compressed, with mips.
+  SOUND_ASSET ///< WAV file.
+}; //AssetType
+
+/// \brief A decoded asset.
+///
+/// An image is decoded to 32-bit RGBA pixels, ready to be copied into a
+/// texture. A DDS file needs no decoding, so it is just the whole file,
+/// ready to be handed to the DDS texture loader. A sound is the whole WAV
+/// file with pointers to its format and sample data, ready to be handed
+/// to a sound effect.
+
+struct LoadedAsset{
+  AssetType nType; ///< Image or sound.
+  int nTag; ///< Caller's identifier for the asset.
+  string strFileName; ///< File name.
+  BOOL bSucceeded; ///< TRUE if the asset was read and decoded.
+
+  unique_ptr<uint8_t[]> pData; ///< Decoded pixels, or DDS or WAV file contents.
+  size_t nDataBytes; ///< Size of pData in bytes.
+  int nWidth; ///< Image width in pixels.
+  int nHeight; ///< Image height in pixels.
+  const WAVEFORMATEX* pWaveFormat; ///< Sound format, points into pData.
+  const uint8_t* pSamples; ///< Sound samples, points into pData.
+  size_t nSampleBytes; ///< Size of sound samples in bytes.
+
+  double fReadTime; ///< Time spent reading the file, in ms.
+  double fDecodeTime; ///< Time spent decoding, in ms.
+
+  LoadedAsset(): nType(IMAGE_ASSET), nTag(-1), bSucceeded(FALSE), nDataBytes(0), nWidth(0), nHeight(0),
+    pWaveFormat(nullptr), pSamples(nullptr), nSampleBytes(0), fReadTime(0.0), fDecodeTime(0.0){
+  } //constructor
+}; //LoadedAsset
+
+/// Callback for finished assets, called on the main thread.
+
+typedef function<void(LoadedAsset& asset)> AssetCallback;
+
+/// Callback for loading progress, called on the main thread.
+
+typedef function<void(int done, int total)> AssetProgressCallback;
+
+/// \brief The asset loader.
+///
+/// The asset loader reads and decodes images and sounds on a pool of worker
+/// threads, so that while one worker waits on the disk the others are
+/// decoding. Finished assets are queued until the main thread collects them
+/// and creates the GPU and audio resources, which must happen there.
+
+class CAssetLoader{
+  private:
+    /// A request to load an asset.
+
+    struct AssetJob{
+      AssetType nType; ///< Image or sound.
+      int nTag; ///< Caller's identifier for the asset.
+      string strFileName; ///< File name.
+    }; //AssetJob
+
+    vector<thread> m_vWorkers; ///< Worker threads.
+    deque<AssetJob> m_stlJobs; ///< Jobs waiting for a worker.
+    deque<unique_ptr<LoadedAsset>> m_stlFinished; ///< Assets waiting for the main thread.
+    mutex m_mutex; ///< Guards jobs, finished assets, and counts.
+    condition_variable m_cvJob; ///< Signalled when a job is queued or on shutdown.
+    condition_variable m_cvFinished; ///< Signalled when an asset is finished.
+    BOOL m_bQuit; ///< TRUE when workers should exit.
+
+    int m_nQueued; ///< Number of jobs queued so far.
+    int m_nDelivered; ///< Number of assets handed to the main thread so far.
+
+    void WorkerThread(); ///< Worker thread body.
+    static void DecodeImage(LoadedAsset& asset); ///< Read and decode an image.
+    static void ReadDDS(LoadedAsset& asset); ///< Read a DDS file.
+    static void DecodeSound(LoadedAsset& asset); ///< Read and parse a WAV file.
+
+  public:
+    CAssetLoader(int threads=0); ///< Constructor.
+    ~CAssetLoader(); ///< Destructor.
+
+    void QueueImage(int tag, const char* fname); ///< Queue an image to be loaded.
+    void QueueDDS(int tag, const char* fname); ///< Queue a DDS file to be loaded.
+    void QueueSound(int tag, const char* fname); ///< Queue a sound to be loaded.
+
+    int Pump(const AssetCallback& callback, const AssetProgressCallback& progress=nullptr); ///< Deliver finished assets.
+    void Finish(const AssetCallback& callback, const AssetProgressCallback& progress=nullptr); ///< Wait for and deliver all assets.
+}; //CAssetLoader
@@ -0,0 +1,40 @@
+/// \file Checksum.cpp
+/// \brief Code for the checksum class CChecksum.
+
+#include "Checksum.h"
+
+CChecksum::CChecksum():
+  m_nHash(2166136261u) //FNV offset basis
+{
+} //constructor
+
+/// \param p Values.
+/// \param n Number of values.
+
+void CChecksum::Add(const int* p, int n){
+  for(int i=0; i<n; i++)
+    Add(p[i]);
+} //Add
+
+/// \param p Bytes.
+/// \param n Number of bytes.
+
+void CChecksum::Add(const unsigned char* p, int n){
+  for(int i=0; i<n; i++){
+    m_nHash ^= p[i];
+    m_nHash *= 16777619u;
+  } //for
+} //Add
+
+/// \param p Signed bytes.
+/// \param n Number of bytes.
+
+void CChecksum::Add(const signed char* p, int n){
+  Add((const unsigned char*)p, n);
+} //Add
+
+/// \return The checksum of everything added so far.
+
+unsigned CChecksum::Get() const{
+  return m_nHash;
+} //Get
@@ -0,0 +1,40 @@
+/// \file Checksum.h
+/// \brief Interface for the checksum class CChecksum.
+
+#pragma once
+
+/// \brief A checksum of the game state.
+///
+/// The checksum is 32-bit FNV-1a over the values added, taken a byte at a
+/// time from least significant to most, so it depends only on the values
+/// and not on the byte order of the machine or the layout of structures.
+/// Two runs of the simulation that agree on the checksum at every tick
+/// almost certainly agree on everything.
+
+class CChecksum{
+  private:
+    unsigned m_nHash; ///< Hash so far.
+
+  public:
+    CChecksum(); ///< Constructor.
+
+    void Add(int n); ///< Add a value.
+    void Add(const int* p, int n); ///< Add an array of values.
+    void Add(const unsigned char* p, int n); ///< Add an array of bytes.
+    void Add(const signed char* p, int n); ///< Add an array of signed bytes.
+
+    unsigned Get() const; ///< The checksum.
+}; //CChecksum
+
+/// Add a value. This is inline because every value in the game state goes
+/// through it every tick.
+/// \param n A value.
+
+inline void CChecksum::Add(int n){
+  const unsigned u = (unsigned)n;
+
+  for(int i=0; i<32; i+=8){
+    m_nHash ^= (u >> i) & 0xFF;
+    m_nHash *= 16777619u; //FNV prime
+  } //for
+} //Add
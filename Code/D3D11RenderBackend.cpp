@@ -0,0 +1,112 @@
+/// \file D3D11RenderBackend.cpp
+/// \brief Code for the Direct3D 11 render backend class CD3D11RenderBackend.
+
+#include "D3D11RenderBackend.h"
+
+CD3D11RenderBackend::CD3D11RenderBackend(ID3D11DeviceContext2* dc, IDXGISwapChain2* swapchain,
+  ID3D11RenderTargetView* rtv, ID3D11DepthStencilView* dsv):
+  m_pDC2(dc), m_pSwapChain2(swapchain), m_pRTV(rtv), m_pDSV(dsv)
+{
+} //constructor
+
+void CD3D11RenderBackend::SetRenderTarget(){
+  Count(SET_RENDER_TARGET_COMMAND);
+  m_pDC2->OMSetRenderTargets(1, &m_pRTV, m_pDSV);
+} //SetRenderTarget
+
+void CD3D11RenderBackend::Clear(const float color[4]){
+  Count(CLEAR_COMMAND);
+  m_pDC2->ClearRenderTargetView(m_pRTV, color);
+  m_pDC2->ClearDepthStencilView(m_pDSV, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+} //Clear
+
+void CD3D11RenderBackend::SetShaders(RenderHandle layout, RenderHandle vs, RenderHandle ps){
+  Count(SET_SHADERS_COMMAND);
+  m_pDC2->IASetInputLayout((ID3D11InputLayout*)layout);
+  m_pDC2->VSSetShader((ID3D11VertexShader*)vs, nullptr, 0);
+  m_pDC2->PSSetShader((ID3D11PixelShader*)ps, nullptr, 0);
+} //SetShaders
+
+void CD3D11RenderBackend::SetTopology(RenderTopology t){
+  Count(SET_TOPOLOGY_COMMAND);
+  m_pDC2->IASetPrimitiveTopology(t == TRIANGLE_LIST_TOPOLOGY?
+    D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST: D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+} //SetTopology
+
+/// Set vertex buffers, starting at slot 0, all with offset 0.
+
+void CD3D11RenderBackend::SetVertexBuffers(int n, const RenderHandle* buffers, const unsigned* strides){
+  Count(SET_VERTEX_BUFFERS_COMMAND);
+
+  ID3D11Buffer* pBuffers[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+  UINT nStrides[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+  UINT nOffsets[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+  n = min(n, D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT);
+
+  for(int i=0; i<n; i++){
+    pBuffers[i] = (ID3D11Buffer*)buffers[i];
+    nStrides[i] = strides[i];
+    nOffsets[i] = 0;
+  } //for
+
+  m_pDC2->IASetVertexBuffers(0, n, pBuffers, nStrides, nOffsets);
+} //SetVertexBuffers
+
+void CD3D11RenderBackend::UpdateBuffer(RenderHandle buffer, const void* data, size_t bytes){
+  Count(UPDATE_BUFFER_COMMAND, bytes);
+  m_pDC2->UpdateSubresource((ID3D11Buffer*)buffer, 0, nullptr, data, 0, 0);
+} //UpdateBuffer
+
+/// Map a dynamic buffer with discard, copy data into it, and unmap it.
+/// \return true if the buffer could be mapped.
+
+bool CD3D11RenderBackend::WriteBuffer(RenderHandle buffer, const void* data, size_t bytes){
+  Count(WRITE_BUFFER_COMMAND, bytes);
+
+  ID3D11Buffer* pBuffer = (ID3D11Buffer*)buffer;
+  D3D11_MAPPED_SUBRESOURCE mapped;
+  if(FAILED(m_pDC2->Map(pBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+    return false; //bail and fail
+
+  memcpy(mapped.pData, data, bytes);
+  m_pDC2->Unmap(pBuffer, 0);
+  return true;
+} //WriteBuffer
+
+void CD3D11RenderBackend::SetConstantBuffer(int slot, RenderHandle buffer){
+  Count(SET_CONSTANT_BUFFER_COMMAND);
+  ID3D11Buffer* pBuffer = (ID3D11Buffer*)buffer;
+  m_pDC2->VSSetConstantBuffers(slot, 1, &pBuffer);
+} //SetConstantBuffer
+
+void CD3D11RenderBackend::SetTexture(int slot, RenderHandle texture){
+  Count(SET_TEXTURE_COMMAND);
+  ID3D11ShaderResourceView* pTexture = (ID3D11ShaderResourceView*)texture;
+  m_pDC2->PSSetShaderResources(slot, 1, &pTexture);
+} //SetTexture
+
+void CD3D11RenderBackend::SetBlendState(RenderHandle state){
+  Count(SET_BLEND_STATE_COMMAND);
+  m_pDC2->OMSetBlendState((ID3D11BlendState*)state, nullptr, 0xffffffff);
+} //SetBlendState
+
+void CD3D11RenderBackend::SetRasterizerState(RenderHandle state){
+  Count(SET_RASTERIZER_STATE_COMMAND);
+  m_pDC2->RSSetState((ID3D11RasterizerState*)state);
+} //SetRasterizerState
+
+void CD3D11RenderBackend::Draw(int vertices, int first){
+  Count(DRAW_COMMAND);
+  m_pDC2->Draw(vertices, first);
+} //Draw
+
+void CD3D11RenderBackend::DrawInstanced(int vertices, int instances, int firstvertex, int firstinstance){
+  Count(DRAW_INSTANCED_COMMAND);
+  m_pDC2->DrawInstanced(vertices, instances, firstvertex, firstinstance);
+} //DrawInstanced
+
+void CD3D11RenderBackend::Present(int interval){
+  Count(PRESENT_COMMAND);
+  m_pSwapChain2->Present(interval, 0);
+  EndFrame();
+} //Present
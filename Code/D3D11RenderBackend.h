@@ -0,0 +1,40 @@
+/// \file D3D11RenderBackend.h
+/// \brief Interface for the Direct3D 11 render backend class CD3D11RenderBackend.
+
+#pragma once
+
+#include "defines.h"
+#include "RenderBackend.h"
+
+/// \brief The Direct3D 11 render backend.
+///
+/// The Direct3D 11 render backend passes each command to the device
+/// context, handles being pointers to the corresponding D3D objects.
+/// It doesn't own the device context, swap chain, or views; the renderer does.
+
+class CD3D11RenderBackend: public CRenderBackend{
+  private:
+    ID3D11DeviceContext2* m_pDC2; ///< Device context.
+    IDXGISwapChain2* m_pSwapChain2; ///< Swap chain.
+    ID3D11RenderTargetView* m_pRTV; ///< Render target view.
+    ID3D11DepthStencilView* m_pDSV; ///< Depth stencil view.
+
+  public:
+    CD3D11RenderBackend(ID3D11DeviceContext2* dc, IDXGISwapChain2* swapchain,
+      ID3D11RenderTargetView* rtv, ID3D11DepthStencilView* dsv); ///< Constructor.
+
+    virtual void SetRenderTarget(); ///< Bind the back buffer and depth buffer.
+    virtual void Clear(const float color[4]); ///< Clear the back buffer and depth buffer.
+    virtual void SetShaders(RenderHandle layout, RenderHandle vs, RenderHandle ps); ///< Set shaders.
+    virtual void SetTopology(RenderTopology t); ///< Set primitive topology.
+    virtual void SetVertexBuffers(int n, const RenderHandle* buffers, const unsigned* strides); ///< Set vertex buffers.
+    virtual void UpdateBuffer(RenderHandle buffer, const void* data, size_t bytes); ///< Update a default buffer.
+    virtual bool WriteBuffer(RenderHandle buffer, const void* data, size_t bytes); ///< Overwrite a dynamic buffer.
+    virtual void SetConstantBuffer(int slot, RenderHandle buffer); ///< Set constant buffer.
+    virtual void SetTexture(int slot, RenderHandle texture); ///< Set texture.
+    virtual void SetBlendState(RenderHandle state); ///< Set blend state.
+    virtual void SetRasterizerState(RenderHandle state); ///< Set rasterizer state.
+    virtual void Draw(int vertices, int first); ///< Draw.
+    virtual void DrawInstanced(int vertices, int instances, int firstvertex, int firstinstance); ///< Draw instanced.
+    virtual void Present(int interval); ///< Present the frame.
+}; //CD3D11RenderBackend
@@ -0,0 +1,125 @@
+/// \file DepthOrder.cpp
+/// \brief Code for the draw order class CDepthOrder.
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "DepthOrder.h"
+
+CDepthOrder::CDepthOrder():
+  m_nNew(0), m_nSorts(0), m_nRadixSorts(0)
+{
+} //constructor
+
+/// Make room for n objects, so that inserting them and sorting them
+/// doesn't allocate memory.
+/// \param n Most objects there will be at once.
+
+void CDepthOrder::Reserve(int n){
+  m_vEntry.reserve(n);
+  m_vScratch.reserve(n);
+} //Reserve
+
+void CDepthOrder::Clear(){
+  m_vEntry.clear();
+  m_nNew = 0;
+} //Clear
+
+/// Add an object to the end of the draw order. The next sort moves it to
+/// the front before moving it to its proper place.
+/// \param h Handle to the object.
+/// \param z Its Z coordinate.
+
+void CDepthOrder::Insert(ObjectHandle h, float z){
+  DepthEntry e;
+  e.m_nKey = GetKey(z);
+  e.m_nHandle = h;
+  m_vEntry.push_back(e);
+  m_nNew++;
+} //Insert
+
+/// Sort the entries into draw order by depth key. An insertion sort is
+/// tried first, since last frame's order is usually close. If it has moved
+/// entries more than MAX_SHIFTS times per entry it stops where it is,
+/// leaving a partly sorted array, and the radix sort takes over. Entries
+/// added since the last sort are moved to the front first, newest first.
+
+void CDepthOrder::Sort(){
+  const int n = (int)m_vEntry.size();
+  DepthEntry* a = m_vEntry.data();
+  int budget = MAX_SHIFTS*n; //moves left before giving up
+  m_nSorts++;
+
+  if(m_nNew > 0){ //one move per frame however many were added
+    reverse(a + n - m_nNew, a + n);
+    rotate(a, a + n - m_nNew, a + n);
+    m_nNew = 0;
+  } //if
+
+  for(int i=1; i<n; i++){
+    if(a[i - 1].m_nKey <= a[i].m_nKey)continue; //already in place, the usual case
+
+    const DepthEntry e = a[i];
+    int j = i;
+
+    while(j > 0 && a[j - 1].m_nKey > e.m_nKey && budget > 0){
+      a[j] = a[j - 1];
+      j--; budget--;
+    } //while
+
+    a[j] = e;
+
+    if(budget <= 0){ //too many out of place
+      RadixSort();
+      return;
+    } //if
+  } //for
+} //Sort
+
+/// Least significant digit radix sort on the depth keys, a byte at a time.
+/// The histograms for all four bytes are made in one pass, and a byte that
+/// is the same in every key is skipped, since the pass would not move
+/// anything.
+
+void CDepthOrder::RadixSort(){
+  const int n = (int)m_vEntry.size();
+  if(n < 2)return;
+  m_nRadixSorts++;
+  m_vScratch.resize(n);
+
+  int count[4][256];
+  memset(count, 0, sizeof(count));
+
+  for(int i=0; i<n; i++){
+    const unsigned k = m_vEntry[i].m_nKey;
+    count[0][k & 0xFF]++;
+    count[1][(k >> 8) & 0xFF]++;
+    count[2][(k >> 16) & 0xFF]++;
+    count[3][k >> 24]++;
+  } //for
+
+  for(int b=0; b<4; b++){
+    const int shift = 8*b;
+    if(count[b][(m_vEntry[0].m_nKey >> shift) & 0xFF] == n)
+      continue; //every key has the same byte here
+
+    int start[256]; //where the entries with each byte value go
+    int sum = 0;
+    for(int d=0; d<256; d++){
+      start[d] = sum;
+      sum += count[b][d];
+    } //for
+
+    for(int i=0; i<n; i++){
+      const DepthEntry& e = m_vEntry[i];
+      m_vScratch[start[(e.m_nKey >> shift) & 0xFF]++] = e;
+    } //for
+
+    m_vEntry.swap(m_vScratch);
+  } //for
+} //RadixSort
+
+int CDepthOrder::GetCount() const{return (int)m_vEntry.size();}
+int CDepthOrder::GetSorts() const{return m_nSorts;}
+int CDepthOrder::GetRadixSorts() const{return m_nRadixSorts;}
@@ -0,0 +1,126 @@
+/// \file DepthOrder.h
+/// \brief Interface for the draw order class CDepthOrder.
+
+#pragma once
+
+#include <string.h>
+
+#include <vector>
+
+#include "ObjectPool.h"
+
+using namespace std;
+
+/// \brief An object to be drawn, and how far back it is.
+
+struct DepthEntry{
+  unsigned m_nKey; ///< Depth key, smaller keys are drawn first.
+  ObjectHandle m_nHandle; ///< The object.
+}; //DepthEntry
+
+/// \brief Objects in the order they are to be drawn, back to front.
+///
+/// The draw order is kept from frame to frame in an array of depth keys
+/// and handles, rather than being sorted from scratch each time. Since
+/// objects seldom change depth, and then only by a little, last frame's
+/// order is almost always nearly right, and an insertion sort puts it
+/// right in close to linear time. If the insertion sort has to move
+/// entries too far, because a lot of objects have moved at once, it gives
+/// up and a radix sort on the depth keys finishes the job in linear time
+/// whatever the order. Both sorts are stable, so objects at the same depth
+/// stay in the same order from frame to frame and don't flicker. New
+/// objects go in front of the rest before they are sorted, newest first,
+/// as they did when the object manager kept a list and pushed each new
+/// object onto its front, so that of two objects at the same depth the
+/// newer is drawn first, behind the older.
+///
+/// The depth key is the bit pattern of Z, flipped so that it sorts as an
+/// unsigned integer from far to near. The radix sort skips any byte of the
+/// key that is the same for every object, which in practice is most of
+/// them, since Z varies over a small range.
+///
+/// The game keeps its fighters in one, in PublishSnapshot, and publishes
+/// them to the renderer back to front. The sprite batch keeps that order
+/// among sprites that share a texture, so a fighter's transparent edges
+/// don't write depth over a teammate standing behind it.
+
+class CDepthOrder{
+  private:
+    static const int MAX_SHIFTS = 4; ///< Insertion sort moves allowed per entry before giving up.
+
+    vector<DepthEntry> m_vEntry; ///< Entries in draw order, once sorted.
+    vector<DepthEntry> m_vScratch; ///< Second buffer for the radix sort.
+
+    int m_nNew; ///< Entries at the end added since the last sort.
+    int m_nSorts; ///< Number of times sorted.
+    int m_nRadixSorts; ///< Number of those that fell back to the radix sort.
+
+    void RadixSort(); ///< Sort by depth key in linear time.
+
+  public:
+    CDepthOrder(); ///< Constructor.
+
+    void Reserve(int n); ///< Make room for n objects.
+    void Clear(); ///< Remove all objects.
+
+    void Insert(ObjectHandle h, float z); ///< Add an object.
+    template<class Pred> void RemoveIf(Pred dead); ///< Remove objects, keeping the rest in order.
+
+    void SetDepth(int i, float z); ///< Change the depth of an entry.
+    void Sort(); ///< Put entries in draw order.
+
+    int GetCount() const; ///< Number of objects.
+    ObjectHandle GetHandle(int i) const; ///< Object at a position in draw order.
+    int GetSorts() const; ///< Number of times sorted.
+    int GetRadixSorts() const; ///< Number of sorts that fell back to radix sort.
+
+    static unsigned GetKey(float z); ///< Depth key for a Z coordinate.
+}; //CDepthOrder
+
+/// Remove the objects that a predicate says are dead. The rest keep their
+/// order, so the next sort has as little to do as before. This is a
+/// template so that the caller can decide what dead means.
+/// \param dead Function or lambda taking a handle and returning true if
+///   the object is to be removed.
+
+template<class Pred> void CDepthOrder::RemoveIf(Pred dead){
+  const size_t old = m_vEntry.size() - m_nNew; //where the new entries start
+  size_t n = 0;
+
+  for(size_t i=0; i<m_vEntry.size(); i++)
+    if(!dead(m_vEntry[i].m_nHandle))
+      m_vEntry[n++] = m_vEntry[i];
+    else if(i >= old)m_nNew--; //the rest of the new ones stay at the end
+
+  m_vEntry.resize(n);
+} //RemoveIf
+
+/// Get the depth key for a Z coordinate. Larger Z is further back, so it
+/// must get a smaller key. A positive float sorts correctly as an unsigned
+/// integer if its sign bit is set, and a negative one if all of its bits
+/// are flipped. Flipping the result puts far before near. This is inline
+/// because it is called for every object every frame.
+/// \param z Z coordinate.
+/// \return Depth key.
+
+inline unsigned CDepthOrder::GetKey(float z){
+  z += 0.0f; //so that -0 and +0 get the same key
+  unsigned n;
+  memcpy(&n, &z, sizeof(n));
+  const unsigned mask = (n & 0x80000000)? 0xFFFFFFFF: 0x80000000;
+  return ~(n ^ mask);
+} //GetKey
+
+/// \param i Position in the draw order.
+/// \param z New Z coordinate of the object there.
+
+inline void CDepthOrder::SetDepth(int i, float z){
+  m_vEntry[i].m_nKey = GetKey(z);
+} //SetDepth
+
+/// \param i Position in the draw order.
+/// \return Handle to the object there.
+
+inline ObjectHandle CDepthOrder::GetHandle(int i) const{
+  return m_vEntry[i].m_nHandle;
+} //GetHandle
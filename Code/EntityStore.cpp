@@ -0,0 +1,387 @@
+/// \file EntityStore.cpp
+/// \brief Code for the entity store class CEntityStore.
+
+#include <limits.h>
+
+#include <algorithm>
+
+#include "EntityStore.h"
+
+/// Remove a row from a column by moving the last row into its place.
+/// \param v Column.
+/// \param i Row to remove.
+
+template<class T> static void RemoveRow(vector<T>& v, int i){
+  v[i] = v.back();
+  v.pop_back();
+} //RemoveRow
+
+/// One tick of a jump. A fighter speeds up on the way up until it passes
+/// the apex, then slows down and falls back. On landing it stands on the
+/// floor with no speed, so that the next jump starts from rest. This is
+/// written with arithmetic rather than branches so that the jump kernel
+/// vectorizes: adding a speed times 0 leaves a height exactly as it was.
+/// Speeds are whole pixels per tick, so it is all integer arithmetic.
+/// \param y [in, out] Height.
+/// \param v [in, out] Vertical speed.
+/// \param ground Height of the floor.
+/// \param apex Height at which a jump starts to fall.
+/// \param go Whether to move at all.
+
+static inline void JumpStep(fixed& y, fixed& v, fixed ground, fixed apex, bool go){
+  const int rising = go & (y >= ground) & (y <= apex); //1 or 0
+  v += rising*FIXED_ONE;
+  y += rising*v;
+
+  const int falling = go & (y > apex); //1 or 0
+  v -= falling*FIXED_ONE;
+  y += falling*v;
+
+  const int landed = go & (y <= ground); //1 or 0
+  y += landed*(ground - y);
+  v -= landed*v;
+} //JumpStep
+
+CEntityStore::CEntityStore(){
+  m_cArena.nMinX = INT_MIN;
+  m_cArena.nMaxX = INT_MAX;
+  m_cArena.nGap = 0;
+  m_cArena.nGround = 0;
+  m_cArena.nApex = 0;
+} //constructor
+
+/// \param arena Floor and walls.
+
+void CEntityStore::SetArena(const ArenaDesc& arena){
+  m_cArena = arena;
+} //SetArena
+
+/// Make a new entity in a new row at the end of the columns. Its slot is
+/// taken from the free list if there is one.
+/// \param desc What the entity is made from.
+/// \return Handle to the new entity, NULL_ENTITY if the store is full.
+
+EntityHandle CEntityStore::Create(const EntityDesc& desc){
+  unsigned slot;
+
+  if(!m_vFreeSlots.empty()){
+    slot = m_vFreeSlots.back();
+    m_vFreeSlots.pop_back();
+  } //if
+
+  else{
+    if(m_vSlotRow.size() > SLOT_MASK)return NULL_ENTITY;
+    slot = (unsigned)m_vSlotRow.size();
+    m_vSlotRow.push_back(0);
+    m_vSlotGeneration.push_back(1);
+  } //else
+
+  const EntityHandle h = ((EntityHandle)m_vSlotGeneration[slot] << SLOT_BITS) | slot;
+  m_vSlotRow[slot] = (unsigned)m_vHandle.size();
+
+  m_vPosX.push_back(desc.nX);
+  m_vPosY.push_back(desc.nY);
+  m_vPosZ.push_back(desc.nZ);
+  m_vLastX.push_back(desc.nX);
+  m_vLastY.push_back(desc.nY);
+  m_vVelY.push_back(0);
+  m_vFacing.push_back(desc.nFacing < 0? -1: 1);
+  m_vActive.push_back(desc.bActive? 1: 0);
+  m_vSprite.push_back(desc.nSprite);
+  m_vHandle.push_back(h);
+
+  m_vAnimator.push_back(CFighterAnimator());
+  m_vAnimator.back().SetFrames(desc.cFrames);
+  m_vFrame.push_back(m_vAnimator.back().GetFrame());
+  m_vState.push_back((unsigned char)m_vAnimator.back().GetState());
+
+  return h;
+} //Create
+
+/// Get rid of an entity. The last row is moved into its place, and its
+/// slot gets a new generation so that any handles to it go stale.
+/// \param h Handle to entity, which may be stale.
+
+void CEntityStore::Destroy(EntityHandle h){
+  const int i = GetRow(h);
+  if(i < 0)return;
+
+  const unsigned slot = h & SLOT_MASK;
+  m_vSlotRow[m_vHandle.back() & SLOT_MASK] = i; //last row moves to i
+
+  RemoveRow(m_vPosX, i);
+  RemoveRow(m_vPosY, i);
+  RemoveRow(m_vPosZ, i);
+  RemoveRow(m_vLastX, i);
+  RemoveRow(m_vLastY, i);
+  RemoveRow(m_vVelY, i);
+  RemoveRow(m_vFacing, i);
+  RemoveRow(m_vActive, i);
+  RemoveRow(m_vFrame, i);
+  RemoveRow(m_vState, i);
+  RemoveRow(m_vSprite, i);
+  RemoveRow(m_vAnimator, i);
+  RemoveRow(m_vHandle, i);
+
+  if(++m_vSlotGeneration[slot] == 0) //generation 0 would make a null handle
+    m_vSlotGeneration[slot] = 1;
+  m_vFreeSlots.push_back(slot);
+} //Destroy
+
+/// Get rid of all entities. Every handle there has ever been goes stale.
+
+void CEntityStore::Clear(){
+  while(!m_vHandle.empty())
+    Destroy(m_vHandle.back());
+} //Clear
+
+/// Get the row of an entity.
+/// \param h Handle to entity.
+/// \return Row, or -1 if the handle is stale or null.
+
+int CEntityStore::GetRow(EntityHandle h) const{
+  const unsigned slot = h & SLOT_MASK;
+  if(slot >= m_vSlotRow.size())return -1;
+  if(m_vSlotGeneration[slot] != (h >> SLOT_BITS))return -1;
+  return (int)m_vSlotRow[slot];
+} //GetRow
+
+/// \param h Handle to entity.
+/// \return true if the handle refers to an entity that still exists.
+
+bool CEntityStore::IsValid(EntityHandle h) const{
+  return GetRow(h) >= 0;
+} //IsValid
+
+/// Advance every entity by one simulation tick: remember where it was,
+/// move it along its jump, and tick its animation state machine.
+
+void CEntityStore::Simulate(){
+  BeginTick();
+  Jump();
+  Animate();
+} //Simulate
+
+/// Remember where every entity is at the start of a tick, for the renderer
+/// to interpolate from. Only X and Y change, so only they are copied.
+
+void CEntityStore::BeginTick(){
+  copy(m_vPosX.begin(), m_vPosX.end(), m_vLastX.begin());
+  copy(m_vPosY.begin(), m_vPosY.end(), m_vLastY.begin());
+} //BeginTick
+
+/// Move every entity that is off the ground along its jump. Every row is
+/// loaded and stored whether it moves or not, so that the compiler can
+/// vectorize the loop.
+
+void CEntityStore::Jump(){
+  const int n = GetCount();
+  fixed* y = m_vPosY.data();
+  fixed* v = m_vVelY.data();
+  const fixed ground = m_cArena.nGround;
+  const fixed apex = m_cArena.nApex;
+
+  for(int i=0; i<n; i++){
+    fixed yi = y[i], vi = v[i];
+    JumpStep(yi, vi, ground, apex, yi != ground);
+    y[i] = yi; v[i] = vi;
+  } //for
+} //Jump
+
+/// Tick every animation state machine with its height above the floor,
+/// and copy out the frame it chooses and the state it is in. A fighter
+/// standing idle on the floor stays idle and keeps its frame, so only
+/// the state and height columns need be looked at to skip it, which is
+/// most fighters most of the time. This relies on the state column being
+/// up to date, which is why inputs go through the store.
+
+void CEntityStore::Animate(){
+  const int n = GetCount();
+  const fixed ground = m_cArena.nGround;
+  const fixed* y = m_vPosY.data();
+  const unsigned char* state = m_vState.data();
+
+  //gather the rows that need ticking without branching on each one
+  m_vAwake.resize(n);
+  int* awake = m_vAwake.data();
+  int m = 0;
+
+  for(int i=0; i<n; i++){
+    awake[m] = i;
+    m += state[i] != IDLE_STATE || y[i] != ground;
+  } //for
+
+  for(int k=0; k<m; k++){
+    const int i = awake[k];
+    m_vAnimator[i].Tick(y[i] - ground);
+    Refresh(i);
+  } //for
+} //Animate
+
+/// \param i Row.
+
+void CEntityStore::Refresh(int i){
+  m_vFrame[i] = m_vAnimator[i].GetFrame();
+  m_vState[i] = (unsigned char)m_vAnimator[i].GetState();
+} //Refresh
+
+/// Move one row along its jump, whether or not it is off the ground.
+/// \param i Row.
+
+void CEntityStore::JumpRow(int i){
+  JumpStep(m_vPosY[i], m_vVelY[i], m_cArena.nGround, m_cArena.nApex, true);
+} //JumpRow
+
+/// Get the front line for fighters facing a given way, which is as close
+/// as they can get to the nearest opponent in play.
+/// \param facing 1 for facing right, -1 for facing left.
+/// \return Highest X for facing right, lowest X for facing left.
+
+fixed CEntityStore::GetFrontLine(int facing) const{
+  const int n = GetCount();
+  fixed front = facing > 0? INT_MAX: INT_MIN;
+
+  for(int i=0; i<n; i++)
+    if(m_vActive[i] && m_vFacing[i] != facing)
+      front = facing > 0? min(front, m_vPosX[i] - m_cArena.nGap):
+        max(front, m_vPosX[i] + m_cArena.nGap);
+
+  return front;
+} //GetFrontLine
+
+/// Walk sideways, but no further than the walls of the arena or the front
+/// line of the opposing team.
+/// \param h Handle to entity.
+/// \param dx Distance to walk, negative for left.
+/// \return true if the fighter was free to walk.
+
+bool CEntityStore::Walk(EntityHandle h, fixed dx){
+  const int i = GetRow(h);
+  if(i < 0 || !m_vAnimator[i].Walk())return false;
+  Refresh(i);
+
+  fixed x = m_vPosX[i] + dx;
+  x = min(max(x, m_cArena.nMinX), m_cArena.nMaxX);
+
+  const fixed front = GetFrontLine(m_vFacing[i]);
+  m_vPosX[i] = m_vFacing[i] > 0? min(x, front): max(x, front);
+  return true;
+} //Walk
+
+/// Start a jump by taking the first step of it.
+/// \param h Handle to entity.
+/// \return true if the fighter was free to jump.
+
+bool CEntityStore::Jump(EntityHandle h){
+  const int i = GetRow(h);
+  if(i < 0 || !m_vAnimator[i].Jump())return false;
+  Refresh(i);
+  JumpRow(i);
+  return true;
+} //Jump
+
+/// Start a punch or kick. It lands with Hit().
+/// \param h Handle to attacker.
+/// \param attack PUNCH_STATE or KICK_STATE.
+/// \return true if the fighter was free to attack.
+
+bool CEntityStore::Attack(EntityHandle h, FighterState attack){
+  const int i = GetRow(h);
+  if(i < 0)return false;
+
+  CFighterAnimator& a = m_vAnimator[i];
+  if(!(attack == PUNCH_STATE? a.Punch(): a.Kick()))return false;
+  Refresh(i);
+  return true;
+} //Attack
+
+/// Land an attack on an opponent, who reels from it. The attack won't
+/// land again, though it may land on others on the same tick. Whether the
+/// two are close enough is for the hitboxes to decide.
+/// \param attacker Handle to a fighter that is punching or kicking.
+/// \param defender Handle to the fighter it hit.
+/// \return true if the hit landed.
+
+bool CEntityStore::Hit(EntityHandle attacker, EntityHandle defender){
+  const int a = GetRow(attacker), d = GetRow(defender);
+  if(a < 0 || d < 0 || a == d || !m_vActive[a] || !m_vActive[d])return false;
+
+  const FighterState attack = (FighterState)m_vState[a];
+  if(attack != PUNCH_STATE && attack != KICK_STATE)return false;
+
+  m_vAnimator[a].Land();
+  m_vAnimator[d].Hit(attack);
+  Refresh(d);
+  return true;
+} //Hit
+
+/// \param h Handle to entity.
+/// \param active true to put it in play, false to take it out.
+
+void CEntityStore::SetActive(EntityHandle h, bool active){
+  const int i = GetRow(h);
+  if(i >= 0)m_vActive[i] = active? 1: 0;
+} //SetActive
+
+/// Tag out a fighter for a partner, who comes in where it was standing.
+/// \param out Handle to fighter leaving play.
+/// \param in Handle to fighter coming into play.
+
+void CEntityStore::Tag(EntityHandle out, EntityHandle in){
+  const int i = GetRow(out), j = GetRow(in);
+  if(i < 0 || j < 0 || i == j)return;
+
+  m_vPosX[j] = m_vLastX[j] = m_vPosX[i];
+  m_vActive[i] = 0;
+  m_vActive[j] = 1;
+} //Tag
+
+/// \param h Handle to entity.
+/// \return Its animation state machine, or nullptr if the handle is stale.
+/// Inputs go through the store, so that it can keep its columns up to date.
+
+const CFighterAnimator* CEntityStore::GetAnimator(EntityHandle h) const{
+  const int i = GetRow(h);
+  return i < 0? nullptr: &m_vAnimator[i];
+} //GetAnimator
+
+/// \return Number of entities, which is the length of every column.
+
+int CEntityStore::GetCount() const{
+  return (int)m_vHandle.size();
+} //GetCount
+
+const fixed* CEntityStore::GetPosX() const{return m_vPosX.data();}
+const fixed* CEntityStore::GetPosY() const{return m_vPosY.data();}
+const fixed* CEntityStore::GetPosZ() const{return m_vPosZ.data();}
+const fixed* CEntityStore::GetLastX() const{return m_vLastX.data();}
+const fixed* CEntityStore::GetLastY() const{return m_vLastY.data();}
+const signed char* CEntityStore::GetFacing() const{return m_vFacing.data();}
+const unsigned char* CEntityStore::GetActive() const{return m_vActive.data();}
+const int* CEntityStore::GetFrame() const{return m_vFrame.data();}
+const unsigned char* CEntityStore::GetState() const{return m_vState.data();}
+const int* CEntityStore::GetSprite() const{return m_vSprite.data();}
+
+/// Add every entity to a checksum, a column at a time in row order, so
+/// that two stores that differ in any entity almost certainly differ in
+/// checksum. The frame and state columns are copies of what is in the
+/// animators, so they are left out.
+/// \param c Checksum.
+
+void CEntityStore::AddToChecksum(CChecksum& c) const{
+  const int n = GetCount();
+  c.Add(n);
+
+  c.Add(m_vPosX.data(), n);
+  c.Add(m_vPosY.data(), n);
+  c.Add(m_vPosZ.data(), n);
+  c.Add(m_vLastX.data(), n);
+  c.Add(m_vLastY.data(), n);
+  c.Add(m_vVelY.data(), n);
+  c.Add(m_vFacing.data(), n);
+  c.Add(m_vActive.data(), n);
+  c.Add((const int*)m_vHandle.data(), n);
+
+  for(int i=0; i<n; i++)
+    m_vAnimator[i].AddToChecksum(c);
+} //AddToChecksum
@@ -0,0 +1,145 @@
+/// \file EntityStore.h
+/// \brief Interface for the entity store class CEntityStore.
+
+#pragma once
+
+#include <vector>
+
+#include "Fixed.h"
+#include "Checksum.h"
+#include "FighterAnimator.h"
+
+using namespace std;
+
+/// Handle to an entity. The low 16 bits are a slot number and the high 16
+/// bits are the generation of the slot, which changes each time the slot
+/// is reused, so that a handle to an entity that has been destroyed is
+/// never mistaken for one to whatever took its place.
+
+typedef unsigned EntityHandle;
+
+const EntityHandle NULL_ENTITY = 0; ///< Handle that is never valid.
+
+/// Teams of fighters. The right team faces left and the left team faces
+/// right, and each team can only walk as far as the other's front line.
+
+enum FighterTeam{
+  RIGHT_TEAM, LEFT_TEAM, NUM_TEAMS
+}; //FighterTeam
+
+/// Keys a team can press, as bits of an input mask. The keys pressed for
+/// a tick are gathered into one mask per team and applied at the start of
+/// the tick in the order of the bits, so that what happens depends only
+/// on the masks and not on exactly when the keys were pressed. That is
+/// what lets a tick be run again with the same result.
+
+enum FighterInput{
+  TAG_INPUT = 1, ///< Tag the next fighter.
+  LEFT_INPUT = 2, ///< Walk left.
+  RIGHT_INPUT = 4, ///< Walk right.
+  JUMP_INPUT = 8, ///< Jump.
+  PUNCH_INPUT = 16, ///< Punch.
+  KICK_INPUT = 32, ///< Kick.
+  NUM_INPUTS = 6 ///< Number of input bits.
+}; //FighterInput
+
+/// \brief The floor and walls of the arena, in fixed point.
+
+struct ArenaDesc{
+  fixed nMinX; ///< Left wall.
+  fixed nMaxX; ///< Right wall.
+  fixed nGap; ///< Closest that fighters on opposing teams can get.
+  fixed nGround; ///< Height of the floor.
+  fixed nApex; ///< Height at which a jump starts to fall.
+}; //ArenaDesc
+
+/// \brief What an entity is made from.
+
+struct EntityDesc{
+  fixed nX, nY, nZ; ///< Location, in fixed point.
+  int nFacing; ///< 1 to face right, -1 to face left.
+  int nSprite; ///< Sprite identifier.
+  bool bActive; ///< Whether it is in play.
+  FighterFrames cFrames; ///< Sprite frames.
+}; //EntityDesc
+
+/// \brief The entity store.
+///
+/// The entity store keeps the game's fighters as a structure of arrays,
+/// with a column for each component and a row for each entity. Rows are
+/// kept packed, so destroying an entity moves the last row into its place,
+/// and entities are referred to from outside by handle rather than by row.
+/// The update kernels each walk the few columns they need from start to
+/// finish, which keeps them in cache and lets the compiler vectorize them.
+/// Any number of entities can be on each team, and entities that are out
+/// of play, such as a tag-team partner waiting to come in, keep their row
+/// but are ignored by the rules for fighting and walking. Locations and
+/// speeds are in fixed point so that the simulation is deterministic.
+
+class CEntityStore{
+  private:
+    static const int SLOT_BITS = 16; ///< Bits of a handle that are the slot number.
+    static const unsigned SLOT_MASK = (1 << SLOT_BITS) - 1; ///< Mask for the slot number.
+
+    ArenaDesc m_cArena; ///< Floor and walls.
+
+    //component columns, one row per entity
+    vector<fixed> m_vPosX, m_vPosY, m_vPosZ; ///< Location.
+    vector<fixed> m_vLastX, m_vLastY; ///< Location at the start of the last tick.
+    vector<fixed> m_vVelY; ///< Vertical speed while jumping, per tick.
+    vector<signed char> m_vFacing; ///< 1 to face right, -1 to face left.
+    vector<unsigned char> m_vActive; ///< Nonzero if in play.
+    vector<int> m_vFrame; ///< Frame to draw.
+    vector<unsigned char> m_vState; ///< What the fighter is doing, a FighterState.
+    vector<int> m_vSprite; ///< Sprite identifier.
+    vector<CFighterAnimator> m_vAnimator; ///< Animation state machines.
+    vector<EntityHandle> m_vHandle; ///< Handle of each row.
+    vector<int> m_vAwake; ///< Rows to be animated this tick, scratch space.
+
+    //handle slots
+    vector<unsigned> m_vSlotRow; ///< Row of the entity in each slot.
+    vector<unsigned short> m_vSlotGeneration; ///< Current generation of each slot.
+    vector<unsigned> m_vFreeSlots; ///< Slots not in use.
+
+    void JumpRow(int i); ///< Move one row along its jump.
+    void Refresh(int i); ///< Copy frame and state out of a row's animator.
+    fixed GetFrontLine(int facing) const; ///< Nearest that a fighter facing this way can get.
+
+  public:
+    CEntityStore(); ///< Constructor.
+
+    void SetArena(const ArenaDesc& arena); ///< Set floor and walls.
+
+    EntityHandle Create(const EntityDesc& desc); ///< Make a new entity.
+    void Destroy(EntityHandle h); ///< Get rid of an entity.
+    void Clear(); ///< Get rid of all entities.
+    int GetRow(EntityHandle h) const; ///< Row of an entity, -1 if the handle is stale.
+    bool IsValid(EntityHandle h) const; ///< Whether a handle refers to an entity.
+
+    void Simulate(); ///< Advance every entity by one tick.
+    void BeginTick(); ///< Remember locations at the start of a tick.
+    void Jump(); ///< Move every airborne entity along its jump.
+    void Animate(); ///< Tick every animation state machine.
+
+    bool Walk(EntityHandle h, fixed dx); ///< Walk sideways.
+    bool Jump(EntityHandle h); ///< Start a jump.
+    bool Attack(EntityHandle h, FighterState attack); ///< Start a punch or kick.
+    bool Hit(EntityHandle attacker, EntityHandle defender); ///< Land an attack on an opponent.
+    void SetActive(EntityHandle h, bool active); ///< Put in or out of play.
+    void Tag(EntityHandle out, EntityHandle in); ///< Swap one fighter for another in the same place.
+    const CFighterAnimator* GetAnimator(EntityHandle h) const; ///< Animation state machine.
+
+    int GetCount() const; ///< Number of entities.
+    const fixed* GetPosX() const; ///< Column of X coordinates.
+    const fixed* GetPosY() const; ///< Column of Y coordinates.
+    const fixed* GetPosZ() const; ///< Column of Z coordinates.
+    const fixed* GetLastX() const; ///< Column of X coordinates at the start of the last tick.
+    const fixed* GetLastY() const; ///< Column of Y coordinates at the start of the last tick.
+    const signed char* GetFacing() const; ///< Column of facings.
+    const unsigned char* GetActive() const; ///< Column of in-play flags.
+    const int* GetFrame() const; ///< Column of frames to draw.
+    const unsigned char* GetState() const; ///< Column of fighter states.
+    const int* GetSprite() const; ///< Column of sprite identifiers.
+
+    void AddToChecksum(CChecksum& c) const; ///< Add every entity to a checksum.
+}; //CEntityStore
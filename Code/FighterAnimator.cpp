@@ -0,0 +1,184 @@
+/// \file FighterAnimator.cpp
+/// \brief Code for the fighter animation class CFighterAnimator.
+
+#include <string.h>
+
+#include "FighterAnimator.h"
+
+CFighterAnimator::CFighterAnimator(){
+  memset(&m_cFrames, 0, sizeof(FighterFrames));
+  m_eState = IDLE_STATE;
+  m_nTicks = 0;
+  m_nHitFrame = 0;
+  m_nHeight = 0;
+  m_bLanded = false;
+} //constructor
+
+/// \param frames Sprite frames for this fighter.
+
+void CFighterAnimator::SetFrames(const FighterFrames& frames){
+  m_cFrames = frames;
+} //SetFrames
+
+/// \param state New state.
+
+void CFighterAnimator::SetState(FighterState state){
+  m_eState = state;
+  m_nTicks = 0;
+  m_bLanded = false;
+} //SetState
+
+/// Finish a timed state by going back to idle, or to jumping if the
+/// fighter is still in the air.
+
+void CFighterAnimator::Settle(){
+  SetState(m_nHeight > 0? JUMP_STATE: IDLE_STATE);
+} //Settle
+
+/// Walking is allowed on the ground or in the air, but not while attacking
+/// or in hit-stun. Each step restarts the walk cycle, so the fighter stops
+/// walking soon after the steps stop coming.
+/// \return true if the fighter may take a step.
+
+bool CFighterAnimator::Walk(){
+  switch(m_eState){
+    case IDLE_STATE:
+    case WALK_STATE:
+      SetState(WALK_STATE);
+      return true;
+
+    case JUMP_STATE:
+      return true;
+
+    default: return false;
+  } //switch
+} //Walk
+
+/// A jump can only start from the ground.
+/// \return true if the fighter may jump.
+
+bool CFighterAnimator::Jump(){
+  if(m_nHeight > 0)return false;
+  if(m_eState != IDLE_STATE && m_eState != WALK_STATE)return false;
+
+  SetState(JUMP_STATE);
+  return true;
+} //Jump
+
+/// A punch can start on the ground or in the air, but not while another
+/// attack is under way or in hit-stun.
+/// \return true if the punch started.
+
+bool CFighterAnimator::Punch(){
+  if(m_eState == PUNCH_STATE || m_eState == KICK_STATE || m_eState == HIT_STATE)
+    return false;
+
+  SetState(PUNCH_STATE);
+  return true;
+} //Punch
+
+/// A kick can start on the ground or in the air, but not while another
+/// attack is under way or in hit-stun.
+/// \return true if the kick started.
+
+bool CFighterAnimator::Kick(){
+  if(m_eState == PUNCH_STATE || m_eState == KICK_STATE || m_eState == HIT_STATE)
+    return false;
+
+  SetState(KICK_STATE);
+  return true;
+} //Kick
+
+/// Being hit interrupts whatever the fighter was doing, and a second hit
+/// restarts the hit-stun.
+/// \param attack PUNCH_STATE or KICK_STATE, whichever the fighter was hit by.
+
+void CFighterAnimator::Hit(FighterState attack){
+  m_nHitFrame = attack == KICK_STATE? m_cFrames.nHitByKick: m_cFrames.nHitByPunch;
+  SetState(HIT_STATE);
+} //Hit
+
+/// An attack hits at most once, however many ticks its hitboxes go on
+/// overlapping someone, so once it has landed it stops striking.
+
+void CFighterAnimator::Land(){
+  m_bLanded = true;
+} //Land
+
+/// Advance by one tick of the fixed timestep. Timed states end when their
+/// time is up, and jumps end on landing.
+/// \param height Height of the fighter above the ground.
+
+void CFighterAnimator::Tick(fixed height){
+  m_nHeight = height;
+  m_nTicks++;
+
+  switch(m_eState){
+    case IDLE_STATE:
+      if(m_nHeight > 0)SetState(JUMP_STATE); //knocked into the air
+      break;
+
+    case WALK_STATE:
+      if(m_nHeight > 0)SetState(JUMP_STATE);
+      else if(m_nTicks >= WALK_TICKS)SetState(IDLE_STATE);
+      break;
+
+    case JUMP_STATE:
+      if(m_nHeight <= 0)SetState(IDLE_STATE); //landed
+      break;
+
+    case PUNCH_STATE: if(m_nTicks >= PUNCH_TICKS)Settle(); break;
+    case KICK_STATE: if(m_nTicks >= KICK_TICKS)Settle(); break;
+    case HIT_STATE: if(m_nTicks >= HIT_TICKS)Settle(); break;
+    default: break;
+  } //switch
+} //Tick
+
+/// Add everything that changes to a checksum. The frames never change,
+/// so they are left out.
+/// \param c Checksum.
+
+void CFighterAnimator::AddToChecksum(CChecksum& c) const{
+  c.Add(m_eState);
+  c.Add(m_nTicks);
+  c.Add(m_nHitFrame);
+  c.Add(m_nHeight);
+  c.Add(m_bLanded);
+} //AddToChecksum
+
+/// \return The current state.
+
+FighterState CFighterAnimator::GetState() const{
+  return m_eState;
+} //GetState
+
+/// \return true if the fighter is punching or kicking and hasn't hit anyone yet.
+
+bool CFighterAnimator::IsStriking() const{
+  return (m_eState == PUNCH_STATE || m_eState == KICK_STATE) && !m_bLanded;
+} //IsStriking
+
+/// Get the frame to draw for the current state.
+/// \return Frame number.
+
+int CFighterAnimator::GetFrame() const{
+  switch(m_eState){
+    case WALK_STATE: return m_cFrames.nWalk[2*m_nTicks/WALK_TICKS];
+    case JUMP_STATE: return m_nHeight > HIGH_JUMP? m_cFrames.nJumpHigh: m_cFrames.nJumpLow;
+    case PUNCH_STATE: return m_cFrames.nPunch;
+    case KICK_STATE: return m_cFrames.nKick;
+    case HIT_STATE: return m_nHitFrame;
+    default: return m_cFrames.nIdle;
+  } //switch
+} //GetFrame
+
+/// Get the name of a state, for debug output.
+/// \param state A state.
+/// \return Name of the state.
+
+const char* CFighterAnimator::GetStateName(FighterState state){
+  static const char* szName[NUM_FIGHTER_STATES] = {
+    "idle", "walk", "jump", "punch", "kick", "hit"};
+
+  return state >= 0 && state < NUM_FIGHTER_STATES? szName[state]: "unknown";
+} //GetStateName
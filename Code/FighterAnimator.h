@@ -0,0 +1,79 @@
+/// \file FighterAnimator.h
+/// \brief Interface for the fighter animation class CFighterAnimator.
+
+#pragma once
+
+#include "Fixed.h"
+#include "Checksum.h"
+
+/// \brief What a fighter is doing.
+
+enum FighterState{
+  IDLE_STATE, WALK_STATE, JUMP_STATE, PUNCH_STATE, KICK_STATE, HIT_STATE,
+  NUM_FIGHTER_STATES
+}; //FighterState
+
+/// \brief Sprite frames used by a fighter.
+///
+/// Frame numbers are indices into the frame cache, so that changing
+/// animation is just a matter of drawing a different frame.
+
+struct FighterFrames{
+  int nIdle; ///< Standing still.
+  int nWalk[2]; ///< Walk cycle.
+  int nJumpLow; ///< In the air, near the ground.
+  int nJumpHigh; ///< In the air, high up.
+  int nPunch; ///< Punching.
+  int nKick; ///< Kicking.
+  int nHitByPunch; ///< Reeling from a punch.
+  int nHitByKick; ///< Reeling from a kick.
+}; //FighterFrames
+
+/// \brief The fighter animator.
+///
+/// The fighter animator is a state machine that decides which frame a
+/// fighter is showing and which inputs it will accept. Inputs change state
+/// at once, and the state machine is advanced by one tick of the fixed
+/// timestep at a time, so an attack or a hit lasts a fixed number of ticks
+/// without ever holding up the game loop. A fighter that is punching,
+/// kicking, or reeling from a hit ignores its own inputs until it has
+/// finished, but the other fighter carries on as usual.
+
+class CFighterAnimator{
+  private:
+    static const int WALK_TICKS = 8; ///< Length of the walk cycle.
+    static const int PUNCH_TICKS = 16; ///< Length of a punch.
+    static const int KICK_TICKS = 16; ///< Length of a kick.
+    static const int HIT_TICKS = 14; ///< Length of hit-stun.
+    static const fixed HIGH_JUMP = 15*FIXED_ONE; ///< Height above which the high jump frame is shown.
+
+    FighterFrames m_cFrames; ///< Sprite frames.
+    FighterState m_eState; ///< Current state.
+    int m_nTicks; ///< Ticks spent in the current state.
+    int m_nHitFrame; ///< Frame to show while in hit-stun.
+    fixed m_nHeight; ///< Height above the ground at the last tick.
+    bool m_bLanded; ///< Whether the current attack has hit anyone yet.
+
+    void SetState(FighterState state); ///< Change state.
+    void Settle(); ///< Go back to idle or jumping.
+
+  public:
+    CFighterAnimator(); ///< Constructor.
+
+    void SetFrames(const FighterFrames& frames); ///< Set the sprite frames.
+
+    bool Walk(); ///< Start or continue walking.
+    bool Jump(); ///< Start a jump.
+    bool Punch(); ///< Start a punch.
+    bool Kick(); ///< Start a kick.
+    void Hit(FighterState attack); ///< Take a hit from a punch or kick.
+    void Land(); ///< Note that the current attack has hit.
+
+    void Tick(fixed height); ///< Advance by one simulation tick.
+    void AddToChecksum(CChecksum& c) const; ///< Add state to a checksum.
+
+    FighterState GetState() const; ///< Current state.
+    bool IsStriking() const; ///< Whether an attack is under way and has yet to hit.
+    int GetFrame() const; ///< Frame to draw.
+    static const char* GetStateName(FighterState state); ///< Name of a state.
+}; //CFighterAnimator
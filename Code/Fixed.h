@@ -0,0 +1,71 @@
+/// \file Fixed.h
+/// \brief Fixed-point arithmetic for the simulation.
+///
+/// The simulation keeps every location, velocity and distance as a 16.16
+/// fixed-point number, that is, an int that counts 65536ths of a pixel.
+/// Integer arithmetic gives exactly the same answer on every compiler,
+/// CPU and set of floating-point flags, so a sequence of inputs always
+/// plays out the same, which replays and lockstep networking depend on.
+/// Floating point is only used on the way in, to convert numbers read from
+/// settings files, and on the way out, to hand locations to the renderer,
+/// and never feeds back into the simulation. Angles are binary angles,
+/// with 65536 to a full turn, and sines and cosines come from a table
+/// rather than from the C library.
+
+#pragma once
+
+#include <math.h>
+
+typedef int fixed; ///< A 16.16 fixed-point number.
+
+const int FIXED_SHIFT = 16; ///< Number of fraction bits.
+const fixed FIXED_ONE = 1 << FIXED_SHIFT; ///< 1.0 in fixed point.
+const int ANGLE_TURN = 1 << 16; ///< Binary angle for a full turn.
+
+/// \param n An integer.
+/// \return The same number in fixed point.
+
+inline fixed IntToFixed(int n){
+  return n*FIXED_ONE;
+} //IntToFixed
+
+/// Convert a float to fixed point, rounding to the nearest 65536th. This
+/// is for numbers read from files when loading, and gives the same answer
+/// everywhere, since multiplying by a power of 2 and rounding are exact.
+/// \param f A float.
+/// \return The nearest fixed-point number.
+
+inline fixed FloatToFixed(float f){
+  return (fixed)floor((double)f*FIXED_ONE + 0.5);
+} //FloatToFixed
+
+/// Convert to floating point for the renderer. The result must never go
+/// back into the simulation.
+/// \param n A fixed-point number.
+/// \return The nearest float.
+
+inline float FixedToFloat(fixed n){
+  return (float)n/(float)FIXED_ONE;
+} //FixedToFloat
+
+/// Multiply, rounding towards minus infinity.
+/// \param a A fixed-point number.
+/// \param b Another.
+/// \return Their product.
+
+inline fixed FixedMul(fixed a, fixed b){
+  const long long p = (long long)a*b;
+  return (fixed)(p >= 0? p >> FIXED_SHIFT: ~(~p >> FIXED_SHIFT)); //no implementation-defined shifts
+} //FixedMul
+
+/// Divide, rounding towards zero.
+/// \param a A fixed-point number.
+/// \param b Another, which mustn't be zero.
+/// \return a divided by b.
+
+inline fixed FixedDiv(fixed a, fixed b){
+  return (fixed)((long long)a*FIXED_ONE/b);
+} //FixedDiv
+
+fixed FixedSin(int angle); ///< Sine of a binary angle.
+fixed FixedCos(int angle); ///< Cosine of a binary angle.
@@ -0,0 +1,117 @@
+/// \file FixedTimestep.cpp
+/// \brief Code for the fixed timestep class CFixedTimestep.
+
+#include <string.h>
+
+#include "FixedTimestep.h"
+
+/// Zero all counts.
+
+void TimestepStats::Clear(){
+  memset(this, 0, sizeof(TimestepStats));
+} //Clear
+
+/// \param rate Simulation ticks per second.
+/// \param maxticks Most ticks to run in one frame when catching up.
+
+CFixedTimestep::CFixedTimestep(int rate, int maxticks):
+  m_nTickLength(1000000/(rate > 0? rate: 60)), m_nMaxTicks(maxticks > 0? maxticks: 1)
+{
+  Reset();
+  m_cStats.Clear();
+} //constructor
+
+/// Start again with nothing accumulated, for example after a pause, so
+/// that the time spent paused isn't simulated.
+
+void CFixedTimestep::Reset(){
+  m_nLastTime = 0;
+  m_nAccumulator = 0;
+  m_bStarted = false;
+} //Reset
+
+/// Add the real time that has passed since the last call to the
+/// accumulator, and take as many whole ticks out of it as there are,
+/// up to the maximum. The first call after a reset only starts the clock.
+/// \param now Current time in microseconds.
+/// \return Number of ticks that the caller should run now.
+
+int CFixedTimestep::Advance(long long now){
+  if(!m_bStarted){
+    m_bStarted = true;
+    m_nLastTime = now;
+    return 0;
+  } //if
+
+  if(now > m_nLastTime)
+    m_nAccumulator += now - m_nLastTime;
+  m_nLastTime = now;
+
+  int ticks = (int)(m_nAccumulator/m_nTickLength);
+
+  if(ticks > m_nMaxTicks){ //too far behind, drop the excess
+    m_cStats.nSpiralFrames++;
+    m_cStats.nDroppedTicks += ticks - m_nMaxTicks;
+    ticks = m_nMaxTicks;
+    m_nAccumulator = ticks*m_nTickLength + m_nAccumulator%m_nTickLength;
+  } //if
+
+  m_nAccumulator -= ticks*m_nTickLength;
+
+  if(ticks > 1)
+    m_cStats.nCatchUpFrames++;
+
+  return ticks;
+} //Advance
+
+/// Get how far the simulation has got towards the next tick, for
+/// interpolating between the positions at the last two ticks.
+/// \return Fraction of a tick, from 0 to 1.
+
+float CFixedTimestep::GetAlpha() const{
+  return (float)m_nAccumulator/m_nTickLength;
+} //GetAlpha
+
+/// Get how long it will be until the next tick is due, as of the last
+/// call to Advance.
+/// \return Time in microseconds.
+
+long long CFixedTimestep::GetTimeToNextTick() const{
+  return m_nTickLength - m_nAccumulator;
+} //GetTimeToNextTick
+
+/// Get the length of a tick.
+/// \return Length of a tick in microseconds.
+
+long long CFixedTimestep::GetTickLength() const{
+  return m_nTickLength;
+} //GetTickLength
+
+/// Get the tick rate.
+/// \return Ticks per second.
+
+int CFixedTimestep::GetTickRate() const{
+  return (int)(1000000/m_nTickLength);
+} //GetTickRate
+
+/// Count a tick and its cost.
+/// \param t Time taken by the tick in microseconds.
+
+void CFixedTimestep::RecordTick(long long t){
+  m_cStats.nTicks++;
+  m_cStats.nTickTime += t;
+  if(t > m_cStats.nMaxTickTime)m_cStats.nMaxTickTime = t;
+} //RecordTick
+
+/// Get the counts since they were last reset.
+/// \return Counts.
+
+const TimestepStats& CFixedTimestep::GetStats() const{
+  return m_cStats;
+} //GetStats
+
+/// Zero the counts.
+
+void CFixedTimestep::ResetStats(){
+  m_cStats.Clear();
+} //ResetStats
@@ -0,0 +1,58 @@
+/// \file FixedTimestep.h
+/// \brief Interface for the fixed timestep class CFixedTimestep.
+
+#pragma once
+
+/// \brief Counts kept by the fixed timestep.
+///
+/// Times are in microseconds, and are the cost of running the simulation.
+/// Frames here are passes through the game loop, which may run any number
+/// of ticks each.
+
+struct TimestepStats{
+  int nTicks; ///< Simulation ticks run.
+  int nCatchUpFrames; ///< Frames that had to run more than one tick.
+  int nSpiralFrames; ///< Frames that fell so far behind that time was dropped.
+  int nDroppedTicks; ///< Ticks' worth of time dropped.
+  long long nTickTime; ///< Total time spent in ticks.
+  long long nMaxTickTime; ///< Longest tick.
+
+  void Clear(); ///< Zero all counts.
+}; //TimestepStats
+
+/// \brief The fixed timestep.
+///
+/// The fixed timestep decouples the simulation from the frame rate. Real
+/// time that passes between frames is added to an accumulator, and the
+/// simulation is run one fixed-length tick at a time for as long as there
+/// is a whole tick in the accumulator. What is left over is how far the
+/// next tick has got, which rendering uses to interpolate between the
+/// positions at the last two ticks. If a frame falls so far behind that
+/// it would need more than a maximum number of ticks to catch up, the
+/// excess time is dropped so that the game slows down rather than
+/// spending ever longer catching up.
+
+class CFixedTimestep{
+  private:
+    long long m_nTickLength; ///< Length of a tick in microseconds.
+    int m_nMaxTicks; ///< Most ticks to run in one frame.
+    long long m_nLastTime; ///< Time of last call to Advance, in microseconds.
+    long long m_nAccumulator; ///< Time not yet simulated, in microseconds.
+    bool m_bStarted; ///< Whether Advance has been called since Reset.
+
+    TimestepStats m_cStats; ///< Counts since the last ResetStats.
+
+  public:
+    CFixedTimestep(int rate=60, int maxticks=5); ///< Constructor.
+
+    void Reset(); ///< Start again with nothing accumulated.
+    int Advance(long long now); ///< Number of ticks to run this frame.
+    float GetAlpha() const; ///< How far the next tick has got.
+    long long GetTimeToNextTick() const; ///< Time until the next tick is due.
+    long long GetTickLength() const; ///< Length of a tick in microseconds.
+    int GetTickRate() const; ///< Ticks per second.
+
+    void RecordTick(long long t); ///< Count the cost of a tick.
+    const TimestepStats& GetStats() const; ///< Counts since the last ResetStats.
+    void ResetStats(); ///< Zero the counts.
+}; //CFixedTimestep
@@ -0,0 +1,304 @@
+/// \file FrameCache.cpp
+/// \brief Code for the sprite frame cache class CFrameCache.
+
+#include "FrameCache.h"
+#include "gamerenderer.h"
+#include "debug.h"
+#include "Profiler.h"
+
+extern CGameRenderer GameRenderer;
+
+CFrameCache::CFrameCache(): m_nLiveResources(0), m_bPlaceholders(FALSE){
+} //constructor
+
+CFrameCache::~CFrameCache(){
+  Release();
+} //destructor
+
+/// Get the entry for a frame in the frame array, growing the array
+/// with empty frames if it isn't big enough yet.
+/// \param index Index of image in image file name list.
+/// \return Reference to the frame array entry.
+
+SpriteFrame& CFrameCache::GetSlot(int index){
+  if(index >= (int)m_vFrames.size()){ //grow frame array, nulled out
+    SpriteFrame blank = {nullptr, 0, 0, 0.0f, 0.0f, 1.0f, 1.0f, FALSE};
+    m_vFrames.resize(index + 1, blank);
+  } //if
+
+  return m_vFrames[index];
+} //GetSlot
+
+/// Create an empty atlas texture that frames can be copied into.
+/// \param w Width of atlas.
+/// \param h Height of atlas.
+/// \param fmt Pixel format, which must match that of the frames.
+/// \return Pointer to shader resource view of atlas, nullptr on failure.
+
+ID3D11ShaderResourceView* CFrameCache::CreateAtlas(int w, int h, DXGI_FORMAT fmt){
+  D3D11_TEXTURE2D_DESC desc;
+  desc.Width = w;
+  desc.Height = h;
+  desc.MipLevels = 1;
+  desc.ArraySize = 1;
+  desc.Format = fmt;
+  desc.SampleDesc.Count = 1;
+  desc.SampleDesc.Quality = 0;
+  desc.Usage = D3D11_USAGE_DEFAULT;
+  desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+  desc.CPUAccessFlags = 0;
+  desc.MiscFlags = 0;
+
+  ID3D11Texture2D* pTexture = nullptr;
+  if(FAILED(GameRenderer.m_pDev2->CreateTexture2D(&desc, nullptr, &pTexture)))
+    return nullptr;
+
+  ID3D11ShaderResourceView* pView = nullptr;
+  GameRenderer.m_pDev2->CreateShaderResourceView(pTexture, nullptr, &pView);
+  SAFE_RELEASE(pTexture); //the view holds a reference
+
+  return pView;
+} //CreateAtlas
+
+/// Release the cache's reference to a texture that it owns, and count the
+/// texture as gone only if that was the last reference, so that a texture
+/// still held elsewhere (for example, still bound to the device context)
+/// is still counted as live.
+/// \param p Texture, set to nullptr.
+
+void CFrameCache::ReleaseTexture(ID3D11ShaderResourceView*& p){
+  if(p && p->Release() == 0)
+    m_nLiveResources--;
+  p = nullptr;
+} //ReleaseTexture
+
+/// Whether a pixel format is block compressed, so that copies into it
+/// must be aligned to 4 by 4 blocks.
+/// \param fmt Pixel format.
+/// \return TRUE if the format is BC1 through BC7.
+
+static BOOL IsBlockCompressed(DXGI_FORMAT fmt){
+  return (fmt >= DXGI_FORMAT_BC1_TYPELESS && fmt <= DXGI_FORMAT_BC5_SNORM) ||
+    (fmt >= DXGI_FORMAT_BC6H_TYPELESS && fmt <= DXGI_FORMAT_BC7_UNORM_SRGB);
+} //IsBlockCompressed
+
+/// Load frames into atlas textures as laid out in a manifest written by the
+/// atlas packer. Each frame image is decoded, unless it has already been
+/// inserted by the asset loader, and copied into its rectangle
+/// in the atlas on the GPU. Frames that can't be placed in an atlas (for
+/// example, because their pixel format differs from that of the atlas, or
+/// because they are block compressed and not aligned to blocks)
+/// are left for Load to give their own texture.
+/// \param fname File name of atlas manifest.
+/// \return TRUE if the manifest was found and loaded.
+
+BOOL CFrameCache::LoadAtlases(const char* fname){
+  PROFILE_ZONE("CFrameCache::LoadAtlases");
+  tinyxml2::XMLDocument doc;
+  if(doc.LoadFile(fname) != 0)return FALSE; //no manifest, no atlases
+
+  XMLElement* root = doc.FirstChildElement("atlases");
+  if(root == nullptr)return FALSE; //bail and fail
+
+  for(XMLElement* atlas = root->FirstChildElement("atlas"); atlas;
+    atlas = atlas->NextSiblingElement("atlas"))
+  {
+    const int w = atlas->IntAttribute("width");
+    const int h = atlas->IntAttribute("height");
+    if(w <= 0 || h <= 0)continue; //bad atlas
+
+    ID3D11Resource* pAtlasResource = nullptr;
+    ID3D11ShaderResourceView* pAtlas = nullptr;
+
+    for(XMLElement* tag = atlas->FirstChildElement("frame"); tag;
+      tag = tag->NextSiblingElement("frame"))
+    {
+      const int index = tag->IntAttribute("index");
+      const char* src = tag->Attribute("src");
+      if(index < 0 || src == nullptr)continue; //bad frame
+
+      SpriteFrame& frame = GetSlot(index);
+      if(frame.bInAtlas)continue; //already loaded
+
+      //decode the frame image, or take the one that's already been inserted
+      ID3D11ShaderResourceView* pImage = nullptr;
+      int width, ht;
+      const BOOL inserted = frame.pTexture != nullptr;
+
+      if(inserted){
+        pImage = frame.pTexture;
+        pImage->AddRef();
+        width = frame.nWidth;
+        ht = frame.nHeight;
+      } //if
+      else GameRenderer.LoadTexture(pImage, (char*)src, &width, &ht);
+
+      if(pImage == nullptr)continue; //Load will complain about this one
+
+      ID3D11Resource* pImageResource = nullptr;
+      D3D11_TEXTURE2D_DESC desc;
+      pImage->GetResource(&pImageResource);
+      ((ID3D11Texture2D*)pImageResource)->GetDesc(&desc);
+
+      //the first frame decides the atlas format
+      if(pAtlas == nullptr){
+        pAtlas = CreateAtlas(w, h, desc.Format);
+        if(pAtlas == nullptr){
+          SAFE_RELEASE(pImageResource);
+          SAFE_RELEASE(pImage);
+          break; //give up on this atlas
+        } //if
+
+        pAtlas->GetResource(&pAtlasResource);
+        m_vAtlases.push_back(pAtlas);
+        m_nLiveResources++;
+      } //if
+
+      //copy top mip level into its place in the atlas
+      const int x = tag->IntAttribute("x");
+      const int y = tag->IntAttribute("y");
+      D3D11_SHADER_RESOURCE_VIEW_DESC atlasdesc;
+      pAtlas->GetDesc(&atlasdesc);
+
+      const BOOL aligned = !IsBlockCompressed(desc.Format) ||
+        (x%4 == 0 && y%4 == 0 && width%4 == 0 && ht%4 == 0);
+
+      if(desc.Format == atlasdesc.Format && aligned && x >= 0 && y >= 0 &&
+        x + width <= w && y + ht <= h)
+      {
+        GameRenderer.m_pDC2->CopySubresourceRegion(pAtlasResource, 0, x, y, 0,
+          pImageResource, 0, nullptr);
+
+        if(inserted){ //the atlas replaces the frame's own texture
+          SAFE_RELEASE(pImage); //so that the frame holds the last reference
+          ReleaseTexture(frame.pTexture);
+        } //if
+
+        frame.pTexture = pAtlas;
+        frame.nWidth = width;
+        frame.nHeight = ht;
+        frame.fU0 = (float)x/w;
+        frame.fV0 = (float)y/h;
+        frame.fU1 = (float)(x + width)/w;
+        frame.fV1 = (float)(y + ht)/h;
+        frame.bInAtlas = TRUE;
+      } //if
+
+      SAFE_RELEASE(pImageResource);
+      SAFE_RELEASE(pImage);
+    } //for
+
+    SAFE_RELEASE(pAtlasResource);
+  } //for
+
+  return TRUE;
+} //LoadAtlases
+
+/// Decode a range of images from the image file name list into textures.
+/// Frames that are already loaded,
+/// including those placed in atlases by LoadAtlases, are left alone, so it
+/// is safe to call this more than once.
+/// \param list Image file name list.
+/// \param first Index of first image to load.
+/// \param last Index of last image to load.
+/// \return TRUE if every image in the range was loaded.
+
+BOOL CFrameCache::Load(CImageFileNameList& list, int first, int last){
+  BOOL success = TRUE;
+
+  for(int i=first; i<=last; i++){
+    SpriteFrame& frame = GetSlot(i);
+    if(frame.pTexture)continue; //already loaded
+
+    GameRenderer.LoadTexture(frame.pTexture, list[i], &frame.nWidth, &frame.nHeight);
+    if(frame.pTexture == nullptr){ //bail on this one
+      DEBUGPRINTF("Cannot load frame %d from %s.\n", i, list[i]);
+      success = FALSE; continue;
+    } //if
+    m_nLiveResources++;
+  } //for
+
+  return success;
+} //Load
+
+/// Add a frame whose texture has been created elsewhere, for example from
+/// pixels decoded by the asset loader. The cache takes ownership of the
+/// texture. If the frame is already loaded, the new texture is released.
+/// \param index Index of image in image file name list.
+/// \param texture Texture containing the frame image.
+/// \param w Width of frame image in pixels.
+/// \param h Height of frame image in pixels.
+
+void CFrameCache::Insert(int index, ID3D11ShaderResourceView* texture, int w, int h){
+  if(index < 0 || texture == nullptr)return; //bad frame
+
+  SpriteFrame& frame = GetSlot(index);
+
+  if(frame.pTexture){ //already loaded
+    SAFE_RELEASE(texture);
+    return;
+  } //if
+
+  frame.pTexture = texture;
+  frame.nWidth = w;
+  frame.nHeight = h;
+  m_nLiveResources++;
+} //Insert
+
+/// Add placeholder frames that have a size but no texture, for running
+/// headless, when there is no device to create textures with.
+/// \param first Index of first frame.
+/// \param last Index of last frame.
+/// \param w Width of each frame in pixels.
+/// \param h Height of each frame in pixels.
+
+void CFrameCache::LoadPlaceholders(int first, int last, int w, int h){
+  for(int i=first; i<=last; i++){
+    SpriteFrame& frame = GetSlot(i);
+    frame.nWidth = w;
+    frame.nHeight = h;
+  } //for
+
+  m_bPlaceholders = TRUE;
+} //LoadPlaceholders
+
+/// Get a frame by its index in the image file name list.
+/// \param index Index of image in image file name list.
+/// \return Pointer to the frame, nullptr if that frame is not loaded.
+
+const SpriteFrame* CFrameCache::GetFrame(int index){
+  if(index < 0 || index >= (int)m_vFrames.size())return nullptr;
+  if(m_vFrames[index].pTexture == nullptr && !m_bPlaceholders)return nullptr;
+  return &m_vFrames[index];
+} //GetFrame
+
+/// Get the number of textures owned by the cache that have not been
+/// destroyed. This should be zero after Release, unless something else
+/// still holds a reference to one of them.
+/// \return Number of live textures.
+
+int CFrameCache::GetLiveResourceCount(){
+  return m_nLiveResources;
+} //GetLiveResourceCount
+
+/// Release the textures of all frames, and the atlases.
+
+void CFrameCache::Release(){
+  for(int i=0; i<(int)m_vFrames.size(); i++){
+    SpriteFrame& frame = m_vFrames[i];
+
+    if(frame.bInAtlas) //atlas is released below
+      frame.pTexture = nullptr;
+    else ReleaseTexture(frame.pTexture);
+  } //for
+
+  for(int i=0; i<(int)m_vAtlases.size(); i++)
+    ReleaseTexture(m_vAtlases[i]);
+
+  m_vFrames.clear();
+  m_vAtlases.clear();
+  m_bPlaceholders = FALSE;
+
+  if(m_nLiveResources != 0)
+    DEBUGPRINTF("Frame cache leaked %d resources.\n", m_nLiveResources);
+} //Release
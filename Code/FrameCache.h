@@ -0,0 +1,62 @@
+/// \file FrameCache.h
+/// \brief Interface for the sprite frame cache class CFrameCache.
+
+#pragma once
+
+#include <vector>
+
+#include "defines.h"
+#include "imagefilenamelist.h"
+
+/// \brief A decoded sprite frame.
+///
+/// A sprite frame is a rectangle within a texture. The texture is either the
+/// frame's own image or an atlas shared with other frames, and is owned by
+/// the frame cache.
+
+struct SpriteFrame{
+  ID3D11ShaderResourceView* pTexture; ///< Texture containing the frame image.
+  int nWidth; ///< Width of frame image in pixels.
+  int nHeight; ///< Height of frame image in pixels.
+  float fU0, fV0; ///< Texture coordinates of top left corner of frame.
+  float fU1, fV1; ///< Texture coordinates of bottom right corner of frame.
+  BOOL bInAtlas; ///< TRUE if the texture is an atlas owned by the cache.
+}; //SpriteFrame
+
+/// \brief The sprite frame cache.
+///
+/// The frame cache decodes each image in the image file name list once, at
+/// startup, and keeps the resulting texture resident for the rest of the
+/// game. Frames are looked up by their index in the image
+/// file name list, so switching a sprite from one animation frame to another
+/// is an array lookup rather than a trip to the disk and the image decoder.
+/// If an atlas manifest made by the atlas packer is available, frames are
+/// copied into shared atlas textures and differ only in their texture
+/// coordinates, so switching frames doesn't change the texture either.
+/// The cache also counts the textures it owns that are still alive, that is,
+/// whose last reference has not yet been released, so that anything still
+/// holding one at shutdown shows up as a leak.
+
+class CFrameCache{
+  private:
+    vector<SpriteFrame> m_vFrames; ///< Frames, indexed by image file name index.
+    vector<ID3D11ShaderResourceView*> m_vAtlases; ///< Atlas textures.
+    int m_nLiveResources; ///< Number of owned textures not yet destroyed.
+    BOOL m_bPlaceholders; ///< TRUE if frames have sizes but no textures.
+
+    SpriteFrame& GetSlot(int index); ///< Get frame array entry, growing if needed.
+    ID3D11ShaderResourceView* CreateAtlas(int w, int h, DXGI_FORMAT fmt); ///< Create empty atlas texture.
+    void ReleaseTexture(ID3D11ShaderResourceView*& p); ///< Release an owned texture.
+
+  public:
+    CFrameCache(); ///< Constructor.
+    ~CFrameCache(); ///< Destructor.
+
+    BOOL LoadAtlases(const char* fname); ///< Load frames into atlases from manifest.
+    BOOL Load(CImageFileNameList& list, int first, int last); ///< Load a range of frames.
+    void Insert(int index, ID3D11ShaderResourceView* texture, int w, int h); ///< Add a loaded frame.
+    void LoadPlaceholders(int first, int last, int w, int h); ///< Add frames without textures.
+    const SpriteFrame* GetFrame(int index); ///< Get a frame by image index.
+    int GetLiveResourceCount(); ///< Number of owned textures not yet destroyed.
+    void Release(); ///< Release all frames.
+}; //CFrameCache
@@ -0,0 +1,85 @@
+/// \file GameLoop.cpp
+/// \brief Code for the game loop class CGameLoop.
+
+#include "GameLoop.h"
+
+/// \param platform Where events and time come from.
+/// \param timestep Decides when ticks are run, and counts their cost.
+/// \param timer Real clock for measuring costs. Tick times go in its tick histogram.
+
+CGameLoop::CGameLoop(CPlatform& platform, CFixedTimestep& timestep, CTimer& timer):
+  m_cPlatform(platform), m_cTimestep(timestep), m_cTimer(timer), m_nFrames(0)
+{
+} //constructor
+
+/// Run the game loop until the platform delivers a quit event. Each pass
+/// handles every event that is waiting, runs as many ticks as the time
+/// on the platform clock calls for, and then waits until the next tick is
+/// due, waking early for any event. While the game isn't the active
+/// application it runs no ticks and waits for an event, and the timestep
+/// is reset so that the time spent waiting isn't simulated. If there is
+/// something that mustn't wait that long, such as an online match, the
+/// idle callback says so, and is called again a tick later if no event
+/// comes in first.
+/// \param key Called for each key press, returns true for the game to exit.
+/// \param tick Called to run a simulation tick.
+/// \param frame Called after the ticks on each pass while active.
+/// \param idle Called on each pass while inactive, or nullptr for none.
+
+void CGameLoop::Run(const GameKeyCallback& key, const GameTickCallback& tick,
+  const GameFrameCallback& frame, const GameIdleCallback& idle)
+{
+  PlatformEvent e;
+
+  while(true){
+    while(m_cPlatform.PollEvent(e)){
+      if(e.eType == QUIT_EVENT)return;
+
+      if(e.eType == KEY_DOWN_EVENT){
+        const long long t0 = m_cTimer.microseconds();
+        const bool quit = key(e.nKey, e.nTime);
+        m_cKeyTimes.Record(m_cTimer.microseconds() - t0);
+        if(quit)m_cPlatform.Quit();
+      } //if
+    } //while
+
+    if(!m_cPlatform.IsActive()){
+      m_cTimestep.Reset(); //don't simulate the time spent inactive
+
+      if(idle && idle()) //wake for it a tick from now
+        m_cPlatform.WaitForEvent(m_cPlatform.Now() + m_cTimestep.GetTickLength());
+      else m_cPlatform.WaitForEvent(-1);
+      continue;
+    } //if
+
+    const long long now = m_cPlatform.Now();
+    const int ticks = m_cTimestep.Advance(now);
+
+    for(int i=0; i<ticks; i++){
+      const long long t0 = m_cTimer.microseconds();
+      tick();
+      const long long t = m_cTimer.microseconds() - t0;
+      m_cTimestep.RecordTick(t);
+      m_cTimer.ticks().Record(t);
+    } //for
+
+    //time the last tick was due is what's left over subtracted from now
+    const long long wait = m_cTimestep.GetTimeToNextTick();
+    frame(ticks, now - (m_cTimestep.GetTickLength() - wait));
+    m_nFrames++;
+
+    m_cPlatform.WaitForEvent(now + wait);
+  } //while
+} //Run
+
+/// \return Histogram of the time taken to handle each key press, in microseconds.
+
+CTimeHistogram& CGameLoop::GetKeyTimes(){
+  return m_cKeyTimes;
+} //GetKeyTimes
+
+/// \return Number of passes through the loop while active.
+
+int CGameLoop::GetFrameCount() const{
+  return m_nFrames;
+} //GetFrameCount
@@ -0,0 +1,59 @@
+/// \file GameLoop.h
+/// \brief Interface for the game loop class CGameLoop.
+
+#pragma once
+
+#include <functional>
+
+#include "Platform.h"
+#include "FixedTimestep.h"
+#include "Timer.h"
+
+using namespace std;
+
+/// Callback for a key press, given its key code and the time it was
+/// pressed in microseconds. Returns true if the game is to exit.
+
+typedef function<bool(int key, long long t)> GameKeyCallback;
+
+/// Callback for a simulation tick.
+
+typedef function<void()> GameTickCallback;
+
+/// Callback for the end of a pass through the game loop, given the number
+/// of ticks run and the time the last of them was due in microseconds.
+
+typedef function<void(int ticks, long long t)> GameFrameCallback;
+
+/// Callback for a pass through the game loop while the game isn't the
+/// active application. Returns true if it is to be called again a tick
+/// later, false if the loop can wait for an event.
+
+typedef function<bool()> GameIdleCallback;
+
+/// \brief The game loop.
+///
+/// The game loop takes events from the platform, runs simulation ticks on
+/// a fixed timestep against the platform clock, and waits on the platform
+/// until the next tick is due or an event comes in. It knows nothing about
+/// the game itself, which it reaches through callbacks, or about the
+/// platform it runs on. The cost of each tick and each key press is
+/// measured on a real clock, whatever the platform clock is.
+
+class CGameLoop{
+  private:
+    CPlatform& m_cPlatform; ///< Where events and time come from.
+    CFixedTimestep& m_cTimestep; ///< Decides when ticks are run.
+    CTimer& m_cTimer; ///< Real clock for measuring costs, with the tick histogram.
+    CTimeHistogram m_cKeyTimes; ///< Time taken to handle key presses.
+    int m_nFrames; ///< Passes through the loop.
+
+  public:
+    CGameLoop(CPlatform& platform, CFixedTimestep& timestep, CTimer& timer); ///< Constructor.
+
+    void Run(const GameKeyCallback& key, const GameTickCallback& tick,
+      const GameFrameCallback& frame, const GameIdleCallback& idle=nullptr); ///< Run until the platform says quit.
+
+    CTimeHistogram& GetKeyTimes(); ///< Histogram of key press handling times.
+    int GetFrameCount() const; ///< Passes through the loop.
+}; //CGameLoop
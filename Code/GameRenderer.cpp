@@ -11,18 +11,31 @@
 #include "imagefilenamelist.h"
 #include "debug.h"
 #include "sprite.h"
-#include "object.h"
+#include "EntityStore.h"
+#include "FrameCache.h"
+#include "ShaderCache.h"
+#include "Profiler.h"
 
 extern int g_nScreenWidth;
 extern int g_nScreenHeight;
-extern BOOL g_bWireFrame;
 extern CImageFileNameList g_cImageFileName;
-extern C3DSprite* g_pPlaneSprite;
-extern CGameObject* g_pPlane; 
-extern C3DSprite* g_pPlaneSprite2;
-extern CGameObject* g_pPlane2;
-BOOL KeyboardHandler(WPARAM keystroke);
-CGameRenderer::CGameRenderer(): m_bCameraDefaultMode(TRUE){
+extern C3DSprite* g_pFighterSprite[NUM_TEAMS];
+extern CFrameCache g_cFrameCache;
+extern CShaderCache g_cShaderCache;
+BOOL KeyboardHandler(int keystroke, long long t);
+CGameRenderer::CGameRenderer(): m_bCameraDefaultMode(TRUE), m_bWireFrame(FALSE){
+  m_pWallTexture = nullptr;
+  m_pFloorTexture = nullptr;
+  m_pWireframeTexture = nullptr;
+
+  m_pSpriteShader = nullptr;
+  m_pSpriteQuadVB = nullptr;
+  m_pSpriteInstanceBuffer = nullptr;
+  m_nSpriteInstanceCapacity = 0;
+  m_nSpriteDrawCalls = 0;
+
+  for(int i=0; i<NUM_BLEND_MODES; i++)
+    m_pSpriteBlendState[i] = nullptr;
 } //constructor
 
 
@@ -70,6 +83,8 @@ void CGameRenderer::InitBackground(){
   constantBufferDesc.MiscFlags = 0;
   constantBufferDesc.StructureByteStride = 0;
     
+  if(m_pDev2 == nullptr)return; //headless, nothing to create
+
   m_pDev2->CreateBuffer(&constantBufferDesc, nullptr, &m_pConstantBuffer);
     
   D3D11_BUFFER_DESC VertexBufferDesc;
@@ -88,55 +103,261 @@ void CGameRenderer::InitBackground(){
   hr = m_pDev2->CreateBuffer(&VertexBufferDesc, &subresourceData, &m_pBackgroundVB);
 } //InitBackground
 
+/// Initialize instanced sprite drawing. Create the shader, a vertex buffer
+/// holding a unit quad that every sprite is scaled from, the per-instance
+/// buffer, and a blend state for each blend mode.
+
+void CGameRenderer::InitSpriteBatch(){
+  //shader, per-vertex quad corner in slot 0 and per-instance data in slot 1
+  m_pSpriteShader = new CShader(5);
+
+  m_pSpriteShader->AddInputElementDesc(0, DXGI_FORMAT_R32G32B32_FLOAT, "POSITION");
+  m_pSpriteShader->AddInputElementDesc(12, DXGI_FORMAT_R32G32_FLOAT, "TEXCOORD");
+  m_pSpriteShader->AddInputElementDesc(0, DXGI_FORMAT_R32G32B32A32_FLOAT, "INSTANCEPOS", 1, true);
+  m_pSpriteShader->AddInputElementDesc(16, DXGI_FORMAT_R32G32_FLOAT, "INSTANCESIZE", 1, true);
+  m_pSpriteShader->AddInputElementDesc(24, DXGI_FORMAT_R32G32B32A32_FLOAT, "INSTANCEUV", 1, true);
+  m_pSpriteShader->VSCreateAndCompile(L"SpriteVS.hlsl", "main");
+  m_pSpriteShader->PSCreateAndCompile(L"SpritePS.hlsl", "main");
+
+  if(m_pDev2 == nullptr){ //headless, nothing to create
+    m_nSpriteInstanceCapacity = 256;
+    return;
+  } //if
+
+  //unit quad, first triangle in clockwise order
+  BILLBOARDVERTEX pVertexBufferData[4];
+
+  pVertexBufferData[0].p = Vector3(0.5f, 0.5f, 0.0f);
+  pVertexBufferData[0].tu = 1.0f; pVertexBufferData[0].tv = 0.0f;
+
+  pVertexBufferData[1].p = Vector3(0.5f, -0.5f, 0.0f);
+  pVertexBufferData[1].tu = 1.0f; pVertexBufferData[1].tv = 1.0f;
+
+  pVertexBufferData[2].p = Vector3(-0.5f, 0.5f, 0.0f);
+  pVertexBufferData[2].tu = 0.0f; pVertexBufferData[2].tv = 0.0f;
+
+  pVertexBufferData[3].p = Vector3(-0.5f, -0.5f, 0.0f);
+  pVertexBufferData[3].tu = 0.0f; pVertexBufferData[3].tv = 1.0f;
+
+  D3D11_BUFFER_DESC VertexBufferDesc;
+  VertexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+  VertexBufferDesc.ByteWidth = sizeof(BILLBOARDVERTEX)*4;
+  VertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+  VertexBufferDesc.CPUAccessFlags = 0;
+  VertexBufferDesc.MiscFlags = 0;
+  VertexBufferDesc.StructureByteStride = 0;
+
+  D3D11_SUBRESOURCE_DATA subresourceData;
+  subresourceData.pSysMem = pVertexBufferData;
+  subresourceData.SysMemPitch = 0;
+  subresourceData.SysMemSlicePitch = 0;
+
+  m_pDev2->CreateBuffer(&VertexBufferDesc, &subresourceData, &m_pSpriteQuadVB);
+
+  CreateSpriteInstanceBuffer(256); //grows on demand
+
+  //blend states
+  D3D11_BLEND_DESC1 blendDesc;
+  ZeroMemory(&blendDesc, sizeof(D3D11_BLEND_DESC1));
+  blendDesc.AlphaToCoverageEnable = FALSE;
+  blendDesc.IndependentBlendEnable = FALSE;
+  blendDesc.RenderTarget[0].BlendEnable = TRUE;
+  blendDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+  blendDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+  blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+  blendDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ZERO;
+  blendDesc.RenderTarget[0].LogicOp = D3D11_LOGIC_OP_CLEAR;
+  blendDesc.RenderTarget[0].LogicOpEnable = FALSE;
+  blendDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+  blendDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
+  blendDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ZERO;
+
+  m_pDev2->CreateBlendState1(&blendDesc, &m_pSpriteBlendState[ALPHA_BLEND]);
+
+  blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_ONE;
+  m_pDev2->CreateBlendState1(&blendDesc, &m_pSpriteBlendState[ADDITIVE_BLEND]);
+} //InitSpriteBatch
+
+/// Create the dynamic per-instance buffer, replacing the old one if any.
+/// \param n Number of sprites that the buffer must hold.
+/// \return TRUE if it succeeded.
+
+BOOL CGameRenderer::CreateSpriteInstanceBuffer(int n){
+  SAFE_RELEASE(m_pSpriteInstanceBuffer);
+  m_nSpriteInstanceCapacity = 0;
+
+  if(m_pDev2 == nullptr){ //headless, pretend
+    m_nSpriteInstanceCapacity = n;
+    return TRUE;
+  } //if
+
+  D3D11_BUFFER_DESC InstanceBufferDesc;
+  InstanceBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+  InstanceBufferDesc.ByteWidth = sizeof(SpriteClipInstance)*n;
+  InstanceBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+  InstanceBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+  InstanceBufferDesc.MiscFlags = 0;
+  InstanceBufferDesc.StructureByteStride = 0;
+
+  HRESULT hr = m_pDev2->CreateBuffer(&InstanceBufferDesc, nullptr, &m_pSpriteInstanceBuffer);
+  if(FAILED(hr))return FALSE;
+
+  m_nSpriteInstanceCapacity = n;
+  return TRUE;
+} //CreateSpriteInstanceBuffer
+
+/// Submit a sprite to be drawn at the end of the frame.
+/// \param texture Texture to draw the sprite from.
+/// \param instance Position, size, and texture coordinates of sprite.
+
+void CGameRenderer::DrawSprite(ID3D11ShaderResourceView* texture, const SpriteInstance& instance){
+  m_cSpriteBatch.Submit(texture, instance);
+} //DrawSprite
+
+/// Draw all of the sprites submitted this frame. The sprite centers for
+/// the whole frame are transformed to clip space in one pass and go to the
+/// GPU in one go, then each run of sprites
+/// that share a texture and blend mode is drawn with a single
+/// instanced draw call.
+
+void CGameRenderer::DrawSprites(){
+  m_cSpriteBatch.End();
+  m_nSpriteDrawCalls = 0;
+
+  const vector<SpriteInstance>& instances = m_cSpriteBatch.GetInstances();
+  const vector<SpriteBatchRun>& runs = m_cSpriteBatch.GetRuns();
+  const int n = (int)instances.size();
+  if(n == 0)return; //nothing to draw
+
+  //make sure the instance buffer is big enough
+  if(n > m_nSpriteInstanceCapacity){
+    int capacity = max(m_nSpriteInstanceCapacity, 1);
+    while(capacity < n)capacity *= 2;
+    if(!CreateSpriteInstanceBuffer(capacity))return; //bail and fail
+  } //if
+
+  //transform and upload instance data
+  m_vSpriteClipInstances.resize(n);
+  TransformSprites(instances.data(), n, m_matViewProj, m_vSpriteClipInstances.data());
+
+  if(!m_pBackend->WriteBuffer(m_pSpriteInstanceBuffer, m_vSpriteClipInstances.data(),
+    sizeof(SpriteClipInstance)*n))
+    return; //bail and fail
+
+  //state shared by all runs
+  m_pSpriteShader->SetShaders();
+  m_pBackend->SetTopology(TRIANGLE_STRIP_TOPOLOGY);
+
+  RenderHandle hBuffers[2] = {m_pSpriteQuadVB, m_pSpriteInstanceBuffer};
+  unsigned nStrides[2] = {sizeof(BILLBOARDVERTEX), sizeof(SpriteClipInstance)};
+  m_pBackend->SetVertexBuffers(2, hBuffers, nStrides);
+
+  ConstantBuffer constantBufferData; //shader needs the view projection axes
+  constantBufferData.wvp = GetViewProjectionMatrix();
+  m_pBackend->UpdateBuffer(m_pConstantBuffer, &constantBufferData, sizeof(constantBufferData));
+  m_pBackend->SetConstantBuffer(0, m_pConstantBuffer);
+
+  if(m_bWireFrame)
+    m_pBackend->SetTexture(0, m_pWireframeTexture);
+
+  //one instanced draw per run
+  for(int i=0; i<(int)runs.size(); i++){
+    const SpriteBatchRun& run = runs[i];
+
+    m_pBackend->SetBlendState(m_pSpriteBlendState[run.nBlend]);
+
+    if(!m_bWireFrame)
+      m_pBackend->SetTexture(0, run.pTexture);
+
+    m_pBackend->DrawInstanced(4, run.nCount, 0, run.nFirst);
+    m_nSpriteDrawCalls++;
+  } //for
+} //DrawSprites
+
+/// Get the number of instanced draw calls used to draw sprites last frame.
+/// \return Number of sprite draw calls.
+
+int CGameRenderer::GetSpriteDrawCallCount(){
+  return m_nSpriteDrawCalls;
+} //GetSpriteDrawCallCount
+
 /// Draw the game background.
 
 void CGameRenderer::DrawBackground(){
-  UINT nVertexBufferOffset = 0;
-  
-  UINT nVertexBufferStride = sizeof(BILLBOARDVERTEX);
-  m_pDC2->IASetVertexBuffers(0, 1, &m_pBackgroundVB, &nVertexBufferStride, &nVertexBufferOffset);
-  m_pDC2->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+  PROFILE_ZONE("CGameRenderer::DrawBackground");
+  RenderHandle hVertexBuffer = m_pBackgroundVB;
+  unsigned nVertexBufferStride = sizeof(BILLBOARDVERTEX);
+  m_pBackend->SetVertexBuffers(1, &hVertexBuffer, &nVertexBufferStride);
+  m_pBackend->SetTopology(TRIANGLE_STRIP_TOPOLOGY);
   m_pShader->SetShaders();
 
   //draw floor
-  if(g_bWireFrame)
-    m_pDC2->PSSetShaderResources(0, 1, &m_pWireframeTexture); //set wireframe texture
+  if(m_bWireFrame)
+    m_pBackend->SetTexture(0, m_pWireframeTexture); //set wireframe texture
   else
-    m_pDC2->PSSetShaderResources(0, 1, &m_pFloorTexture); //set floor texture
-  
-  SetWorldMatrix();
+    m_pBackend->SetTexture(0, m_pFloorTexture); //set floor texture
   
   ConstantBuffer constantBufferData; ///< Constant buffer data for shader.
 
-  constantBufferData.wvp = CalculateWorldViewProjectionMatrix();
-  m_pDC2->UpdateSubresource(m_pConstantBuffer, 0, nullptr, &constantBufferData, 0, 0);
-  m_pDC2->VSSetConstantBuffers(0, 1, &m_pConstantBuffer);
-  m_pDC2->Draw(4, 0);
+  constantBufferData.wvp = GetViewProjectionMatrix(); //background is in world space
+  m_pBackend->UpdateBuffer(m_pConstantBuffer, &constantBufferData, sizeof(constantBufferData));
+  m_pBackend->SetConstantBuffer(0, m_pConstantBuffer);
+  m_pBackend->Draw(4, 0);
 
-  //draw backdrop
-  if(!g_bWireFrame)
-    m_pDC2->PSSetShaderResources(0, 1, &m_pWallTexture);
+  //draw backdrop, same transform
+  if(!m_bWireFrame)
+    m_pBackend->SetTexture(0, m_pWallTexture);
 
-  constantBufferData.wvp = CalculateWorldViewProjectionMatrix();
-  m_pDC2->UpdateSubresource(m_pConstantBuffer, 0, nullptr, &constantBufferData, 0, 0);
-  m_pDC2->VSSetConstantBuffers(0, 1, &m_pConstantBuffer);
-  m_pDC2->Draw(4, 2);
+  m_pBackend->Draw(4, 2);
 } //DrawBackground
  
-/// Load the background and sprite textures.
+/// Load the background textures, skipping any that the asset loader
+/// has already provided.
 
 void CGameRenderer::LoadTextures(){ 
-  LoadTexture(m_pWallTexture, g_cImageFileName[0]);
-  LoadTexture(m_pFloorTexture, g_cImageFileName[1]);
-  LoadTexture(m_pWireframeTexture, g_cImageFileName[2]); //black for wireframe
+  if(m_pWallTexture == nullptr)
+    LoadTexture(m_pWallTexture, g_cImageFileName[0]);
+  if(m_pFloorTexture == nullptr)
+    LoadTexture(m_pFloorTexture, g_cImageFileName[1]);
+  if(m_pWireframeTexture == nullptr)
+    LoadTexture(m_pWireframeTexture, g_cImageFileName[2]); //black for wireframe
 } //LoadTextures
 
+/// Use a texture created elsewhere as one of the background textures.
+/// The renderer takes ownership of the texture.
+/// \param index Index of image in image file name list, 0 to 2.
+/// \param texture The texture.
+
+void CGameRenderer::SetBackgroundTexture(int index, ID3D11ShaderResourceView* texture){
+  ID3D11ShaderResourceView** p = nullptr;
+
+  switch(index){
+    case 0: p = &m_pWallTexture; break;
+    case 1: p = &m_pFloorTexture; break;
+    case 2: p = &m_pWireframeTexture; break;
+  } //switch
+
+  if(p == nullptr){ //not a background texture
+    SAFE_RELEASE(texture);
+    return;
+  } //if
+
+  SAFE_RELEASE(*p);
+  *p = texture;
+} //SetBackgroundTexture
+
 /// All textures used in the game are released - the release function is kind
 /// of like a destructor for DirectX entities, which are COM objects.
 
 void CGameRenderer::Release(){ 
-  g_pPlaneSprite->Release();
-  g_pPlaneSprite2->Release();
+  for(int i=0; i<NUM_TEAMS; i++)
+    if(g_pFighterSprite[i])g_pFighterSprite[i]->Release();
+
+  if(m_pDC2)m_pDC2->ClearState(); //unbind the last frame's textures
+  g_cFrameCache.Release();
+
+  if(g_cFrameCache.GetLiveResourceCount() != 0)
+    ABORT("Frame cache leaked %d textures.", g_cFrameCache.GetLiveResourceCount());
 
   SAFE_RELEASE(m_pWallTexture);
   SAFE_RELEASE(m_pFloorTexture);
@@ -144,64 +365,67 @@ void CGameRenderer::Release(){
   SAFE_RELEASE(m_pBackgroundVB);
 
   SAFE_DELETE(m_pShader);
+
+  SAFE_RELEASE(m_pSpriteQuadVB);
+  SAFE_RELEASE(m_pSpriteInstanceBuffer);
+  for(int i=0; i<NUM_BLEND_MODES; i++)
+    SAFE_RELEASE(m_pSpriteBlendState[i]);
+  SAFE_DELETE(m_pSpriteShader);
+  g_cShaderCache.Release();
   
   CRenderer::Release();
 } //Release
 
-/// Move all objects, then draw them.
-/// \return TRUE if it succeeded
+/// Draw all objects in a snapshot, interpolated between the last two
+/// simulation ticks.
+/// \param s Snapshot of the game state.
+/// \param alpha How far the next tick has got, from 0 to 1.
 
-void CGameRenderer::ComposeFrame(){
+void CGameRenderer::ComposeFrame(const GameSnapshot& s, float alpha){
+  PROFILE_ZONE("CGameRenderer::ComposeFrame");
   //prepare to draw
-  m_pDC2->OMSetRenderTargets(1, &m_pRTV, m_pDSV);
+  m_pBackend->SetRenderTarget();
   float clearColor[] = { 1.0f, 1.0f, 1.0f, 0.0f };
-  m_pDC2->ClearRenderTargetView(m_pRTV, clearColor);
-  m_pDC2->ClearDepthStencilView(m_pDSV, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+  m_pBackend->Clear(clearColor);
 
   //draw
   DrawBackground(); //draw background
-  g_pPlane->draw(); //draw plane
-  g_pPlane2->draw();
+
+  m_cSpriteBatch.Begin();
+
+  for(int i=0; i<s.nObjects; i++){ //draw objects
+    const ObjectSnapshot& obj = s.cObject[i];
+    if(obj.pSprite && obj.pSprite->SetFrame(obj.nFrame))
+      obj.pSprite->Draw(Vector3::Lerp(obj.vLastPos, obj.vPos, alpha));
+  } //for
+
+  DrawSprites(); //draw all sprites in as few draw calls as possible
 } //ComposeFrame
  
-/// Compose a frame of animation and present it to the video card.
-
-void CGameRenderer::ProcessFrame() {
-
-
-	if (g_pPlane->m_vPos.y != 300.0f )
-	{
-		g_pPlane->jump();
-		
-		if (g_pPlane->m_vPos.y > 315.0f)
-			g_pPlaneSprite->Load(g_cImageFileName[16]);
-		else
-			g_pPlaneSprite->Load(g_cImageFileName[3]);
-	}
-
-	if (g_pPlane2->m_vPos.y != 300.0f)
-	{
-		g_pPlane2->jump();
-		if (g_pPlane2->m_vPos.y > 315.0f)
-        g_pPlaneSprite2->Load(g_cImageFileName[8]);
-		else 
-			g_pPlaneSprite2->Load(g_cImageFileName[4]);
-
-	}
-		
-		ComposeFrame();
-		m_pSwapChain2->Present(1, 0); //present it
-
-		
+/// Compose a frame of animation and present it to the video card. The
+/// simulation is run separately, see SimulateTick, and the renderer only
+/// sees the snapshots that it publishes. The wireframe and camera settings
+/// come from the snapshot too, so that all Direct3D calls are made by
+/// whichever thread is rendering.
+/// \param s Snapshot of the game state.
+/// \param alpha How far the next simulation tick has got, from 0 to 1.
+
+void CGameRenderer::ProcessFrame(const GameSnapshot& s, float alpha){
+  PROFILE_ZONE("CGameRenderer::ProcessFrame");
+  if((m_bWireFrame != FALSE) != s.bWireFrame){
+    m_bWireFrame = s.bWireFrame;
+    SetWireFrameMode(m_bWireFrame);
+  } //if
+
+  if((m_bCameraDefaultMode != FALSE) != s.bCameraDefaultMode)
+    FlipCameraMode();
+
+  ComposeFrame(s, alpha);
+
+  PROFILE_ZONE("Present");
+  m_pBackend->Present(1); //present it
 } //ProcessFrame
 
-void CGameRenderer::ProcessFrameForOther()
-{
-
-	ComposeFrame();
-	m_pSwapChain2->Present(4, 0); //present it
-}
-
 
 /// Toggle between eagle-eye camera (camera pulled back far enough to see
 /// backdrop) and the normal game camera.
@@ -6,6 +6,9 @@
 #include "renderer.h"
 #include "defines.h"
 #include "Shader.h"
+#include "SpriteBatch.h"
+#include "SpriteTransform.h"
+#include "SnapshotBuffer.h"
 
 /// \brief The game renderer.
 ///
@@ -22,20 +25,37 @@ class CGameRenderer: public CRenderer{
     ID3D11Buffer* m_pConstantBuffer; ///< Constant buffer for shader.
     CShader* m_pShader; ///< Pointer to an instance of the shader class.
 
+    //Direct3D stuff for instanced sprites
+    CSpriteBatch m_cSpriteBatch; ///< Sprites submitted this frame.
+    vector<SpriteClipInstance> m_vSpriteClipInstances; ///< Sprites transformed to clip space.
+    CShader* m_pSpriteShader; ///< Instanced sprite shader.
+    ID3D11Buffer* m_pSpriteQuadVB; ///< Vertex buffer for unit quad.
+    ID3D11Buffer* m_pSpriteInstanceBuffer; ///< Dynamic per-instance sprite buffer.
+    int m_nSpriteInstanceCapacity; ///< Number of sprites that fit in instance buffer.
+    ID3D11BlendState1* m_pSpriteBlendState[NUM_BLEND_MODES]; ///< Blend state for each blend mode.
+    int m_nSpriteDrawCalls; ///< Number of sprite draw calls last frame.
+
     BOOL m_bCameraDefaultMode; ///< Camera in default mode.
+    BOOL m_bWireFrame; ///< Drawing in wireframe.
+
+    BOOL CreateSpriteInstanceBuffer(int n); ///< Create instance buffer for n sprites.
+    void DrawSprites(); ///< Draw all sprites submitted this frame.
  
   public:
     CGameRenderer(); ///< Constructor.
 
     void InitBackground(); ///< Initialize the background.
     void DrawBackground(); ///< Draw the background.
+    void InitSpriteBatch(); ///< Initialize instanced sprite drawing.
+    void DrawSprite(ID3D11ShaderResourceView* texture, const SpriteInstance& instance); ///< Submit a sprite.
+    int GetSpriteDrawCallCount(); ///< Number of sprite draw calls last frame.
   
     void LoadTextures(); ///< Load textures for image storage.
+    void SetBackgroundTexture(int index, ID3D11ShaderResourceView* texture); ///< Use a loaded background texture.
     void Release(); ///< Release offscreen images.
 
-    void ComposeFrame(); ///< Compose a frame of animation.
-    void ProcessFrame(); ///< Process a frame of animation.
-	void ProcessFrameForOther();
+    void ComposeFrame(const GameSnapshot& s, float alpha=1.0f); ///< Compose a frame of animation.
+    void ProcessFrame(const GameSnapshot& s, float alpha=1.0f); ///< Process a frame of animation.
 	
     void FlipCameraMode(); ///< Flip the camera mode.
 }; //CGameRenderer 
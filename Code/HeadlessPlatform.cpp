@@ -0,0 +1,188 @@
+/// \file HeadlessPlatform.cpp
+/// \brief Code for the headless platform class CHeadlessPlatform.
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "HeadlessPlatform.h"
+#include "Portable.h"
+
+CHeadlessPlatform::CHeadlessPlatform():
+  m_nNextKey(0), m_nEndTime(0), m_bEnded(false)
+{
+  m_nNow.store(0);
+  m_szTitle[0] = '\0';
+} //constructor
+
+/// Add a key press to the script. Key presses can be added in any order,
+/// and ones at the same time are delivered in the order they were added.
+/// \param t Time to press it, in microseconds.
+/// \param key Key code.
+
+void CHeadlessPlatform::AddKey(long long t, int key){
+  ScriptedKey k;
+  k.nTime = t;
+  k.nKey = key;
+
+  //insert after any at the same time, so ties keep their order
+  auto it = upper_bound(m_vScript.begin() + m_nNextKey, m_vScript.end(), k,
+    [](const ScriptedKey& a, const ScriptedKey& b){return a.nTime < b.nTime;});
+  m_vScript.insert(it, k);
+} //AddKey
+
+/// Add key presses from a script file. Each line has a time in
+/// microseconds and a key, which is a name that ParseKey understands.
+/// Blank lines and anything after a # are ignored.
+/// \param fname Name of script file.
+/// \return true if the file was read and every line made sense.
+
+bool CHeadlessPlatform::LoadScript(const char* fname){
+  FILE* input = nullptr;
+  if(fopen_s(&input, fname, "rt") != 0 || input == nullptr)return false;
+
+  bool ok = true;
+  char line[256];
+
+  while(fgets(line, sizeof(line), input)){
+    char* comment = strchr(line, '#');
+    if(comment)*comment = '\0';
+
+    char* p = nullptr; //end of the time
+    const long long t = strtoll(line, &p, 10);
+    if(p == line)continue; //blank line
+
+    char* name = p + strspn(p, " \t"); //key name, up to the next space
+    name[strcspn(name, " \t\r\n")] = '\0';
+
+    const int key = name[0]? ParseKey(name): -1;
+    if(key < 0 || t < 0)ok = false;
+    else AddKey(t, key);
+  } //while
+
+  fclose(input);
+  return ok;
+} //LoadScript
+
+/// Set the time to quit. If none is set, the game quits as soon as the
+/// last scripted key has been delivered.
+/// \param t Time to quit, in microseconds.
+
+void CHeadlessPlatform::SetEndTime(long long t){
+  m_nEndTime = t;
+} //SetEndTime
+
+/// Get the time to quit, which is the time of the last scripted key if
+/// no end time has been set.
+/// \return Time to quit, in microseconds.
+
+long long CHeadlessPlatform::GetEndTime() const{
+  if(m_nEndTime > 0 || m_vScript.empty())return m_nEndTime;
+  return m_vScript.back().nTime;
+} //GetEndTime
+
+/// Get a key code from its name. Names are ESCAPE, SPACE, LEFT, UP,
+/// RIGHT, DOWN, F1 to F8, a single letter or digit, or a number such
+/// as 0x4B. Case doesn't matter.
+/// \param name Name of key.
+/// \return Key code, or -1 if the name makes no sense.
+
+int CHeadlessPlatform::ParseKey(const char* name){
+  static const struct{const char* szName; int nKey;} cNamedKey[] = {
+    {"ESCAPE", KEY_ESCAPE}, {"SPACE", KEY_SPACE}, {"LEFT", KEY_LEFT},
+    {"UP", KEY_UP}, {"RIGHT", KEY_RIGHT}, {"DOWN", KEY_DOWN}
+  }; //cNamedKey
+
+  char upper[64];
+  size_t len = 0;
+  for(; name[len] && len < sizeof(upper) - 1; len++)
+    upper[len] = (char)toupper((unsigned char)name[len]);
+  upper[len] = '\0';
+
+  if(len == 0)return -1;
+
+  for(size_t i=0; i<sizeof(cNamedKey)/sizeof(cNamedKey[0]); i++)
+    if(!strcmp(upper, cNamedKey[i].szName))
+      return cNamedKey[i].nKey;
+
+  if(upper[0] == 'F' && len == 2 && upper[1] >= '1' && upper[1] <= '8')
+    return KEY_F1 + upper[1] - '1';
+
+  if(len == 1 && isalnum((unsigned char)upper[0]))
+    return upper[0];
+
+  char* end = nullptr;
+  const long key = strtol(name, &end, 0);
+  return *end == '\0' && key > 0 && key < 256? (int)key: -1;
+} //ParseKey
+
+/// Queue the scripted keys whose time has come, each stamped with its
+/// scripted time, and a quit event once the end time has been reached.
+
+void CHeadlessPlatform::Pump(){
+  const long long now = m_nNow.load();
+
+  for(; m_nNextKey < m_vScript.size() && m_vScript[m_nNextKey].nTime <= now; m_nNextKey++)
+    Post(KEY_DOWN_EVENT, m_vScript[m_nNextKey].nKey, m_vScript[m_nNextKey].nTime);
+
+  if(!m_bEnded && now >= GetEndTime()){
+    Post(QUIT_EVENT, 0, now);
+    m_bEnded = true;
+  } //if
+} //Pump
+
+/// There is no window, so this only remembers the name as the title, and
+/// the size of the client area is ignored.
+/// \param name Name of game.
+/// \return true.
+
+bool CHeadlessPlatform::CreateGameWindow(const char* name, int, int){
+  SetTitle(name);
+  return true;
+} //CreateGameWindow
+
+/// There is no window, so there's nothing to do.
+
+void CHeadlessPlatform::DestroyGameWindow(){
+} //DestroyGameWindow
+
+/// Remember the title, for whoever wants to check it.
+/// \param title Title text.
+
+void CHeadlessPlatform::SetTitle(const char* title){
+  snprintf(m_szTitle, sizeof(m_szTitle), "%s", title);
+} //SetTitle
+
+/// \return The title last set.
+
+const char* CHeadlessPlatform::GetTitle() const{
+  return m_szTitle;
+} //GetTitle
+
+/// Move the clock on to the time given, or to the next scripted key or
+/// the end time if either of those comes first. The clock never goes
+/// backwards, and waiting for an event with none to come moves it
+/// straight to the end time.
+/// \param t Time to wait until in microseconds, or -1 to wait for an event.
+
+void CHeadlessPlatform::WaitForEvent(long long t){
+  long long next = GetEndTime(); //soonest thing to happen
+
+  if(m_nNextKey < m_vScript.size())
+    next = min(next, m_vScript[m_nNextKey].nTime);
+  if(t >= 0)
+    next = min(next, t);
+
+  if(next > m_nNow.load())
+    m_nNow.store(next);
+} //WaitForEvent
+
+/// Get the simulated time, which any thread can do.
+/// \return Time in microseconds.
+
+long long CHeadlessPlatform::Now(){
+  return m_nNow.load();
+} //Now
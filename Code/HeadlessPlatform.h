@@ -0,0 +1,59 @@
+/// \file HeadlessPlatform.h
+/// \brief Interface for the headless platform class CHeadlessPlatform.
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include "Platform.h"
+
+using namespace std;
+
+/// \brief A key press in a script.
+
+struct ScriptedKey{
+  long long nTime; ///< Time to press it, in microseconds.
+  int nKey; ///< Key code.
+}; //ScriptedKey
+
+/// \brief The headless platform.
+///
+/// The headless platform has no window and no keyboard, and its clock
+/// only moves when the game loop waits. Key presses come from a script,
+/// and each is delivered stamped with exactly the time the script gives
+/// for it. Waiting moves the clock straight to the time waited for, or to
+/// the next scripted key if that comes first, so the game loop runs as
+/// fast as it can and does exactly the same thing on every run, on any
+/// operating system. The game is told to quit when the clock reaches the
+/// end of the script.
+
+class CHeadlessPlatform: public CPlatform{
+  private:
+    vector<ScriptedKey> m_vScript; ///< Key presses in order of time.
+    size_t m_nNextKey; ///< Index of the next key press to deliver.
+    long long m_nEndTime; ///< Time to quit in microseconds, 0 for when the script runs out.
+    atomic<long long> m_nNow; ///< Simulated clock in microseconds.
+    bool m_bEnded; ///< Whether a quit event has been queued for the end time.
+    char m_szTitle[256]; ///< Window title, since there's no window to show it.
+
+    long long GetEndTime() const; ///< Time to quit.
+
+  protected:
+    void Pump(); ///< Queue scripted keys that are due.
+
+  public:
+    CHeadlessPlatform(); ///< Constructor.
+
+    void AddKey(long long t, int key); ///< Add a key press to the script.
+    bool LoadScript(const char* fname); ///< Add key presses from a file.
+    void SetEndTime(long long t); ///< Set the time to quit.
+    static int ParseKey(const char* name); ///< Key code from a name.
+
+    bool CreateGameWindow(const char* name, int width, int height); ///< Pretend to make the game window.
+    void DestroyGameWindow(); ///< Pretend to get rid of the game window.
+    void SetTitle(const char* title); ///< Set the window title.
+    const char* GetTitle() const; ///< Get the window title.
+    void WaitForEvent(long long t); ///< Move the clock on.
+    long long Now(); ///< Current simulated time in microseconds.
+}; //CHeadlessPlatform
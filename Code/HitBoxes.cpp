@@ -0,0 +1,287 @@
+/// \file HitBoxes.cpp
+/// \brief Code for the hitbox class CHitBoxes.
+
+#include <limits.h>
+
+#include <algorithm>
+
+#include <emmintrin.h>
+
+#include "HitBoxes.h"
+
+/// Names of the XML tags for each kind of box.
+
+static const char* g_szBoxTag[NUM_BOX_KINDS] = {"hitbox", "hurtbox"};
+
+void CHitBoxes::WorldBoxes::Clear(){
+  vLeft.clear(); vBottom.clear(); vRight.clear(); vTop.clear();
+  vTeam.clear(); vBody.clear(); vBox.clear();
+} //Clear
+
+/// Move a box from a frame into the world and add it. Facing left mirrors
+/// it, so its back edge becomes its right edge.
+/// \param b Box relative to the body.
+/// \param x X coordinate of the body.
+/// \param y Y coordinate of the body.
+/// \param facing 1 if the body faces right, -1 if left.
+/// \param team Team of the body.
+/// \param body Which body, by order added.
+/// \param box Which of the body's boxes on its frame.
+
+void CHitBoxes::WorldBoxes::Add(const HitBox& b, fixed x, fixed y, int facing,
+  int team, int body, int box)
+{
+  vLeft.push_back(facing > 0? x + b.nBack: x - b.nFront);
+  vRight.push_back(facing > 0? x + b.nFront: x - b.nBack);
+  vBottom.push_back(y + b.nBottom);
+  vTop.push_back(y + b.nTop);
+  vTeam.push_back(team);
+  vBody.push_back(body);
+  vBox.push_back(box);
+} //Add
+
+/// Pad the arrays to a multiple of 4 with boxes that are inside out, so
+/// that the overlap test can take them 4 at a time without a scalar tail.
+
+void CHitBoxes::WorldBoxes::Pad(){
+  while(vLeft.size()%4){
+    vLeft.push_back(INT_MAX); vRight.push_back(INT_MIN);
+    vBottom.push_back(INT_MAX); vTop.push_back(INT_MIN);
+    vTeam.push_back(-1); vBody.push_back(-1); vBox.push_back(-1);
+  } //while
+} //Pad
+
+/// Add a box to a frame. It can't be used until Compile() is called.
+/// \param frame Frame number.
+/// \param kind Hitbox or hurtbox.
+/// \param box The box.
+
+void CHitBoxes::AddBox(int frame, HitBoxKind kind, const HitBox& box){
+  if(frame < 0 || kind < 0 || kind >= NUM_BOX_KINDS)return;
+  m_vStagedFrame[kind].push_back(frame);
+  m_vStagedBox[kind].push_back(box);
+} //AddBox
+
+/// Compile the boxes added so far, along with those compiled before, into
+/// one array for each kind sorted by frame. Boxes on the same frame keep
+/// the order they were added in.
+
+void CHitBoxes::Compile(){
+  for(int k=0; k<NUM_BOX_KINDS; k++){
+    //put the compiled boxes back with the staged ones
+    for(size_t f=0; f<m_vFirst[k].size(); f++)
+      for(int i=0; i<m_vCount[k][f]; i++){
+        m_vStagedFrame[k].push_back((int)f);
+        m_vStagedBox[k].push_back(m_vBox[k][m_vFirst[k][f] + i]);
+      } //for
+
+    //sort by frame with a counting sort, which is stable
+    int frames = 0;
+    for(int f: m_vStagedFrame[k])
+      frames = max(frames, f + 1);
+
+    m_vCount[k].assign(frames, 0);
+    for(int f: m_vStagedFrame[k])
+      m_vCount[k][f]++;
+
+    m_vFirst[k].assign(frames, 0);
+    for(int f=1; f<frames; f++)
+      m_vFirst[k][f] = m_vFirst[k][f - 1] + m_vCount[k][f - 1];
+
+    vector<int> next(m_vFirst[k]); //where the next box of each frame goes
+    m_vBox[k].resize(m_vStagedBox[k].size());
+    for(size_t i=0; i<m_vStagedBox[k].size(); i++)
+      m_vBox[k][next[m_vStagedFrame[k][i]]++] = m_vStagedBox[k][i];
+
+    m_vStagedFrame[k].clear();
+    m_vStagedBox[k].clear();
+  } //for
+} //Compile
+
+/// Load boxes from the XML settings and compile them. They are in a
+/// hitboxes tag, with a frame tag for each frame that has any, which has a
+/// hitbox or hurtbox tag for each box, for example:
+///
+///     <hitboxes>
+///       <frame index="14">
+///         <hurtbox back="-20" front="20" bottom="-64" top="48"/>
+///         <hitbox back="0" front="30" bottom="0" top="40"/>
+///       </frame>
+///     </hitboxes>
+///
+/// Edges are in pixels and may have fractions, and are converted to fixed
+/// point as they are read.
+///
+/// \param settings TinyXML element containing settings tags.
+/// \return true if there was a hitboxes tag.
+
+bool CHitBoxes::Load(XMLElement* settings){
+  XMLElement* ist = settings? settings->FirstChildElement("hitboxes"): nullptr;
+  if(ist == nullptr)return false;
+
+  for(XMLElement* tag = ist->FirstChildElement("frame"); tag;
+    tag = tag->NextSiblingElement("frame"))
+  {
+    int frame = -1;
+    tag->QueryIntAttribute("index", &frame);
+    if(frame < 0)continue; //bad frame
+
+    for(int k=0; k<NUM_BOX_KINDS; k++)
+      for(XMLElement* box = tag->FirstChildElement(g_szBoxTag[k]); box;
+        box = box->NextSiblingElement(g_szBoxTag[k]))
+      {
+        float back = 0.0f, bottom = 0.0f, front = 0.0f, top = 0.0f;
+        box->QueryFloatAttribute("back", &back);
+        box->QueryFloatAttribute("bottom", &bottom);
+        box->QueryFloatAttribute("front", &front);
+        box->QueryFloatAttribute("top", &top);
+
+        const HitBox b = {FloatToFixed(back), FloatToFixed(bottom),
+          FloatToFixed(front), FloatToFixed(top)};
+        if(b.nBack < b.nFront && b.nBottom < b.nTop) //skip empty boxes
+          AddBox(frame, (HitBoxKind)k, b);
+      } //for
+  } //for
+
+  Compile();
+  return true;
+} //Load
+
+void CHitBoxes::Clear(){
+  for(int k=0; k<NUM_BOX_KINDS; k++){
+    m_vStagedFrame[k].clear(); m_vStagedBox[k].clear();
+    m_vBox[k].clear(); m_vFirst[k].clear(); m_vCount[k].clear();
+  } //for
+} //Clear
+
+/// \param kind Hitbox or hurtbox.
+/// \return Number of compiled boxes of that kind on all frames.
+
+int CHitBoxes::GetBoxCount(HitBoxKind kind) const{
+  return (int)m_vBox[kind].size();
+} //GetBoxCount
+
+/// \param frame Frame number.
+/// \param kind Hitbox or hurtbox.
+/// \return Number of boxes of that kind on that frame.
+
+int CHitBoxes::GetBoxCount(int frame, HitBoxKind kind) const{
+  if(frame < 0 || frame >= (int)m_vCount[kind].size())return 0;
+  return m_vCount[kind][frame];
+} //GetBoxCount
+
+/// \param frame Frame number.
+/// \param kind Hitbox or hurtbox.
+/// \return The boxes of that kind on that frame, GetBoxCount() of them.
+
+const HitBox* CHitBoxes::GetBoxes(int frame, HitBoxKind kind) const{
+  if(GetBoxCount(frame, kind) == 0)return nullptr;
+  return &m_vBox[kind][m_vFirst[kind][frame]];
+} //GetBoxes
+
+/// Remove all bodies, ready to add this tick's.
+
+void CHitBoxes::BeginTick(){
+  for(int k=0; k<NUM_BOX_KINDS; k++)
+    m_cWorld[k].Clear();
+  m_vBodyId.clear();
+} //BeginTick
+
+/// Add a body in play. Its hurtboxes can always be hit, but its hitboxes
+/// only deal hits while it is striking, for example until an attack has
+/// landed, so that one punch doesn't land on every tick that it lasts.
+/// \param id Identifier for the body, which goes into hit events.
+/// \param team Team, since bodies on the same team can't hit each other.
+/// \param frame Animation frame it is showing.
+/// \param x X coordinate.
+/// \param y Y coordinate.
+/// \param facing 1 if it faces right, -1 if left.
+/// \param striking Whether its hitboxes are live.
+
+void CHitBoxes::AddBody(unsigned id, int team, int frame, fixed x, fixed y,
+  int facing, bool striking)
+{
+  const int body = (int)m_vBodyId.size();
+  m_vBodyId.push_back(id);
+
+  for(int k=0; k<NUM_BOX_KINDS; k++){
+    if(k == HIT_BOX && !striking)continue;
+    const HitBox* b = GetBoxes(frame, (HitBoxKind)k);
+
+    for(int i=0; i<GetBoxCount(frame, (HitBoxKind)k); i++)
+      m_cWorld[k].Add(b[i], x, y, facing, team, body, i);
+  } //for
+} //AddBody
+
+/// Record a hit, unless the attacker has already hit the defender this
+/// tick with an earlier hitbox.
+/// \param events Hit events.
+/// \param start First event for this attacker.
+/// \param hit Hitbox in the world.
+/// \param hurt Hurtbox in the world.
+
+void CHitBoxes::AddEvent(vector<HitEvent>& events, size_t start, int hit, int hurt) const{
+  const unsigned defender = m_vBodyId[m_cWorld[HURT_BOX].vBody[hurt]];
+
+  for(size_t i=start; i<events.size(); i++)
+    if(events[i].nDefender == defender)return;
+
+  HitEvent e;
+  e.nAttacker = m_vBodyId[m_cWorld[HIT_BOX].vBody[hit]];
+  e.nDefender = defender;
+  e.nBox = m_cWorld[HIT_BOX].vBox[hit];
+  events.push_back(e);
+} //AddEvent
+
+/// Test every live hitbox against every hurtbox. Each hitbox is broadcast
+/// into an SSE register and tested against four hurtboxes at once, with a
+/// compare for each edge and one for the team, and the result is a bit
+/// mask that is almost always zero. Boxes that only touch don't overlap.
+/// Events come out in the order the attackers were added.
+/// \param events [out] One event for each attacker and defender that overlap.
+
+void CHitBoxes::FindHits(vector<HitEvent>& events){
+  events.clear();
+
+  WorldBoxes& hit = m_cWorld[HIT_BOX];
+  WorldBoxes& hurt = m_cWorld[HURT_BOX];
+  hurt.Pad();
+
+  const int nHit = (int)hit.vLeft.size();
+  const int nHurt = (int)hurt.vLeft.size();
+  const __m128i* left = (const __m128i*)hurt.vLeft.data();
+  const __m128i* bottom = (const __m128i*)hurt.vBottom.data();
+  const __m128i* right = (const __m128i*)hurt.vRight.data();
+  const __m128i* top = (const __m128i*)hurt.vTop.data();
+  const __m128i* team = (const __m128i*)hurt.vTeam.data();
+
+  size_t start = 0; //first event for the current attacker
+
+  for(int i=0; i<nHit; i++){
+    if(i > 0 && hit.vBody[i] != hit.vBody[i - 1])
+      start = events.size(); //new attacker
+
+    const __m128i l = _mm_set1_epi32(hit.vLeft[i]);
+    const __m128i b = _mm_set1_epi32(hit.vBottom[i]);
+    const __m128i r = _mm_set1_epi32(hit.vRight[i]);
+    const __m128i t = _mm_set1_epi32(hit.vTop[i]);
+    const __m128i own = _mm_set1_epi32(hit.vTeam[i]);
+
+    for(int j=0; j<nHurt; j+=4){
+      const int q = j/4; //quad of hurtboxes
+      __m128i m = _mm_and_si128(_mm_cmplt_epi32(l, _mm_loadu_si128(right + q)),
+        _mm_cmplt_epi32(_mm_loadu_si128(left + q), r));
+      m = _mm_and_si128(m, _mm_and_si128(_mm_cmplt_epi32(b, _mm_loadu_si128(top + q)),
+        _mm_cmplt_epi32(_mm_loadu_si128(bottom + q), t)));
+      const __m128i same = _mm_cmpeq_epi32(own, _mm_loadu_si128(team + q));
+
+      int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_andnot_si128(same, m)));
+
+      while(mask){ //usually not even once
+        const int k = mask & 1? 0: mask & 2? 1: mask & 4? 2: 3;
+        AddEvent(events, start, i, j + k);
+        mask &= mask - 1;
+      } //while
+    } //for
+  } //for
+} //FindHits
@@ -0,0 +1,100 @@
+/// \file HitBoxes.h
+/// \brief Interface for the hitbox class CHitBoxes.
+
+#pragma once
+
+#include <vector>
+
+#include "tinyxml2.h"
+
+#include "Fixed.h"
+
+using namespace std;
+using namespace tinyxml2;
+
+/// Kinds of box.
+
+enum HitBoxKind{
+  HIT_BOX, ///< Deals a hit.
+  HURT_BOX, ///< Can be hit.
+  NUM_BOX_KINDS
+}; //HitBoxKind
+
+/// \brief A box on an animation frame.
+///
+/// Coordinates are relative to the location of whoever is showing the
+/// frame, with X increasing in the direction they face and Y increasing
+/// upwards, so the same box serves whichever way they are facing. Edges
+/// are in fixed point, like everything else the simulation uses.
+
+struct HitBox{
+  fixed nBack; ///< Edge furthest behind.
+  fixed nBottom; ///< Bottom edge.
+  fixed nFront; ///< Edge furthest in front.
+  fixed nTop; ///< Top edge.
+}; //HitBox
+
+/// \brief A hitbox of one body overlapping a hurtbox of another.
+
+struct HitEvent{
+  unsigned nAttacker; ///< Identifier of the body dealing the hit.
+  unsigned nDefender; ///< Identifier of the body taking it.
+  int nBox; ///< Which of the attacker's hitboxes on its frame it was.
+}; //HitEvent
+
+/// \brief Hitboxes and hurtboxes for every animation frame.
+///
+/// Each animation frame can have any number of hitboxes, which deal hits,
+/// and hurtboxes, which take them. They are authored in the XML settings,
+/// and compiled when loaded into one flat array of boxes for each kind,
+/// sorted by frame, with the first box and the number of boxes for each
+/// frame, so that looking up a frame's boxes is just indexing.
+///
+/// Each tick, every body in play (a fighter or a projectile) is added with
+/// its frame, location, facing and team. Its boxes are moved into the
+/// world and appended to one array of hitboxes and one of hurtboxes, each
+/// kept as a structure of arrays. Then every hitbox is tested against
+/// every hurtbox on another team in one pass, four hurtboxes at a time
+/// with SSE, and each attacker that overlaps a defender produces one hit
+/// event, for the first of its hitboxes to overlap.
+
+class CHitBoxes{
+  private:
+    /// \brief Boxes in the world, one array per edge.
+    struct WorldBoxes{
+      vector<fixed> vLeft, vBottom, vRight, vTop; ///< Edges.
+      vector<int> vTeam; ///< Team of the body each box belongs to.
+      vector<int> vBody; ///< Which body, by order added.
+      vector<int> vBox; ///< Which of the body's boxes on its frame.
+
+      void Clear(); ///< Remove all boxes.
+      void Add(const HitBox& b, fixed x, fixed y, int facing, int team, int body, int box); ///< Add a box.
+      void Pad(); ///< Pad to a multiple of 4 with boxes that overlap nothing.
+    }; //WorldBoxes
+
+    vector<int> m_vStagedFrame[NUM_BOX_KINDS]; ///< Frame of each box not yet compiled.
+    vector<HitBox> m_vStagedBox[NUM_BOX_KINDS]; ///< Boxes not yet compiled.
+
+    vector<HitBox> m_vBox[NUM_BOX_KINDS]; ///< Compiled boxes, sorted by frame.
+    vector<int> m_vFirst[NUM_BOX_KINDS]; ///< First compiled box of each frame.
+    vector<int> m_vCount[NUM_BOX_KINDS]; ///< Number of compiled boxes of each frame.
+
+    WorldBoxes m_cWorld[NUM_BOX_KINDS]; ///< This tick's boxes in the world.
+    vector<unsigned> m_vBodyId; ///< Identifier of each body added this tick.
+
+    void AddEvent(vector<HitEvent>& events, size_t start, int hit, int hurt) const; ///< Record a hit.
+
+  public:
+    void AddBox(int frame, HitBoxKind kind, const HitBox& box); ///< Add a box to a frame.
+    void Compile(); ///< Compile boxes added into flat arrays.
+    bool Load(XMLElement* settings); ///< Load and compile boxes from XML settings.
+    void Clear(); ///< Forget every box.
+
+    int GetBoxCount(HitBoxKind kind) const; ///< Number of compiled boxes of a kind.
+    int GetBoxCount(int frame, HitBoxKind kind) const; ///< Number of boxes of a kind on a frame.
+    const HitBox* GetBoxes(int frame, HitBoxKind kind) const; ///< Boxes of a kind on a frame.
+
+    void BeginTick(); ///< Remove all bodies.
+    void AddBody(unsigned id, int team, int frame, fixed x, fixed y, int facing, bool striking); ///< Add a body in play.
+    void FindHits(vector<HitEvent>& events); ///< Test every hitbox against every hurtbox.
+}; //CHitBoxes
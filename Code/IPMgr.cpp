@@ -6,8 +6,6 @@
 #include "debug.h"
 #include "IPMgr.h" 
 
-#ifdef DEBUG_ON
-
 /// Winsock error descriptions.
 
 WSAEDESCRIPTION g_WSAErrorDescriptions[] = {
@@ -148,6 +146,7 @@ WSAEDESCRIPTION g_WSAErrorDescriptions[] = {
 IPManager::IPManager(char* address,int port){ //constructor
   WSADATA wsaData; //winsock data
   m_bInitialized = TRUE; //start assuming all is OK
+  m_bListening = FALSE;
 
   //start up winsock
   m_bInitialized = m_bInitialized && WSAStartup(WINSOCK_VERSION, &wsaData)==0; //did we init OK?
@@ -204,4 +203,68 @@ BOOL IPManager::SendPacket(char* message,int length){ //send  packet
   else return TRUE;
 } //SendPacket
 
-#endif
\ No newline at end of file
+/// Bind the socket to a local port, and stop it from blocking, so that
+/// packets can be received on it without waiting.
+/// \param port Local port number
+/// \return TRUE if it succeeded
+
+BOOL IPManager::Listen(int port){
+  if(!m_bInitialized)return FALSE; //bail if not ready
+
+  SOCKADDR_IN saLocal; //local address
+  ZeroMemory(&saLocal, sizeof(saLocal));
+  saLocal.sin_family = AF_INET;
+  saLocal.sin_port = htons(port);
+  saLocal.sin_addr.s_addr = htonl(INADDR_ANY);
+
+  u_long nNonBlocking = 1; //for ioctlsocket
+  m_bListening = bind(m_Socket, (LPSOCKADDR)&saLocal, sizeof(saLocal)) != SOCKET_ERROR &&
+    ioctlsocket(m_Socket, FIONBIO, &nNonBlocking) != SOCKET_ERROR;
+  return m_bListening;
+} //Listen
+
+/// Receive a packet from the client, if one is waiting. Packets from
+/// anywhere else are thrown away.
+/// \param buffer Buffer for the packet
+/// \param size Size of buffer
+/// \return Length of packet, 0 if none is waiting, -1 if it was too big for the buffer
+
+int IPManager::ReceivePacket(char* buffer,int size){
+  if(!m_bListening)return 0; //bail if not ready
+
+  while(true){
+    SOCKADDR_IN saFrom; //where the packet came from
+    int nFromLength = sizeof(saFrom);
+
+    const int nRet = recvfrom(m_Socket, buffer, size, 0, (LPSOCKADDR)&saFrom, &nFromLength);
+
+    if(nRet == SOCKET_ERROR){
+      const int nError = WSAGetLastError();
+      if(nError == WSAEMSGSIZE)return -1; //truncated
+      if(nError == WSAECONNRESET)continue; //an earlier send bounced, ignore it
+      return 0; //WSAEWOULDBLOCK, nothing waiting, or something worse
+    } //if
+
+    if(saFrom.sin_addr.s_addr == m_saClient.sin_addr.s_addr &&
+      saFrom.sin_port == m_saClient.sin_port)
+      return nRet;
+  } //while
+} //ReceivePacket
+
+/// Send a datagram to the peer, as a net link.
+/// \param p Datagram
+/// \param n Length of datagram
+/// \return true if it was sent
+
+bool IPManager::Send(const unsigned char* p, int n){
+  return SendPacket((char*)p, n) != FALSE;
+} //Send
+
+/// Receive a datagram from the peer, as a net link.
+/// \param p Buffer for the datagram
+/// \param size Size of buffer
+/// \return Length of datagram, 0 if none is waiting, -1 if it was too big for the buffer
+
+int IPManager::Receive(unsigned char* p, int size){
+  return ReceivePacket((char*)p, size);
+} //Receive
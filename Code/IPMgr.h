@@ -5,6 +5,8 @@
 
 #include <winsock.h>
 
+#include "NetLink.h"
+
 #define WINSOCK_VERSION MAKEWORD(1,1) ///< MAKEWORD(x,y) for version x.y
 
 /// Winsock error description.
@@ -14,14 +16,17 @@ struct WSAEDESCRIPTION{
   char *szDescription; ///< Text description of the error.
 }; //WSAEDESCRIPTION
 
-/// \brief The IP manager class manages UDP/IP error reporting.
+/// \brief The IP manager class manages UDP/IP.
 ///
-/// The IP manager is intended only to be used by the debug manager for sending
-/// error strings to a debug client.
+/// The IP manager is used by the debug manager for sending error strings
+/// to a debug client, and as the link to the peer in a net session. For
+/// the latter it listens on a port of its own, and only takes packets from
+/// the address and port it sends to.
 
-class IPManager{
+class IPManager: public CNetLink{
   private:
     BOOL m_bInitialized; ///< TRUE if initialized OK.
+    BOOL m_bListening; ///< TRUE if bound to a local port.
     SOCKADDR_IN m_saClient; ///< Client socket info.
     SOCKET m_Socket; ///< The socket.
 
@@ -29,5 +34,10 @@ class IPManager{
     IPManager(char* addr,int port); ///< Constructor.
     virtual ~IPManager(); ///< Destructor.
     BOOL SendPacket(char* message,int length); ///< Send packet.
+    BOOL Listen(int port); ///< Receive packets on a local port.
+    int ReceivePacket(char* buffer,int size); ///< Receive packet.
     LPCTSTR WinsockErrorDescription(int nErrorCode); ///< Describe WS error message.
+
+    bool Send(const unsigned char* p, int n); ///< Send a datagram to the peer.
+    int Receive(unsigned char* p, int size); ///< Receive a datagram from the peer, if one is waiting.
 }; //IPManager
@@ -31,6 +31,13 @@ char* CImageFileNameList::operator[](const int ix){ //safe index into name list
   else return errname; //else return a default string
 } //operator[]
 
+/// Get the number of image file names in the list.
+/// \return Number of image file names loaded from the XML settings.
+
+int CImageFileNameList::GetCount(){
+  return m_nImageFileCount;
+} //GetCount
+
 /// Load image file names from tags in a TinyXML element.
 /// \param settings TinyXML element containing settings tags
 
@@ -22,4 +22,5 @@ class CImageFileNameList{
     ~CImageFileNameList(); ///< Destructor.
     void GetImageFileNames(XMLElement* xmlSettings); ///< Get names from XML element.
     char* operator[](const int); ///< Safe index into name list.
+    int GetCount(); ///< Number of image file names stored.
 }; //CImageFileNameList
\ No newline at end of file
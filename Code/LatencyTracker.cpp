@@ -0,0 +1,99 @@
+/// \file LatencyTracker.cpp
+/// \brief Code for the input latency tracker CLatencyTracker.
+
+#include <stdio.h>
+
+#include "LatencyTracker.h"
+#include "Portable.h"
+
+/// \param maxsamples Most samples to keep in the log. Histograms carry on
+/// counting after the log is full.
+
+CLatencyTracker::CLatencyTracker(size_t maxsamples): m_nMaxSamples(maxsamples){
+} //constructor
+
+/// Record the latency of an input.
+/// \param input The input and the time it arrived.
+/// \param tick Tick of the first snapshot to show its result.
+/// \param t Time the frame showing it was presented, in microseconds.
+
+void CLatencyTracker::Record(const InputStamp& input, int tick, long long t){
+  if(input.eAction < 0 || input.eAction >= NUM_INPUT_ACTIONS)return;
+
+  m_cLatency[input.eAction].Record(t - input.nTime);
+
+  if(m_vSamples.size() < m_nMaxSamples){
+    LatencySample sample;
+    sample.eAction = input.eAction;
+    sample.nTick = tick;
+    sample.nInputTime = input.nTime;
+    sample.nPresentTime = t;
+    m_vSamples.push_back(sample);
+  } //if
+} //Record
+
+/// Forget all samples and histograms. Only the recording thread may call this.
+
+void CLatencyTracker::Clear(){
+  for(int i=0; i<NUM_INPUT_ACTIONS; i++)
+    m_cLatency[i].Clear();
+  m_vSamples.clear();
+} //Clear
+
+/// \param action A kind of input.
+/// \return Histogram of its latency in microseconds.
+
+CTimeHistogram& CLatencyTracker::GetHistogram(InputAction action){
+  return m_cLatency[action];
+} //GetHistogram
+
+/// \param action A kind of input.
+/// \return Name of the kind of input.
+
+const char* CLatencyTracker::GetActionName(InputAction action){
+  static const char* szName[NUM_INPUT_ACTIONS] = {"move", "jump", "punch", "kick"};
+  return action >= 0 && action < NUM_INPUT_ACTIONS? szName[action]: "unknown";
+} //GetActionName
+
+/// Describe the latency of each kind of input that has had any, as the
+/// 50th and 99th percentiles in milliseconds, for an on-screen display.
+/// \param buffer [out] Buffer for the text.
+/// \param size Size of buffer.
+
+void CLatencyTracker::GetSummary(char* buffer, size_t size){
+  if(size == 0)return;
+  buffer[0] = '\0';
+
+  size_t n = 0; //characters written so far
+
+  for(int i=0; i<NUM_INPUT_ACTIONS && n<size; i++){
+    const CTimeHistogram& h = m_cLatency[i];
+    if(h.GetCount() == 0)continue;
+
+    const int written = snprintf(buffer + n, size - n, "%s%s %0.1f/%0.1f ms",
+      n > 0? ", ": "", GetActionName((InputAction)i),
+      h.GetPercentile(50)/1000.0, h.GetPercentile(99)/1000.0);
+    if(written < 0)break;
+    n += written;
+  } //for
+} //GetSummary
+
+/// Save the logged samples as CSV, one line per input.
+/// \param fname Name of file to write.
+/// \return true if it succeeded.
+
+bool CLatencyTracker::WriteCSV(const char* fname) const{
+  FILE* output = nullptr;
+  if(fopen_s(&output, fname, "wt") != 0 || output == nullptr)return false;
+
+  fprintf(output, "action,tick,input_us,present_us,latency_us\n");
+
+  for(size_t i=0; i<m_vSamples.size(); i++){
+    const LatencySample& s = m_vSamples[i];
+    fprintf(output, "%s,%d,%lld,%lld,%lld\n", GetActionName(s.eAction), s.nTick,
+      s.nInputTime, s.nPresentTime, s.nPresentTime - s.nInputTime);
+  } //for
+
+  fclose(output);
+  return true;
+} //WriteCSV
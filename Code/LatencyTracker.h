@@ -0,0 +1,60 @@
+/// \file LatencyTracker.h
+/// \brief Interface for the input latency tracker CLatencyTracker.
+
+#pragma once
+
+#include <vector>
+
+#include "timer.h"
+
+using namespace std;
+
+/// \brief Kinds of input whose latency is tracked.
+
+enum InputAction{
+  MOVE_ACTION, JUMP_ACTION, PUNCH_ACTION, KICK_ACTION, NUM_INPUT_ACTIONS
+}; //InputAction
+
+/// \brief An input and the time it arrived.
+
+struct InputStamp{
+  InputAction eAction; ///< What the input did.
+  long long nTime; ///< Time the key was pressed, in microseconds.
+}; //InputStamp
+
+/// \brief An input and the time it was first shown.
+
+struct LatencySample{
+  InputAction eAction; ///< What the input did.
+  int nTick; ///< Tick of the first snapshot to show it.
+  long long nInputTime; ///< Time the key was pressed, in microseconds.
+  long long nPresentTime; ///< Time the frame showing it was presented, in microseconds.
+}; //LatencySample
+
+/// \brief The input latency tracker.
+///
+/// The latency tracker measures the time from a key being pressed to the
+/// frame that first shows its result being presented. Inputs are stamped
+/// as they arrive, the stamps travel with the game state to the renderer,
+/// and the renderer hands them back here once it has presented a frame.
+/// There is a histogram for each kind of input, and a log of samples that
+/// can be saved as CSV. Recording must be done by one thread only, but the
+/// histograms can be read from any.
+
+class CLatencyTracker{
+  private:
+    CTimeHistogram m_cLatency[NUM_INPUT_ACTIONS]; ///< Latency of each kind of input.
+    vector<LatencySample> m_vSamples; ///< Log of samples.
+    size_t m_nMaxSamples; ///< Most samples to log.
+
+  public:
+    CLatencyTracker(size_t maxsamples=100000); ///< Constructor.
+
+    void Record(const InputStamp& input, int tick, long long t); ///< Record an input shown at time t.
+    void Clear(); ///< Forget everything.
+
+    CTimeHistogram& GetHistogram(InputAction action); ///< Latency histogram for a kind of input.
+    static const char* GetActionName(InputAction action); ///< Name of a kind of input.
+    void GetSummary(char* buffer, size_t size); ///< Percentiles as text.
+    bool WriteCSV(const char* fname) const; ///< Save the samples as CSV.
+}; //CLatencyTracker
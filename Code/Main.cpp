@@ -16,6 +16,10 @@
 
 #include <windows.h>
 #include <windowsx.h>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <algorithm>
 
 #include "defines.h"
 #include "abort.h"
@@ -24,9 +28,27 @@
 #include "debug.h"
 #include "timer.h"
 #include "sprite.h"
-#include "object.h"
+#include "EntityStore.h"
+#include "HitBoxes.h"
+#include "Simulation.h"
+#include "NetSession.h"
+#include "IPMgr.h"
+#include "Replay.h"
 #include "keyboard.h"
 #include "renderer.h"
+#include "FrameCache.h"
+#include "ShaderCache.h"
+#include "AssetLoader.h"
+#include "NullRenderBackend.h"
+#include "StateFilterBackend.h"
+#include "FixedTimestep.h"
+#include "SnapshotBuffer.h"
+#include "DepthOrder.h"
+#include "LatencyTracker.h"
+#include "Profiler.h"
+#include "GameLoop.h"
+#include "Win32Platform.h"
+#include "HeadlessPlatform.h"
 
 #include "sound.h"
 CSoundManager* g_pSoundManager;
@@ -37,11 +59,11 @@ CSoundManager* g_pSoundManager;
 int g_nScreenWidth; ///< Screen width.
 int g_nScreenHeight; ///< Screen height.
 BOOL g_bWireFrame = FALSE; ///< TRUE for wireframe rendering.
+BOOL g_bCameraDefaultMode = TRUE; ///< TRUE for the normal camera, FALSE for eagle-eye.
 
 //globals
 C3DSprite* g_pPlatformSprite = nullptr;
 C3DSprite* g_pPlatformSprite2 = nullptr;
-CTimer actualtime;
 
 
 
@@ -50,7 +72,6 @@ const float HALF_HAMSTER_HT = HAMSTER_HT / 2.0f;
 
 
 
-BOOL g_bActiveApp;  ///< TRUE if this is the active application
 HWND g_HwndApp; ///< Application window handle.
 HINSTANCE g_hInstance; ///< Application instance handle.
 char g_szGameName[256]; ///< Name of this game
@@ -59,12 +80,36 @@ char g_szShaderModel[256]; ///< The shader model version used
 
 
 CImageFileNameList g_cImageFileName; ///< List of image file names.
+CFrameCache g_cFrameCache; ///< Resident sprite frames, indexed by image file name.
+CShaderCache g_cShaderCache; ///< Compiled shaders, shared and saved to disk.
 CTimer g_cTimer; ///< The game timer.
+CFixedTimestep g_cTimestep(60); ///< Runs the simulation at 60 ticks a second.
+CSnapshotBuffer g_cSnapshots; ///< Game state passed from the simulation to the renderer.
+CDepthOrder g_cDrawOrder; ///< Fighters in the order they are drawn, back to front.
+thread g_cRenderThread; ///< Render thread.
+atomic<bool> g_bRendering(false); ///< Whether the render thread is to keep going.
+CLatencyTracker g_cLatency; ///< Time from key press to the frame showing it, recorded by the renderer.
+BOOL g_bLatencyOverlay = FALSE; ///< TRUE to show input latency in the title bar.
+CPlatform* g_pPlatform = nullptr; ///< Window, events, and the clock the game runs on.
 
-C3DSprite* g_pPlaneSprite = nullptr; ///< Pointer to the plane sprite.
-CGameObject* g_pPlane = nullptr; ///< Pointer to the plane object.
-C3DSprite* g_pPlaneSprite2 = nullptr; ///< Pointer to the plane sprite.
-CGameObject* g_pPlane2 = nullptr; ///< Pointer to the plane object.
+//fighters
+CSimulation g_cSimulation; ///< The fighters, and everything else a tick changes.
+int g_nTeamSize = 1; ///< Fighters on each team.
+BOOL g_bTagTeam = FALSE; ///< TRUE for one fighter per team in play at a time, FALSE for all of them.
+C3DSprite* g_pFighterSprite[NUM_TEAMS] = {nullptr, nullptr}; ///< Sprite for each team.
+CHitBoxes g_cHitBoxes; ///< Hitboxes and hurtboxes for each frame.
+NetInput g_nInput[NUM_TEAMS]; ///< Keys each team has pressed for the next tick, FighterInput bits.
+long long g_nInputTime[NUM_TEAMS][NUM_INPUTS]; ///< When each of those keys was first pressed.
+
+//online play
+int g_nNetWindow = 8; ///< Most ticks to run ahead of the remote player's input.
+IPManager* g_pNetLink = nullptr; ///< Link to the other player.
+CNetSession* g_pNetSession = nullptr; ///< Rollback session, nullptr unless playing online.
+
+vector<CSimulation> g_vSavedState; ///< One slot for each tick a rollback can go back.
+
+//replays
+CReplayWriter g_cReplayWriter; ///< Records the keys pressed on each tick, if asked to.
 
 
 
@@ -102,8 +147,9 @@ XMLElement* g_xmlSettings = nullptr; ///< TinyXML element for settings tag.
 CGameRenderer GameRenderer; ///< The game renderer.
 //functions in Window.cpp
 void InitGraphics();
+void InitHeadlessGraphics();
 
-HWND CreateDefaultWindow(char* name, HINSTANCE hInstance, int nCmdShow);
+void ActOnInput(FighterTeam team, NetInput accepted); ///< Act on the keys that took effect.
 
 /// \brief Initialize XML settings.
 ///
@@ -112,6 +158,8 @@ HWND CreateDefaultWindow(char* name, HINSTANCE hInstance, int nCmdShow);
 /// cannot load the file or cannot find settings tag in loaded file.
 
 void InitXMLSettings(){
+  PROFILE_ZONE("InitXMLSettings");
+
   //open and load XML file
   const char* xmlFileName = "gamesettings.xml"; //Settings file name.
   if(g_xmlDocument.LoadFile(xmlFileName) != 0)
@@ -129,6 +177,7 @@ void InitXMLSettings(){
 
 void LoadGameSettings(){
   if(!g_xmlSettings)return; //bail and fail
+  PROFILE_ZONE("LoadGameSettings");
 
   //get game name
   XMLElement* ist = g_xmlSettings->FirstChildElement("game"); 
@@ -148,6 +197,27 @@ void LoadGameSettings(){
     strncpy_s(g_szShaderModel, len + 1, renderSettings->Attribute("shadermodel"), len);
   } //if
 
+  //get fighter settings
+  XMLElement* fighterSettings =
+    g_xmlSettings->FirstChildElement("fighters"); //fighters tag
+  if(fighterSettings){
+    fighterSettings->QueryIntAttribute("perteam", &g_nTeamSize);
+    g_nTeamSize = min(max(g_nTeamSize, 1), MAX_TEAM_SIZE);
+
+    bool bTagTeam = false; //stays false if there's no tagteam attribute
+    fighterSettings->QueryBoolAttribute("tagteam", &bTagTeam);
+    g_bTagTeam = bTagTeam? TRUE: FALSE;
+  } //if
+
+  //get hitboxes and hurtboxes, if there are any
+  g_cHitBoxes.Load(g_xmlSettings);
+
+  //get online play settings
+  XMLElement* netSettings =
+    g_xmlSettings->FirstChildElement("net"); //net tag
+  if(netSettings)
+    netSettings->QueryIntAttribute("window", &g_nNetWindow);
+
   //get image file names
   g_cImageFileName.GetImageFileNames(g_xmlSettings);
 
@@ -157,27 +227,403 @@ void LoadGameSettings(){
   #endif //DEBUG_ON
 } //LoadGameSettings
 
-/// \brief Create game objects. 
+/// \brief Create game objects.
 ///
-/// Create a plane object, we'll add more objects in later demos.
-
-void CreateObjects(){  
-  g_pPlane = new CGameObject( 
-	  Vector3(626, 300.0f, 0),
-    Vector3(0, 2.0f, 0), g_pPlaneSprite);
-  g_pPlane2 = new CGameObject(
-	  Vector3(400, 300.0f, -10),
-	  Vector3(0,2.0f, 0), g_pPlaneSprite2);
+/// Set up a new fight, with g_nTeamSize fighters on each team, in tag-team
+/// mode if g_bTagTeam is set. If the XML settings had no hitboxes, the
+/// fighters' frames get default ones.
+
+void CreateObjects(){
+  g_cSimulation.Create(g_cHitBoxes, g_nTeamSize, g_bTagTeam != FALSE);
 } //CreateObjects
 
+/// \brief Run one simulation tick.
+///
+/// The fight simulation runs the tick, then each team's keys that took
+/// effect make their sounds and are stamped for latency.
+/// \param input Keys pressed by each team, FighterInput bits.
+
+void SimulateTick(const NetInput* input){
+  PROFILE_ZONE("SimulateTick");
+  NetInput accepted[NUM_TEAMS];
+  g_cSimulation.Tick(input, accepted);
+  for(int team=0; team<NUM_TEAMS; team++)
+    ActOnInput((FighterTeam)team, accepted[team]);
+} //SimulateTick
+
+/// \brief Save the simulation state for a rollback.
+///
+/// Copying the simulation into a slot that has held one before reuses
+/// the slot's columns, so once every slot has been used this allocates
+/// nothing.
+/// \param slot Slot to save it in.
+
+void SaveState(int slot){
+  g_vSavedState[slot] = g_cSimulation;
+} //SaveState
+
+/// \brief Load the simulation state for a rollback.
+/// \param slot Slot it was saved in.
+
+void LoadState(int slot){
+  g_cSimulation = g_vSavedState[slot];
+} //LoadState
+
+/// \brief Run the next tick with the keys pressed since the last one.
+///
+/// Offline, both teams' keys go straight into the tick. Online, the local
+/// team's keys go to the net session, which runs the tick with the remote
+/// team's keys or a prediction of them, after running earlier ticks again
+/// if an earlier prediction turned out wrong. If the session is too far
+/// ahead of the other player it stalls, and the keys wait for next time.
+/// Offline, the keys are also recorded to the replay, if one is being made.
+
+void RunTick(){
+  if(g_pNetSession == nullptr){
+    SimulateTick(g_nInput);
+    g_cReplayWriter.Record(g_nInput, g_cSimulation.GetChecksum());
+    memset(g_nInput, 0, sizeof(g_nInput));
+  } //if
+
+  else{
+    const int local = g_pNetSession->GetLocalPlayer();
+    if(g_pNetSession->Advance(g_nInput[local]))
+      g_nInput[local] = 0;
+  } //else
+} //RunTick
+
+/// \brief Keep in touch with the other player while the game isn't active.
+///
+/// No ticks are run while the game isn't the active application, but
+/// online the other player's game is still running, and must hear from
+/// this one or it will stall, so the net session keeps sending and
+/// receiving every tick. Offline there is nothing to do.
+/// \return true if it is to be called again a tick later.
+
+bool RunIdle(){
+  if(g_pNetSession == nullptr)return false;
+  g_pNetSession->Idle();
+  return true;
+} //RunIdle
+
+/// \brief Publish a snapshot of the game state for the renderer.
+/// \param t Time that the last tick was due, in microseconds.
+
+void PublishSnapshot(long long t){
+  PROFILE_ZONE("PublishSnapshot");
+  GameSnapshot& s = g_cSnapshots.GetWriteSnapshot();
+
+  s.nTick = g_cSimulation.GetTick();
+  s.nTickTime = t;
+  s.nObjects = 0;
+
+  //fighters in play, back to front, straight from the entity store's columns
+  const CEntityStore& fighters = g_cSimulation.GetFighters();
+  const unsigned char* active = fighters.GetActive();
+  const int* sprite = fighters.GetSprite();
+  const int* frame = fighters.GetFrame();
+  const fixed* x = fighters.GetPosX();
+  const fixed* y = fighters.GetPosY();
+  const fixed* z = fighters.GetPosZ();
+  const fixed* lastx = fighters.GetLastX();
+  const fixed* lasty = fighters.GetLastY();
+
+  if(g_cDrawOrder.GetCount() != fighters.GetCount()){ //new fight
+    g_cDrawOrder.Clear();
+    for(int team=0; team<NUM_TEAMS; team++)
+      for(int k=0; k<g_cSimulation.GetTeamSize(); k++)
+        g_cDrawOrder.Insert(g_cSimulation.GetFighter((FighterTeam)team, k), 0.0f);
+  } //if
+
+  for(int j=0; j<g_cDrawOrder.GetCount(); j++){
+    const int i = fighters.GetRow(g_cDrawOrder.GetHandle(j));
+    g_cDrawOrder.SetDepth(j, i < 0? 0.0f: FixedToFloat(z[i]));
+  } //for
+
+  g_cDrawOrder.Sort(); //nearly always in order already
+
+  for(int j=0; j<g_cDrawOrder.GetCount() && s.nObjects<MAX_SNAPSHOT_OBJECTS; j++){
+    const int i = fighters.GetRow(g_cDrawOrder.GetHandle(j));
+    if(i >= 0 && active[i]){
+      ObjectSnapshot& o = s.cObject[s.nObjects++];
+      o.pSprite = g_pFighterSprite[sprite[i]];
+      o.nFrame = frame[i];
+      o.vLastPos = XMFLOAT3(FixedToFloat(lastx[i]), FixedToFloat(lasty[i]), FixedToFloat(z[i]));
+      o.vPos = XMFLOAT3(FixedToFloat(x[i]), FixedToFloat(y[i]), FixedToFloat(z[i]));
+    } //if
+  } //for
+
+  s.bWireFrame = g_bWireFrame != FALSE;
+  s.bCameraDefaultMode = g_bCameraDefaultMode != FALSE;
+  s.nPublishTime = g_pPlatform->Now();
+
+  //if the renderer never got the last snapshot, its inputs are carried
+  //forward, otherwise they have been recorded and can be dropped
+  if(!g_cSnapshots.Publish())
+    g_cSnapshots.GetWriteSnapshot().nInputs = 0;
+} //PublishSnapshot
+
+/// \brief Stamp an input with the time its key was pressed.
+///
+/// The stamp goes into the snapshot being written, and so to the renderer
+/// with the first snapshot to show its result.
+/// \param action What the input did.
+/// \param t Time the key was pressed, in microseconds, negative for no stamp.
+
+void StampInput(InputAction action, long long t){
+  if(t < 0)return; //not pressed here, or already stamped
+  GameSnapshot& s = g_cSnapshots.GetWriteSnapshot();
+
+  if(s.nInputs < MAX_SNAPSHOT_INPUTS){
+    s.cInput[s.nInputs].eAction = action;
+    s.cInput[s.nInputs].nTime = t;
+    s.nInputs++;
+  } //if
+} //StampInput
+
+/// \brief Record the latency of the inputs in a snapshot.
+///
+/// Called by whichever thread is rendering, once it has presented the
+/// first frame to show a snapshot.
+/// \param s Snapshot just presented.
+/// \param t Time it was presented, in microseconds.
+
+void RecordLatency(const GameSnapshot& s, long long t){
+  for(int i=0; i<s.nInputs; i++)
+    g_cLatency.Record(s.cInput[i], s.nTick, t);
+} //RecordLatency
+
+/// \brief Show input latency in the title bar.
+///
+/// The game has no text rendering, so the title bar is the overlay. It
+/// shows the 50th and 99th percentile latency of each kind of input.
+
+void ShowLatencyOverlay(){
+  char summary[256];
+  g_cLatency.GetSummary(summary, sizeof(summary));
+
+  char buffer[512];
+  sprintf_s(buffer, "%s - Latency %s", g_szGameName, summary[0]? summary: "none yet");
+  g_pPlatform->SetTitle(buffer);
+} //ShowLatencyOverlay
+
+/// \brief Render thread body.
+///
+/// Draw the newest snapshot over and over, interpolating between its last
+/// two ticks according to how long ago the last one was due. Present waits
+/// for the vertical blank, which paces this thread, but nothing else ever
+/// waits for it. If there is nothing new to draw it sleeps instead, and
+/// the time spent asleep isn't counted as a frame.
+
+void RenderThread(){
+  const float fTickLength = (float)g_cTimestep.GetTickLength();
+  long long nLastFrame = 0; //start of last frame drawn in microseconds, 0 if none
+  float alpha = 0.0f; //interpolation used for last frame drawn
+
+  g_cProfiler.SetThreadName("render");
+
+  while(g_bRendering.load()){
+    if(alpha >= 1.0f && g_cSnapshots.GetQueueDepth() == 0){ //nothing has changed
+      nLastFrame = 0;
+      Sleep(1);
+      continue;
+    } //if
+
+    const long long now = g_pPlatform->Now();
+    if(!g_cSnapshots.Acquire(now)){ //nothing published yet
+      Sleep(1);
+      continue;
+    } //if
+
+    if(nLastFrame > 0)
+      g_cTimer.frames().Record(now - nLastFrame);
+    nLastFrame = now;
+
+    const GameSnapshot& s = g_cSnapshots.GetReadSnapshot();
+    alpha = min(1.0f, max(0.0f, (now - s.nTickTime)/fTickLength));
+    GameRenderer.ProcessFrame(s, alpha);
+
+    if(g_cSnapshots.IsFresh())
+      RecordLatency(s, g_pPlatform->Now());
+  } //while
+} //RenderThread
+
+/// \brief Start the render thread.
+///
+/// From now on only the render thread may use the renderer.
+
+void StartRenderThread(){
+  timeBeginPeriod(1); //so that waiting for the next tick is accurate
+  g_bRendering.store(true);
+  g_cRenderThread = thread(RenderThread);
+} //StartRenderThread
+
+/// \brief Stop the render thread and wait for it to finish.
+
+void StopRenderThread(){
+  if(g_cRenderThread.joinable()){
+    g_bRendering.store(false);
+    g_cRenderThread.join();
+    timeEndPeriod(1);
+  } //if
+} //StopRenderThread
+
+/// \brief Finish a frame of the game loop.
+///
+/// Called by the game loop once it has run as many simulation ticks as
+/// the platform clock calls for. Publish a snapshot for the render thread
+/// if anything has changed. Time spent in ticks is counted by the fixed
+/// timestep and the timer's tick histogram, and the render thread counts
+/// the time between frames. These and the snapshot counts are reported
+/// every few seconds.
+/// \param ticks Number of ticks just run.
+/// \param t Time that the last tick was due, in microseconds.
+
+void RunFrame(int ticks, long long t){
+  if(g_pSoundManager)
+    g_pSoundManager->play(2);
+
+  if(ticks > 0)
+    PublishSnapshot(t);
+
+  static BOOL bFirstFrame = TRUE;
+  if(bFirstFrame){ //how long did startup take?
+    DEBUGPRINTF("First frame at %d ms.\n", g_cTimer.time());
+    bFirstFrame = FALSE;
+  } //if
+
+  static int nLastReport = 0;
+  if(g_cTimer.elapsed(nLastReport, 5000)){
+    const TimestepStats& s = g_cTimestep.GetStats();
+    DEBUGPRINTF("%d ticks at %d Hz: tick mean %0.1f max %lld us, "
+      "%d catch-up frames, %d spirals dropping %d ticks.\n",
+      s.nTicks, g_cTimestep.GetTickRate(),
+      s.nTicks? (double)s.nTickTime/s.nTicks: 0.0, s.nMaxTickTime,
+      s.nCatchUpFrames, s.nSpiralFrames, s.nDroppedTicks);
+    g_cTimestep.ResetStats();
+    DEBUGPRINTF("Tick %d checksum %08x.\n", g_cSimulation.GetTick(),
+      g_cSimulation.GetChecksum());
+
+    if(g_pNetSession){
+      const NetStats& n = g_pNetSession->GetStats();
+      CTimeHistogram& r = g_pNetSession->GetRollbackTimes();
+      DEBUGPRINTF("Net: %d ticks, %d stalls, %d rollbacks (%0.1f%% of ticks) "
+        "running %d ticks again, most %d, rollback p50 %lld p99 %lld max %lld us, "
+        "%d packets sent, %d received, %d bad, %d checksums compared, %d desyncs.\n",
+        n.nTicks, n.nStalls, n.nRollbacks, n.nTicks? 100.0*n.nRollbacks/n.nTicks: 0.0,
+        n.nResimulated, n.nMaxRollback, r.GetPercentile(50), r.GetPercentile(99), r.GetMax(),
+        n.nPacketsSent, n.nPacketsReceived, n.nBadPackets, n.nChecksums, n.nDesyncs);
+      if(n.nFirstDesync >= 0)
+        DEBUGPRINTF("Net: out of sync since tick %d.\n", n.nFirstDesync + 1);
+      g_pNetSession->ResetStats();
+    } //if
+
+    SnapshotStats ss;
+    g_cSnapshots.GetStats(ss);
+    CTimeHistogram& a = g_cSnapshots.GetAgeHistogram();
+    const int drawn = ss.nFresh + ss.nRepeated;
+    DEBUGPRINTF("Snapshots: %d published, %d overwritten, %d frames repeated, "
+      "mean queue depth %0.2f, age p50 %lld p99 %lld max %lld us.\n",
+      ss.nPublished, ss.nOverwritten, ss.nRepeated,
+      drawn? (double)ss.nFresh/drawn: 0.0,
+      a.GetPercentile(50), a.GetPercentile(99), a.GetMax());
+    g_cSnapshots.ResetStats();
+
+    char summary[256];
+    g_cLatency.GetSummary(summary, sizeof(summary));
+    if(summary[0])DEBUGPRINTF("Input latency p50/p99: %s.\n", summary);
+
+    CTimeHistogram& f = g_cTimer.frames();
+    CTimeHistogram& k = g_cTimer.ticks();
+    DEBUGPRINTF("Frame interval p50 %lld p95 %lld p99 %lld max %lld us, "
+      "tick p50 %lld p95 %lld p99 %lld max %lld us.\n",
+      f.GetPercentile(50), f.GetPercentile(95), f.GetPercentile(99), f.GetMax(),
+      k.GetPercentile(50), k.GetPercentile(95), k.GetPercentile(99), k.GetMax());
+    f.Clear();
+    k.Clear();
+  } //if
+
+  static int nLastOverlay = 0;
+  if(g_bLatencyOverlay && g_cTimer.elapsed(nLastOverlay, 500))
+    ShowLatencyOverlay();
+} //RunFrame
+
+/// \brief Whether ticks are being run again after a rollback.
+///
+/// While they are, sounds aren't played again, since they were played the
+/// first time the tick was run.
+/// \return true if they are.
+
+bool IsRollingBack(){
+  return g_pNetSession && g_pNetSession->IsRollingBack();
+} //IsRollingBack
+
+/// \brief Act on the keys that took effect for a team.
+///
+/// Keys pressed on this machine are stamped with the time they were
+/// pressed, to measure their latency, and jumps and attacks make their
+/// sounds, but not when a tick is run again after a rollback, since that
+/// was done the first time the tick was run. The remote player's keys
+/// aren't stamped, since their latency is measured on the other machine.
+/// \param team Team.
+/// \param accepted Keys that took effect, FighterInput bits.
+
+void ActOnInput(FighterTeam team, NetInput accepted){
+  if(IsRollingBack())return;
+
+  if(g_pNetSession == nullptr || team == g_pNetSession->GetLocalPlayer()){
+    const long long* t = g_nInputTime[team]; //when each key was pressed
+    if(accepted & LEFT_INPUT)StampInput(MOVE_ACTION, t[1]);
+    if(accepted & RIGHT_INPUT)StampInput(MOVE_ACTION, t[2]);
+    if(accepted & JUMP_INPUT)StampInput(JUMP_ACTION, t[3]);
+    if(accepted & PUNCH_INPUT)StampInput(PUNCH_ACTION, t[4]);
+    if(accepted & KICK_INPUT)StampInput(KICK_ACTION, t[5]);
+  } //if
+
+  if(g_pSoundManager){
+    if(accepted & JUMP_INPUT)g_pSoundManager->play(3);
+    if(accepted & PUNCH_INPUT)g_pSoundManager->play(0);
+    if(accepted & KICK_INPUT)g_pSoundManager->play(1);
+  } //if
+} //ActOnInput
+
+/// \brief Press a fighter key.
+///
+/// The key takes effect at the start of the next tick, and pressing it
+/// again before then does nothing more. Online, every fighter key
+/// controls the local team.
+/// \param team Team whose key it is.
+/// \param key Which key, a FighterInput bit.
+/// \param t Time the key was pressed, in microseconds.
+
+void PressKey(FighterTeam team, FighterInput key, long long t){
+  if(g_pNetSession)
+    team = (FighterTeam)g_pNetSession->GetLocalPlayer();
+
+  if(!(g_nInput[team] & key)){
+    int i = 0; //which bit
+    while((1 << i) != key)i++;
+
+    g_nInput[team] |= key;
+    g_nInputTime[team][i] = t;
+  } //if
+} //PressKey
+
 /// \brief Keyboard handler.
 ///
-/// Handler for keyboard messages from the Windows API. Takes the appropriate
-/// action when the user presses a key on the keyboard.
-/// \param keystroke Virtual key code for the key pressed
+/// Handler for key presses from the platform. Takes the appropriate
+/// action when the user presses a key on the keyboard. Fighter keys are
+/// only noted, to be applied at the start of the next tick, and moves and
+/// attacks then go to the fighter's animation state machine, which plays
+/// them out over the following ticks, so this returns at once and neither
+/// player's keys are held up by the other's attacks.
+/// Each move or attack that is accepted is stamped with the time its key
+/// was pressed, to measure how long it takes to reach the screen.
+/// \param keystroke Key code for the key pressed
+/// \param t Time the key was pressed, in microseconds
 /// \return TRUE if the game is to exit
 
-BOOL KeyboardHandler(WPARAM keystroke){ 
+BOOL KeyboardHandler(int keystroke, long long t){ 
 
 	/*if (keystroke.KeyIsPressed(VK_ESCAPE))
 	{
@@ -213,131 +659,74 @@ BOOL KeyboardHandler(WPARAM keystroke){
 
 	switch (keystroke) {
 		
-	case VK_ESCAPE: //exit game
+	case KEY_ESCAPE: //exit game
 		return TRUE; //exit keyboard handler
 		break;
-	case VK_F1: //flip camera mode
-		GameRenderer.FlipCameraMode();
+	case KEY_F1: //flip camera mode, the renderer picks it up from the next snapshot
+		g_bCameraDefaultMode = !g_bCameraDefaultMode;
 		break;
-	case VK_F2: //toggle wireframe mode
+	case KEY_F2: //toggle wireframe mode, likewise
 		g_bWireFrame = !g_bWireFrame;
-		GameRenderer.SetWireFrameMode(g_bWireFrame);
+		break;
+	case KEY_F3: //toggle latency overlay
+		g_bLatencyOverlay = !g_bLatencyOverlay;
+		if (g_bLatencyOverlay)
+			ShowLatencyOverlay();
+		else g_pPlatform->SetTitle(g_szGameName);
+		break;
+	case KEY_F4: //start or stop profiling, starting afresh
+		if (!g_cProfiler.IsEnabled())
+			g_cProfiler.Clear();
+		g_cProfiler.Enable(!g_cProfiler.IsEnabled());
+		break;
+	case KEY_F5: //save what has been profiled so far
+		if (g_cProfiler.WriteTrace("trace.json"))
+			DEBUGPRINTF("Wrote trace.json.\n");
 		break;
 
 
-	case VK_UP:
-		if (g_pPlane)
-			g_pPlane->jump();
-		g_pSoundManager->play(3);
+	case KEY_UP: //right player jumps
+		PressKey(RIGHT_TEAM, JUMP_INPUT, t);
 		break;
-	case VK_LEFT:
-		if (g_pPlane)
-			g_pPlane->moveLeft();
-		
+	case KEY_LEFT: //right player walks left
+		PressKey(RIGHT_TEAM, LEFT_INPUT, t);
 		break;
-	case VK_RIGHT:
-		if (g_pPlane)
-			g_pPlane->moveRight();
+	case KEY_RIGHT: //right player walks right
+		PressKey(RIGHT_TEAM, RIGHT_INPUT, t);
 		break;
 
-	case 0x4B:
-		
-		if (g_pPlane)
-			g_pPlane->rightkick();
-		g_pPlaneSprite->Load(g_cImageFileName[15]);
-		
-		if (g_pPlane->m_vPos.x <= g_pPlane2->m_vPos.x + 50.0f)
-		{
-			GameRenderer.ProcessFrameForOther();
-			g_pPlaneSprite2->Load(g_cImageFileName[17]);
-		}
-		
-		GameRenderer.ProcessFrameForOther();
-		GameRenderer.ProcessFrameForOther();
-		GameRenderer.ProcessFrameForOther();
-
-		g_pPlaneSprite->Load(g_cImageFileName[3]);
-		g_pPlaneSprite2->Load(g_cImageFileName[4]);
-		GameRenderer.ProcessFrameForOther();
+	case 0x4B: //K, right player kicks
+		PressKey(RIGHT_TEAM, KICK_INPUT, t);
 		break;
 
-	case 0x4C:
-		if (g_pPlane)
-			g_pPlane->rightpunch();
-		g_pPlaneSprite->Load(g_cImageFileName[14]);
-
-		if (g_pPlane->m_vPos.x <= g_pPlane2->m_vPos.x + 50.0f)
-		{
-			GameRenderer.ProcessFrameForOther();
-			g_pPlaneSprite2->Load(g_cImageFileName[17]);
-		}
-		GameRenderer.ProcessFrameForOther();
-		GameRenderer.ProcessFrameForOther();
-		GameRenderer.ProcessFrameForOther();
-		g_pPlaneSprite->Load(g_cImageFileName[3]);
-		g_pPlaneSprite2->Load(g_cImageFileName[4]);
-		GameRenderer.ProcessFrameForOther();
+	case 0x4C: //L, right player punches
+		PressKey(RIGHT_TEAM, PUNCH_INPUT, t);
 		break;
 
-	case 0x57:
-		if (g_pPlane2)
-			g_pPlane2->jump();
-		g_pSoundManager->play(3);
+	case 0x4F: //O, right team tags
+		PressKey(RIGHT_TEAM, TAG_INPUT, t);
 		break;
 
-	case 0x41:
-		if (g_pPlane2)
-			g_pPlane2->moveLeft();
-		
-			g_pPlaneSprite2->Load(g_cImageFileName[4]);
-			GameRenderer.ProcessFrameForOther();
+	case 0x57: //W, left player jumps
+		PressKey(LEFT_TEAM, JUMP_INPUT, t);
+		break;
 
-			g_pPlaneSprite2->Load(g_cImageFileName[5]);
-			GameRenderer.ProcessFrameForOther();
-			
+	case 0x41: //A, left player walks left
+		PressKey(LEFT_TEAM, LEFT_INPUT, t);
+		break;
+	case 0x44: //D, left player walks right
+		PressKey(LEFT_TEAM, RIGHT_INPUT, t);
 		break;
-	case 0x44:
-			g_pPlane2->moveRight();
-				g_pPlaneSprite2->Load(g_cImageFileName[5]);
-				GameRenderer.ProcessFrameForOther();
-				g_pPlaneSprite2->Load(g_cImageFileName[4]);
-				GameRenderer.ProcessFrameForOther();
 
+	case 0x47: //G, left player kicks
+		PressKey(LEFT_TEAM, KICK_INPUT, t);
 		break;
-	case 0x47:
-			g_pPlane2->leftkick();
-			g_pPlaneSprite2->Load(g_cImageFileName[6]);
-			
-				if (g_pPlane2->m_vPos.x >= g_pPlane->m_vPos.x - 50.0f)
-				{
-					GameRenderer.ProcessFrameForOther();
-					g_pPlaneSprite->Load(g_cImageFileName[13]);
-				}
-				GameRenderer.ProcessFrameForOther();
-				GameRenderer.ProcessFrameForOther();
-				GameRenderer.ProcessFrameForOther();
-				g_pPlaneSprite->Load(g_cImageFileName[3]);
-				g_pPlaneSprite2->Load(g_cImageFileName[4]);
-				GameRenderer.ProcessFrameForOther();
+	case 0x46: //F, left player punches
+		PressKey(LEFT_TEAM, PUNCH_INPUT, t);
 		break;
-	case 0x46:
-		if (g_pPlane2)
-			g_pPlane2->leftpunch();
-		g_pPlaneSprite2->Load(g_cImageFileName[7]);
-
-		if (g_pPlane2->m_vPos.x >= g_pPlane->m_vPos.x - 50.0f)
-		{
-			g_pPlaneSprite->Load(g_cImageFileName[12]);
-
-		}
-
-		GameRenderer.ProcessFrameForOther();
-		GameRenderer.ProcessFrameForOther();
-		GameRenderer.ProcessFrameForOther();
-		g_pPlaneSprite->Load(g_cImageFileName[3]);
-		g_pPlaneSprite2->Load(g_cImageFileName[4]);
-		GameRenderer.ProcessFrameForOther();
-		
+
+	case 0x54: //T, left team tags
+		PressKey(LEFT_TEAM, TAG_INPUT, t);
 		break;
 	  
     
@@ -346,110 +735,480 @@ BOOL KeyboardHandler(WPARAM keystroke){
   return FALSE; //normal exit
 } //KeyboardHandler
 
-/// \brief Window procedure.
+/// \brief Run the game headless.
 ///
-/// Handler for messages from the Windows API. 
-/// \param hwnd Window handle
-/// \param message Message code
-/// \param wParam Parameter for message 
-/// \param lParam Second parameter for message
-/// \return 0 if message is handled
-
-LRESULT CALLBACK WindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam){
-  switch(message){ //handle message
-    case WM_ACTIVATEAPP: g_bActiveApp = (BOOL)wParam; break; //iconize
-
-    case WM_KEYDOWN: //keyboard hit
-		/*if (KeyboardHandler(0X44))
-		{
-			g_pPlaneSprite2->Load(g_cImageFileName[4]);
-			DestroyWindow(hwnd); \
-		}*/
-		if (KeyboardHandler(wParam))
-		{
-			DestroyWindow(hwnd);
-		}
-      break;
-
-    case WM_DESTROY: //on exit
-      GameRenderer.Release(); //release textures
-	
-      delete g_pPlane; //delete the plane object
-      delete g_pPlaneSprite; //delete the plane sprite
-	  delete g_pPlane2; //delete the plane object
-	  delete g_pPlaneSprite2; //delete the plane sprite
-	  SAFE_DELETE(g_pSoundManager);
-      PostQuitMessage(0);
-	 
-      break;
-
-    default: //default window procedure
-      return DefWindowProc(hwnd, message, wParam, lParam);
-  } //switch(message)
+/// Run the game loop for a number of frames on the headless platform,
+/// without a window, a GPU, or sound, rendering into the null backend, to
+/// measure the CPU cost of a frame. The time taken and the number of
+/// commands issued for each frame are written to headless.csv, and the
+/// commands for the last frame to headless.txt. Both players' keys are
+/// pressed from a script, either read from a file or a built-in one that
+/// repeats, and it fails if the keyboard handler ever takes longer than a
+/// bound. The platform clock is simulated, so each key arrives at exactly
+/// the time the script gives, and each frame is rendered as soon as its
+/// tick is due and presented at the next vertical blank. Input latency
+/// comes out the same on every run. It is written to latency.csv, and the
+/// checksum of the simulation state after every tick to checksum.csv, so
+/// that runs of different builds or on different machines can be diffed.
+/// \param frames Number of frames to run.
+/// \param script Name of key script file, or nullptr for the built-in script.
+/// \return 0 if it succeeded.
+
+int RunHeadless(int frames, const char* script){
+  CHeadlessPlatform cPlatform;
+  g_pPlatform = &cPlatform;
+  cPlatform.CreateGameWindow(g_szGameName, g_nScreenWidth, g_nScreenHeight);
+
+  InitHeadlessGraphics();
+  g_cFrameCache.LoadPlaceholders(0, g_cImageFileName.GetCount() - 1,
+    (int)HAMSTER_HT, (int)HAMSTER_HT);
+
+  for(int i=0; i<NUM_TEAMS; i++)
+    g_pFighterSprite[i] = new C3DSprite(); //make a sprite
+  g_pFighterSprite[RIGHT_TEAM]->SetFrame(3);
+  g_pFighterSprite[LEFT_TEAM]->SetFrame(4);
+  CreateObjects(); //create game objects
+
+  const long long TICK = g_cTimestep.GetTickLength(); //simulated frame time
+
+  if(script){
+    if(!cPlatform.LoadScript(script)){
+      ABORT("Cannot load key script %s.", script);
+      return 1;
+    } //if
+  } //if
+
+  else{
+    //keys pressed on each frame of a repeating script, 0 for none, with
+    //attacks overlapping the other player's moves and attacks
+    const int SCRIPTLENGTH = 40;
+    const int nScript[SCRIPTLENGTH] = {
+      0x4C, 0x41, 0x41, 0x47, KEY_LEFT, 0x44, 0x57, 0, 0x46, KEY_UP,
+      0x4B, 0x4B, 0x44, 0x44, KEY_RIGHT, 0x46, 0, 0x4C, 0x41, 0,
+      0x47, KEY_LEFT, 0x4B, 0x57, 0, 0x44, KEY_UP, 0x46, 0, 0x4C,
+      0, 0x41, 0, 0x47, 0x4B, 0, KEY_LEFT, 0, 0x44, 0};
+    unsigned int seed = 1; //for pseudo-random key press times
+
+    for(int i=0; i<frames; i++)
+      if(nScript[i%SCRIPTLENGTH]){ //pressed some time since the last tick
+        seed = seed*1103515245 + 12345;
+        cPlatform.AddKey((i + 1)*TICK - (seed >> 16)%TICK, nScript[i%SCRIPTLENGTH]);
+      } //if
+  } //else
+
+  cPlatform.SetEndTime((frames + 1)*TICK); //in case the frames aren't all drawn by then
+
+  FILE* output = nullptr;
+  if(fopen_s(&output, "headless.csv", "wt") != 0 || output == nullptr){
+    ABORT("Cannot open headless.csv.");
+    return 1;
+  } //if
+
+  fprintf(output, "frame,microseconds,draws,statechanges,elided,bufferupdates,bytes\n");
+
+  FILE* checksums = nullptr;
+  if(fopen_s(&checksums, "checksum.csv", "wt") != 0 || checksums == nullptr){
+    fclose(output);
+    ABORT("Cannot open checksum.csv.");
+    return 1;
+  } //if
+
+  fprintf(checksums, "tick,checksum\n");
+
+  CStateFilterBackend* pFilter = (CStateFilterBackend*)GameRenderer.GetBackend();
+  CNullRenderBackend* pBackend = (CNullRenderBackend*)pFilter->GetBackend();
+  double total = 0.0, worst = 0.0; //in microseconds
+  const long long MAXINPUTTIME = 1000; //longest the handler may take, in microseconds
+  int nFrames = 0; //frames drawn so far
+  chrono::steady_clock::time_point t0; //when the first tick of this frame started
+  bool bFrameStarted = false; //whether t0 is set
+
+  g_cProfiler.Enable(true); //profile the whole run
+
+  CGameLoop cLoop(cPlatform, g_cTimestep, g_cTimer);
+
+  cLoop.Run(
+    [](int key, long long t){
+      return KeyboardHandler(key, t) != FALSE;
+    },
+
+    [&](){
+      if(!bFrameStarted){
+        t0 = chrono::steady_clock::now();
+        bFrameStarted = true;
+      } //if
+      RunTick(); //one tick per frame, as at 60 Hz
+      fprintf(checksums, "%d,%08x\n", g_cSimulation.GetTick(), g_cSimulation.GetChecksum());
+    },
+
+    [&](int ticks, long long tick){
+      if(ticks == 0)return; //woken by a key, nothing new to draw
+
+      PublishSnapshot(tick);
+      g_cSnapshots.Acquire(cPlatform.Now()); //render on this thread
+      GameRenderer.ProcessFrame(g_cSnapshots.GetReadSnapshot());
+      RecordLatency(g_cSnapshots.GetReadSnapshot(), tick + TICK); //at the next vertical blank
+      const double t = chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count();
+      g_cTimer.frames().Record((long long)t);
+      bFrameStarted = false;
+
+      const RenderFrameStats& stats = pBackend->GetLastFrameStats();
+      const RenderFrameStats& elided = pFilter->GetLastFrameElided();
+      fprintf(output, "%d,%0.2f,%d,%d,%d,%d,%u\n", nFrames, t, stats.GetDrawCalls(),
+        stats.GetStateChanges(), elided.GetStateChanges(), stats.GetBufferUpdates(),
+        (unsigned)stats.nBytesUploaded);
+
+      total += t;
+      worst = max(worst, t);
+
+      if(++nFrames == frames)
+        cPlatform.Quit();
+    });
+
+  fclose(output);
+  fclose(checksums);
+
+  if(fopen_s(&output, "headless.txt", "wt") == 0 && output){
+    pBackend->WriteLastFrameLog(output);
+    fclose(output);
+  } //if
+
+  DEBUGPRINTF("Headless: %d frames, mean %0.2f us, worst %0.2f us.\n",
+    nFrames, nFrames > 0? total/nFrames: 0.0, worst);
+
+  CTimeHistogram& f = g_cTimer.frames();
+  DEBUGPRINTF("Headless: p50 %lld us, p95 %lld us, p99 %lld us.\n",
+    f.GetPercentile(50), f.GetPercentile(95), f.GetPercentile(99));
+
+  CTimeHistogram& k = cLoop.GetKeyTimes();
+  DEBUGPRINTF("Headless: %lld key presses, p99 %lld us, max %lld us.\n",
+    k.GetCount(), k.GetPercentile(99), k.GetMax());
+
+  char summary[256];
+  g_cLatency.GetSummary(summary, sizeof(summary));
+  DEBUGPRINTF("Headless: input latency p50/p99 %s.\n", summary);
+  g_cLatency.WriteCSV("latency.csv");
+
+  g_cProfiler.Enable(false);
+  g_cProfiler.WriteTrace("headless_trace.json");
+
+  GameRenderer.Release();
+  g_cSimulation.Clear();
+  for(int i=0; i<NUM_TEAMS; i++)
+    SAFE_DELETE(g_pFighterSprite[i]);
+  g_pPlatform = nullptr;
+
+  if(k.GetMax() > MAXINPUTTIME){
+    DEBUGPRINTF("Headless: keyboard handler took over %lld us.\n", MAXINPUTTIME);
+    return 1;
+  } //if
 
   return 0;
-} //WindowProc
+} //RunHeadless
+
+/// \brief Replay a match as fast as it will go.
+///
+/// Play the keys from a replay file, without a window, a renderer, sound,
+/// or a clock to wait for, so that the simulation runs as fast as the CPU
+/// allows, and report the number of ticks run a second. The team size and
+/// tag-team mode come from the replay, and the rest of the settings must
+/// be the ones it was recorded with. The state is checked against each
+/// checksum in the replay, so a replay also reproduces a bug exactly, and
+/// shows whether a change to the simulation has changed how a match plays
+/// out. The replay is played a number of times, and the time of each
+/// pass is written to replay.csv, so that the fastest pass can be taken as
+/// the benchmark, as the others were slowed by something else.
+/// \param fname Name of replay file.
+/// \param passes Number of times to play it.
+/// \return 0 if every checksum matched.
+
+int RunReplay(const char* fname, int passes){
+  CReplayReader cReplay;
+  if(!cReplay.Load(fname)){
+    ABORT("Cannot load replay %s.", fname);
+    return 1;
+  } //if
+
+  if(cReplay.IsTruncated())
+    DEBUGPRINTF("Replay: %s was cut short, playing what there is.\n", fname);
+
+  g_nTeamSize = min(max(cReplay.GetTeamSize(), 1), MAX_TEAM_SIZE);
+  g_bTagTeam = cReplay.IsTagTeam()? TRUE: FALSE;
+
+  //keys come from the replay, so there's nothing to stamp or record
+  for(int team=0; team<NUM_TEAMS; team++)
+    for(int i=0; i<NUM_INPUTS; i++)
+      g_nInputTime[team][i] = -1;
+
+  FILE* output = nullptr;
+  if(fopen_s(&output, "replay.csv", "wt") != 0 || output == nullptr){
+    ABORT("Cannot open replay.csv.");
+    return 1;
+  } //if
+
+  fprintf(output, "pass,ticks,seconds,tickspersecond\n");
+
+  const int ticks = cReplay.GetTickCount();
+  const vector<ReplayChecksum>& checksums = cReplay.GetChecksums();
+  int nMismatches = 0; //checksums that didn't match, on the first pass
+  int nFirstMismatch = -1; //first tick whose checksum didn't match
+  double best = 0.0; //fastest pass, in ticks a second
+
+  for(int pass=0; pass<max(passes, 1); pass++){
+    CreateObjects(); //fresh, so that handles come out as they did in the match
+    size_t next = 0; //next checksum to check
+
+    const chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+
+    for(int t=0; t<ticks; t++){
+      SimulateTick(cReplay.GetInput(t));
+
+      const int tick = g_cSimulation.GetTick();
+
+      if(next < checksums.size() && checksums[next].nTick == tick){
+        if(pass == 0 && checksums[next].nChecksum != g_cSimulation.GetChecksum()){
+          if(nMismatches++ == 0)nFirstMismatch = tick;
+        } //if
+
+        next++;
+      } //if
+    } //for
+
+    const double seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    const double rate = seconds > 0.0? ticks/seconds: 0.0;
+    best = max(best, rate);
+    fprintf(output, "%d,%d,%0.6f,%0.0f\n", pass, ticks, seconds, rate);
+  } //for
+
+  fclose(output);
+
+  DEBUGPRINTF("Replay: %d ticks from %u bytes, %d passes, best %0.0f ticks a second, "
+    "%0.0f times real time.\n", ticks, (unsigned)cReplay.GetSize(), max(passes, 1), best,
+    best/g_cTimestep.GetTickRate());
+  DEBUGPRINTF("Replay: final checksum %08x, %d of %d checksums matched.\n",
+    g_cSimulation.GetChecksum(), (int)checksums.size() - nMismatches, (int)checksums.size());
+  if(nMismatches > 0)
+    DEBUGPRINTF("Replay: out of step with the recording by tick %d.\n", nFirstMismatch);
+
+  g_cSimulation.Clear();
+  return nMismatches > 0? 1: 0;
+} //RunReplay
+
+/// \brief Start playing online.
+///
+/// Open a UDP link to the other player and start a rollback session on it.
+/// Both machines must have the same settings, and each must play a
+/// different team. The session doesn't wait for the other player, but
+/// stalls a few ticks in until the other player's keys start arriving.
+/// \param address IP address of the other player.
+/// \param port Port the other player listens on.
+/// \param localport Port to listen on.
+/// \param team Team to play, 0 for the right team, 1 for the left.
+/// \return true if it started.
+
+bool StartNetSession(char* address, int port, int localport, int team){
+  g_pNetLink = new IPManager(address, port);
+
+  if(!g_pNetLink->Listen(localport)){
+    SAFE_DELETE(g_pNetLink);
+    return false;
+  } //if
+
+  g_pNetSession = new CNetSession(*g_pNetLink, team, g_nNetWindow);
+  g_vSavedState.resize(g_pNetSession->GetStateSlots());
+  g_pNetSession->SetCallbacks(SimulateTick, SaveState, LoadState,
+    [](){return g_cSimulation.GetChecksum();});
+
+  DEBUGPRINTF("Playing online as the %s team against %s:%d, from port %d.\n",
+    team == RIGHT_TEAM? "right": "left", address, port, localport);
+  return true;
+} //StartNetSession
+
+/// \brief Stop playing online.
+
+void StopNetSession(){
+  SAFE_DELETE(g_pNetSession);
+  SAFE_DELETE(g_pNetLink);
+  g_vSavedState.clear();
+} //StopNetSession
 
 /// \brief Winmain.  
 ///         
 /// Main entry point for this application. 
 /// \param hInst Handle to the current instance of this application.
 /// \param hPrevInst Handle to previous instance, deprecated.
-/// \param lpCmdLine Command line string, unused. 
+/// \param lpCmdLine Command line string, "-headless n" to run n frames headless,
+/// with "-script file" to take keys from a script file, "-profile" to
+/// profile from startup, "-net address port localport team" to play
+/// online against another machine, with team 0 for right and 1 for left,
+/// "-record file" to record the keys pressed offline to a replay file, and
+/// "-replay file" to replay one as fast as it will go, with "-passes n" to
+/// replay it n times.
 /// \param nShow Specifies how the window is to be shown.
 /// \return TRUE if application terminates correctly.
 
 int WINAPI WinMain(HINSTANCE hInst, HINSTANCE hPrevInst, LPSTR lpCmdLine, int nShow){
-  MSG msg; //current message
-  HWND hwnd; //handle to fullscreen window
-
   #ifdef DEBUG_ON
     g_cDebugManager.open(); //open debug streams, settings came from XML file
   #endif //DEBUG_ON
 
   g_hInstance = hInst;
   g_cTimer.start(); //start game timer
+  g_cProfiler.SetThreadName("main");
+  if(strstr(lpCmdLine, "-profile"))
+    g_cProfiler.Enable(true); //so that loading is profiled too
   InitXMLSettings(); //initialize XML settings reader
   LoadGameSettings();
 
+  char replay[MAX_PATH] = ""; //replay file to play
+  const char* r = strstr(lpCmdLine, "-replay ");
+  if(r && sscanf_s(r, "-replay %259s", replay, (unsigned)sizeof(replay)) == 1){
+    int nPasses = 1; //times to play it
+    const char* p = strstr(lpCmdLine, "-passes ");
+    if(p)sscanf_s(p, "-passes %d", &nPasses);
+    return RunReplay(replay, nPasses);
+  } //if
+
+  char record[MAX_PATH] = ""; //replay file to record to
+  const char* rec = strstr(lpCmdLine, "-record ");
+  if(rec)sscanf_s(rec, "-record %259s", record, (unsigned)sizeof(record));
+
+  int nHeadlessFrames = 0; //run headless to measure frame cost
+  if(sscanf_s(lpCmdLine, "-headless %d", &nHeadlessFrames) == 1 && nHeadlessFrames > 0){
+    char script[MAX_PATH] = ""; //key script file name
+    const char* p = strstr(lpCmdLine, "-script ");
+    if(p)sscanf_s(p, "-script %259s", script, (unsigned)sizeof(script));
+    if(record[0] && !g_cReplayWriter.Open(record, g_nTeamSize, g_bTagTeam != FALSE))
+      ABORT("Cannot open replay %s.", record);
+    const int result = RunHeadless(nHeadlessFrames, script[0]? script: nullptr);
+    g_cReplayWriter.Close();
+    return result;
+  } //if
+
+  CWin32Platform cPlatform(hInst, nShow);
+  g_pPlatform = &cPlatform;
+
+  //start reading and decoding images and sounds on worker threads, so that
+  //it overlaps window creation and shader compilation
+  const int NUMSOUNDS = 4;
+  const char* szSoundFile[NUMSOUNDS] = {
+    "Sounds\\PUNCH.wav", "Sounds\\kick.wav", "Sounds\\theme.wav", "Sounds\\jump.wav"};
+  const int nSoundInstances[NUMSOUNDS] = {15, 15, 1, 15};
+  LoadedAsset cSound[NUMSOUNDS]; //sounds must be added in order
+
+  //images that the texture compressor has done come from their DDS files
+  GameRenderer.LoadTextureManifest("textures.xml");
+
+  CAssetLoader* pAssetLoader = new CAssetLoader;
+  for(int i=0; i<g_cImageFileName.GetCount(); i++){
+    const char* dds = GameRenderer.GetCompressedTextureName(g_cImageFileName[i]);
+    if(dds)pAssetLoader->QueueDDS(i, dds);
+    else pAssetLoader->QueueImage(i, g_cImageFileName[i]);
+  } //for
+  for(int i=0; i<NUMSOUNDS; i++)
+    pAssetLoader->QueueSound(i, szSoundFile[i]);
+
   //create fullscreen window
-  hwnd = CreateDefaultWindow(g_szGameName, hInst, nShow);
-  if(!hwnd)return FALSE; //bail if problem creating window
-  g_HwndApp = hwnd; //save window handle
+  if(!cPlatform.CreateGameWindow(g_szGameName, g_nScreenWidth, g_nScreenHeight))
+    return FALSE; //bail if problem creating window
+  g_HwndApp = cPlatform.GetWindow(); //save window handle
   g_pSoundManager = new CSoundManager(5);
-  g_pSoundManager->Load("Sounds\\PUNCH.wav", 15);
-  g_pSoundManager->Load("Sounds\\kick.wav", 15);
-  g_pSoundManager->Load("Sounds\\theme.wav", 1);
-  g_pSoundManager->Load("Sounds\\jump.wav", 15);
   
   InitGraphics(); //initialize graphics
-  g_pPlaneSprite = new C3DSprite(); //make a sprite
-  g_pPlaneSprite2 = new C3DSprite(); //make a sprite
-  GameRenderer.LoadTextures(); //load images
+  g_cShaderCache.Report(); //how long did the shaders take?
+  for(int i=0; i<NUM_TEAMS; i++)
+    g_pFighterSprite[i] = new C3DSprite(); //make a sprite
+
+  //create textures as images arrive, keep sounds until they're all here
+  pAssetLoader->Finish(
+    [&](LoadedAsset& asset){
+      DEBUGPRINTF("Loaded %s: read %0.1f ms, decode %0.1f ms%s.\n", asset.strFileName.c_str(),
+        asset.fReadTime, asset.fDecodeTime, asset.bSucceeded? "": " (failed)");
+      if(!asset.bSucceeded)return; //will be loaded the slow way below
+
+      if(asset.nType == SOUND_ASSET)
+        cSound[asset.nTag] = move(asset);
+
+      else{
+        ID3D11ShaderResourceView* pTexture = nullptr;
+        if(asset.nType == DDS_ASSET)
+          GameRenderer.CreateTextureFromDDS(pTexture, asset.pData.get(), asset.nDataBytes);
+        else GameRenderer.CreateTexture(pTexture, asset.pData.get(), asset.nWidth, asset.nHeight);
+        if(pTexture == nullptr)return;
+
+        if(asset.nTag < 3)
+          GameRenderer.SetBackgroundTexture(asset.nTag, pTexture);
+        else g_cFrameCache.Insert(asset.nTag, pTexture, asset.nWidth, asset.nHeight);
+      } //else
+    },
+    [&](int done, int total){
+      char buffer[256];
+      sprintf_s(buffer, "%s - Loading %d/%d", g_szGameName, done, total);
+      cPlatform.SetTitle(buffer);
+    });
+
+  SAFE_DELETE(pAssetLoader);
+  cPlatform.SetTitle(g_szGameName);
+
+  for(int i=0; i<NUMSOUNDS; i++)
+    if(cSound[i].bSucceeded)
+      g_pSoundManager->Load(cSound[i].pData, cSound[i].pWaveFormat,
+        cSound[i].pSamples, cSound[i].nSampleBytes, nSoundInstances[i]);
+    else g_pSoundManager->Load((char*)szSoundFile[i], nSoundInstances[i]);
+
+  GameRenderer.LoadTextures(); //load any images that the asset loader couldn't
   
 
-  if(!g_pPlaneSprite->Load(g_cImageFileName[3])) //plane sprite
-    ABORT("Plane image %s not found.", g_cImageFileName[3]);
-  if (!g_pPlaneSprite2->Load(g_cImageFileName[4])) //plane sprite
-	  ABORT("Plane image %s not found.", g_cImageFileName[4]);
+  //decode every fighter frame once, up front, into atlases if they've been packed
+  g_cFrameCache.LoadAtlases("atlas.xml");
+  if(!g_cFrameCache.Load(g_cImageFileName, 3, g_cImageFileName.GetCount() - 1))
+    ABORT("Cannot load sprite frames.");
+
+  if(!g_pFighterSprite[RIGHT_TEAM]->SetFrame(3)) //right team sprite
+    ABORT("Fighter image %s not found.", g_cImageFileName[3]);
+  if(!g_pFighterSprite[LEFT_TEAM]->SetFrame(4)) //left team sprite
+    ABORT("Fighter image %s not found.", g_cImageFileName[4]);
 
   CreateObjects(); //create game objects
+
+  char szPeer[16]; //other player's IP address when online
+  int nPeerPort = 0, nLocalPort = 0, nTeam = 0; //other player's port, ours, and our team
+  const char* net = strstr(lpCmdLine, "-net ");
+  if(net && sscanf_s(net, "-net %15s %d %d %d", szPeer, (unsigned)sizeof(szPeer),
+    &nPeerPort, &nLocalPort, &nTeam) == 4 && !StartNetSession(szPeer, nPeerPort, nLocalPort, nTeam))
+    ABORT("Cannot listen for the other player on port %d.", nLocalPort);
+
+  if(record[0]){ //online, a tick can be run again with other keys, so only offline play is recorded
+    if(g_pNetSession)DEBUGPRINTF("Matches played online aren't recorded.\n");
+    else if(!g_cReplayWriter.Open(record, g_nTeamSize, g_bTagTeam != FALSE))
+      ABORT("Cannot open replay %s.", record);
+  } //if
+
+  StartRenderThread(); //render on another thread from now on
  
 
  
- //message loop
-  while (TRUE)
-	  if (PeekMessage(&msg, nullptr, 0, 0, PM_NOREMOVE)) { //if message waiting
-		  if (!GetMessage(&msg, nullptr, 0, 0))return (int)msg.wParam; //get it
-		  TranslateMessage(&msg); DispatchMessage(&msg); //translate it
-	  } //if
-	  else
-		  if (g_bActiveApp)
-		  {
-			  g_pSoundManager->play(2);
-			  GameRenderer.ProcessFrame();
-			 
-			 
-		  }
-      else WaitMessage();
+  //game loop, until the window is closed or escape is pressed
+  CGameLoop cLoop(cPlatform, g_cTimestep, g_cTimer);
+  cLoop.Run(
+    [](int key, long long t){
+      return KeyboardHandler(key, t) != FALSE;
+    },
+    RunTick, RunFrame, RunIdle);
+
+  //on exit
+  StopRenderThread(); //the renderer is ours again
+  g_cLatency.WriteCSV("latency.csv");
+  StopNetSession();
+  g_cReplayWriter.Close();
+  GameRenderer.Release(); //release textures
+
+  g_cSimulation.Clear(); //delete the fighters
+  for(int i=0; i<NUM_TEAMS; i++)
+    SAFE_DELETE(g_pFighterSprite[i]); //delete the fighter sprites
+  SAFE_DELETE(g_pSoundManager);
+
+  cPlatform.DestroyGameWindow();
+  g_pPlatform = nullptr;
+  return 0;
 } //WinMain
@@ -0,0 +1,20 @@
+/// \file NetLink.h
+/// \brief Interface for the network link class CNetLink.
+
+#pragma once
+
+/// \brief A link to a peer on the network.
+///
+/// A link sends and receives datagrams to and from one peer. Datagrams
+/// may be lost, duplicated or arrive out of order, and receiving never
+/// waits, so that a net session can poll its link once a tick. IPManager
+/// is a link over UDP, and a link can equally be a pipe in memory, or a
+/// wrapper round another link that delays and drops datagrams for testing.
+
+class CNetLink{
+  public:
+    virtual ~CNetLink(){}; ///< Destructor.
+
+    virtual bool Send(const unsigned char* p, int n) = 0; ///< Send a datagram.
+    virtual int Receive(unsigned char* p, int size) = 0; ///< Receive a datagram, if one is waiting.
+}; //CNetLink
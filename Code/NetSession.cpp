@@ -0,0 +1,349 @@
+/// \file NetSession.cpp
+/// \brief Code for the rollback net session class CNetSession.
+///
+/// A packet is a header followed by a run of the sender's inputs, one
+/// byte per tick, and a run of the sender's checksums, four bytes per
+/// tick, with every number little-endian so that it means the same on any
+/// machine:
+///
+///     byte 0      NET_MAGIC
+///     bytes 1-4   tick of the first input in the packet
+///     byte 5      number of inputs in the packet
+///     bytes 6-9   number of the receiver's inputs the sender has
+///     bytes 10-13 tick of the first checksum in the packet
+///     byte 14     number of checksums in the packet
+///     bytes 15-18 number of the receiver's checksums the sender has
+///     bytes 19-   inputs, then checksums
+
+#include <limits.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "NetSession.h"
+
+static const unsigned char NET_MAGIC = 0xB7; ///< First byte of every packet.
+
+const int CNetSession::MAX_WINDOW;
+const int CNetSession::MAX_PACKET_INPUTS;
+const int CNetSession::MAX_PACKET_CHECKSUMS;
+
+/// Write an int into a packet.
+/// \param p Where to put it.
+/// \param n The int.
+
+static void PutInt(unsigned char* p, int n){
+  const unsigned u = (unsigned)n;
+
+  for(int i=0; i<4; i++)
+    p[i] = (unsigned char)(u >> (8*i));
+} //PutInt
+
+/// Read an int from a packet.
+/// \param p Where it is.
+/// \return The int.
+
+static int GetInt(const unsigned char* p){
+  unsigned u = 0;
+
+  for(int i=0; i<4; i++)
+    u |= (unsigned)p[i] << (8*i);
+
+  return (int)u;
+} //GetInt
+
+/// \param link Link to the peer, which must outlast the session.
+/// \param local Local player, 0 or 1. The peer must be the other.
+/// \param window Most ticks to run ahead of the last remote input, from 1
+/// to MAX_WINDOW. A bigger window rides out more latency without stalling,
+/// at the cost of longer rollbacks.
+
+CNetSession::CNetSession(CNetLink& link, int local, int window):
+  m_cLink(link),
+  m_nLocal(local == 0? 0: 1),
+  m_nWindow(min(max(window, 1), MAX_WINDOW)),
+  m_nTick(0),
+  m_nRemoteCount(0),
+  m_nAcked(0),
+  m_nRemoteChecksums(0),
+  m_nChecksumsAcked(0),
+  m_nCompared(0),
+  m_nRollbackTo(INT_MAX),
+  m_bRollingBack(false)
+{
+  memset(m_nLocalInput, 0, sizeof(m_nLocalInput));
+  memset(m_nRemoteInput, 0, sizeof(m_nRemoteInput));
+  memset(m_nUsedInput, 0, sizeof(m_nUsedInput));
+  memset(m_nChecksum, 0, sizeof(m_nChecksum));
+  memset(m_nRemoteChecksum, 0, sizeof(m_nRemoteChecksum));
+
+  memset(&m_cStats, 0, sizeof(m_cStats));
+  m_cStats.nFirstDesync = -1;
+  m_cTimer.start();
+} //constructor
+
+/// Set the callbacks that reach the game. They must be set before the
+/// first tick is advanced.
+/// \param tick Runs a tick with both players' inputs.
+/// \param save Saves the state to a slot, from 0 to GetStateSlots() - 1.
+/// \param load Loads the state from a slot.
+/// \param checksum Checksums the state.
+
+void CNetSession::SetCallbacks(const NetTickCallback& tick, const NetStateCallback& save,
+  const NetStateCallback& load, const NetChecksumCallback& checksum)
+{
+  m_fnTick = tick;
+  m_fnSave = save;
+  m_fnLoad = load;
+  m_fnChecksum = checksum;
+} //SetCallbacks
+
+/// Take in every packet waiting on the link. A link returns a negative
+/// number for a datagram too big for the buffer, which can't be one of ours.
+
+void CNetSession::Poll(){
+  unsigned char p[256];
+  int n;
+
+  while((n = m_cLink.Receive(p, sizeof(p))) != 0){
+    m_cStats.nPacketsReceived++;
+    if(n < 0)m_cStats.nBadPackets++;
+    else Read(p, n);
+  } //while
+} //Poll
+
+/// Take in a packet. Remote inputs and checksums are only taken in order,
+/// without gaps, and any inputs that weren't what a tick was run with mark
+/// that tick to be run again.
+/// \param p Packet.
+/// \param n Size of packet in bytes.
+
+void CNetSession::Read(const unsigned char* p, int n){
+  if(n < HEADER_BYTES || p[0] != NET_MAGIC || n != HEADER_BYTES + p[5] + 4*p[14]){
+    m_cStats.nBadPackets++;
+    return;
+  } //if
+
+  const int first = GetInt(p + 1);
+  const int count = p[5];
+  const int ack = GetInt(p + 6);
+  const int firstsum = GetInt(p + 10);
+  const int sums = p[14];
+  const int sumack = GetInt(p + 15);
+
+  m_nAcked = max(m_nAcked, min(ack, m_nTick)); //can't have more than were sent
+  m_nChecksumsAcked = max(m_nChecksumsAcked, min(sumack, GetConfirmed()));
+
+  for(int i=0; i<count; i++){
+    const int t = first + i;
+    if(t < m_nRemoteCount)continue; //already have it
+    if(t > m_nRemoteCount || t - m_nTick >= RING/2)break; //gap, or too far ahead to keep
+
+    const NetInput input = p[HEADER_BYTES + i];
+    m_nRemoteInput[t%RING] = input;
+    m_nRemoteCount++;
+
+    if(t < m_nTick && m_nUsedInput[t%RING] != input) //mispredicted
+      m_nRollbackTo = min(m_nRollbackTo, t);
+  } //for
+
+  const unsigned char* q = p + HEADER_BYTES + count; //checksums
+
+  for(int i=0; i<sums; i++){
+    const int t = firstsum + i;
+    if(t < m_nRemoteChecksums)continue; //already have it
+    if(t > m_nRemoteChecksums || t - m_nCompared >= RING)break; //gap, or too far ahead to keep
+
+    m_nRemoteChecksum[t%RING] = (unsigned)GetInt(q + 4*i);
+    m_nRemoteChecksums++;
+  } //for
+} //Read
+
+/// Send a packet with every local input the peer hasn't acknowledged, and
+/// every checksum for a tick run with both players' inputs that the peer
+/// hasn't acknowledged, each up to a limit, with the oldest first.
+
+void CNetSession::Send(){
+  unsigned char p[HEADER_BYTES + MAX_PACKET_INPUTS + 4*MAX_PACKET_CHECKSUMS];
+  const int count = min(m_nTick - m_nAcked, MAX_PACKET_INPUTS);
+  const int sums = min(GetConfirmed() - m_nChecksumsAcked, MAX_PACKET_CHECKSUMS);
+
+  p[0] = NET_MAGIC;
+  PutInt(p + 1, m_nAcked);
+  p[5] = (unsigned char)count;
+  PutInt(p + 6, m_nRemoteCount);
+  PutInt(p + 10, m_nChecksumsAcked);
+  p[14] = (unsigned char)sums;
+  PutInt(p + 15, m_nRemoteChecksums);
+
+  for(int i=0; i<count; i++)
+    p[HEADER_BYTES + i] = m_nLocalInput[(m_nAcked + i)%RING];
+
+  unsigned char* q = p + HEADER_BYTES + count; //checksums
+
+  for(int i=0; i<sums; i++)
+    PutInt(q + 4*i, (int)m_nChecksum[(m_nChecksumsAcked + i)%RING]);
+
+  if(m_cLink.Send(p, HEADER_BYTES + count + 4*sums))
+    m_cStats.nPacketsSent++;
+} //Send
+
+/// Run the next tick with the local input and the remote input, or the
+/// prediction of it if it hasn't arrived, which is that nothing was
+/// pressed. The state is saved first, in case the tick has to be run
+/// again, and checksummed after.
+
+void CNetSession::RunTick(){
+  const int i = m_nTick%RING;
+  m_fnSave(m_nTick%GetStateSlots());
+
+  NetInput input[2];
+  input[m_nLocal] = m_nLocalInput[i];
+  input[1 - m_nLocal] = m_nUsedInput[i] = m_nTick < m_nRemoteCount? m_nRemoteInput[i]: 0;
+
+  m_fnTick(input);
+  m_nChecksum[i] = m_fnChecksum();
+  m_nTick++;
+} //RunTick
+
+/// If a remote input was mispredicted, load the state from before the
+/// earliest such tick and run every tick since again. The window makes
+/// sure that the state is still in its slot.
+
+void CNetSession::Rollback(){
+  if(m_nRollbackTo >= m_nTick)return;
+
+  const long long t0 = m_cTimer.microseconds();
+  const int target = m_nTick;
+  const int n = target - m_nRollbackTo;
+
+  m_fnLoad(m_nRollbackTo%GetStateSlots());
+  m_nTick = m_nRollbackTo;
+  m_bRollingBack = true;
+  while(m_nTick < target)
+    RunTick();
+  m_bRollingBack = false;
+
+  m_nRollbackTo = INT_MAX;
+  m_cStats.nRollbacks++;
+  m_cStats.nResimulated += n;
+  m_cStats.nMaxRollback = max(m_cStats.nMaxRollback, n);
+  m_cRollbackTimes.Record(m_cTimer.microseconds() - t0);
+} //Rollback
+
+/// Compare the peer's checksums with ours, in order of tick, for every
+/// tick that both of us have run with both players' inputs. Each tick is
+/// compared once. Advance() stalls rather than let a checksum that hasn't
+/// been compared yet fall out of the ring.
+
+void CNetSession::Compare(){
+  const int n = min(m_nRemoteChecksums, GetConfirmed()); //ticks that can be compared
+
+  for(; m_nCompared<n; m_nCompared++){
+    const int i = m_nCompared%RING;
+    m_cStats.nChecksums++;
+
+    if(m_nRemoteChecksum[i] != m_nChecksum[i]){
+      m_cStats.nDesyncs++;
+      if(m_cStats.nFirstDesync < 0)
+        m_cStats.nFirstDesync = m_nCompared;
+    } //if
+  } //for
+} //Compare
+
+/// Run the next tick, unless it would be more than a window of ticks ahead
+/// of the last remote input, or the peer is too far behind in receiving
+/// local inputs or checksums. That keeps every checksum in the ring until
+/// it has been sent and compared. Any rollback is done first, whether the
+/// tick is run or not.
+/// \param input Local player's input for the tick.
+/// \return true if the tick was run, false if it stalled, in which case
+/// the same input is to be given again next time.
+
+bool CNetSession::Advance(NetInput input){
+  Poll();
+  Rollback();
+
+  const bool stall = m_nTick - m_nRemoteCount >= m_nWindow ||
+    m_nTick - m_nAcked >= MAX_PACKET_INPUTS ||
+    GetConfirmed() - m_nChecksumsAcked >= MAX_PACKET_CHECKSUMS ||
+    m_nTick - m_nCompared >= RING;
+
+  if(stall)m_cStats.nStalls++;
+
+  else{
+    m_nLocalInput[m_nTick%RING] = input;
+    RunTick();
+    m_cStats.nTicks++;
+  } //else
+
+  Compare();
+  Send();
+  return !stall;
+} //Advance
+
+/// Keep in touch with the peer without running a tick, for example while
+/// the game isn't the active application, so that the peer isn't left
+/// waiting for acknowledgements.
+
+void CNetSession::Idle(){
+  Poll();
+  Rollback();
+  Compare();
+  Send();
+} //Idle
+
+/// \return Number of ticks whose state is final, having been run with the
+/// actual inputs of both players.
+
+int CNetSession::GetConfirmed() const{
+  return min(m_nRemoteCount, m_nTick);
+} //GetConfirmed
+
+/// \return Number of ticks run, which is also the next tick to run.
+
+int CNetSession::GetTick() const{
+  return m_nTick;
+} //GetTick
+
+/// \return true while ticks are being run again after a rollback, during
+/// which the game should make no sound and record nothing about its inputs.
+
+bool CNetSession::IsRollingBack() const{
+  return m_bRollingBack;
+} //IsRollingBack
+
+/// \return Local player, 0 or 1.
+
+int CNetSession::GetLocalPlayer() const{
+  return m_nLocal;
+} //GetLocalPlayer
+
+/// \return Number of slots the state is saved in, one more than the window.
+
+int CNetSession::GetStateSlots() const{
+  return m_nWindow + 1;
+} //GetStateSlots
+
+/// \return Statistics since they were last reset.
+
+const NetStats& CNetSession::GetStats() const{
+  return m_cStats;
+} //GetStats
+
+/// \return Histogram of the time taken by each rollback to run ticks again,
+/// in microseconds.
+
+CTimeHistogram& CNetSession::GetRollbackTimes(){
+  return m_cRollbackTimes;
+} //GetRollbackTimes
+
+/// Zero the statistics, except for the first tick to desync, which is
+/// kept, since nothing after it can be trusted.
+
+void CNetSession::ResetStats(){
+  const int first = m_cStats.nFirstDesync;
+  memset(&m_cStats, 0, sizeof(m_cStats));
+  m_cStats.nFirstDesync = first;
+  m_cRollbackTimes.Clear();
+} //ResetStats
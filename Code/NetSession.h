@@ -0,0 +1,132 @@
+/// \file NetSession.h
+/// \brief Interface for the rollback net session class CNetSession.
+
+#pragma once
+
+#include <functional>
+
+#include "NetLink.h"
+#include "Timer.h"
+
+using namespace std;
+
+typedef unsigned char NetInput; ///< Bit mask of the keys a player pressed for a tick.
+
+/// Callback to run one tick of the simulation, given each player's input
+/// for it, indexed by player.
+
+typedef function<void(const NetInput* input)> NetTickCallback;
+
+/// Callback to save the game state to a slot, or load it from one.
+
+typedef function<void(int slot)> NetStateCallback;
+
+/// Callback for the checksum of the game state.
+
+typedef function<unsigned()> NetChecksumCallback;
+
+/// \brief Net session statistics.
+
+struct NetStats{
+  int nTicks; ///< Ticks advanced.
+  int nStalls; ///< Ticks not advanced for being too far ahead of the peer.
+  int nRollbacks; ///< Times the state was rolled back.
+  int nResimulated; ///< Ticks run again after a rollback.
+  int nMaxRollback; ///< Most ticks run again for one rollback.
+  int nPacketsSent; ///< Packets sent.
+  int nPacketsReceived; ///< Packets received, good or bad.
+  int nBadPackets; ///< Packets received that weren't understood.
+  int nChecksums; ///< Checksums compared with the peer's.
+  int nDesyncs; ///< Checksums that differed from the peer's.
+  int nFirstDesync; ///< First tick whose checksum differed, -1 if none.
+}; //NetStats
+
+/// \brief A rollback net session for two players.
+///
+/// The net session runs the simulation for two players on two machines,
+/// each of which has all of the game state and runs every tick. Each
+/// tick, the local player's input goes to the peer over a link, along
+/// with any earlier inputs the peer hasn't acknowledged, so that a lost
+/// packet costs nothing but a little time. The tick is run at once, without
+/// waiting for the remote player's input, which is predicted. Inputs are
+/// key presses rather than keys held, so the prediction is that nothing
+/// was pressed, which is usually right. When the remote input for a tick
+/// arrives and it isn't what was predicted, the state is loaded as it was
+/// before that tick, and that tick and every one since is run again with
+/// the inputs now known, all within one call to Advance(). The state is
+/// saved before every tick so that there is always a state to go back to.
+///
+/// The session never gets more than a window of ticks ahead of the last
+/// remote input it has, and stalls instead, so the state never needs
+/// to go back further than that. Each side also sends the checksum of the
+/// state after every tick for which it has both players' inputs, again
+/// until the peer acknowledges it, and compares each of the peer's
+/// checksums with its own for the same tick, to catch the two simulations
+/// drifting apart, which they should never do.
+///
+/// The session knows nothing about the game, which it reaches through
+/// callbacks, or about the network, which it reaches through a link.
+
+class CNetSession{
+  public:
+    static const int MAX_WINDOW = 15; ///< Most ticks the state can go back.
+
+  private:
+    static const int RING = 128; ///< Ticks of inputs and checksums kept.
+    static const int MAX_PACKET_INPUTS = 32; ///< Most inputs sent in one packet.
+    static const int MAX_PACKET_CHECKSUMS = 32; ///< Most checksums sent in one packet.
+    static const int HEADER_BYTES = 19; ///< Size of a packet without its inputs and checksums.
+
+    CNetLink& m_cLink; ///< Link to the peer.
+    int m_nLocal; ///< Local player, 0 or 1.
+    int m_nWindow; ///< Most ticks to run ahead of the last remote input.
+
+    NetTickCallback m_fnTick; ///< Runs a tick.
+    NetStateCallback m_fnSave; ///< Saves the state to a slot.
+    NetStateCallback m_fnLoad; ///< Loads the state from a slot.
+    NetChecksumCallback m_fnChecksum; ///< Checksums the state.
+
+    int m_nTick; ///< Next tick to run, which is the number run so far.
+    int m_nRemoteCount; ///< Number of remote inputs received, from tick 0 on.
+    int m_nAcked; ///< Number of local inputs the peer has received.
+    int m_nRemoteChecksums; ///< Number of remote checksums received, from tick 0 on.
+    int m_nChecksumsAcked; ///< Number of local checksums the peer has received.
+    int m_nCompared; ///< Number of ticks whose checksums have been compared.
+    int m_nRollbackTo; ///< Earliest tick to run again, INT_MAX if none.
+    bool m_bRollingBack; ///< Whether ticks are being run again.
+
+    NetInput m_nLocalInput[RING]; ///< Local inputs by tick.
+    NetInput m_nRemoteInput[RING]; ///< Remote inputs received, by tick.
+    NetInput m_nUsedInput[RING]; ///< Remote inputs that ticks were last run with.
+    unsigned m_nChecksum[RING]; ///< Checksum of the state after each tick.
+    unsigned m_nRemoteChecksum[RING]; ///< Remote checksums received, by tick.
+
+    NetStats m_cStats; ///< Statistics.
+    CTimer m_cTimer; ///< Clock for timing rollbacks.
+    CTimeHistogram m_cRollbackTimes; ///< Time taken to run ticks again, per rollback.
+
+    void Poll(); ///< Take in every packet waiting.
+    void Read(const unsigned char* p, int n); ///< Take in a packet.
+    void Send(); ///< Send a packet.
+    void Rollback(); ///< Go back and run ticks again.
+    void RunTick(); ///< Run the next tick.
+    void Compare(); ///< Compare the peer's checksums with ours.
+    int GetConfirmed() const; ///< Number of ticks run with both players' inputs.
+
+  public:
+    CNetSession(CNetLink& link, int local, int window); ///< Constructor.
+
+    void SetCallbacks(const NetTickCallback& tick, const NetStateCallback& save,
+      const NetStateCallback& load, const NetChecksumCallback& checksum); ///< Set game callbacks.
+
+    bool Advance(NetInput input); ///< Run the next tick with the local player's input.
+    void Idle(); ///< Keep in touch with the peer without running a tick.
+
+    int GetTick() const; ///< Number of ticks run.
+    bool IsRollingBack() const; ///< Whether ticks are being run again.
+    int GetLocalPlayer() const; ///< Local player, 0 or 1.
+    int GetStateSlots() const; ///< Number of state slots the game must keep.
+    const NetStats& GetStats() const; ///< Statistics.
+    CTimeHistogram& GetRollbackTimes(); ///< Time taken to run ticks again, per rollback.
+    void ResetStats(); ///< Zero statistics, other than the first desync.
+}; //CNetSession
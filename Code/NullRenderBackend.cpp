@@ -0,0 +1,141 @@
+/// \file NullRenderBackend.cpp
+/// \brief Code for the null render backend class CNullRenderBackend.
+
+#include <string.h>
+
+#include "NullRenderBackend.h"
+
+/// Add a command to the log for the frame in progress, and count it.
+/// \param t Command type.
+/// \param bytes Number of bytes the command uploads, if any.
+/// \return Reference to the new log entry, nulled out.
+
+RenderCommand& CNullRenderBackend::Record(RenderCommandType t, size_t bytes){
+  Count(t, bytes);
+
+  RenderCommand command;
+  memset(&command, 0, sizeof(command));
+  command.nType = t;
+  command.nBytes = bytes;
+
+  m_vLog.push_back(command);
+  return m_vLog.back();
+} //Record
+
+void CNullRenderBackend::SetRenderTarget(){
+  Record(SET_RENDER_TARGET_COMMAND);
+} //SetRenderTarget
+
+void CNullRenderBackend::Clear(const float color[4]){
+  Record(CLEAR_COMMAND);
+} //Clear
+
+void CNullRenderBackend::SetShaders(RenderHandle layout, RenderHandle vs, RenderHandle ps){
+  RenderCommand& command = Record(SET_SHADERS_COMMAND);
+  command.hResource[0] = layout;
+  command.hResource[1] = vs;
+  command.hResource[2] = ps;
+} //SetShaders
+
+void CNullRenderBackend::SetTopology(RenderTopology t){
+  Record(SET_TOPOLOGY_COMMAND).nArg[0] = t;
+} //SetTopology
+
+/// Record setting vertex buffers. Only the first three buffers are
+/// kept in the log, which is all the game uses.
+
+void CNullRenderBackend::SetVertexBuffers(int n, const RenderHandle* buffers, const unsigned* strides){
+  RenderCommand& command = Record(SET_VERTEX_BUFFERS_COMMAND);
+  command.nArg[0] = n;
+
+  for(int i=0; i<n && i<3; i++){
+    command.hResource[i] = buffers[i];
+    command.nArg[i + 1] = (int)strides[i];
+  } //for
+} //SetVertexBuffers
+
+void CNullRenderBackend::UpdateBuffer(RenderHandle buffer, const void* data, size_t bytes){
+  Record(UPDATE_BUFFER_COMMAND, bytes).hResource[0] = buffer;
+} //UpdateBuffer
+
+/// Record overwriting a dynamic buffer, copying the data into scratch
+/// memory as mapping a real buffer would.
+
+bool CNullRenderBackend::WriteBuffer(RenderHandle buffer, const void* data, size_t bytes){
+  Record(WRITE_BUFFER_COMMAND, bytes).hResource[0] = buffer;
+
+  if(m_vScratch.size() < bytes)
+    m_vScratch.resize(bytes);
+  if(bytes > 0)
+    memcpy(m_vScratch.data(), data, bytes);
+
+  return true;
+} //WriteBuffer
+
+void CNullRenderBackend::SetConstantBuffer(int slot, RenderHandle buffer){
+  RenderCommand& command = Record(SET_CONSTANT_BUFFER_COMMAND);
+  command.hResource[0] = buffer;
+  command.nArg[0] = slot;
+} //SetConstantBuffer
+
+void CNullRenderBackend::SetTexture(int slot, RenderHandle texture){
+  RenderCommand& command = Record(SET_TEXTURE_COMMAND);
+  command.hResource[0] = texture;
+  command.nArg[0] = slot;
+} //SetTexture
+
+void CNullRenderBackend::SetBlendState(RenderHandle state){
+  Record(SET_BLEND_STATE_COMMAND).hResource[0] = state;
+} //SetBlendState
+
+void CNullRenderBackend::SetRasterizerState(RenderHandle state){
+  Record(SET_RASTERIZER_STATE_COMMAND).hResource[0] = state;
+} //SetRasterizerState
+
+void CNullRenderBackend::Draw(int vertices, int first){
+  RenderCommand& command = Record(DRAW_COMMAND);
+  command.nArg[0] = vertices;
+  command.nArg[1] = first;
+} //Draw
+
+void CNullRenderBackend::DrawInstanced(int vertices, int instances, int firstvertex, int firstinstance){
+  RenderCommand& command = Record(DRAW_INSTANCED_COMMAND);
+  command.nArg[0] = vertices;
+  command.nArg[1] = instances;
+  command.nArg[2] = firstvertex;
+  command.nArg[3] = firstinstance;
+} //DrawInstanced
+
+/// Record presenting the frame. The log for this frame becomes the last
+/// frame's log, and a new one is started.
+
+void CNullRenderBackend::Present(int interval){
+  Record(PRESENT_COMMAND).nArg[0] = interval;
+
+  m_vLastLog.swap(m_vLog);
+  m_vLog.clear(); //keeps its capacity, so no allocation next frame
+  EndFrame();
+} //Present
+
+/// Get the commands recorded for the last frame presented.
+/// \return The command log.
+
+const vector<RenderCommand>& CNullRenderBackend::GetLastFrameLog() const{
+  return m_vLastLog;
+} //GetLastFrameLog
+
+/// Print the commands recorded for the last frame, one per line, with
+/// handles and arguments. Handles differ from run to run, so compare
+/// logs by command and argument, not by handle value.
+/// \param output File to print to.
+
+void CNullRenderBackend::WriteLastFrameLog(FILE* output) const{
+  for(int i=0; i<(int)m_vLastLog.size(); i++){
+    const RenderCommand& command = m_vLastLog[i];
+
+    fprintf(output, "%s %p %p %p %d %d %d %d %u\n", GetRenderCommandName(command.nType),
+      command.hResource[0], command.hResource[1], command.hResource[2],
+      command.nArg[0], command.nArg[1], command.nArg[2], command.nArg[3],
+      (unsigned)command.nBytes);
+  } //for
+} //WriteLastFrameLog
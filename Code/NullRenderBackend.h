@@ -0,0 +1,60 @@
+/// \file NullRenderBackend.h
+/// \brief Interface for the null render backend class CNullRenderBackend.
+
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+
+#include "RenderBackend.h"
+
+using namespace std;
+
+/// \brief A recorded render command.
+///
+/// The handles and arguments that a command was given. Which of them are
+/// used depends on the kind of command, and unused ones are zero.
+
+struct RenderCommand{
+  RenderCommandType nType; ///< Kind of command.
+  RenderHandle hResource[3]; ///< Shaders, buffers, texture, or state.
+  int nArg[4]; ///< Counts, slots, strides, and offsets.
+  size_t nBytes; ///< Bytes uploaded.
+}; //RenderCommand
+
+/// \brief The null render backend.
+///
+/// The null render backend draws nothing. It records each command it is given
+/// into a command log, which is kept until the end of the next frame, so that
+/// the game can be run without a window or a GPU and the work it asks for can
+/// be examined, counted, and compared from one change to the next. Dynamic
+/// buffer writes are copied into scratch memory, since the game would pay
+/// for that copy on a real backend too.
+
+class CNullRenderBackend: public CRenderBackend{
+  private:
+    vector<RenderCommand> m_vLog; ///< Commands for the frame in progress.
+    vector<RenderCommand> m_vLastLog; ///< Commands for the last complete frame.
+    vector<unsigned char> m_vScratch; ///< Stands in for mapped buffer memory.
+
+    RenderCommand& Record(RenderCommandType t, size_t bytes=0); ///< Log a command.
+
+  public:
+    virtual void SetRenderTarget(); ///< Bind the back buffer and depth buffer.
+    virtual void Clear(const float color[4]); ///< Clear the back buffer and depth buffer.
+    virtual void SetShaders(RenderHandle layout, RenderHandle vs, RenderHandle ps); ///< Set shaders.
+    virtual void SetTopology(RenderTopology t); ///< Set primitive topology.
+    virtual void SetVertexBuffers(int n, const RenderHandle* buffers, const unsigned* strides); ///< Set vertex buffers.
+    virtual void UpdateBuffer(RenderHandle buffer, const void* data, size_t bytes); ///< Update a default buffer.
+    virtual bool WriteBuffer(RenderHandle buffer, const void* data, size_t bytes); ///< Overwrite a dynamic buffer.
+    virtual void SetConstantBuffer(int slot, RenderHandle buffer); ///< Set constant buffer.
+    virtual void SetTexture(int slot, RenderHandle texture); ///< Set texture.
+    virtual void SetBlendState(RenderHandle state); ///< Set blend state.
+    virtual void SetRasterizerState(RenderHandle state); ///< Set rasterizer state.
+    virtual void Draw(int vertices, int first); ///< Draw.
+    virtual void DrawInstanced(int vertices, int instances, int firstvertex, int firstinstance); ///< Draw instanced.
+    virtual void Present(int interval); ///< Present the frame.
+
+    const vector<RenderCommand>& GetLastFrameLog() const; ///< Commands for the last frame.
+    void WriteLastFrameLog(FILE* output) const; ///< Print commands for the last frame.
+}; //CNullRenderBackend
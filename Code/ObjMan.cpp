@@ -1,44 +1,86 @@
 /// \file objman.cpp
 /// \brief Code for the object manager class CObjectManager.
+///
+/// This is not compiled in this tree, since it needs crow.h and members
+/// of CGameObject that the fighting game's object no longer has. The
+/// object pools are checked by PoolBench instead, and the draw order kept
+/// by CDepthOrder by DepthBench, which sorts it the same way as draw().
+/// The collision broadphase is checked by CollisionBench, which finds the
+/// same collisions in the same order with CSpatialHash as with every pair.
+
+#include <new>
+#include <algorithm>
 
 #include "objman.h"
 #include "debug.h"
 #include "defines.h"
 #include "timer.h"
 #include "crow.h"
+#include "Profiler.h"
 
 extern int g_nScreenWidth;
 extern int g_nScreenHeight;
 extern CTimer g_cTimer; 
 
-/// Comparison for depth sorting game objects.
-/// To compare two game objects, simply compare their Z coordinates.
-/// \param p0 Pointer to game object 0.
-/// \param p1 Pointer to game object 1.
-/// \return true If object 0 is behind object 1.
+const float CObjectManager::COLLISION_RADIUS = 15.0f;
 
-bool ZCompare(const CGameObject* p0, const CGameObject* p1){
-  return p0->m_vPos.z > p1->m_vPos.z;
-} //ZCompare
+/// Make a pool of the default size for each object type, and room in the
+/// object list for every object they can hold.
 
-CObjectManager::CObjectManager(){ 
-  m_stlObjectList.clear();
+CObjectManager::CObjectManager():
+  m_cTargets(COLLISION_RADIUS, 2*NUM_OBJECT_TYPES*DEFAULT_POOL_CAPACITY)
+{ 
   m_stlNameToObject.clear();
   m_stlNameToObjectType.clear();
   m_nLastGunFireTime = 0;
+
+  for(int i=0; i<NUM_OBJECT_TYPES; i++)
+    m_pPool[i] = new CObjectPool(i, DEFAULT_POOL_CAPACITY,
+      i == CROW_OBJECT? sizeof(CCrowObject): sizeof(CGameObject));
+
+  m_vObjects.reserve(NUM_OBJECT_TYPES*DEFAULT_POOL_CAPACITY);
+  m_cDrawOrder.Reserve(NUM_OBJECT_TYPES*DEFAULT_POOL_CAPACITY);
+  m_cTargets.Reserve(NUM_OBJECT_TYPES*DEFAULT_POOL_CAPACITY);
+  m_vNearby.reserve(NUM_OBJECT_TYPES*DEFAULT_POOL_CAPACITY);
 } //constructor
 
 CObjectManager::~CObjectManager(){ 
-  for(auto i=m_stlObjectList.begin(); i!=m_stlObjectList.end(); i++)
-    delete *i;
+  for(auto i=m_vObjects.begin(); i!=m_vObjects.end(); i++)
+    destroyObject(*i);
+  for(int i=0; i<NUM_OBJECT_TYPES; i++)
+    delete m_pPool[i];
 } //destructor
 
+/// Set the number of objects of a type that there can be at once. This
+/// allocates memory, so it must be done while loading, before there are
+/// any objects of that type.
+/// \param t Object type.
+/// \param capacity Most objects of that type at once.
+/// \return true if the pool was made.
+
+bool CObjectManager::CreatePool(ObjectType t, int capacity){
+  if(t < 0 || t >= NUM_OBJECT_TYPES || m_pPool[t]->GetCount() > 0)
+    return false;
+
+  const int old = m_pPool[t]->GetCapacity();
+  delete m_pPool[t];
+  m_pPool[t] = new CObjectPool(t, capacity,
+    t == CROW_OBJECT? sizeof(CCrowObject): sizeof(CGameObject));
+
+  m_vObjects.reserve(m_vObjects.capacity() - old + m_pPool[t]->GetCapacity());
+  m_cDrawOrder.Reserve((int)m_vObjects.capacity());
+  m_cTargets.Reserve((int)m_vObjects.capacity());
+  m_vNearby.reserve(m_vObjects.capacity());
+  return true;
+} //CreatePool
+
 /// Insert a map from an object name string to an object type enumeration.
 /// \param name Name of an object type
 /// \param t Enumerated object type corresponding to that name.
 
 void CObjectManager::InsertObjectType(const char* name, ObjectType t){
   m_stlNameToObjectType.insert(pair<string, ObjectType>(name, t)); 
+  m_stlNameToObject.insert(pair<string, ObjectHandle>(name, NULL_OBJECT)); //so it needn't be added mid-game
 } //InsertObjectType
 
 /// Get the ObjectType corresponding to a type name string. Returns NUM_OBJECT_TYPES
@@ -54,58 +96,88 @@ ObjectType CObjectManager::GetObjectType(const char* name){
   else return i->second; //return object type
 } //GetObjectType
 
-/// Create a new instance of a game object.
+/// Create a new instance of a game object in the pool for its type. If
+/// the pool is full, no object is created. If there is no live object with
+/// this name, the new object takes it. New objects go at the end of the
+/// object list, where the old linked list put them at the front. Objects
+/// are moved, culled and checked for collisions in that order, and nothing
+/// depends on it: each object moves and ages by itself, and a bullet and
+/// whatever it hits both die whichever of them is checked first. The draw
+/// order, which shows, still puts new objects in front, newest first, so
+/// that of two objects at the same depth the newer is drawn behind.
 /// \param obj The type of the new object
 /// \param name The name of object as found in name tag of XML settings file
 /// \param s Location.
 /// \param v Velocity.
-/// \return Pointer to object created.
+/// \return Handle to object created, NULL_OBJECT if none was.
+
+ObjectHandle CObjectManager::createObject(ObjectType obj, const char* name, const Vector3& s, const Vector3& v){
+  if(obj < 0 || obj >= NUM_OBJECT_TYPES)return NULL_OBJECT;
 
-CGameObject* CObjectManager::createObject(ObjectType obj, const char* name, const Vector3& s, const Vector3& v){
-  CGameObject* p;
+  ObjectHandle h;
+  void* p = m_pPool[obj]->Allocate(h);
+  if(p == nullptr){
+    DEBUGPRINTF("No room for another %s.\n", name);
+    return NULL_OBJECT;
+  } //if
 
   if(obj == CROW_OBJECT) 
-    p = new CCrowObject(name, s, v);
-  else p = new CGameObject(obj, name, s, v);    
+    new(p) CCrowObject(name, s, v);
+  else new(p) CGameObject(obj, name, s, v);    
 
-  m_stlObjectList.push_front(p); //insert in object list
+  m_vObjects.push_back(h); //insert at end of object list, which has room already
+  m_cDrawOrder.Insert(h, s.z); //and in draw order, in front at the next sort
 
-  if(m_stlNameToObject.find(name) == m_stlNameToObject.end()) //if name not in map
-    m_stlNameToObject.insert(pair<string, CGameObject*>(name, p)); //put it there
+  auto i = m_stlNameToObject.find(name);
+  if(i == m_stlNameToObject.end()) //if name not in map
+    m_stlNameToObject.insert(pair<string, ObjectHandle>(name, h)); //put it there
+  else if(GetObjectPtr(i->second) == nullptr) //if its object has died
+    i->second = h; //this one takes its name
 
-  return p;
+  return h;
 } //createObject
 
 /// Create a new instance of a game object with velocity zero.
 /// \param objname The name of the new object's type
 /// \param name The name of object as found in name tag of XML settings file
 /// \param s Location.
-/// \return Pointer to object created.
+/// \return Handle to object created, NULL_OBJECT if none was.
 
-CGameObject* CObjectManager::createObject(const char* objname, const char* name, const Vector3& s){
+ObjectHandle CObjectManager::createObject(const char* objname, const char* name, const Vector3& s){
   ObjectType obj = GetObjectType(objname);
   return createObject(obj, name, s, Vector3(0.0f));
 } //createObject
 
+/// Destroy an object and give its slot back to its pool. Any handles to
+/// it go stale. This doesn't remove it from the object list.
+/// \param h Handle to object.
+
+void CObjectManager::destroyObject(ObjectHandle h){
+  CGameObject* p = GetObjectPtr(h);
+  if(p == nullptr)return;
+
+  p->~CGameObject();
+  m_pPool[CObjectPool::GetHandleType(h)]->Free(h);
+} //destroyObject
+
 /// Move all game objects, while making sure that they wrap around the world correctly.
 
 void CObjectManager::move(){
+  PROFILE_ZONE("CObjectManager::move");
   const float dX = (float)g_nScreenWidth; // Wrap distance from plane.
 
-  //find the plane
-  unordered_map<string, CGameObject*>::iterator planeIterator = 
-    m_stlNameToObject.find((string)"plane");
-  CGameObject* planeObject = planeIterator->second;
+  //find the plane, if it's still alive
+  CGameObject* planeObject = GetObjectPtr(GetObjectByName("plane"));
 
   //move nonplayer objects
-  for(auto i=m_stlObjectList.begin(); i!=m_stlObjectList.end(); i++){ //for each object
-    CGameObject* curObject = *i; //current object
+  for(auto i=m_vObjects.begin(); i!=m_vObjects.end(); i++){ //for each object
+    CGameObject* curObject = GetObjectPtr(*i); //current object
     curObject->move(); //move it
 
     //wrap objects a fixed distance from plane
     if(curObject != planeObject){ //not the plane
       float planeX=0.0f; //plane's X coordinate
-      if(planeIterator != m_stlNameToObject.end())
+      if(planeObject)
         planeX = planeObject->m_vPos.x;
 
       float& x = curObject->m_vPos.x; //X coordinate of current object
@@ -123,26 +195,47 @@ void CObjectManager::move(){
 } //move
 
 /// Draw the objects from the object list and the player object. Care
-/// must be taken to draw them from back to front.
+/// must be taken to draw them from back to front. The draw order is left
+/// as it was last frame, with each object's depth updated, and re-sorted,
+/// which is quick because it is almost always nearly right already.
 
 void CObjectManager::draw(){
-  m_stlObjectList.sort(ZCompare); //depth sort
-  for(auto i = m_stlObjectList.begin(); i != m_stlObjectList.end(); i++) //for each object
-    (*i)->draw();
+  PROFILE_ZONE("CObjectManager::draw");
+  const int n = m_cDrawOrder.GetCount();
+
+  for(int i=0; i<n; i++) //update depths
+    m_cDrawOrder.SetDepth(i, GetObjectPtr(m_cDrawOrder.GetHandle(i))->m_vPos.z);
+
+  m_cDrawOrder.Sort(); //depth sort
+
+  for(int i=0; i<n; i++) //for each object, back to front
+    GetObjectPtr(m_cDrawOrder.GetHandle(i))->draw();
 } //draw
 
-/// Get a pointer to an object by name, nullptr if it doesn't exist.
+/// Get a handle to an object by name. The handle may be stale if the
+/// object has died since, so it must be checked with GetObjectPtr().
 /// \param name Name of object.
-/// \return Pointer to object created with that name, if it exists.
+/// \return Handle to object created with that name, NULL_OBJECT if there isn't one.
 
-CGameObject* CObjectManager::GetObjectByName(const char* name){ 
-  unordered_map<string, CGameObject*>::iterator 
+ObjectHandle CObjectManager::GetObjectByName(const char* name){ 
+  unordered_map<string, ObjectHandle>::iterator 
     current = m_stlNameToObject.find((string)name);
   if(current != m_stlNameToObject.end())
     return current->second;
-  else return nullptr;
+  else return NULL_OBJECT;
 } //GetObjectByName
 
+/// Get a pointer to an object from its handle. The pointer is only good
+/// until the object dies, so it mustn't be kept.
+/// \param h Handle to object.
+/// \return Pointer to object, nullptr if the handle is stale.
+
+CGameObject* CObjectManager::GetObjectPtr(ObjectHandle h){
+  const int t = CObjectPool::GetHandleType(h);
+  if(t >= NUM_OBJECT_TYPES)return nullptr;
+  return (CGameObject*)m_pPool[t]->Get(h);
+} //GetObjectPtr
+
 /// Distance between objects.
 /// \param pointer to first object 
 /// \param pointer to second object
@@ -161,10 +254,8 @@ float CObjectManager::distance(CGameObject *g0, CGameObject *g1){
 /// \param name Name of the object that is to fire the gun.
 
 void CObjectManager::FireGun(char* name){   
-  std::unordered_map<std::string, CGameObject*>::iterator planeIterator = 
-    m_stlNameToObject.find((std::string)"plane");
-  if(planeIterator == m_stlNameToObject.end())return; //this should of course never happen
-  const CGameObject* planeObject = planeIterator->second;
+  const CGameObject* planeObject = GetObjectPtr(GetObjectByName("plane"));
+  if(planeObject == nullptr)return; //this should of course never happen
 
   if(g_cTimer.elapsed(m_nLastGunFireTime, 200)){ //slow down firing rate
     const float fAngle = planeObject->m_fOrientation;
@@ -194,8 +285,10 @@ void CObjectManager::FireGun(char* name){
 /// flagged with a negative life span, so ignore those.
 
 void CObjectManager::cull(){ 
-  for(auto i=m_stlObjectList.begin(); i!=m_stlObjectList.end(); i++){
-    CGameObject* object = *i; //current object
+  const size_t n = m_vObjects.size(); //not the ones created as we go
+
+  for(size_t i=0; i<n; i++){
+    CGameObject* object = GetObjectPtr(m_vObjects[i]); //current object
 
     //died of old age
     if(object->m_nLifeTime > 0 && //if mortal and ...
@@ -225,24 +318,43 @@ void CObjectManager::CreateNextIncarnation(CGameObject* object){
 } //CreateNextIncarnation
 
 /// Master collision detection function.
-/// Compare every object against every other object for collision. Only
-/// bullets can collide right now.
+/// Compare every bullet against the objects near it for collision. Only
+/// bullets can collide right now, and only with vulnerable objects, so
+/// those are put into a spatial hash first, which wraps around the world
+/// the same way that distance() does. The hash finds the objects near a
+/// bullet in the same order as they are in the object list, so the same
+/// collisions happen in the same order as if every object were checked.
 
 void CObjectManager::CollisionDetection(){ 
-  for(auto i=m_stlObjectList.begin(); i!=m_stlObjectList.end(); i++)
-    if((*i)->m_nObjectType == BULLET_OBJECT) //and is a bullet
-      CollisionDetection(*i); //check every object for collision with this bullet
+  PROFILE_ZONE("CObjectManager::CollisionDetection");
+  const size_t n = m_vObjects.size(); //not the ones created as we go
+
+  m_cTargets.Clear(2.0f*(float)g_nScreenWidth); //world width
+  for(size_t i=0; i<n; i++){
+    const CGameObject* p = GetObjectPtr(m_vObjects[i]);
+    if(p->m_bVulnerable)
+      m_cTargets.Insert((int)i, p->m_vPos.x, p->m_vPos.y);
+  } //for
+  m_cTargets.Build();
+
+  for(size_t i=0; i<n; i++){
+    CGameObject* p = GetObjectPtr(m_vObjects[i]);
+    if(p->m_nObjectType == BULLET_OBJECT) //and is a bullet
+      CollisionDetection(p); //check nearby objects for collision with this bullet
+  } //for
 } //CollisionDetection
 
-/// Given an object pointer, compare that object against every other 
-/// object for collision. If a collision is detected, replace the object hit
-/// with the next in series (if one exists), and kill the object doing the
-/// hitting (bullets don't go through objects in this game).
+/// Given an object pointer, compare that object against the vulnerable
+/// objects near it for collision. If a collision is detected, replace the
+/// object hit with the next in series (if one exists), and kill the object
+/// doing the hitting (bullets don't go through objects in this game).
 /// \param p Pointer to the object to be compared against.
 
 void CObjectManager::CollisionDetection(CGameObject* p){ 
-  for(auto j=m_stlObjectList.begin(); j!=m_stlObjectList.end(); j++)
-    CollisionDetection(p, *j);
+  m_cTargets.Query(p->m_vPos.x, p->m_vPos.y, m_vNearby);
+
+  for(size_t j=0; j<m_vNearby.size(); j++)
+    CollisionDetection(p, GetObjectPtr(m_vObjects[m_vNearby[j]]));
 } //CollisionDetection
 
 /// Given 2 object pointers, see whether the objects collide. 
@@ -253,23 +365,25 @@ void CObjectManager::CollisionDetection(CGameObject* p){
 
 void CObjectManager::CollisionDetection(CGameObject* p0, CGameObject* p1)
 { 
-  if(p1->m_bVulnerable && distance(p0, p1) < 15.0f){
+  if(p1->m_bVulnerable && distance(p0, p1) < COLLISION_RADIUS){
     p0->m_bIsDead = p1->m_bIsDead = TRUE; //they're dead, Jim
     CreateNextIncarnation(p1); //replace with dead object, if any
   } //if
 } //CollisionDetection
 
-/// Collect garbage, that is, remove dead objects from the object list.
+/// Collect garbage, that is, remove dead objects from the object list
+/// and give their slots back to their pools. The rest keep their order.
 
 void CObjectManager::GarbageCollect(){
-  auto i = m_stlObjectList.begin();
-  while(i != m_stlObjectList.end()){
-    CGameObject* p = *i; //save pointer to object temporarily
-    if(p->m_bIsDead){
-      i = m_stlObjectList.erase(i); //remove pointer from list
-      delete p; //delete object
-    } //if
-    if(i != m_stlObjectList.end())
-      ++i; //next object
-  } //while
+  auto i = remove_if(m_vObjects.begin(), m_vObjects.end(), [this](ObjectHandle h){
+    if(!GetObjectPtr(h)->m_bIsDead)return false;
+    destroyObject(h); //delete object
+    return true;
+  }); //remove_if
+
+  m_vObjects.erase(i, m_vObjects.end()); //remove handles from list
+
+  m_cDrawOrder.RemoveIf([this](ObjectHandle h){ //and from draw order
+    return GetObjectPtr(h) == nullptr;
+  }); //RemoveIf
 } //GarbageCollect
\ No newline at end of file
@@ -3,11 +3,14 @@
 
 #pragma once
 
-#include <list>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "object.h"
+#include "ObjectPool.h"
+#include "DepthOrder.h"
+#include "SpatialHash.h"
 
 /// \brief The object manager. 
 ///
@@ -15,24 +18,40 @@
 /// game objects. Objects can be named on creation so that they
 /// can be accessed later - this is needed in particular for the player
 /// object or objects.
+///
+/// Each type of object has its own fixed-size pool, allocated when the
+/// object manager is made, so that nothing is allocated from the heap
+/// while the game is running. Objects are referred to by handle rather
+/// than by pointer, and a handle to an object that has died goes stale
+/// instead of dangling. The draw order is kept separately from the
+/// object list and brought up to date each frame, rather than sorted
+/// from scratch.
 
 class CObjectManager{
   private:
-    list<CGameObject*> m_stlObjectList; ///< List of game objects.
-    unordered_map<string, CGameObject*> m_stlNameToObject; ///< Map names to objects.
+    static const int DEFAULT_POOL_CAPACITY = 256; ///< Objects of each type, unless told otherwise.
+    static const float COLLISION_RADIUS; ///< Distance at which objects collide.
+
+    CObjectPool* m_pPool[NUM_OBJECT_TYPES]; ///< Pool for each object type.
+    vector<ObjectHandle> m_vObjects; ///< Handles to live game objects.
+    CDepthOrder m_cDrawOrder; ///< Live game objects in the order they are drawn.
+    CSpatialHash m_cTargets; ///< Broadphase for vulnerable objects, by position in the object list.
+    vector<int> m_vNearby; ///< Positions in the object list of targets near a bullet.
+    unordered_map<string, ObjectHandle> m_stlNameToObject; ///< Map names to objects.
     unordered_map<string, ObjectType> m_stlNameToObjectType; ///< Map names to object types.
     
     int m_nLastGunFireTime; ///< Time gun was last fired.
 
     //creation functions
-    CGameObject* createObject(const char* obj, const char* name, const Vector3& s); ///< Create new object by name.
+    ObjectHandle createObject(const char* obj, const char* name, const Vector3& s); ///< Create new object by name.
+    void destroyObject(ObjectHandle h); ///< Destroy an object and free its slot.
     
     //distance functions
     float distance(CGameObject *g0, CGameObject *g1); ///< Distance between objects.
 
     //collision detection
     void CollisionDetection(); ///< Process all collisions.
-    void CollisionDetection(CGameObject* i); ///< Process collisions of all with one object.
+    void CollisionDetection(CGameObject* i); ///< Process collisions of nearby targets with one object.
     void CollisionDetection(CGameObject* i, CGameObject* j); ///< Process collisions of 2 objects.
 
     //managing dead objects
@@ -44,12 +63,14 @@ class CObjectManager{
     CObjectManager(); ///< Constructor.
     ~CObjectManager(); ///< Destructor.
 
-    CGameObject* createObject(ObjectType obj, const char* name, const Vector3& s, const Vector3& v); ///< Create new object.
+    bool CreatePool(ObjectType t, int capacity); ///< Set the number of objects of a type.
+    ObjectHandle createObject(ObjectType obj, const char* name, const Vector3& s, const Vector3& v); ///< Create new object.
 
     void move(); ///< Move all objects.
     void draw(); ///< Draw all objects.
 
-    CGameObject* GetObjectByName(const char* name); ///< Get pointer to object by name.
+    ObjectHandle GetObjectByName(const char* name); ///< Get handle to object by name.
+    CGameObject* GetObjectPtr(ObjectHandle h); ///< Get pointer to object, nullptr if it has died.
     void InsertObjectType(const char* objname, ObjectType t); ///< Map name string to object type enumeration.
     ObjectType GetObjectType(const char* name); ///< Get object type corresponding to name string.
     
@@ -25,13 +25,5 @@ class CGameObject{ //class for a game object
 
   public:
     CGameObject(const Vector3& s, const Vector3& v, C3DSprite *sprite); ///< Constructor.
-    void draw(); ///< Draw at current location.
-    void moveRight();
-	void moveLeft();///< Change location depending on time and speed
-	void jump();
-	void leftpunch();
-	void leftkick();
-	void rightpunch();
-	void rightkick();
 }; //CGameObject
 
@@ -0,0 +1,76 @@
+/// \file ObjectPool.cpp
+/// \brief Code for the object pool class CObjectPool.
+
+#include "ObjectPool.h"
+
+/// Allocate the slab and fill the free list, so that the lowest slots are
+/// handed out first.
+/// \param type Pool type, less than MAX_TYPES.
+/// \param capacity Number of slots, at most MAX_CAPACITY.
+/// \param size Size of the objects in the pool in bytes.
+
+CObjectPool::CObjectPool(int type, int capacity, size_t size):
+  m_nType(type & (MAX_TYPES - 1)),
+  m_nCapacity(capacity < 0? 0: capacity > MAX_CAPACITY? MAX_CAPACITY: capacity),
+  m_nSlotSize((size + ALIGNMENT - 1)/ALIGNMENT*ALIGNMENT),
+  m_nHighWater(0), m_nFailures(0)
+{
+  m_pSlab = new unsigned char[m_nSlotSize*m_nCapacity + ALIGNMENT];
+  m_pSlots = m_pSlab + (ALIGNMENT - (size_t)m_pSlab%ALIGNMENT)%ALIGNMENT;
+  m_vGeneration.assign(m_nCapacity, 1);
+
+  m_vFree.reserve(m_nCapacity);
+  for(int i=m_nCapacity-1; i>=0; i--)
+    m_vFree.push_back((unsigned short)i);
+} //constructor
+
+/// The owner must have destroyed every object in the pool by now, since
+/// the pool doesn't know what they are.
+
+CObjectPool::~CObjectPool(){
+  delete [] m_pSlab;
+} //destructor
+
+/// Take a slot off the free list.
+/// \param h [out] Handle to the slot, NULL_OBJECT if the pool is full.
+/// \return Storage to construct the object in, nullptr if the pool is full.
+
+void* CObjectPool::Allocate(ObjectHandle& h){
+  if(m_vFree.empty()){
+    m_nFailures++;
+    h = NULL_OBJECT;
+    return nullptr;
+  } //if
+
+  const int slot = m_vFree.back();
+  m_vFree.pop_back();
+
+  const int count = m_nCapacity - (int)m_vFree.size();
+  if(count > m_nHighWater)m_nHighWater = count;
+
+  h = ((ObjectHandle)m_vGeneration[slot] << (SLOT_BITS + TYPE_BITS)) |
+    (m_nType << SLOT_BITS) | slot;
+  return m_pSlots + slot*m_nSlotSize;
+} //Allocate
+
+/// Put a slot back on the free list, and bump its generation so that any
+/// handle to it goes stale. Generation 0 is skipped, so that no handle is
+/// ever NULL_OBJECT.
+/// \param h Handle to the slot.
+/// \return true if the handle was live.
+
+bool CObjectPool::Free(ObjectHandle h){
+  const int slot = GetSlot(h);
+  if(slot < 0)return false;
+
+  if(++m_vGeneration[slot] == 0)
+    m_vGeneration[slot] = 1;
+  m_vFree.push_back((unsigned short)slot);
+  return true;
+} //Free
+
+int CObjectPool::GetType() const{return m_nType;}
+int CObjectPool::GetCapacity() const{return m_nCapacity;}
+int CObjectPool::GetCount() const{return m_nCapacity - (int)m_vFree.size();}
+int CObjectPool::GetHighWater() const{return m_nHighWater;}
+int CObjectPool::GetFailures() const{return m_nFailures;}
@@ -0,0 +1,109 @@
+/// \file ObjectPool.h
+/// \brief Interface for the object pool class CObjectPool.
+
+#pragma once
+
+#include <stddef.h>
+
+#include <vector>
+
+using namespace std;
+
+/// Handle to a pooled object. The low 12 bits are a slot number, the next
+/// 4 bits say which pool the slot is in, and the high 16 bits are the
+/// generation of the slot, which changes each time it is freed, so that a
+/// handle to an object that has died is never mistaken for one to whatever
+/// took its place.
+
+typedef unsigned ObjectHandle;
+
+const ObjectHandle NULL_OBJECT = 0; ///< Handle that is never valid.
+
+/// \brief A slab of fixed-size slots for objects.
+///
+/// An object pool allocates all of its memory once, when it is made, and
+/// hands out slots from a free list after that, so that making and killing
+/// objects never touches the heap. The pool only deals in storage: the
+/// owner constructs each object in its slot with placement new, and calls
+/// its destructor before freeing the slot. Every slot has a generation
+/// that is bumped when it is freed, and a handle is only good while its
+/// generation matches, so a stale handle is caught rather than followed.
+/// Since a free slot's generation has always moved on from the last handle
+/// given out for it, the generation alone says whether a slot is in use.
+
+class CObjectPool{
+  private:
+    static const int SLOT_BITS = 12; ///< Bits of a handle that are the slot number.
+    static const int TYPE_BITS = 4; ///< Bits of a handle that are the pool type.
+    static const int ALIGNMENT = 16; ///< Slots start on multiples of this many bytes.
+
+    int m_nType; ///< Pool type, which goes in every handle.
+    int m_nCapacity; ///< Number of slots.
+    size_t m_nSlotSize; ///< Size of a slot in bytes.
+    unsigned char* m_pSlab; ///< Memory for all the slots.
+    unsigned char* m_pSlots; ///< First slot, aligned.
+
+    vector<unsigned short> m_vGeneration; ///< Current generation of each slot.
+    vector<unsigned short> m_vFree; ///< Slots not in use, used as a stack.
+
+    int m_nHighWater; ///< Most slots ever in use at once.
+    int m_nFailures; ///< Number of times the pool was full.
+
+    int GetSlot(ObjectHandle h) const; ///< Slot of a handle, -1 if stale.
+
+  public:
+    static const int MAX_CAPACITY = 1 << SLOT_BITS; ///< Most slots in a pool.
+    static const int MAX_TYPES = 1 << TYPE_BITS; ///< Most pools.
+
+    CObjectPool(int type, int capacity, size_t size); ///< Constructor.
+    ~CObjectPool(); ///< Destructor.
+
+    void* Allocate(ObjectHandle& h); ///< Get a free slot.
+    bool Free(ObjectHandle h); ///< Give a slot back.
+    void* Get(ObjectHandle h) const; ///< Storage for a handle, nullptr if stale.
+    bool IsValid(ObjectHandle h) const; ///< Whether a handle is to a live object.
+
+    int GetType() const; ///< Pool type.
+    int GetCapacity() const; ///< Number of slots.
+    int GetCount() const; ///< Number of slots in use.
+    int GetHighWater() const; ///< Most slots ever in use at once.
+    int GetFailures() const; ///< Number of times the pool was full.
+
+    static int GetHandleType(ObjectHandle h); ///< Pool type of a handle.
+}; //CObjectPool
+
+/// Get the slot for a handle, checking that it is for this pool and that
+/// the slot hasn't been freed since. This and the functions that call it
+/// are inline because every use of an object goes through a handle.
+/// \param h Handle to an object.
+/// \return Its slot, or -1 if the handle is stale, null, or for another pool.
+
+inline int CObjectPool::GetSlot(ObjectHandle h) const{
+  const int slot = h & (MAX_CAPACITY - 1);
+  if(GetHandleType(h) != m_nType || slot >= m_nCapacity)return -1;
+  if(m_vGeneration[slot] != (h >> (SLOT_BITS + TYPE_BITS)))return -1;
+  return slot;
+} //GetSlot
+
+/// \param h Handle to an object.
+/// \return Storage holding the object, or nullptr if the handle is stale.
+
+inline void* CObjectPool::Get(ObjectHandle h) const{
+  const int slot = GetSlot(h);
+  if(slot < 0)return nullptr;
+  return m_pSlots + slot*m_nSlotSize;
+} //Get
+
+/// \param h Handle to an object.
+/// \return true if the handle refers to a live object in this pool.
+
+inline bool CObjectPool::IsValid(ObjectHandle h) const{
+  return GetSlot(h) >= 0;
+} //IsValid
+
+/// \param h Handle to an object.
+/// \return The type of the pool it came from.
+
+inline int CObjectPool::GetHandleType(ObjectHandle h){
+  return (h >> SLOT_BITS) & (MAX_TYPES - 1);
+} //GetHandleType
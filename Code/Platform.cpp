@@ -0,0 +1,56 @@
+/// \file Platform.cpp
+/// \brief Code for the platform class CPlatform.
+
+#include "Platform.h"
+
+CPlatform::CPlatform(): m_bActive(true){
+} //constructor
+
+CPlatform::~CPlatform(){
+} //destructor
+
+/// Put an event at the back of the queue.
+/// \param type Kind of event.
+/// \param key Key code for key events, 0 for others.
+/// \param t Time the event happened, in microseconds.
+
+void CPlatform::Post(PlatformEventType type, int key, long long t){
+  PlatformEvent e;
+  e.eType = type;
+  e.nKey = key;
+  e.nTime = t;
+  m_stlEvents.push_back(e);
+} //Post
+
+/// Get the event at the front of the queue, pumping the platform for more
+/// if the queue is empty. Activation events are noted on the way out.
+/// \param e [out] The event.
+/// \return true if there was an event.
+
+bool CPlatform::PollEvent(PlatformEvent& e){
+  if(m_stlEvents.empty())
+    Pump();
+  if(m_stlEvents.empty())return false;
+
+  e = m_stlEvents.front();
+  m_stlEvents.pop_front();
+
+  if(e.eType == ACTIVATE_EVENT)m_bActive = true;
+  else if(e.eType == DEACTIVATE_EVENT)m_bActive = false;
+
+  return true;
+} //PollEvent
+
+/// Queue a quit event, which the game loop exits on.
+
+void CPlatform::Quit(){
+  Post(QUIT_EVENT, 0, Now());
+} //Quit
+
+/// Find out whether the game is the active application. The game loop
+/// doesn't simulate while it isn't.
+/// \return true if active.
+
+bool CPlatform::IsActive() const{
+  return m_bActive;
+} //IsActive
@@ -0,0 +1,78 @@
+/// \file Platform.h
+/// \brief Interface for the platform class CPlatform.
+///
+/// The platform is the only thing that knows how to make a window, where
+/// key presses come from, and what time it is. It knows nothing about
+/// Windows, so that the game loop can be run on a platform that plays back
+/// scripted keys against a simulated clock.
+
+#pragma once
+
+#include <deque>
+
+using namespace std;
+
+/// Key codes. Letters and digits are their upper-case ASCII codes. These
+/// are the same as Windows virtual key codes, so that the Win32 platform
+/// can pass keys through as they are.
+
+enum PlatformKey{
+  KEY_ESCAPE = 0x1B, ///< Escape.
+  KEY_SPACE = 0x20, ///< Space bar.
+  KEY_LEFT = 0x25, ///< Left arrow.
+  KEY_UP = 0x26, ///< Up arrow.
+  KEY_RIGHT = 0x27, ///< Right arrow.
+  KEY_DOWN = 0x28, ///< Down arrow.
+  KEY_F1 = 0x70, ///< Function keys follow on from here.
+  KEY_F2, KEY_F3, KEY_F4, KEY_F5, KEY_F6, KEY_F7, KEY_F8
+}; //PlatformKey
+
+/// Kinds of event that a platform delivers.
+
+enum PlatformEventType{
+  KEY_DOWN_EVENT, ///< A key was pressed.
+  ACTIVATE_EVENT, ///< The game became the active application.
+  DEACTIVATE_EVENT, ///< The game stopped being the active application.
+  QUIT_EVENT ///< The game is to exit.
+}; //PlatformEventType
+
+/// \brief An event from the platform.
+
+struct PlatformEvent{
+  PlatformEventType eType; ///< Kind of event.
+  int nKey; ///< Key code for key events.
+  long long nTime; ///< Time the event happened, in microseconds on the platform clock.
+}; //PlatformEvent
+
+/// \brief The platform.
+///
+/// The platform makes the game window, delivers events from a queue, and
+/// keeps the clock that the game loop runs on. Each platform fills the
+/// queue in its own way when asked to pump, and stamps each event with the
+/// time it happened. The game loop waits on the platform between ticks,
+/// so that a platform with a simulated clock can jump straight to the
+/// next thing that happens.
+
+class CPlatform{
+  private:
+    deque<PlatformEvent> m_stlEvents; ///< Events waiting to be delivered.
+    bool m_bActive; ///< Whether the game is the active application.
+
+  protected:
+    void Post(PlatformEventType type, int key, long long t); ///< Queue an event.
+    virtual void Pump() = 0; ///< Queue any events that have happened.
+
+  public:
+    CPlatform(); ///< Constructor.
+    virtual ~CPlatform(); ///< Destructor.
+
+    virtual bool CreateGameWindow(const char* name, int width, int height) = 0; ///< Make the game window.
+    virtual void DestroyGameWindow() = 0; ///< Get rid of the game window.
+    virtual void SetTitle(const char* title) = 0; ///< Set the window title.
+    virtual void WaitForEvent(long long t) = 0; ///< Wait for an event or a time.
+    virtual long long Now() = 0; ///< Current time in microseconds.
+
+    bool PollEvent(PlatformEvent& e); ///< Get the next event, if there is one.
+    void Quit(); ///< Ask the game loop to exit.
+    bool IsActive() const; ///< Whether the game is the active application.
+}; //CPlatform
@@ -0,0 +1,27 @@
+/// \file Portable.h
+/// \brief fopen_s for compilers whose C library doesn't have it.
+///
+/// The game opens files with fopen_s, as the Microsoft C library would
+/// have it. Code that the tools also build with other compilers includes
+/// this, which gives those compilers an fopen_s that does the same, so
+/// that nothing has to turn off the library's warnings to call fopen.
+
+#pragma once
+
+#include <errno.h>
+#include <stdio.h>
+
+#ifndef _WIN32
+
+/// Open a file, as the Microsoft C library's fopen_s does.
+/// \param f [out] The file, or nullptr if it couldn't be opened.
+/// \param fname Name of file.
+/// \param mode Mode, as for fopen.
+/// \return 0 if the file was opened, otherwise an error number.
+
+inline int fopen_s(FILE** f, const char* fname, const char* mode){
+  *f = fopen(fname, mode);
+  return *f? 0: errno;
+} //fopen_s
+
+#endif //_WIN32
@@ -0,0 +1,130 @@
+/// \file Profiler.cpp
+/// \brief Code for the CPU profiler class CProfiler.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Profiler.h"
+#include "Portable.h"
+
+CProfiler g_cProfiler; ///< The profiler.
+
+thread_local ProfileThreadBuffer* t_pProfileBuffer = nullptr; ///< Calling thread's buffer.
+
+/// Microseconds from a monotonic clock, to calibrate the tick counter against.
+/// \return Time in microseconds.
+
+static long long Microseconds(){
+  return chrono::duration_cast<chrono::microseconds>(
+    chrono::steady_clock::now().time_since_epoch()).count();
+} //Microseconds
+
+CProfiler::CProfiler(){
+  m_bEnabled.store(false);
+  m_nBaseTicks = Now();
+  m_nBaseTime = Microseconds();
+} //constructor
+
+CProfiler::~CProfiler(){
+  for(size_t i=0; i<m_vBuffers.size(); i++)
+    delete m_vBuffers[i];
+} //destructor
+
+/// Work out how fast the tick counter runs, by comparing how far it and
+/// the monotonic clock have gone since the profiler was created.
+/// \return Ticks per microsecond.
+
+double CProfiler::GetTicksPerMicrosecond(){
+  const long long ticks = Now() - m_nBaseTicks;
+  const long long us = Microseconds() - m_nBaseTime;
+  return us > 0 && ticks > 0? (double)ticks/us: 1.0;
+} //GetTicksPerMicrosecond
+
+/// Get the calling thread's buffer, making one the first time.
+/// \return The calling thread's buffer.
+
+ProfileThreadBuffer* CProfiler::GetThreadBuffer(){
+  if(t_pProfileBuffer == nullptr){
+    ProfileThreadBuffer* p = new ProfileThreadBuffer;
+    p->m_nCount.store(0);
+    p->m_szName[0] = '\0';
+
+    lock_guard<mutex> lock(m_mutex);
+    p->m_nThreadId = (int)m_vBuffers.size() + 1;
+    m_vBuffers.push_back(p);
+    t_pProfileBuffer = p;
+  } //if
+
+  return t_pProfileBuffer;
+} //GetThreadBuffer
+
+/// Start or stop recording zones.
+/// \param on true to start recording, false to stop.
+
+void CProfiler::Enable(bool on){
+  m_bEnabled.store(on);
+} //Enable
+
+/// Forget everything recorded. Zones that other threads are in the middle
+/// of may still be recorded, so this is best done with recording stopped.
+
+void CProfiler::Clear(){
+  lock_guard<mutex> lock(m_mutex);
+
+  for(size_t i=0; i<m_vBuffers.size(); i++)
+    m_vBuffers[i]->m_nCount.store(0);
+} //Clear
+
+/// Give the calling thread a name to be shown in traces.
+/// \param name Name of thread.
+
+void CProfiler::SetThreadName(const char* name){
+  ProfileThreadBuffer* p = GetThreadBuffer();
+  snprintf(p->m_szName, sizeof(p->m_szName), "%s", name);
+} //SetThreadName
+
+/// Write everything recorded to a file in the Chrome trace event format,
+/// as complete events with times in microseconds since the profiler was
+/// created. This can be called while other threads are recording, but
+/// the oldest of their events may be overwritten while it is being read
+/// if they are recording fast enough to lap their ring buffers.
+/// \param fname Name of file to write.
+/// \return true if it succeeded.
+
+bool CProfiler::WriteTrace(const char* fname){
+  FILE* output = nullptr;
+  if(fopen_s(&output, fname, "wt") != 0 || output == nullptr)return false;
+
+  const double rate = GetTicksPerMicrosecond();
+  bool first = true; //no comma before first event
+
+  fprintf(output, "{\"traceEvents\":[\n");
+
+  lock_guard<mutex> lock(m_mutex);
+
+  for(size_t i=0; i<m_vBuffers.size(); i++){
+    ProfileThreadBuffer* p = m_vBuffers[i];
+
+    if(p->m_szName[0]){ //metadata event naming the thread
+      fprintf(output, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+        "\"args\":{\"name\":\"%s\"}}", first? "": ",\n", p->m_nThreadId, p->m_szName);
+      first = false;
+    } //if
+
+    const unsigned n = p->m_nCount.load(memory_order_acquire);
+    const unsigned size = ProfileThreadBuffer::SIZE;
+    const unsigned start = n > size? n - size: 0; //oldest still in the ring
+
+    for(unsigned j=start; j<n; j++){
+      const ProfileEvent& e = p->m_cEvent[j & (size - 1)];
+      fprintf(output, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+        "\"ts\":%0.3f,\"dur\":%0.3f}", first? "": ",\n", e.szName, p->m_nThreadId,
+        (e.nStart - m_nBaseTicks)/rate, (e.nEnd - e.nStart)/rate);
+      first = false;
+    } //for
+  } //for
+
+  fprintf(output, "\n],\"displayTimeUnit\":\"ns\"}\n");
+  fclose(output);
+  return true;
+} //WriteTrace
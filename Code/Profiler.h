@@ -0,0 +1,154 @@
+/// \file Profiler.h
+/// \brief Interface for the CPU profiler class CProfiler.
+
+#pragma once
+
+#define PROFILE_ON ///< Define this for profiling zones, comment out to compile them away.
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#if defined(_MSC_VER)
+  #include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+#endif
+
+using namespace std;
+
+/// \brief A profiling zone that has been timed.
+
+struct ProfileEvent{
+  const char* szName; ///< Name of zone, which must be a string literal.
+  long long nStart; ///< Time the zone was entered, in profiler ticks.
+  long long nEnd; ///< Time the zone was left, in profiler ticks.
+}; //ProfileEvent
+
+/// \brief The events recorded by one thread.
+///
+/// Each thread records into its own ring buffer, so recording needs no
+/// locks. When it is full the oldest events are overwritten.
+
+struct ProfileThreadBuffer{
+  static const unsigned SIZE = 1 << 16; ///< Number of events, a power of 2.
+
+  ProfileEvent m_cEvent[SIZE]; ///< The ring buffer.
+  atomic<unsigned> m_nCount; ///< Number of events ever recorded.
+  int m_nThreadId; ///< Small number identifying the thread in traces.
+  char m_szName[32]; ///< Name of the thread in traces.
+}; //ProfileThreadBuffer
+
+/// \brief The CPU profiler.
+///
+/// The profiler times scoped zones, which are set up using the macro
+/// PROFILE_ZONE, and writes them out in the Chrome trace event format,
+/// which chrome://tracing and Perfetto will display as a timeline with
+/// nested zones for each thread. When profiling is off a zone costs one
+/// relaxed load and a branch, and when PROFILE_ON isn't defined it costs
+/// nothing at all. When it is on a zone reads the time stamp counter on
+/// the way in and out and writes one event into the current thread's ring
+/// buffer.
+
+class CProfiler{
+  private:
+    atomic<bool> m_bEnabled; ///< Whether zones are being recorded.
+    long long m_nBaseTicks; ///< Ticks when the profiler was created.
+    long long m_nBaseTime; ///< Microseconds when the profiler was created.
+    mutex m_mutex; ///< Guards the list of thread buffers.
+    vector<ProfileThreadBuffer*> m_vBuffers; ///< One buffer for each thread that has recorded.
+
+    double GetTicksPerMicrosecond(); ///< Rate of the tick counter.
+
+  public:
+    CProfiler(); ///< Constructor.
+    ~CProfiler(); ///< Destructor.
+
+    static long long Now(); ///< Current time in ticks.
+
+    void Enable(bool on); ///< Start or stop recording.
+    bool IsEnabled() const; ///< Whether zones are being recorded.
+    void Clear(); ///< Forget everything recorded.
+
+    ProfileThreadBuffer* GetThreadBuffer(); ///< Buffer for the calling thread.
+    void Record(const char* name, long long start, long long end); ///< Record a zone.
+    void SetThreadName(const char* name); ///< Name the calling thread in traces.
+    bool WriteTrace(const char* fname); ///< Write a Chrome trace event file.
+}; //CProfiler
+
+extern CProfiler g_cProfiler; ///< The profiler.
+extern thread_local ProfileThreadBuffer* t_pProfileBuffer; ///< Calling thread's buffer, null until it has one.
+
+/// Read the tick counter. On x86 this is the time stamp counter, which is
+/// the cheapest clock there is and on any recent processor runs at a
+/// constant rate. Elsewhere it is nanoseconds from a monotonic clock.
+/// This is inline because every zone calls it twice.
+/// \return Current time in ticks.
+
+inline long long CProfiler::Now(){
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+  return (long long)__rdtsc();
+#else
+  return chrono::duration_cast<chrono::nanoseconds>(
+    chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+} //Now
+
+/// Find out whether zones are being recorded. This is inline because
+/// every zone calls it, whether or not profiling is on.
+/// \return true if zones are being recorded.
+
+inline bool CProfiler::IsEnabled() const{
+  return m_bEnabled.load(memory_order_relaxed);
+} //IsEnabled
+
+/// Record a zone in the calling thread's ring buffer. The event is
+/// written before the count is bumped, so a reader that sees the new
+/// count sees the whole event. This is inline because it is on the path
+/// of every zone when profiling is on.
+/// \param name Name of zone, which must be a string literal.
+/// \param start Time the zone was entered, in ticks.
+/// \param end Time the zone was left, in ticks.
+
+inline void CProfiler::Record(const char* name, long long start, long long end){
+  ProfileThreadBuffer* p = t_pProfileBuffer? t_pProfileBuffer: GetThreadBuffer();
+  const unsigned n = p->m_nCount.load(memory_order_relaxed);
+
+  ProfileEvent& e = p->m_cEvent[n & (ProfileThreadBuffer::SIZE - 1)];
+  e.szName = name;
+  e.nStart = start;
+  e.nEnd = end;
+
+  p->m_nCount.store(n + 1, memory_order_release);
+} //Record
+
+/// \brief A profiling zone.
+///
+/// A zone times the scope that it is declared in, from construction to
+/// destruction. Use the macro PROFILE_ZONE rather than this directly.
+
+class CProfileZone{
+  private:
+    const char* m_szName; ///< Name of zone.
+    long long m_nStart; ///< Time entered in ticks, 0 if profiling was off.
+
+  public:
+    /// \param name Name of zone, which must be a string literal.
+    CProfileZone(const char* name): m_szName(name),
+      m_nStart(g_cProfiler.IsEnabled()? CProfiler::Now(): 0){}
+
+    ~CProfileZone(){
+      if(m_nStart)g_cProfiler.Record(m_szName, m_nStart, CProfiler::Now());
+    } //destructor
+}; //CProfileZone
+
+#ifdef PROFILE_ON
+  #define PROFILE_JOIN2(a, b) a##b ///< Paste tokens together.
+  #define PROFILE_JOIN(a, b) PROFILE_JOIN2(a, b) ///< Paste tokens together after expanding them.
+
+  /// Time the rest of the enclosing scope as a zone with the given name.
+  #define PROFILE_ZONE(name) CProfileZone PROFILE_JOIN(cProfileZone, __LINE__)(name)
+#else
+  #define PROFILE_ZONE(name) ///< Profiling is compiled away.
+#endif //PROFILE_ON
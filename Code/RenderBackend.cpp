@@ -0,0 +1,92 @@
+/// \file RenderBackend.cpp
+/// \brief Code for the render backend class CRenderBackend.
+
+#include <string.h>
+
+#include "RenderBackend.h"
+
+/// Zero all counts.
+
+void RenderFrameStats::Clear(){
+  memset(nCommands, 0, sizeof(nCommands));
+  nBytesUploaded = 0;
+} //Clear
+
+/// Get the number of draw commands.
+/// \return Number of draw commands.
+
+int RenderFrameStats::GetDrawCalls() const{
+  return nCommands[DRAW_COMMAND] + nCommands[DRAW_INSTANCED_COMMAND];
+} //GetDrawCalls
+
+/// Get the number of commands that bind state for later draws.
+/// \return Number of state changes.
+
+int RenderFrameStats::GetStateChanges() const{
+  return nCommands[SET_RENDER_TARGET_COMMAND] + nCommands[SET_SHADERS_COMMAND] +
+    nCommands[SET_TOPOLOGY_COMMAND] + nCommands[SET_VERTEX_BUFFERS_COMMAND] +
+    nCommands[SET_CONSTANT_BUFFER_COMMAND] + nCommands[SET_TEXTURE_COMMAND] +
+    nCommands[SET_BLEND_STATE_COMMAND] + nCommands[SET_RASTERIZER_STATE_COMMAND];
+} //GetStateChanges
+
+/// Get the number of commands that copy data into buffers.
+/// \return Number of buffer updates.
+
+int RenderFrameStats::GetBufferUpdates() const{
+  return nCommands[UPDATE_BUFFER_COMMAND] + nCommands[WRITE_BUFFER_COMMAND];
+} //GetBufferUpdates
+
+/// Get a printable name for a command type.
+/// \param t Command type.
+/// \return Name of command type.
+
+const char* GetRenderCommandName(RenderCommandType t){
+  static const char* names[NUM_RENDER_COMMANDS] = {
+    "SetRenderTarget", "Clear", "SetShaders", "SetTopology", "SetVertexBuffers",
+    "UpdateBuffer", "WriteBuffer", "SetConstantBuffer", "SetTexture",
+    "SetBlendState", "SetRasterizerState", "Draw", "DrawInstanced", "Present"
+  }; //names
+
+  if(t < 0 || t >= NUM_RENDER_COMMANDS)return "Unknown";
+  return names[t];
+} //GetRenderCommandName
+
+CRenderBackend::CRenderBackend(): m_nFrames(0){
+  m_cCurrentFrame.Clear();
+  m_cLastFrame.Clear();
+} //constructor
+
+CRenderBackend::~CRenderBackend(){
+} //destructor
+
+/// Count a command in the frame in progress.
+/// \param t Command type.
+/// \param bytes Number of bytes the command uploads, if any.
+
+void CRenderBackend::Count(RenderCommandType t, size_t bytes){
+  m_cCurrentFrame.nCommands[t]++;
+  m_cCurrentFrame.nBytesUploaded += bytes;
+} //Count
+
+/// Finish counting the frame in progress, which becomes the last frame.
+/// Backends call this when they present.
+
+void CRenderBackend::EndFrame(){
+  m_cLastFrame = m_cCurrentFrame;
+  m_cCurrentFrame.Clear();
+  m_nFrames++;
+} //EndFrame
+
+/// Get the command counts for the last frame presented.
+/// \return Counts for the last frame.
+
+const RenderFrameStats& CRenderBackend::GetLastFrameStats() const{
+  return m_cLastFrame;
+} //GetLastFrameStats
+
+/// Get the number of frames presented so far.
+/// \return Number of frames.
+
+int CRenderBackend::GetFrameCount() const{
+  return m_nFrames;
+} //GetFrameCount
@@ -0,0 +1,93 @@
+/// \file RenderBackend.h
+/// \brief Interface for the render backend class CRenderBackend.
+///
+/// The render backend is the only thing that issues per-frame commands to
+/// the graphics API. It knows nothing about Direct3D, so that the game can
+/// be rendered into a backend that just records what it was asked to do.
+
+#pragma once
+
+#include <stddef.h>
+
+typedef const void* RenderHandle; ///< Opaque handle to a shader, buffer, texture, or state.
+
+/// Kinds of command that a render backend accepts.
+
+enum RenderCommandType{
+  SET_RENDER_TARGET_COMMAND, ///< Bind the back buffer and depth buffer.
+  CLEAR_COMMAND, ///< Clear the back buffer and depth buffer.
+  SET_SHADERS_COMMAND, ///< Set input layout, vertex shader, and pixel shader.
+  SET_TOPOLOGY_COMMAND, ///< Set primitive topology.
+  SET_VERTEX_BUFFERS_COMMAND, ///< Set vertex buffers.
+  UPDATE_BUFFER_COMMAND, ///< Copy data into a default buffer.
+  WRITE_BUFFER_COMMAND, ///< Overwrite the contents of a dynamic buffer.
+  SET_CONSTANT_BUFFER_COMMAND, ///< Set vertex shader constant buffer.
+  SET_TEXTURE_COMMAND, ///< Set pixel shader texture.
+  SET_BLEND_STATE_COMMAND, ///< Set blend state.
+  SET_RASTERIZER_STATE_COMMAND, ///< Set rasterizer state.
+  DRAW_COMMAND, ///< Draw.
+  DRAW_INSTANCED_COMMAND, ///< Draw instanced.
+  PRESENT_COMMAND, ///< Present the back buffer.
+  NUM_RENDER_COMMANDS ///< Number of kinds of command.
+}; //RenderCommandType
+
+/// Primitive topologies.
+
+enum RenderTopology{
+  TRIANGLE_STRIP_TOPOLOGY, ///< Triangle strip.
+  TRIANGLE_LIST_TOPOLOGY ///< Triangle list.
+}; //RenderTopology
+
+/// \brief Counts of the commands issued in one frame.
+
+struct RenderFrameStats{
+  int nCommands[NUM_RENDER_COMMANDS]; ///< Number of commands of each kind.
+  size_t nBytesUploaded; ///< Bytes copied into buffers.
+
+  void Clear(); ///< Zero all counts.
+  int GetDrawCalls() const; ///< Number of draw commands.
+  int GetStateChanges() const; ///< Number of commands that bind state.
+  int GetBufferUpdates() const; ///< Number of buffer updates.
+}; //RenderFrameStats
+
+const char* GetRenderCommandName(RenderCommandType t); ///< Name of a command type.
+
+/// \brief The render backend.
+///
+/// The render backend takes the commands that the renderer issues each frame.
+/// Resources are referred to by opaque handles. Every backend counts the
+/// commands it is given, frame by frame, so that the cost of a frame can be
+/// tracked whichever backend draws it.
+
+class CRenderBackend{
+  private:
+    RenderFrameStats m_cCurrentFrame; ///< Counts for the frame in progress.
+    RenderFrameStats m_cLastFrame; ///< Counts for the last complete frame.
+    int m_nFrames; ///< Number of frames presented.
+
+  protected:
+    void Count(RenderCommandType t, size_t bytes=0); ///< Count a command.
+    void EndFrame(); ///< Finish counting a frame.
+
+  public:
+    CRenderBackend(); ///< Constructor.
+    virtual ~CRenderBackend(); ///< Destructor.
+
+    virtual void SetRenderTarget() = 0; ///< Bind the back buffer and depth buffer.
+    virtual void Clear(const float color[4]) = 0; ///< Clear the back buffer and depth buffer.
+    virtual void SetShaders(RenderHandle layout, RenderHandle vs, RenderHandle ps) = 0; ///< Set shaders.
+    virtual void SetTopology(RenderTopology t) = 0; ///< Set primitive topology.
+    virtual void SetVertexBuffers(int n, const RenderHandle* buffers, const unsigned* strides) = 0; ///< Set vertex buffers.
+    virtual void UpdateBuffer(RenderHandle buffer, const void* data, size_t bytes) = 0; ///< Update a default buffer.
+    virtual bool WriteBuffer(RenderHandle buffer, const void* data, size_t bytes) = 0; ///< Overwrite a dynamic buffer.
+    virtual void SetConstantBuffer(int slot, RenderHandle buffer) = 0; ///< Set constant buffer.
+    virtual void SetTexture(int slot, RenderHandle texture) = 0; ///< Set texture.
+    virtual void SetBlendState(RenderHandle state) = 0; ///< Set blend state.
+    virtual void SetRasterizerState(RenderHandle state) = 0; ///< Set rasterizer state.
+    virtual void Draw(int vertices, int first) = 0; ///< Draw.
+    virtual void DrawInstanced(int vertices, int instances, int firstvertex, int firstinstance) = 0; ///< Draw instanced.
+    virtual void Present(int interval) = 0; ///< Present the frame.
+
+    const RenderFrameStats& GetLastFrameStats() const; ///< Counts for the last frame.
+    int GetFrameCount() const; ///< Number of frames presented.
+}; //CRenderBackend
@@ -7,20 +7,26 @@
 #include "defines.h"
 #include "abort.h"
 #include "debug.h"
+#include "Profiler.h"
+#include "D3D11RenderBackend.h"
+#include "NullRenderBackend.h"
+#include "StateFilterBackend.h"
 
 extern int g_nScreenWidth;
 extern int g_nScreenHeight;
 
-CRenderer::CRenderer():m_pDev2(nullptr){
+CRenderer::CRenderer():m_pDev2(nullptr), m_pBackend(nullptr){
   m_matWorld = XMMatrixIdentity();
   m_matView = XMMatrixIdentity();
   m_matProj = XMMatrixIdentity();
+  UpdateViewProjectionMatrix();
 } //constructor
 
 /// All D3D objects used in the game are released - the release function is kind
 /// of like a destructor for DirectX entities, which are COM objects.
 
 void CRenderer::Release(){ 
+  SAFE_DELETE(m_pBackend);
   SAFE_RELEASE(m_pDC2);
   SAFE_RELEASE(m_pRasterizerState);
   SAFE_RELEASE(m_pSwapChain2);
@@ -49,6 +55,9 @@ BOOL CRenderer::InitD3D(HINSTANCE hInstance, HWND hwnd){
   if(FAILED(CreateRasterizer()))
     return FALSE;
   CreateViewport();
+
+  m_pBackend = new CStateFilterBackend(
+    new CD3D11RenderBackend(m_pDC2, m_pSwapChain2, m_pRTV, m_pDSV));
   
   //transformation matrices
   SetViewMatrix(Vector3(1024, 384, -350.0f), Vector3(1024, 384, 1000));
@@ -57,6 +66,32 @@ BOOL CRenderer::InitD3D(HINSTANCE hInstance, HWND hwnd){
   return TRUE; //success exit
 } //InitD3D
 
+/// Initialize the renderer without a window or a GPU. There is no device,
+/// so no resources are created and every handle is null, but per-frame
+/// commands are recorded by a null backend so that frames can be composed
+/// and their cost measured. The null backend sits behind the same state
+/// filter as the Direct3D backend does, so it records only what would
+/// reach the GPU.
+/// \return TRUE if it succeeded
+
+BOOL CRenderer::InitHeadless(){
+  m_pDev2 = nullptr;
+  m_pBackend = new CStateFilterBackend(new CNullRenderBackend);
+
+  //transformation matrices
+  SetViewMatrix(Vector3(1024, 384, -350.0f), Vector3(1024, 384, 1000));
+  SetProjectionMatrix();
+
+  return TRUE; //success exit
+} //InitHeadless
+
+/// Get the backend that per-frame commands go to.
+/// \return Pointer to the render backend, nullptr before initialization.
+
+CRenderBackend* CRenderer::GetBackend(){
+  return m_pBackend;
+} //GetBackend
+
 /// Set and initialize the device, device context, and swap chain.
 /// Assign them to the member pointers m_pDev2, m_pDC2, and m_pSwapChain2.
 /// \param hwnd Window handle
@@ -214,6 +249,7 @@ void CRenderer::SetWorldMatrix(const Vector3& v){
 
 void CRenderer::SetViewMatrix(const Vector3& s, const Vector3& p){
   m_matView = XMMatrixLookAtLH(s, p, Vector3(0, 1, 0));
+  UpdateViewProjectionMatrix();
 } //SetViewMatrix
 
 /// Set the projection matrix m_matProj to a perspective projection matrix
@@ -221,38 +257,156 @@ void CRenderer::SetViewMatrix(const Vector3& s, const Vector3& p){
 
 void CRenderer::SetProjectionMatrix(){
   m_matProj = XMMatrixPerspectiveFovLH((float)XM_PI/4.0f, (float)g_nScreenWidth/g_nScreenHeight, 1.0f, 10000.0f);
+  UpdateViewProjectionMatrix();
 } //SetProjectionMatrix
 
+/// Recompute the product of the view and projection matrices, which
+/// only changes when one of them does.
+
+void CRenderer::UpdateViewProjectionMatrix(){
+  m_matViewProj = m_matView * m_matProj;
+  XMStoreFloat4x4(&m_matViewProjT, XMMatrixTranspose(m_matViewProj));
+} //UpdateViewProjectionMatrix
+
 /// Compose the world, view, and projection transformations.
 /// \return Product of the world, view, and projection matrices.
 
 XMFLOAT4X4 CRenderer::CalculateWorldViewProjectionMatrix(){
   XMFLOAT4X4 f;
-  XMStoreFloat4x4(&f, XMMatrixTranspose(m_matWorld * m_matView * m_matProj));
+  XMStoreFloat4x4(&f, XMMatrixTranspose(m_matWorld * m_matViewProj));
   return f;
 } //CalculateWorldViewProjectionMatrix
 
-/// Load an image from a file into a D3D texture. 
-/// \param v Pointer to D3D texture to receive the image
+/// Get the product of the view and projection transformations, transposed
+/// for shaders. This is the world view projection matrix for anything
+/// whose vertices are already in world space.
+/// \return Product of the view and projection matrices, transposed.
+
+const XMFLOAT4X4& CRenderer::GetViewProjectionMatrix(){
+  return m_matViewProjT;
+} //GetViewProjectionMatrix
+
+/// Load an image from a file into a D3D texture. If the texture manifest
+/// gives a DDS file for it, that is loaded instead, falling back to the
+/// image if it can't be.
+/// \param v Pointer to D3D texture to receive the image, nullptr on failure
 /// \param fname Name of the file containing the texture
 /// \param w Pointer to a variable that receives the texture width
 /// \param h Pointer to a variable that receives the texture width 
 
 void CRenderer::LoadTexture(ID3D11ShaderResourceView* &v, char* fname, int* w, int* h){
   wchar_t  ws[100];
-  swprintf(ws, 100, L"%hs", fname);
-  CreateWICTextureFromFile(m_pDev2, m_pDC2, ws, nullptr, &v, 0);
+  v = nullptr;
+
+  //block compressed, with mips, if the texture compressor has made one
+  const char* dds = GetCompressedTextureName(fname);
+  if(dds){
+    swprintf(ws, 100, L"%hs", dds);
+    CreateDDSTextureFromFile(m_pDev2, ws, nullptr, &v);
+    if(v == nullptr)
+      DEBUGPRINTF("Cannot load %s, loading %s instead.\n", dds, fname);
+  } //if
+
+  if(v == nullptr){
+    swprintf(ws, 100, L"%hs", fname);
+    CreateWICTextureFromFile(m_pDev2, m_pDC2, ws, nullptr, &v, 0);
+  } //if
+
+  if(v == nullptr)return; //bail and fail
 
   //get texture width and height
   ID3D11Resource* r;
   D3D11_TEXTURE2D_DESC desc;
   v->GetResource(&r);
   ((ID3D11Texture2D*)r)->GetDesc(&desc);
+  SAFE_RELEASE(r); //GetResource added a reference
 
   if(w)*w = desc.Width;
   if(h)*h = desc.Height;
 } //LoadTexture
 
+/// Load the manifest written by the texture compressor, which gives the
+/// DDS file to use in place of each image that it has compressed.
+/// Images that aren't in the manifest are loaded as before.
+/// \param fname File name of texture manifest.
+/// \return TRUE if the manifest was found and loaded.
+
+BOOL CRenderer::LoadTextureManifest(const char* fname){
+  PROFILE_ZONE("CRenderer::LoadTextureManifest");
+  tinyxml2::XMLDocument doc;
+  if(doc.LoadFile(fname) != 0)return FALSE; //no manifest, no compressed textures
+
+  XMLElement* root = doc.FirstChildElement("textures");
+  if(root == nullptr)return FALSE; //bail and fail
+
+  for(XMLElement* tag = root->FirstChildElement("texture"); tag;
+    tag = tag->NextSiblingElement("texture"))
+  {
+    const char* src = tag->Attribute("src");
+    const char* dds = tag->Attribute("dds");
+    if(src && dds)
+      m_stlCompressedTextures[src] = dds;
+  } //for
+
+  return TRUE;
+} //LoadTextureManifest
+
+/// Get the name of the DDS file that the texture compressor made from an
+/// image file, if there is one.
+/// \param fname Image file name, as in the settings file.
+/// \return DDS file name, nullptr if the image isn't in the manifest.
+
+const char* CRenderer::GetCompressedTextureName(const char* fname){
+  auto it = m_stlCompressedTextures.find(fname);
+  return it == m_stlCompressedTextures.end()? nullptr: it->second.c_str();
+} //GetCompressedTextureName
+
+/// Create a texture from the contents of a DDS file that has already been
+/// read into memory. The mips are in the file, so none are generated.
+/// \param v Pointer to D3D texture to receive the image, nullptr on failure
+/// \param data Pointer to the DDS file contents
+/// \param bytes Size of DDS file in bytes
+
+void CRenderer::CreateTextureFromDDS(ID3D11ShaderResourceView* &v, const void* data, size_t bytes){
+  v = nullptr;
+  CreateDDSTextureFromMemory(m_pDev2, (const uint8_t*)data, bytes, nullptr, &v);
+} //CreateTextureFromDDS
+
+/// Create a texture from 32-bit RGBA pixels that have already been decoded,
+/// with a full mip chain generated on the GPU.
+/// \param v Pointer to D3D texture to receive the image, nullptr on failure
+/// \param pixels Pointer to the pixels, w*h of them, top row first
+/// \param w Width of image
+/// \param h Height of image
+
+void CRenderer::CreateTexture(ID3D11ShaderResourceView* &v, const void* pixels, int w, int h){
+  v = nullptr;
+
+  D3D11_TEXTURE2D_DESC desc;
+  desc.Width = w;
+  desc.Height = h;
+  desc.MipLevels = 0; //full mip chain
+  desc.ArraySize = 1;
+  desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+  desc.SampleDesc.Count = 1;
+  desc.SampleDesc.Quality = 0;
+  desc.Usage = D3D11_USAGE_DEFAULT;
+  desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+  desc.CPUAccessFlags = 0;
+  desc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+
+  ID3D11Texture2D* pTexture = nullptr;
+  if(FAILED(m_pDev2->CreateTexture2D(&desc, nullptr, &pTexture)))
+    return; //bail and fail
+
+  if(SUCCEEDED(m_pDev2->CreateShaderResourceView(pTexture, nullptr, &v))){
+    m_pDC2->UpdateSubresource(pTexture, 0, nullptr, pixels, w*4, w*h*4);
+    m_pDC2->GenerateMips(v);
+  } //if
+
+  SAFE_RELEASE(pTexture); //the view holds a reference
+} //CreateTexture
+
 /// Set wireframe mode on or off.
 /// \param on TRUE iff wireframe mode is to be turned on. 
 
@@ -262,5 +416,5 @@ void CRenderer::SetWireFrameMode(BOOL on){
   hr = m_pDev2->CreateRasterizerState1(&m_rasterizerDesc, &m_pRasterizerState);
     
   if(SUCCEEDED(hr))
-    m_pDC2->RSSetState(m_pRasterizerState);
+    m_pBackend->SetRasterizerState(m_pRasterizerState);
 } //SetWireFrameMode
\ No newline at end of file
@@ -3,11 +3,15 @@
 
 #pragma once
 
+#include <map>
+#include <string>
 #include <vector>
 #include <D3Dcompiler.h>
 
 #include "WICTextureLoader.h"
+#include "DDSTextureLoader.h"
 #include "defines.h"
+#include "RenderBackend.h"
 
 using namespace std;
 using namespace DirectX;
@@ -20,6 +24,8 @@ using namespace DirectX;
 class CRenderer{
   friend class CShader;
   friend class C3DSprite;
+  friend class CFrameCache;
+  friend class CShaderCache;
 
   protected:
     HRESULT CreateD3DDeviceAndSwapChain(HWND hwnd); ///< Create D3d device.
@@ -30,12 +36,14 @@ class CRenderer{
     void SetWorldMatrix(const Vector3& v=Vector3(0.0f)); ///< Set the world matrix.
     void SetViewMatrix(const Vector3& s, const Vector3& p); ///< Set the view matrix.
     void SetProjectionMatrix(); ///< Set the projection matrix.
+    void UpdateViewProjectionMatrix(); ///< Recompute view projection matrix.
 
     ID3D11RasterizerState1* m_pRasterizerState; ///< Rasterizer state.
     D3D11_RASTERIZER_DESC1 m_rasterizerDesc; ///< Rasterizer description.
 
   protected:
-    ID3D11Device2* m_pDev2; ///< D3D device.
+    ID3D11Device2* m_pDev2; ///< D3D device, nullptr when headless.
+    CRenderBackend* m_pBackend; ///< Backend that per-frame commands go to.
 
     ID3D11DeviceContext2* m_pDC2; ///< Device context.
 
@@ -45,14 +53,27 @@ class CRenderer{
     XMMATRIX m_matWorld; ///< World matrix.
     XMMATRIX m_matView; ///< View matrix.
     XMMATRIX m_matProj; ///< Projection matrix.
+    XMMATRIX m_matViewProj; ///< Product of view and projection matrices.
+    XMFLOAT4X4 m_matViewProjT; ///< Same, transposed for shaders.
+
+    map<string, string> m_stlCompressedTextures; ///< DDS file name for each image file name.
   
   public:
 	  IDXGISwapChain2* m_pSwapChain2; ///< Swap chain.
     CRenderer(); ///< Constructor.
     BOOL InitD3D(HINSTANCE hInstance, HWND hwnd); ///< Initialize Direct3D 11.2.
+    BOOL InitHeadless(); ///< Initialize without a window or a GPU.
+    CRenderBackend* GetBackend(); ///< Get the render backend.
+    BOOL LoadTextureManifest(const char* fname); ///< Load compressed texture manifest.
+    const char* GetCompressedTextureName(const char* fname); ///< Get DDS file name for an image.
     void LoadTexture(ID3D11ShaderResourceView* &v, char* fname,
       int* w=0, int* h=0); ///< Load texture from a file.
+    void CreateTexture(ID3D11ShaderResourceView* &v, const void* pixels,
+      int w, int h); ///< Create texture from RGBA pixels.
+    void CreateTextureFromDDS(ID3D11ShaderResourceView* &v, const void* data,
+      size_t bytes); ///< Create texture from DDS file contents.
     XMFLOAT4X4 CalculateWorldViewProjectionMatrix(); ///< Compute product of world, view, and projection matrices. 
+    const XMFLOAT4X4& GetViewProjectionMatrix(); ///< Get product of view and projection matrices.
     void SetWireFrameMode(BOOL on); ///< Turn wireframe mode on or off.
     virtual void Release(); ///< Release D3D stuff.
 }; //CRenderer
\ No newline at end of file
@@ -0,0 +1,235 @@
+/// \file Replay.cpp
+/// \brief Code for the replay writer CReplayWriter and reader CReplayReader.
+
+#include <string.h>
+
+#include "Replay.h"
+#include "Portable.h"
+
+static const unsigned char REPLAY_MAGIC[4] = {'A', 'G', 'R', 'P'}; ///< First bytes of a replay.
+static const int REPLAY_HEADER_BYTES = 8; ///< Size of the header.
+
+CReplayWriter::CReplayWriter(): m_pFile(nullptr), m_nTick(0), m_nSkipped(0){
+} //constructor
+
+CReplayWriter::~CReplayWriter(){
+  Close();
+} //destructor
+
+/// Start a replay file, closing any that is open.
+/// \param fname Name of replay file.
+/// \param teamsize Fighters on each team.
+/// \param tagteam Whether it is played in tag-team mode.
+/// \return true if the file was opened.
+
+bool CReplayWriter::Open(const char* fname, int teamsize, bool tagteam){
+  Close();
+
+  if(fopen_s(&m_pFile, fname, "wb") != 0 || m_pFile == nullptr)return false;
+
+  unsigned char header[REPLAY_HEADER_BYTES];
+  memcpy(header, REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+  header[4] = (unsigned char)REPLAY_VERSION;
+  header[5] = (unsigned char)teamsize;
+  header[6] = tagteam? 1: 0;
+  header[7] = 0;
+  fwrite(header, 1, sizeof(header), m_pFile);
+
+  m_nTick = m_nSkipped = 0;
+  return true;
+} //Open
+
+/// Write a number in the variable-length form, 7 bits a byte, low bits first.
+/// \param n The number.
+
+void CReplayWriter::PutNumber(unsigned n){
+  while(n >= 0x80){
+    fputc((int)(n & 0x7F) | 0x80, m_pFile);
+    n >>= 7;
+  } //while
+
+  fputc((int)n, m_pFile);
+} //PutNumber
+
+/// Record the keys pressed on a tick, which is only written if any were,
+/// and every REPLAY_CHECKSUM_INTERVAL ticks, the checksum after the tick.
+/// \param input Keys pressed by each team, FighterInput bits.
+/// \param checksum Checksum of the state after the tick.
+
+void CReplayWriter::Record(const NetInput* input, unsigned checksum){
+  if(m_pFile == nullptr)return;
+
+  bool bKeys = false; //whether any key was pressed
+  for(int i=0; i<NUM_TEAMS; i++)
+    bKeys = bKeys || input[i] != 0;
+
+  if(bKeys){
+    PutNumber((unsigned)m_nSkipped << 1);
+    for(int i=0; i<NUM_TEAMS; i++)
+      fputc(input[i], m_pFile);
+    m_nSkipped = 0;
+  } //if
+
+  else m_nSkipped++;
+
+  if(++m_nTick%REPLAY_CHECKSUM_INTERVAL == 0){
+    PutNumber((unsigned)m_nSkipped << 1 | 1);
+    for(int i=0; i<4; i++)
+      fputc((int)(checksum >> (8*i)) & 0xFF, m_pFile);
+    m_nSkipped = 0;
+    fflush(m_pFile); //a second at most is lost in a crash
+  } //if
+} //Record
+
+/// Finish the replay file, with a record for any ticks at the end on which
+/// no key was pressed, so that the replay runs for as long as the match did.
+/// The checksum in that record is of no tick in particular, so it's zero,
+/// and the reader drops it.
+
+void CReplayWriter::Close(){
+  if(m_pFile == nullptr)return;
+
+  if(m_nSkipped > 0){
+    PutNumber((unsigned)m_nSkipped << 1 | 1);
+    for(int i=0; i<4; i++)
+      fputc(0, m_pFile);
+  } //if
+
+  fclose(m_pFile);
+  m_pFile = nullptr;
+} //Close
+
+/// \return true if a replay file is open.
+
+bool CReplayWriter::IsOpen() const{
+  return m_pFile != nullptr;
+} //IsOpen
+
+/// \return Number of ticks recorded since the file was opened.
+
+int CReplayWriter::GetTick() const{
+  return m_nTick;
+} //GetTick
+
+CReplayReader::CReplayReader():
+  m_nTeamSize(1), m_bTagTeam(false), m_bTruncated(false), m_nBytes(0){
+} //constructor
+
+/// Read a replay file and unpack it. Checksums are only kept for ticks that
+/// are a multiple of REPLAY_CHECKSUM_INTERVAL, as the writer puts them.
+/// \param fname Name of replay file.
+/// \return true if it is a replay of this version. A replay cut short is
+/// still read, as far as its last whole record.
+
+bool CReplayReader::Load(const char* fname){
+  m_vInput.clear();
+  m_vChecksum.clear();
+  m_bTruncated = false;
+
+  FILE* input = nullptr;
+  if(fopen_s(&input, fname, "rb") != 0 || input == nullptr)return false;
+
+  vector<unsigned char> data;
+  unsigned char buffer[4096];
+  size_t n;
+
+  while((n = fread(buffer, 1, sizeof(buffer), input)) > 0)
+    data.insert(data.end(), buffer, buffer + n);
+
+  fclose(input);
+  m_nBytes = data.size();
+
+  if(data.size() < REPLAY_HEADER_BYTES || memcmp(data.data(), REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) ||
+    data[4] != REPLAY_VERSION)
+    return false;
+
+  m_nTeamSize = data[5];
+  m_bTagTeam = data[6] != 0;
+
+  const unsigned char* p = data.data() + REPLAY_HEADER_BYTES;
+  const unsigned char* end = data.data() + data.size();
+
+  while(p < end){
+    unsigned v = 0; //variable-length number
+    int shift = 0; //where its next 7 bits go
+    const unsigned char* q = p; //read ahead, in case the record isn't whole
+
+    while(q < end && (*q & 0x80) && shift < 28){
+      v |= (unsigned)(*q++ & 0x7F) << shift;
+      shift += 7;
+    } //while
+
+    if(q == end || (*q & 0x80)){ //cut short, or too long to be a number
+      m_bTruncated = true;
+      break;
+    } //if
+
+    v |= (unsigned)*q++ << shift;
+
+    const size_t size = v & 1? 4: NUM_TEAMS; //bytes after the number
+    if((size_t)(end - q) < size){
+      m_bTruncated = true;
+      break;
+    } //if
+
+    m_vInput.resize(m_vInput.size() + NUM_TEAMS*(size_t)(v >> 1), 0);
+
+    if(v & 1){
+      ReplayChecksum c;
+      c.nTick = GetTickCount();
+      c.nChecksum = q[0] | q[1] << 8 | q[2] << 16 | (unsigned)q[3] << 24;
+      if(c.nTick%REPLAY_CHECKSUM_INTERVAL == 0)
+        m_vChecksum.push_back(c);
+    } //if
+
+    else m_vInput.insert(m_vInput.end(), q, q + NUM_TEAMS);
+
+    p = q + size;
+  } //while
+
+  return true;
+} //Load
+
+/// \return Number of ticks in the replay.
+
+int CReplayReader::GetTickCount() const{
+  return (int)(m_vInput.size()/NUM_TEAMS);
+} //GetTickCount
+
+/// \param tick Tick, from 0 to GetTickCount() - 1.
+/// \return Keys pressed by each team on the tick, indexed by team.
+
+const NetInput* CReplayReader::GetInput(int tick) const{
+  return &m_vInput[NUM_TEAMS*(size_t)tick];
+} //GetInput
+
+/// \return Checksums, each of the state after some number of ticks, in
+/// order of tick.
+
+const vector<ReplayChecksum>& CReplayReader::GetChecksums() const{
+  return m_vChecksum;
+} //GetChecksums
+
+/// \return Fighters on each team when the replay was recorded.
+
+int CReplayReader::GetTeamSize() const{
+  return m_nTeamSize;
+} //GetTeamSize
+
+/// \return true if the replay was recorded in tag-team mode.
+
+bool CReplayReader::IsTagTeam() const{
+  return m_bTagTeam;
+} //IsTagTeam
+
+/// \return true if the file ended part way through a record.
+
+bool CReplayReader::IsTruncated() const{
+  return m_bTruncated;
+} //IsTruncated
+
+/// \return Size of the file in bytes.
+
+size_t CReplayReader::GetSize() const{
+  return m_nBytes;
+} //GetSize
@@ -0,0 +1,101 @@
+/// \file Replay.h
+/// \brief Interface for the replay writer CReplayWriter and reader CReplayReader.
+///
+/// A replay is the keys both teams pressed on every tick of a match, which
+/// is all it takes to play the match again, since the simulation gives the
+/// same result for the same keys on every machine and build. The stream
+/// starts with a header:
+///
+///     bytes 0-3   "AGRP"
+///     byte 4      REPLAY_VERSION
+///     byte 5      fighters on each team
+///     byte 6      1 for tag-team mode, 0 if not
+///     byte 7      0
+///
+/// followed by records, each starting with a number n in the variable-length
+/// form that uses 7 bits a byte, low bits first, with the top bit set on
+/// every byte but the last. Every record first skips n/2 ticks on which
+/// nobody pressed a key. Then if n is even, the next two bytes are the keys
+/// pressed on the tick after those by the right team and the left team. If
+/// n is odd, the next four bytes are the little-endian checksum of the state
+/// after the ticks so far. A match in which each team presses a key on
+/// one tick in three takes under two bytes a tick.
+
+#pragma once
+
+#include <stdio.h>
+
+#include <vector>
+
+#include "NetSession.h"
+#include "EntityStore.h"
+
+using namespace std;
+
+const int REPLAY_VERSION = 1; ///< Version of the replay stream.
+const int REPLAY_CHECKSUM_INTERVAL = 60; ///< Ticks between checksums in a replay.
+
+/// \brief A checksum stored in a replay.
+
+struct ReplayChecksum{
+  int nTick; ///< Number of ticks run.
+  unsigned nChecksum; ///< Checksum of the state after them.
+}; //ReplayChecksum
+
+/// \brief The replay writer.
+///
+/// The replay writer writes the keys pressed on each tick to a replay
+/// file as the match is played, with a checksum once a second. The file
+/// is flushed after each checksum, so that if the game crashes, the replay
+/// still holds everything up to a second before, which is what it takes
+/// to see the crash again.
+
+class CReplayWriter{
+  private:
+    FILE* m_pFile; ///< Replay file, nullptr if none is open.
+    int m_nTick; ///< Ticks recorded.
+    int m_nSkipped; ///< Ticks since the last record, on which no key was pressed.
+
+    void PutNumber(unsigned n); ///< Write a variable-length number.
+
+  public:
+    CReplayWriter(); ///< Constructor.
+    ~CReplayWriter(); ///< Destructor.
+
+    bool Open(const char* fname, int teamsize, bool tagteam); ///< Start a replay file.
+    void Record(const NetInput* input, unsigned checksum); ///< Record a tick.
+    void Close(); ///< Finish the replay file.
+
+    bool IsOpen() const; ///< Whether a replay file is open.
+    int GetTick() const; ///< Number of ticks recorded.
+}; //CReplayWriter
+
+/// \brief The replay reader.
+///
+/// The replay reader reads a whole replay file into memory and unpacks it
+/// into the keys pressed on each tick, so that nothing is left to do while
+/// it is played but run the simulation. A replay cut short by a crash is
+/// read as far as its last whole record.
+
+class CReplayReader{
+  private:
+    vector<NetInput> m_vInput; ///< Keys pressed on each tick, NUM_TEAMS to a tick.
+    vector<ReplayChecksum> m_vChecksum; ///< Checksums, in order of tick.
+    int m_nTeamSize; ///< Fighters on each team.
+    bool m_bTagTeam; ///< Whether it was played in tag-team mode.
+    bool m_bTruncated; ///< Whether the file ended part way through a record.
+    size_t m_nBytes; ///< Size of the file in bytes.
+
+  public:
+    CReplayReader(); ///< Constructor.
+
+    bool Load(const char* fname); ///< Read a replay file.
+
+    int GetTickCount() const; ///< Number of ticks.
+    const NetInput* GetInput(int tick) const; ///< Keys pressed by each team on a tick.
+    const vector<ReplayChecksum>& GetChecksums() const; ///< Checksums.
+    int GetTeamSize() const; ///< Fighters on each team.
+    bool IsTagTeam() const; ///< Whether it was played in tag-team mode.
+    bool IsTruncated() const; ///< Whether the file was cut short.
+    size_t GetSize() const; ///< Size of the file in bytes.
+}; //CReplayReader
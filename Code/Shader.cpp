@@ -6,9 +6,11 @@
 #include "defines.h"
 #include "debug.h"
 #include "Abort.h"
+#include "ShaderCache.h"
 
 extern char g_szShaderModel[256];
 extern CGameRenderer GameRenderer;
+extern CShaderCache g_cShaderCache;
 
 /// Constructor, which initializes member variables and creates the  
 /// input element descriptor array.
@@ -18,6 +20,7 @@ CShader::CShader(int n){
   m_pIEDesc = new D3D11_INPUT_ELEMENT_DESC[n];
   m_nMaxDescs = n;
   m_nNumDescs = 0;
+  m_pInputLayout = nullptr;
   m_pVertexShader = nullptr;
   m_pPixelShader = nullptr;
 } //constructor
@@ -34,15 +37,20 @@ CShader::~CShader(){
 /// \param offset Aligned byte offset.
 /// \param fmt Color format.
 /// \param name Semantic name.
+/// \param slot Input slot, that is, which vertex buffer the element comes from.
+/// \param instanced true if the element is per-instance rather than per-vertex data.
 /// \return true if succeeded, false if array full.
 
-bool CShader::AddInputElementDesc(UINT offset, DXGI_FORMAT fmt, LPCSTR name){
+bool CShader::AddInputElementDesc(UINT offset, DXGI_FORMAT fmt, LPCSTR name,
+  UINT slot, bool instanced)
+{
   if(m_nNumDescs < m_nMaxDescs){
     m_pIEDesc[m_nNumDescs].AlignedByteOffset = offset;
     m_pIEDesc[m_nNumDescs].Format = fmt;
-    m_pIEDesc[m_nNumDescs].InputSlot = 0;
-    m_pIEDesc[m_nNumDescs].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-    m_pIEDesc[m_nNumDescs].InstanceDataStepRate = 0;
+    m_pIEDesc[m_nNumDescs].InputSlot = slot;
+    m_pIEDesc[m_nNumDescs].InputSlotClass = instanced?
+      D3D11_INPUT_PER_INSTANCE_DATA: D3D11_INPUT_PER_VERTEX_DATA;
+    m_pIEDesc[m_nNumDescs].InstanceDataStepRate = instanced? 1: 0;
     m_pIEDesc[m_nNumDescs].SemanticIndex = 0;
     m_pIEDesc[m_nNumDescs].SemanticName = name;
 
@@ -53,97 +61,48 @@ bool CShader::AddInputElementDesc(UINT offset, DXGI_FORMAT fmt, LPCSTR name){
   else return false;
 } //AddInputElementDesc
 
-/// Create and compile a vertex shader.
+/// Create a vertex shader and its input layout. The shader cache compiles
+/// the shader only if it hasn't been compiled before, and shares the shader
+/// and input layout with every other CShader that uses them.
 /// \param fileName Name of file containing vertex shader.
 /// \param entryPoint Name of function to call in that file.
 
 bool CShader::VSCreateAndCompile(LPCWSTR fileName, LPCSTR entryPoint){
-  HRESULT hr;
-  ID3DBlob* code;
-  ID3DBlob* errorMsgs;
-
   char shaderModel[256];
   strcpy_s(shaderModel, "vs_");
   strcat_s(shaderModel, g_szShaderModel);
 
-  hr = D3DCompileFromFile(fileName, 0, 0, entryPoint, shaderModel,  0, 0, &code, &errorMsgs);
-
-  if(FAILED(hr)){
-    if(errorMsgs){
-      ABORT("Pixel shader error: %s\n", (char*)errorMsgs->GetBufferPointer());
-      errorMsgs->Release();
-    } //if
-    return false;
-  } //if
-
-  hr = GameRenderer.m_pDev2->CreateVertexShader(code->GetBufferPointer(),
-    code->GetBufferSize(), nullptr, &m_pVertexShader);
-
-  if(FAILED(hr)){
-    if(errorMsgs){
-      ABORT("Pixel shader error: %s\n", (char*)errorMsgs->GetBufferPointer());
-      errorMsgs->Release();
-    } //if
-    return false;
-  } //if
-  
-  hr = GameRenderer.m_pDev2->CreateInputLayout(m_pIEDesc, m_nMaxDescs,
-    code->GetBufferPointer(), code->GetBufferSize(), &m_pInputLayout);
+  SAFE_RELEASE(m_pVertexShader);
+  SAFE_RELEASE(m_pInputLayout);
 
-  SAFE_RELEASE(code);
-  SAFE_RELEASE(errorMsgs);
+  m_pVertexShader = g_cShaderCache.GetVertexShader(fileName, entryPoint, shaderModel,
+    m_pIEDesc, m_nNumDescs, &m_pInputLayout);
 
-  return true;
+  return m_pVertexShader != nullptr && m_pInputLayout != nullptr;
 } //VSCreateAndCompile
 
-/// Create and compile a pixel shader.
+/// Create a pixel shader. The shader cache compiles the shader only if it
+/// hasn't been compiled before, and shares it with every other CShader
+/// that uses it.
 /// \param fileName Name of file containing pixel shader.
 /// \param entryPoint Name of function to call in that file.
 
 bool CShader::PSCreateAndCompile(LPCWSTR fileName, LPCSTR entryPoint){
-  HRESULT hr;
-  ID3DBlob* code;
-  ID3DBlob* errorMsgs;
-
   char shaderModel[256];
   strcpy_s(shaderModel, "ps_");
   strcat_s(shaderModel, g_szShaderModel);
 
-  hr = D3DCompileFromFile(fileName, 0, 0, entryPoint, shaderModel, 
-    0, 0, &code, &errorMsgs);
-
-  if(FAILED(hr)){
-    if(errorMsgs){
-      ABORT("Pixel shader error: %s\n", (char*)errorMsgs->GetBufferPointer());
-      errorMsgs->Release();
-    } //if
-    return false;
-  } //if
-
-  hr = GameRenderer.m_pDev2->CreatePixelShader(code->GetBufferPointer(), 
-    code->GetBufferSize(), nullptr, &m_pPixelShader);
-
-  if(FAILED(hr)){
-    if(errorMsgs){
-      ABORT("Pixel shader error: %s\n", (char*)errorMsgs->GetBufferPointer());
-      errorMsgs->Release();
-    } //if
-    return false;
-  } //if
+  SAFE_RELEASE(m_pPixelShader);
 
-  SAFE_RELEASE(code);
-  SAFE_RELEASE(errorMsgs);
+  m_pPixelShader = g_cShaderCache.GetPixelShader(fileName, entryPoint, shaderModel);
 
-  return true;
+  return m_pPixelShader != nullptr;
 } //PSCreateAndCompile
 
 /// Set the game renderer's vertex and pixel shaders.
 
 void CShader::SetShaders(){
-  ID3D11DeviceContext2* pDC = GameRenderer.m_pDC2;
-  if(pDC){
-    pDC->IASetInputLayout(m_pInputLayout);
-    pDC->VSSetShader(m_pVertexShader, nullptr, 0);
-    pDC->PSSetShader(m_pPixelShader, nullptr, 0);
-  } //if
+  CRenderBackend* pBackend = GameRenderer.m_pBackend;
+  if(pBackend)
+    pBackend->SetShaders(m_pInputLayout, m_pVertexShader, m_pPixelShader);
 } //SetShaders
\ No newline at end of file
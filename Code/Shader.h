@@ -27,7 +27,8 @@ class CShader{
     CShader(int n);
     ~CShader();
 
-    bool AddInputElementDesc(UINT offset, DXGI_FORMAT fmt, LPCSTR name); ///< Add an input element descriptor to the array.
+    bool AddInputElementDesc(UINT offset, DXGI_FORMAT fmt, LPCSTR name,
+      UINT slot=0, bool instanced=false); ///< Add an input element descriptor to the array.
 
     bool VSCreateAndCompile(LPCWSTR fileName, LPCSTR entryPoint); ///< Create and compile vertex shader.
     bool PSCreateAndCompile(LPCWSTR fileName, LPCSTR entryPoint);///< Create and compile pixel shader.
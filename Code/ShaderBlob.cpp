@@ -0,0 +1,134 @@
+/// \file ShaderBlob.cpp
+/// \brief Code for hashing and storing compiled shader bytecode.
+///
+/// A shader blob file consists of a header followed by the bytecode. The
+/// header holds a magic number, a format version, the hash of the shader
+/// source that the bytecode was compiled from, the bytecode size, and a
+/// hash of the bytecode itself so that truncated or corrupt files are
+/// rejected rather than handed to the device.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ShaderBlob.h"
+#include "Portable.h"
+
+const unsigned int SHADER_BLOB_MAGIC = 0x43444853; ///< "SHDC" in little-endian order.
+const unsigned int SHADER_BLOB_VERSION = 1; ///< Bump when the file format changes.
+
+/// Header at the start of a shader blob file.
+
+struct ShaderBlobHeader{
+  unsigned int nMagic; ///< Must be SHADER_BLOB_MAGIC.
+  unsigned int nVersion; ///< Must be SHADER_BLOB_VERSION.
+  ShaderHash nSourceHash; ///< Hash of shader source.
+  ShaderHash nCodeHash; ///< Hash of bytecode.
+  unsigned int nCodeSize; ///< Size of bytecode in bytes.
+  unsigned int nPadding; ///< Zero.
+}; //ShaderBlobHeader
+
+/// Compute the 64-bit FNV-1a hash of a block of memory. The hash of a
+/// sequence of blocks can be found by passing the hash of the earlier
+/// blocks as the seed.
+/// \param p Pointer to memory.
+/// \param n Number of bytes.
+/// \param h Seed.
+/// \return The hash.
+
+ShaderHash HashBytes(const void* p, size_t n, ShaderHash h){
+  const unsigned char* q = (const unsigned char*)p;
+
+  for(size_t i=0; i<n; i++){
+    h ^= q[i];
+    h *= 1099511628211ULL; //FNV prime
+  } //for
+
+  return h;
+} //HashBytes
+
+/// Hash a string, including its null terminator so that consecutive
+/// strings hashed with the same seed can't run into each other.
+/// \param s The string.
+/// \param h Seed.
+/// \return The hash.
+
+ShaderHash HashString(const string& s, ShaderHash h){
+  return HashBytes(s.c_str(), s.size() + 1, h);
+} //HashString
+
+/// Make the cache key for a shader, which identifies its source file,
+/// entry point, and shader model.
+/// \param file Shader source file name.
+/// \param entry Entry point.
+/// \param model Shader model, for example "vs_4_0".
+/// \return The key.
+
+string MakeShaderKey(const string& file, const string& entry, const string& model){
+  return file + "|" + entry + "|" + model;
+} //MakeShaderKey
+
+/// Make the name of the file that caches the bytecode for a given key.
+/// \param dir Cache directory.
+/// \param key Cache key.
+/// \return File name.
+
+string MakeShaderBlobName(const string& dir, const string& key){
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%016llx.cso", HashString(key));
+  return dir.empty()? buffer: dir + "/" + buffer;
+} //MakeShaderBlobName
+
+/// Read compiled shader bytecode from a blob file, provided that it was
+/// compiled from source with the given hash and is intact.
+/// \param fname Blob file name.
+/// \param source Hash of current shader source.
+/// \param code Receives the bytecode.
+/// \return true if the bytecode is valid for that source.
+
+bool ReadShaderBlob(const string& fname, ShaderHash source, vector<unsigned char>& code){
+  FILE* f = nullptr;
+  if(fopen_s(&f, fname.c_str(), "rb") != 0 || f == nullptr)return false;
+
+  ShaderBlobHeader header;
+  bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+    header.nMagic == SHADER_BLOB_MAGIC &&
+    header.nVersion == SHADER_BLOB_VERSION &&
+    header.nSourceHash == source &&
+    header.nCodeSize > 0;
+
+  if(ok){
+    code.resize(header.nCodeSize);
+    ok = fread(code.data(), 1, header.nCodeSize, f) == header.nCodeSize &&
+      HashBytes(code.data(), code.size()) == header.nCodeHash;
+  } //if
+
+  fclose(f);
+  if(!ok)code.clear();
+  return ok;
+} //ReadShaderBlob
+
+/// Write compiled shader bytecode to a blob file.
+/// \param fname Blob file name.
+/// \param source Hash of shader source that it was compiled from.
+/// \param code The bytecode.
+/// \return true if the file was written.
+
+bool WriteShaderBlob(const string& fname, ShaderHash source, const vector<unsigned char>& code){
+  FILE* f = nullptr;
+  if(fopen_s(&f, fname.c_str(), "wb") != 0 || f == nullptr)return false;
+
+  ShaderBlobHeader header;
+  memset(&header, 0, sizeof(header));
+  header.nMagic = SHADER_BLOB_MAGIC;
+  header.nVersion = SHADER_BLOB_VERSION;
+  header.nSourceHash = source;
+  header.nCodeHash = HashBytes(code.data(), code.size());
+  header.nCodeSize = (unsigned int)code.size();
+
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+    fwrite(code.data(), 1, code.size(), f) == code.size();
+
+  if(fclose(f) != 0)ok = false;
+  if(!ok)remove(fname.c_str()); //don't leave a partial file behind
+  return ok;
+} //WriteShaderBlob
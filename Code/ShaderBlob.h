@@ -0,0 +1,26 @@
+/// \file ShaderBlob.h
+/// \brief Interface for hashing and storing compiled shader bytecode.
+///
+/// These functions know nothing about Direct3D. They hash shader source
+/// and cache keys, and read and write compiled bytecode to disk, so that
+/// the shader cache can skip the shader compiler on later runs.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+typedef unsigned long long ShaderHash; ///< 64-bit FNV-1a hash.
+
+const ShaderHash SHADER_HASH_SEED = 14695981039346656037ULL; ///< FNV-1a offset basis.
+
+ShaderHash HashBytes(const void* p, size_t n, ShaderHash h=SHADER_HASH_SEED); ///< Hash a block of memory.
+ShaderHash HashString(const string& s, ShaderHash h=SHADER_HASH_SEED); ///< Hash a string, including terminator.
+
+string MakeShaderKey(const string& file, const string& entry, const string& model); ///< Cache key for a shader.
+string MakeShaderBlobName(const string& dir, const string& key); ///< File name for a cached blob.
+
+bool ReadShaderBlob(const string& fname, ShaderHash source, vector<unsigned char>& code); ///< Read compiled shader.
+bool WriteShaderBlob(const string& fname, ShaderHash source, const vector<unsigned char>& code); ///< Write compiled shader.
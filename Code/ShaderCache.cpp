@@ -0,0 +1,214 @@
+/// \file ShaderCache.cpp
+/// \brief Code for the shader cache class CShaderCache.
+
+#include <stdio.h>
+#include <D3Dcompiler.h>
+
+#include "ShaderCache.h"
+#include "gamerenderer.h"
+#include "timer.h"
+#include "debug.h"
+#include "abort.h"
+
+extern CGameRenderer GameRenderer;
+extern CTimer g_cTimer;
+
+CShaderCache::CShaderCache(): m_strDirectory("ShaderCache"){
+  m_nMemoryHits = m_nDiskHits = m_nCompiles = 0;
+  m_nDiskTime = m_nCompileTime = 0;
+} //constructor
+
+CShaderCache::~CShaderCache(){
+  Release();
+} //destructor
+
+/// Read a whole file into memory.
+/// \param file File name.
+/// \param data Receives the file contents.
+/// \return true if the file was read.
+
+static bool ReadWholeFile(LPCWSTR file, vector<unsigned char>& data){
+  FILE* f = nullptr;
+  if(_wfopen_s(&f, file, L"rb") != 0 || f == nullptr)return false;
+
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  data.resize(size > 0? size: 0);
+  bool ok = size > 0 && fread(data.data(), 1, size, f) == (size_t)size;
+
+  fclose(f);
+  return ok;
+} //ReadWholeFile
+
+/// Get the bytecode for a shader. Look in memory first, then on disk,
+/// and as a last resort compile the shader and save the result to disk.
+/// Bytecode on disk is only used if it was compiled from the current
+/// version of the shader source.
+/// \param file Name of file containing shader source.
+/// \param entry Name of function to call in that file.
+/// \param model Shader model, for example "vs_4_0".
+/// \param key Receives the cache key for the shader.
+/// \return Pointer to the bytecode, nullptr if it couldn't be compiled.
+
+const vector<unsigned char>* CShaderCache::GetBytecode(LPCWSTR file, LPCSTR entry,
+  LPCSTR model, string& key)
+{
+  char filename[MAX_PATH];
+  sprintf_s(filename, "%ls", file);
+  key = MakeShaderKey(filename, entry, model);
+
+  //in memory
+  auto i = m_stlBytecode.find(key);
+  if(i != m_stlBytecode.end()){
+    m_nMemoryHits++;
+    return &i->second;
+  } //if
+
+  int t0 = g_cTimer.time();
+
+  //hash the source, which we need to compile it anyway
+  vector<unsigned char> source;
+  if(!ReadWholeFile(file, source)){
+    ABORT("Cannot read shader file %s.\n", filename);
+    return nullptr;
+  } //if
+
+  const ShaderHash hash = HashString(model, HashString(entry, HashBytes(source.data(), source.size())));
+  const string blobname = MakeShaderBlobName(m_strDirectory, key);
+
+  //on disk
+  vector<unsigned char> code;
+  if(ReadShaderBlob(blobname, hash, code)){
+    m_nDiskHits++;
+    m_nDiskTime += g_cTimer.time() - t0;
+    return &(m_stlBytecode[key] = code);
+  } //if
+
+  //compile it
+  ID3DBlob* pCode = nullptr;
+  ID3DBlob* pErrorMsgs = nullptr;
+
+  HRESULT hr = D3DCompile(source.data(), source.size(), filename, nullptr, nullptr,
+    entry, model, 0, 0, &pCode, &pErrorMsgs);
+
+  if(FAILED(hr)){
+    if(pErrorMsgs)
+      ABORT("Shader error: %s\n", (char*)pErrorMsgs->GetBufferPointer());
+    SAFE_RELEASE(pErrorMsgs);
+    return nullptr;
+  } //if
+
+  const unsigned char* p = (const unsigned char*)pCode->GetBufferPointer();
+  code.assign(p, p + pCode->GetBufferSize());
+  SAFE_RELEASE(pCode);
+  SAFE_RELEASE(pErrorMsgs);
+
+  //save it for next time
+  CreateDirectory(m_strDirectory.c_str(), nullptr);
+  if(!WriteShaderBlob(blobname, hash, code))
+    DEBUGPRINTF("Cannot save compiled shader %s.\n", blobname.c_str());
+
+  m_nCompiles++;
+  m_nCompileTime += g_cTimer.time() - t0;
+  return &(m_stlBytecode[key] = code);
+} //GetBytecode
+
+/// Get a vertex shader and an input layout to go with it, creating
+/// them if nobody has asked for them before. The caller gets a reference
+/// to each, which it must release.
+/// \param file Name of file containing shader source.
+/// \param entry Name of function to call in that file.
+/// \param model Shader model, for example "vs_4_0".
+/// \param desc Input element descriptor array.
+/// \param n Number of input element descriptors.
+/// \param layout Receives input layout.
+/// \return Pointer to the vertex shader, nullptr on failure.
+
+ID3D11VertexShader* CShaderCache::GetVertexShader(LPCWSTR file, LPCSTR entry, LPCSTR model,
+  const D3D11_INPUT_ELEMENT_DESC* desc, int n, ID3D11InputLayout** layout)
+{
+  *layout = nullptr;
+
+  string key;
+  const vector<unsigned char>* code = GetBytecode(file, entry, model, key);
+  if(code == nullptr)return nullptr;
+
+  //vertex shader
+  if(GameRenderer.m_pDev2 == nullptr)return nullptr; //headless
+
+  ID3D11VertexShader*& pShader = m_stlVertexShaders[key];
+  if(pShader == nullptr)
+    GameRenderer.m_pDev2->CreateVertexShader(code->data(), code->size(), nullptr, &pShader);
+  if(pShader == nullptr)return nullptr;
+
+  //input layout, keyed by shader and all of the input element descriptors
+  string layoutkey = key;
+  char buffer[256];
+  for(int i=0; i<n; i++){
+    sprintf_s(buffer, "|%s,%u,%d,%u,%u,%d,%u", desc[i].SemanticName, desc[i].SemanticIndex,
+      (int)desc[i].Format, desc[i].InputSlot, desc[i].AlignedByteOffset,
+      (int)desc[i].InputSlotClass, desc[i].InstanceDataStepRate);
+    layoutkey += buffer;
+  } //for
+
+  ID3D11InputLayout*& pLayout = m_stlInputLayouts[layoutkey];
+  if(pLayout == nullptr)
+    GameRenderer.m_pDev2->CreateInputLayout(desc, n, code->data(), code->size(), &pLayout);
+
+  if(pLayout){
+    pLayout->AddRef();
+    *layout = pLayout;
+  } //if
+
+  pShader->AddRef();
+  return pShader;
+} //GetVertexShader
+
+/// Get a pixel shader, creating it if nobody has asked for it before.
+/// The caller gets a reference to it, which it must release.
+/// \param file Name of file containing shader source.
+/// \param entry Name of function to call in that file.
+/// \param model Shader model, for example "ps_4_0".
+/// \return Pointer to the pixel shader, nullptr on failure.
+
+ID3D11PixelShader* CShaderCache::GetPixelShader(LPCWSTR file, LPCSTR entry, LPCSTR model){
+  string key;
+  const vector<unsigned char>* code = GetBytecode(file, entry, model, key);
+  if(code == nullptr)return nullptr;
+
+  if(GameRenderer.m_pDev2 == nullptr)return nullptr; //headless
+
+  ID3D11PixelShader*& pShader = m_stlPixelShaders[key];
+  if(pShader == nullptr)
+    GameRenderer.m_pDev2->CreatePixelShader(code->data(), code->size(), nullptr, &pShader);
+  if(pShader == nullptr)return nullptr;
+
+  pShader->AddRef();
+  return pShader;
+} //GetPixelShader
+
+/// Report how many shaders were found in memory, loaded from disk, or
+/// compiled, and how long loading and compiling took.
+
+void CShaderCache::Report(){
+  DEBUGPRINTF("Shader cache: %d memory hits, %d loaded from disk in %d ms, %d compiled in %d ms.\n",
+    m_nMemoryHits, m_nDiskHits, m_nDiskTime, m_nCompiles, m_nCompileTime);
+} //Report
+
+/// Release the cache's references to all shaders and input layouts.
+
+void CShaderCache::Release(){
+  for(auto i=m_stlVertexShaders.begin(); i!=m_stlVertexShaders.end(); i++)
+    SAFE_RELEASE(i->second);
+  for(auto i=m_stlPixelShaders.begin(); i!=m_stlPixelShaders.end(); i++)
+    SAFE_RELEASE(i->second);
+  for(auto i=m_stlInputLayouts.begin(); i!=m_stlInputLayouts.end(); i++)
+    SAFE_RELEASE(i->second);
+
+  m_stlVertexShaders.clear();
+  m_stlPixelShaders.clear();
+  m_stlInputLayouts.clear();
+  m_stlBytecode.clear();
+} //Release
@@ -0,0 +1,52 @@
+/// \file ShaderCache.h
+/// \brief Interface for the shader cache class CShaderCache.
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "defines.h"
+#include "ShaderBlob.h"
+
+/// \brief The shader cache.
+///
+/// The shader cache makes sure that each shader is compiled at most once per
+/// run, and usually not at all. Compiled bytecode is kept in memory keyed by
+/// source file, entry point, and shader model, and is also saved to disk
+/// along with a hash of the shader source, so that later runs load the
+/// bytecode instead of compiling it again, until the source changes. The
+/// shader objects and input layouts created from the bytecode are shared
+/// by every CShader that asks for the same thing, input layouts being
+/// keyed by their input element descriptors as well.
+
+class CShaderCache{
+  private:
+    unordered_map<string, vector<unsigned char>> m_stlBytecode; ///< Map key to bytecode.
+    unordered_map<string, ID3D11VertexShader*> m_stlVertexShaders; ///< Map key to vertex shader.
+    unordered_map<string, ID3D11PixelShader*> m_stlPixelShaders; ///< Map key to pixel shader.
+    unordered_map<string, ID3D11InputLayout*> m_stlInputLayouts; ///< Map key and layout to input layout.
+
+    string m_strDirectory; ///< Directory for compiled shader blobs.
+
+    int m_nMemoryHits; ///< Bytecode found in memory.
+    int m_nDiskHits; ///< Bytecode loaded from disk.
+    int m_nCompiles; ///< Bytecode compiled from source.
+    int m_nDiskTime; ///< Total time spent loading bytecode, in ms.
+    int m_nCompileTime; ///< Total time spent compiling, in ms.
+
+    const vector<unsigned char>* GetBytecode(LPCWSTR file, LPCSTR entry,
+      LPCSTR model, string& key); ///< Get bytecode, compiling if necessary.
+
+  public:
+    CShaderCache(); ///< Constructor.
+    ~CShaderCache(); ///< Destructor.
+
+    ID3D11VertexShader* GetVertexShader(LPCWSTR file, LPCSTR entry, LPCSTR model,
+      const D3D11_INPUT_ELEMENT_DESC* desc, int n, ID3D11InputLayout** layout); ///< Get vertex shader and input layout.
+    ID3D11PixelShader* GetPixelShader(LPCWSTR file, LPCSTR entry, LPCSTR model); ///< Get pixel shader.
+
+    void Report(); ///< Report cache statistics.
+    void Release(); ///< Release all shaders.
+}; //CShaderCache
@@ -0,0 +1,271 @@
+/// \file Simulation.cpp
+/// \brief Code for the fight simulation class CSimulation.
+
+#include <algorithm>
+
+#include "Simulation.h"
+
+CSimulation::CSimulation():
+  m_nTeamSize(0), m_bTagTeam(false), m_nTick(0), m_nChecksum(0), m_nHitsLanded(0),
+  m_pHitBoxes(nullptr)
+{
+  m_nPoint[RIGHT_TEAM] = m_nPoint[LEFT_TEAM] = 0;
+  m_vHitEvents.reserve(NUM_TEAMS*MAX_TEAM_SIZE*MAX_TEAM_SIZE); //at most one per attacker and defender
+} //constructor
+
+/// Give a fighter's frames default boxes, for when the XML settings have
+/// no hitboxes tag. Every frame gets a hurtbox the size of the fighter's
+/// body, and the punch and kick frames get a hitbox in front, high for a
+/// punch and low for a kick. A punch reaches 50 pixels from the fighter to
+/// the middle of an opponent.
+/// \param boxes Hitboxes.
+/// \param f Sprite frames used by the fighter.
+
+void CSimulation::AddDefaultHitBoxes(CHitBoxes& boxes, const FighterFrames& f){
+  const HitBox hurt = {IntToFixed(-20), IntToFixed(-64), IntToFixed(20), IntToFixed(48)}; //back, bottom, front, top
+  const HitBox punch = {0, 0, IntToFixed(30), IntToFixed(40)};
+  const HitBox kick = {0, IntToFixed(-50), IntToFixed(35), 0};
+
+  const int frame[] = {f.nIdle, f.nWalk[0], f.nWalk[1], f.nJumpLow, f.nJumpHigh,
+    f.nPunch, f.nKick, f.nHitByPunch, f.nHitByKick};
+  const int n = sizeof(frame)/sizeof(frame[0]);
+
+  for(int i=0; i<n; i++) //one hurtbox on each frame, even if it's used twice
+    if(find(frame, frame + i, frame[i]) == frame + i)
+      boxes.AddBox(frame[i], HURT_BOX, hurt);
+
+  boxes.AddBox(f.nPunch, HIT_BOX, punch);
+  boxes.AddBox(f.nKick, HIT_BOX, kick);
+} //AddDefaultHitBoxes
+
+/// Set up a new fight in the game's arena. Each team has teamsize
+/// fighters, standing one behind the other, each further back than the
+/// last, facing the opposing team. In tag-team mode only the first
+/// fighter on each team is in play, and the rest wait to be tagged in,
+/// otherwise all of them are in play at once. The entity store is made
+/// afresh, so that the fighters' handles come out the same every time.
+/// If the hitboxes are empty, the fighters' frames get default ones.
+/// \param boxes Hitboxes and hurtboxes for each frame, kept by reference.
+/// \param teamsize Fighters on each team, from 1 to MAX_TEAM_SIZE.
+/// \param tagteam Whether one fighter per team is in play at a time.
+
+void CSimulation::Create(CHitBoxes& boxes, int teamsize, bool tagteam){
+  const ArenaDesc cArena = {IntToFixed(338), IntToFixed(688), IntToFixed(35),
+    IntToFixed(300), IntToFixed(350)};
+
+  //idle, walk cycle, jump low and high, punch, kick, hit by punch and by kick
+  const FighterFrames cRightFrames = {3, {3, 3}, 3, 16, 14, 15, 12, 13};
+  const FighterFrames cLeftFrames = {4, {5, 4}, 4, 8, 7, 6, 17, 17};
+
+  m_pHitBoxes = &boxes;
+
+  if(boxes.GetBoxCount(HIT_BOX) + boxes.GetBoxCount(HURT_BOX) == 0){
+    AddDefaultHitBoxes(boxes, cRightFrames);
+    AddDefaultHitBoxes(boxes, cLeftFrames);
+    boxes.Compile();
+  } //if
+
+  m_cFighters = CEntityStore();
+  m_cFighters.SetArena(cArena);
+  m_nTeamSize = min(max(teamsize, 1), MAX_TEAM_SIZE);
+  m_bTagTeam = tagteam;
+
+  for(int k=0; k<m_nTeamSize; k++){
+    EntityDesc d;
+    d.nY = IntToFixed(300);
+    d.bActive = k == 0 || !tagteam;
+
+    d.nX = IntToFixed(626 + 20*k); d.nZ = IntToFixed(20*k);
+    d.nFacing = -1; d.nSprite = RIGHT_TEAM;
+    d.cFrames = cRightFrames;
+    m_hFighter[RIGHT_TEAM][k] = m_cFighters.Create(d);
+
+    d.nX = IntToFixed(400 - 20*k); d.nZ = IntToFixed(-10 + 20*k);
+    d.nFacing = 1; d.nSprite = LEFT_TEAM;
+    d.cFrames = cLeftFrames;
+    m_hFighter[LEFT_TEAM][k] = m_cFighters.Create(d);
+  } //for
+
+  m_nPoint[RIGHT_TEAM] = m_nPoint[LEFT_TEAM] = 0;
+  m_nTick = 0;
+  m_nChecksum = 0;
+  m_nHitsLanded = 0;
+} //Create
+
+/// Get rid of the fighters.
+
+void CSimulation::Clear(){
+  m_cFighters.Clear();
+  m_nTeamSize = 0;
+} //Clear
+
+/// Tag the next fighter on a team. In tag-team mode the point fighter
+/// leaves play and the next one comes in where it was standing, but only
+/// if the point fighter is standing or walking, so that nobody leaves in
+/// the middle of a jump or an attack. Otherwise every fighter is already
+/// in play, and the keys just move on to control the next one.
+/// \param team Team.
+/// \return true if the keys now control another fighter.
+
+bool CSimulation::Tag(FighterTeam team){
+  if(m_nTeamSize < 2)return false;
+
+  const EntityHandle h = m_hFighter[team][m_nPoint[team]];
+  const int next = (m_nPoint[team] + 1)%m_nTeamSize;
+
+  if(m_bTagTeam){
+    const CFighterAnimator* a = m_cFighters.GetAnimator(h);
+    if(a == nullptr || (a->GetState() != IDLE_STATE && a->GetState() != WALK_STATE))return false;
+    m_cFighters.Tag(h, m_hFighter[team][next]);
+  } //if
+
+  m_nPoint[team] = next;
+  return true;
+} //Tag
+
+/// Apply a team's keys, each doing what it used to do the moment it was
+/// pressed, in the order of the FighterInput bits.
+/// \param team Team.
+/// \param input Keys pressed, FighterInput bits.
+/// \return Keys that took effect, FighterInput bits.
+
+NetInput CSimulation::ApplyInput(FighterTeam team, NetInput input){
+  NetInput accepted = 0;
+
+  if((input & TAG_INPUT) && Tag(team))
+    accepted |= TAG_INPUT;
+
+  const EntityHandle h = m_hFighter[team][m_nPoint[team]];
+
+  if((input & LEFT_INPUT) && m_cFighters.Walk(h, IntToFixed(-5)))
+    accepted |= LEFT_INPUT;
+  if((input & RIGHT_INPUT) && m_cFighters.Walk(h, IntToFixed(5)))
+    accepted |= RIGHT_INPUT;
+  if((input & JUMP_INPUT) && m_cFighters.Jump(h))
+    accepted |= JUMP_INPUT;
+  if((input & PUNCH_INPUT) && m_cFighters.Attack(h, PUNCH_STATE))
+    accepted |= PUNCH_INPUT;
+  if((input & KICK_INPUT) && m_cFighters.Attack(h, KICK_STATE))
+    accepted |= KICK_INPUT;
+
+  return accepted;
+} //ApplyInput
+
+/// Put every fighter in play into the hitbox tester, with the frame it is
+/// showing, and land a hit for every hitbox of a fighter that is striking
+/// that overlaps a hurtbox of an opponent.
+
+void CSimulation::LandHits(){
+  const fixed* x = m_cFighters.GetPosX();
+  const fixed* y = m_cFighters.GetPosY();
+  const signed char* facing = m_cFighters.GetFacing();
+  const unsigned char* active = m_cFighters.GetActive();
+  const int* frame = m_cFighters.GetFrame();
+
+  m_pHitBoxes->BeginTick();
+
+  for(int team=0; team<NUM_TEAMS; team++)
+    for(int k=0; k<m_nTeamSize; k++){
+      const EntityHandle h = m_hFighter[team][k];
+      const int i = m_cFighters.GetRow(h);
+      if(i < 0 || !active[i])continue;
+
+      m_pHitBoxes->AddBody(h, team, frame[i], x[i], y[i], facing[i],
+        m_cFighters.GetAnimator(h)->IsStriking());
+    } //for
+
+  m_pHitBoxes->FindHits(m_vHitEvents);
+
+  m_nHitsLanded = 0;
+  for(const HitEvent& e: m_vHitEvents)
+    if(m_cFighters.Hit(e.nAttacker, e.nDefender))
+      m_nHitsLanded++;
+} //LandHits
+
+/// Run one tick. Apply the keys each team pressed for the tick, then
+/// advance the fighters by one fixed-length tick. Jumps move a fixed
+/// distance per tick, so the arc is the same whatever the frame rate.
+/// Each fighter's animation state machine then moves on by a tick and
+/// picks its frame, so attacks and hits play out over several ticks.
+/// Then the hitboxes on the frames picked decide who hits whom. The
+/// simulation is all fixed point, so the same keys on the same ticks
+/// always give the same result, and the checksum of the state at the end
+/// of each tick is the same on every machine and build. If two runs ever
+/// disagree, the first tick whose checksum differs is where they went apart.
+/// \param input Keys pressed by each team, FighterInput bits.
+/// \param accepted [out] Keys that took effect for each team, may be nullptr.
+
+void CSimulation::Tick(const NetInput* input, NetInput* accepted){
+  m_nTick++;
+
+  for(int team=0; team<NUM_TEAMS; team++){
+    const NetInput a = ApplyInput((FighterTeam)team, input[team]);
+    if(accepted)accepted[team] = a;
+  } //for
+
+  m_cFighters.Simulate();
+  LandHits();
+
+  CChecksum c;
+  c.Add(m_nTick);
+  m_cFighters.AddToChecksum(c);
+  c.Add(m_nPoint, NUM_TEAMS);
+  m_nChecksum = c.Get();
+} //Tick
+
+/// \return The fighters.
+
+CEntityStore& CSimulation::GetFighters(){
+  return m_cFighters;
+} //GetFighters
+
+/// \return The fighters.
+
+const CEntityStore& CSimulation::GetFighters() const{
+  return m_cFighters;
+} //GetFighters
+
+/// \param team Team.
+/// \param k Which of the team's fighters, from 0 to the team size less 1.
+/// \return Handle to the fighter.
+
+EntityHandle CSimulation::GetFighter(FighterTeam team, int k) const{
+  return m_hFighter[team][k];
+} //GetFighter
+
+/// \param team Team.
+/// \return Which of the team's fighters the keys control.
+
+int CSimulation::GetPoint(FighterTeam team) const{
+  return m_nPoint[team];
+} //GetPoint
+
+/// \return Fighters on each team.
+
+int CSimulation::GetTeamSize() const{
+  return m_nTeamSize;
+} //GetTeamSize
+
+/// \return true if one fighter per team is in play at a time.
+
+bool CSimulation::IsTagTeam() const{
+  return m_bTagTeam;
+} //IsTagTeam
+
+/// \return Number of ticks run since the fight was set up.
+
+int CSimulation::GetTick() const{
+  return m_nTick;
+} //GetTick
+
+/// \return Checksum of the state after the last tick, 0 before the first.
+
+unsigned CSimulation::GetChecksum() const{
+  return m_nChecksum;
+} //GetChecksum
+
+/// \return Number of hits landed on the last tick.
+
+int CSimulation::GetHitsLanded() const{
+  return m_nHitsLanded;
+} //GetHitsLanded
@@ -0,0 +1,67 @@
+/// \file Simulation.h
+/// \brief Interface for the fight simulation class CSimulation.
+
+#pragma once
+
+#include <vector>
+
+#include "EntityStore.h"
+#include "HitBoxes.h"
+#include "NetSession.h"
+
+using namespace std;
+
+const int MAX_TEAM_SIZE = 4; ///< Most fighters on a team.
+
+/// \brief The fight simulation.
+///
+/// The simulation is the part of the game that must come out the same on
+/// every machine: the fighters in their entity store, which of each team's
+/// fighters the keys control, and the number of ticks run. Each tick
+/// applies the keys each team pressed for it, advances the fighters, lands
+/// hits, and checksums the result. Anything else the game does with a key,
+/// such as playing a sound or stamping it to measure its latency, it does
+/// with the keys that Tick reports took effect, so the simulation needs no
+/// window, sound, or clock. The game, its replays and rollbacks, and the
+/// checks in Tools all run fights through this class, so they can't drift
+/// apart. A simulation is saved for a rollback by copying it, which reuses
+/// the memory of one that has held a fight before. Every simulation has
+/// room for the most hits a tick can land from the start, so neither a
+/// tick nor a copy ever allocates from the heap. The hitboxes are shared
+/// by every copy, and aren't part of the state.
+
+class CSimulation{
+  private:
+    CEntityStore m_cFighters; ///< All the fighters, both teams.
+    EntityHandle m_hFighter[NUM_TEAMS][MAX_TEAM_SIZE]; ///< Handles to each team's fighters.
+    int m_nTeamSize; ///< Fighters on each team.
+    bool m_bTagTeam; ///< Whether one fighter per team is in play at a time.
+    int m_nPoint[NUM_TEAMS]; ///< Which of each team's fighters the keys control.
+    int m_nTick; ///< Number of ticks run.
+    unsigned m_nChecksum; ///< Checksum of the state after the last tick.
+    int m_nHitsLanded; ///< Hits landed on the last tick.
+    CHitBoxes* m_pHitBoxes; ///< Hitboxes and hurtboxes for each frame.
+    vector<HitEvent> m_vHitEvents; ///< Hits found on the last tick.
+
+    static void AddDefaultHitBoxes(CHitBoxes& boxes, const FighterFrames& f); ///< Give frames default boxes.
+    bool Tag(FighterTeam team); ///< Tag the next fighter on a team.
+    NetInput ApplyInput(FighterTeam team, NetInput input); ///< Apply a team's keys.
+    void LandHits(); ///< Land hits.
+
+  public:
+    CSimulation(); ///< Constructor.
+
+    void Create(CHitBoxes& boxes, int teamsize, bool tagteam); ///< Set up a new fight.
+    void Clear(); ///< Get rid of the fighters.
+    void Tick(const NetInput* input, NetInput* accepted=nullptr); ///< Run one tick.
+
+    CEntityStore& GetFighters(); ///< The fighters.
+    const CEntityStore& GetFighters() const; ///< The fighters.
+    EntityHandle GetFighter(FighterTeam team, int k) const; ///< One of a team's fighters.
+    int GetPoint(FighterTeam team) const; ///< Which of a team's fighters the keys control.
+    int GetTeamSize() const; ///< Fighters on each team.
+    bool IsTagTeam() const; ///< Whether one fighter per team is in play at a time.
+    int GetTick() const; ///< Number of ticks run.
+    unsigned GetChecksum() const; ///< Checksum after the last tick.
+    int GetHitsLanded() const; ///< Hits landed on the last tick.
+}; //CSimulation
@@ -0,0 +1,116 @@
+/// \file SnapshotBuffer.cpp
+/// \brief Code for the game state snapshot buffer CSnapshotBuffer.
+
+#include <string.h>
+
+#include "SnapshotBuffer.h"
+
+CSnapshotBuffer::CSnapshotBuffer(){
+  memset(m_cSlot, 0, sizeof(m_cSlot));
+  m_nWriteSlot = 0;
+  m_nMiddle.store(1);
+  m_nReadSlot = 2;
+  m_bAcquired = false;
+  m_bFresh = false;
+  ResetStats();
+} //constructor
+
+/// Get the snapshot that the writer is to fill in next. Only the writer's
+/// thread may call this.
+/// \return Writer's snapshot.
+
+GameSnapshot& CSnapshotBuffer::GetWriteSnapshot(){
+  return m_cSlot[m_nWriteSlot];
+} //GetWriteSnapshot
+
+/// Publish the writer's snapshot by swapping it into the middle slot, and
+/// take the old middle slot to write into next time. Only the writer's
+/// thread may call this.
+/// \return true if the old middle slot was never read. It is then the
+/// writer's snapshot again, so anything in it that must reach the reader
+/// can be carried forward into the next snapshot.
+
+bool CSnapshotBuffer::Publish(){
+  const int old = m_nMiddle.exchange(m_nWriteSlot | FRESH, memory_order_acq_rel);
+  m_nWriteSlot = old & ~FRESH;
+
+  m_nPublished.fetch_add(1, memory_order_relaxed);
+  if(old & FRESH) //the reader never saw it
+    m_nOverwritten.fetch_add(1, memory_order_relaxed);
+
+  return (old & FRESH) != 0;
+} //Publish
+
+/// Take the newest snapshot, if there is one that the reader hasn't had,
+/// by swapping the reader's slot with the middle slot. Only the reader's
+/// thread may call this.
+/// \param now Current time in microseconds, to measure the snapshot's age.
+/// \return true if there is a snapshot to draw, new or not.
+
+bool CSnapshotBuffer::Acquire(long long now){
+  m_bFresh = (m_nMiddle.load(memory_order_acquire) & FRESH) != 0;
+
+  if(m_bFresh){
+    m_nReadSlot = m_nMiddle.exchange(m_nReadSlot, memory_order_acq_rel) & ~FRESH;
+    m_bAcquired = true;
+    m_nFresh.fetch_add(1, memory_order_relaxed);
+  } //if
+
+  else if(m_bAcquired)
+    m_nRepeated.fetch_add(1, memory_order_relaxed);
+
+  if(m_bAcquired)
+    m_cAge.Record(now - m_cSlot[m_nReadSlot].nPublishTime);
+
+  return m_bAcquired;
+} //Acquire
+
+/// Find out whether the reader's last acquisition got a snapshot that it
+/// hadn't had before. Only the reader's thread may call this.
+/// \return true if the reader's snapshot is new.
+
+bool CSnapshotBuffer::IsFresh() const{
+  return m_bFresh;
+} //IsFresh
+
+/// Get the snapshot that the reader last acquired. Only the reader's
+/// thread may call this.
+/// \return Reader's snapshot.
+
+const GameSnapshot& CSnapshotBuffer::GetReadSnapshot() const{
+  return m_cSlot[m_nReadSlot];
+} //GetReadSnapshot
+
+/// Get the number of snapshots waiting for the reader. Since newer
+/// snapshots replace older ones, this is never more than 1.
+/// \return Queue depth.
+
+int CSnapshotBuffer::GetQueueDepth() const{
+  return (m_nMiddle.load(memory_order_relaxed) & FRESH)? 1: 0;
+} //GetQueueDepth
+
+/// \param stats [out] Counts since they were last reset.
+
+void CSnapshotBuffer::GetStats(SnapshotStats& stats) const{
+  stats.nPublished = m_nPublished.load(memory_order_relaxed);
+  stats.nOverwritten = m_nOverwritten.load(memory_order_relaxed);
+  stats.nFresh = m_nFresh.load(memory_order_relaxed);
+  stats.nRepeated = m_nRepeated.load(memory_order_relaxed);
+} //GetStats
+
+/// Get the histogram of snapshot ages, from publication to being drawn.
+/// \return Snapshot age histogram.
+
+CTimeHistogram& CSnapshotBuffer::GetAgeHistogram(){
+  return m_cAge;
+} //GetAgeHistogram
+
+/// Zero the counts. This can be called from any thread.
+
+void CSnapshotBuffer::ResetStats(){
+  m_nPublished.store(0, memory_order_relaxed);
+  m_nOverwritten.store(0, memory_order_relaxed);
+  m_nFresh.store(0, memory_order_relaxed);
+  m_nRepeated.store(0, memory_order_relaxed);
+  m_cAge.Clear();
+} //ResetStats
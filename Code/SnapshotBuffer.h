@@ -0,0 +1,101 @@
+/// \file SnapshotBuffer.h
+/// \brief Interface for the game state snapshot buffer CSnapshotBuffer.
+
+#pragma once
+
+#include <atomic>
+#include <DirectXMath.h>
+
+#include "timer.h"
+#include "LatencyTracker.h"
+
+using namespace std;
+using namespace DirectX;
+
+class C3DSprite;
+
+const int MAX_SNAPSHOT_OBJECTS = 8; ///< Most objects in a snapshot.
+const int MAX_SNAPSHOT_INPUTS = 32; ///< Most inputs in a snapshot.
+
+/// \brief What the renderer needs to know about an object.
+
+struct ObjectSnapshot{
+  C3DSprite* pSprite; ///< Sprite to draw it with.
+  int nFrame; ///< Frame to draw.
+  XMFLOAT3 vLastPos; ///< Location at the start of the last tick.
+  XMFLOAT3 vPos; ///< Location at the end of the last tick.
+}; //ObjectSnapshot
+
+/// \brief What the renderer needs to know about the game.
+///
+/// A snapshot is taken by the simulation after each batch of ticks, and
+/// doesn't change once it has been published, so the renderer can draw it
+/// without locking anything. It also carries the inputs whose results it
+/// is the first to show, so that their latency can be measured when it
+/// is presented.
+
+struct GameSnapshot{
+  int nTick; ///< Number of the last tick simulated.
+  long long nTickTime; ///< Time the last tick was due, in microseconds.
+  long long nPublishTime; ///< Time the snapshot was published, in microseconds.
+  int nObjects; ///< Number of objects.
+  ObjectSnapshot cObject[MAX_SNAPSHOT_OBJECTS]; ///< Objects, in drawing order.
+  bool bWireFrame; ///< Draw in wireframe.
+  bool bCameraDefaultMode; ///< Camera in default mode.
+  int nInputs; ///< Number of inputs.
+  InputStamp cInput[MAX_SNAPSHOT_INPUTS]; ///< Inputs first shown by this snapshot.
+}; //GameSnapshot
+
+/// \brief Counts kept by the snapshot buffer.
+
+struct SnapshotStats{
+  int nPublished; ///< Snapshots published.
+  int nOverwritten; ///< Snapshots replaced by a newer one before the renderer got to them.
+  int nFresh; ///< Frames that drew a snapshot for the first time.
+  int nRepeated; ///< Frames that drew the same snapshot as the frame before.
+}; //SnapshotStats
+
+/// \brief The snapshot buffer.
+///
+/// The snapshot buffer passes game state snapshots from the simulation
+/// thread to the render thread through a lock-free triple buffer. The
+/// writer fills one slot and the reader draws from another, and the third
+/// holds the newest complete snapshot. Publishing swaps the writer's slot
+/// with the middle one, and acquiring swaps the reader's slot with the
+/// middle one if it holds something new. Neither side ever waits for the
+/// other. A snapshot that isn't read before the next is published is lost,
+/// so the renderer always draws the newest state, and at most one snapshot
+/// is ever queued.
+
+class CSnapshotBuffer{
+  private:
+    static const int FRESH = 4; ///< Flag on the middle slot, set if the reader hasn't had it.
+
+    GameSnapshot m_cSlot[3]; ///< The three slots.
+    int m_nWriteSlot; ///< Slot owned by the writer.
+    int m_nReadSlot; ///< Slot owned by the reader.
+    atomic<int> m_nMiddle; ///< Slot in the middle, with the FRESH flag.
+    bool m_bAcquired; ///< Whether the reader has ever had a snapshot.
+    bool m_bFresh; ///< Whether the reader's last acquisition got something new.
+
+    atomic<int> m_nPublished; ///< Snapshots published.
+    atomic<int> m_nOverwritten; ///< Snapshots lost.
+    atomic<int> m_nFresh; ///< Acquisitions that got something new.
+    atomic<int> m_nRepeated; ///< Acquisitions that didn't.
+    CTimeHistogram m_cAge; ///< Age of snapshots when drawn.
+
+  public:
+    CSnapshotBuffer(); ///< Constructor.
+
+    GameSnapshot& GetWriteSnapshot(); ///< Snapshot for the writer to fill in.
+    bool Publish(); ///< Make the writer's snapshot the newest.
+
+    bool Acquire(long long now); ///< Get the newest snapshot for the reader.
+    bool IsFresh() const; ///< Whether the reader's snapshot is new.
+    const GameSnapshot& GetReadSnapshot() const; ///< Snapshot for the reader to draw.
+
+    int GetQueueDepth() const; ///< Number of snapshots waiting for the reader.
+    void GetStats(SnapshotStats& stats) const; ///< Counts since the last ResetStats.
+    CTimeHistogram& GetAgeHistogram(); ///< Age of snapshots when drawn.
+    void ResetStats(); ///< Zero the counts.
+}; //CSnapshotBuffer
@@ -0,0 +1,117 @@
+/// \file SoftImage.cpp
+/// \brief Code for reading, writing, and comparing images in CPU memory.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SoftImage.h"
+#include "Portable.h"
+
+/// Write an image to an uncompressed 24-bit TGA file. Alpha is dropped,
+/// since the game never shows it.
+/// \param fname File name.
+/// \param pixels Pixels, top row first.
+/// \param w Width in pixels.
+/// \param h Height in pixels.
+/// \return true if the file was written.
+
+bool WriteTGA(const char* fname, const uint32_t* pixels, int w, int h){
+  FILE* output = nullptr;
+  if(fopen_s(&output, fname, "wb") != 0 || output == nullptr)return false;
+
+  unsigned char header[18] = {0};
+  header[2] = 2; //uncompressed true color
+  header[12] = (unsigned char)(w & 0xff);
+  header[13] = (unsigned char)(w >> 8);
+  header[14] = (unsigned char)(h & 0xff);
+  header[15] = (unsigned char)(h >> 8);
+  header[16] = 24; //bits per pixel
+  header[17] = 0x20; //top row first
+  fwrite(header, 1, sizeof(header), output);
+
+  vector<unsigned char> row(3*w);
+
+  for(int y=0; y<h; y++){
+    for(int x=0; x<w; x++){
+      const uint32_t p = pixels[y*w + x];
+      row[3*x] = (unsigned char)(p >> 16); //blue
+      row[3*x + 1] = (unsigned char)(p >> 8); //green
+      row[3*x + 2] = (unsigned char)p; //red
+    } //for
+
+    fwrite(row.data(), 1, row.size(), output);
+  } //for
+
+  const bool ok = ferror(output) == 0;
+  fclose(output);
+  return ok;
+} //WriteTGA
+
+/// Read an image from an uncompressed 24- or 32-bit TGA file.
+/// \param fname File name.
+/// \param pixels Receives the pixels, top row first.
+/// \param w Receives width in pixels.
+/// \param h Receives height in pixels.
+/// \return true if the file was read.
+
+bool ReadTGA(const char* fname, vector<uint32_t>& pixels, int& w, int& h){
+  FILE* input = nullptr;
+  if(fopen_s(&input, fname, "rb") != 0 || input == nullptr)return false;
+
+  unsigned char header[18];
+  if(fread(header, 1, sizeof(header), input) != sizeof(header) || header[2] != 2 ||
+    (header[16] != 24 && header[16] != 32))
+  {
+    fclose(input); return false; //not a TGA file we can read
+  } //if
+
+  fseek(input, header[0], SEEK_CUR); //skip image ID
+
+  w = header[12] | header[13] << 8;
+  h = header[14] | header[15] << 8;
+  const int bpp = header[16]/8;
+  const bool topfirst = (header[17] & 0x20) != 0;
+
+  pixels.resize(w*h);
+  vector<unsigned char> row(bpp*w);
+  bool ok = true;
+
+  for(int i=0; i<h && ok; i++){
+    ok = fread(row.data(), 1, row.size(), input) == row.size();
+    const int y = topfirst? i: h - 1 - i;
+
+    for(int x=0; x<w; x++){
+      const unsigned char* p = &row[bpp*x];
+      const uint32_t a = bpp == 4? p[3]: 255;
+      pixels[y*w + x] = p[2] | p[1] << 8 | p[0] << 16 | a << 24;
+    } //for
+  } //for
+
+  fclose(input);
+  return ok;
+} //ReadTGA
+
+/// Compare the color channels of two images of the same size.
+/// \param a First image.
+/// \param b Second image.
+/// \param n Number of pixels.
+/// \param tolerance Largest channel difference that doesn't count.
+/// \return Number of pixels that differ, and the largest difference.
+
+ImageDifference CompareImages(const uint32_t* a, const uint32_t* b, int n, int tolerance){
+  ImageDifference result = {0, 0};
+
+  for(int i=0; i<n; i++){
+    int worst = 0;
+
+    for(int shift=0; shift<24; shift+=8){
+      const int d = abs((int)((a[i] >> shift) & 0xff) - (int)((b[i] >> shift) & 0xff));
+      if(d > worst)worst = d;
+    } //for
+
+    if(worst > tolerance)result.nDifferentPixels++;
+    if(worst > result.nMaxDifference)result.nMaxDifference = worst;
+  } //for
+
+  return result;
+} //CompareImages
@@ -0,0 +1,26 @@
+/// \file SoftImage.h
+/// \brief Interface for reading, writing, and comparing images in CPU memory.
+///
+/// These go with the software rasterizer, for saving frames that it renders
+/// and comparing them against golden images. Pixels are 32-bit RGBA with
+/// red in the low byte, top row first. Files are uncompressed TGA, which
+/// needs no image library.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+using namespace std;
+
+/// \brief Result of comparing two images.
+
+struct ImageDifference{
+  int nDifferentPixels; ///< Number of pixels with a channel differing by more than the tolerance.
+  int nMaxDifference; ///< Largest difference in any channel of any pixel.
+}; //ImageDifference
+
+bool WriteTGA(const char* fname, const uint32_t* pixels, int w, int h); ///< Write image to TGA file.
+bool ReadTGA(const char* fname, vector<uint32_t>& pixels, int& w, int& h); ///< Read image from TGA file.
+ImageDifference CompareImages(const uint32_t* a, const uint32_t* b, int n, int tolerance); ///< Compare color channels.
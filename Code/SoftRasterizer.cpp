@@ -0,0 +1,523 @@
+/// \file SoftRasterizer.cpp
+/// \brief Code for the software rasterizer class CSoftRasterizer.
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <emmintrin.h>
+#ifdef __AVX2__
+  #include <immintrin.h>
+#endif //__AVX2__
+
+#include "SoftRasterizer.h"
+
+const int TILE_SIZE = 64; ///< Width and height of a screen tile in pixels.
+const float MIN_W = 1e-5f; ///< Triangles with a vertex nearer than this are dropped.
+
+/// Create the framebuffer and start the worker threads.
+/// \param w Framebuffer width in pixels.
+/// \param h Framebuffer height in pixels.
+/// \param threads Number of threads to rasterize with, including the
+///   caller of Flush, 0 for one per hardware thread.
+
+CSoftRasterizer::CSoftRasterizer(int w, int h, int threads):
+  m_nWidth(w), m_nHeight(h), m_bClear(false), m_nClearColor(0), m_fClearDepth(1.0f),
+  m_nGeneration(0), m_nBusyWorkers(0), m_bQuit(false), m_nNextTile(0)
+{
+  m_nStride = (w + 3) & ~3;
+  m_vColor.resize(m_nStride*h, 0);
+  m_vDepth.resize(m_nStride*h, 1.0f);
+
+  m_nTilesX = (w + TILE_SIZE - 1)/TILE_SIZE;
+  m_nTilesY = (h + TILE_SIZE - 1)/TILE_SIZE;
+  m_vBins.resize(m_nTilesX*m_nTilesY);
+
+  if(threads <= 0)
+    threads = max(1, (int)thread::hardware_concurrency());
+
+  for(int i=1; i<threads; i++)
+    m_vWorkers.push_back(thread(&CSoftRasterizer::WorkerThread, this));
+} //constructor
+
+/// Tell the workers to quit and wait for them.
+
+CSoftRasterizer::~CSoftRasterizer(){
+  {
+    lock_guard<mutex> lock(m_mutex);
+    m_bQuit = true;
+  }
+
+  m_cvWork.notify_all();
+
+  for(int i=0; i<(int)m_vWorkers.size(); i++)
+    m_vWorkers[i].join();
+} //destructor
+
+/// Clear the color and depth buffers. This is deferred until the next
+/// flush, when each tile is cleared just before it is drawn.
+/// \param color Color to clear to, RGBA with red in the low byte.
+/// \param depth Depth to clear to.
+
+void CSoftRasterizer::Clear(uint32_t color, float depth){
+  if(!m_vTriangles.empty())
+    Flush(); //the clear comes after these
+
+  m_bClear = true;
+  m_nClearColor = color;
+  m_fClearDepth = depth;
+} //Clear
+
+/// Transform a vertex by a matrix. The matrix is laid out as in the
+/// game's shader constant buffer, that is, transposed, so that each row
+/// gives one clip space coordinate.
+/// \param v Vertex.
+/// \param m Matrix.
+/// \param out Receives clip space x, y, z, w, then u and v.
+
+static void TransformVertex(const SoftVertex& v, const float m[16], float out[6]){
+  for(int i=0; i<4; i++)
+    out[i] = m[4*i]*v.fX + m[4*i + 1]*v.fY + m[4*i + 2]*v.fZ + m[4*i + 3];
+
+  out[4] = v.fU;
+  out[5] = v.fV;
+} //TransformVertex
+
+/// Draw a triangle strip, with the same winding rules as the GPU: the odd
+/// triangles have their first two vertices swapped.
+/// \param v Vertices.
+/// \param n Number of vertices.
+/// \param m World view projection matrix, as in the shader constant buffer.
+/// \param texture Texture.
+/// \param blend Blend mode.
+
+void CSoftRasterizer::DrawStrip(const SoftVertex* v, int n, const float m[16],
+  const SoftTexture* texture, SoftBlendMode blend)
+{
+  if(n < 3 || texture == nullptr || texture->vTexels.empty())return;
+
+  float p[3][6]; //last three vertices, transformed
+  TransformVertex(v[0], m, p[0]);
+  TransformVertex(v[1], m, p[1]);
+
+  for(int i=2; i<n; i++){
+    TransformVertex(v[i], m, p[i%3]);
+    const float* a = p[(i - 2)%3];
+    const float* b = p[(i - 1)%3];
+    const float* c = p[i%3];
+
+    if(i & 1)SetupTriangle(b, a, c, texture, blend);
+    else SetupTriangle(a, b, c, texture, blend);
+  } //for
+} //DrawStrip
+
+/// Draw sprites exactly as the instanced sprite vertex shader does, each
+/// as a unit quad scaled to the sprite size and moved to the sprite center.
+/// \param s Sprite instances.
+/// \param n Number of sprite instances.
+/// \param m View projection matrix, as in the shader constant buffer.
+/// \param texture Texture shared by all of the sprites.
+/// \param blend Blend mode.
+
+void CSoftRasterizer::DrawSprites(const SpriteInstance* s, int n, const float m[16],
+  const SoftTexture* texture, SoftBlendMode blend)
+{
+  //corners of the unit quad and their texture coordinates, as in InitSpriteBatch
+  static const float corner[4][4] = {
+    {0.5f, 0.5f, 1.0f, 0.0f}, {0.5f, -0.5f, 1.0f, 1.0f},
+    {-0.5f, 0.5f, 0.0f, 0.0f}, {-0.5f, -0.5f, 0.0f, 1.0f}
+  }; //corner
+
+  for(int i=0; i<n; i++){
+    SoftVertex quad[4];
+
+    for(int j=0; j<4; j++){
+      quad[j].fX = s[i].fX + corner[j][0]*s[i].fWidth;
+      quad[j].fY = s[i].fY + corner[j][1]*s[i].fHeight;
+      quad[j].fZ = s[i].fZ;
+      quad[j].fU = s[i].fU0 + corner[j][2]*(s[i].fU1 - s[i].fU0);
+      quad[j].fV = s[i].fV0 + corner[j][3]*(s[i].fV1 - s[i].fV0);
+    } //for
+
+    DrawStrip(quad, 4, m, texture, blend);
+  } //for
+} //DrawSprites
+
+/// Set up a triangle for rasterization, and add it to the bins of the
+/// tiles that its bounding box touches.
+/// \param p0 First vertex, clip space position then texture coordinates.
+/// \param p1 Second vertex.
+/// \param p2 Third vertex.
+/// \param texture Texture.
+/// \param blend Blend mode.
+
+void CSoftRasterizer::SetupTriangle(const float* p0, const float* p1, const float* p2,
+  const SoftTexture* texture, SoftBlendMode blend)
+{
+  const float* p[3] = {p0, p1, p2};
+  if(p0[3] < MIN_W || p1[3] < MIN_W || p2[3] < MIN_W)
+    return; //behind the camera, or too close to it
+
+  //project to screen space
+  float x[3], y[3], oow[3];
+
+  for(int i=0; i<3; i++){
+    oow[i] = 1.0f/p[i][3];
+    x[i] = (p[i][0]*oow[i]*0.5f + 0.5f)*m_nWidth;
+    y[i] = (0.5f - p[i][1]*oow[i]*0.5f)*m_nHeight;
+  } //for
+
+  //front faces are clockwise on screen, which with y down is positive area
+  const float area = (x[1] - x[0])*(y[2] - y[0]) - (x[2] - x[0])*(y[1] - y[0]);
+  if(area <= 0.0f)return; //back facing or degenerate
+
+  SoftTriangle t;
+  t.pTexture = texture;
+  t.nBlend = blend;
+
+  //bounding box, clamped to the screen
+  t.nMinX = max(0, (int)floorf(min(x[0], min(x[1], x[2]))));
+  t.nMinY = max(0, (int)floorf(min(y[0], min(y[1], y[2]))));
+  t.nMaxX = min(m_nWidth - 1, (int)ceilf(max(x[0], max(x[1], x[2]))));
+  t.nMaxY = min(m_nHeight - 1, (int)ceilf(max(y[0], max(y[1], y[2]))));
+  if(t.nMinX > t.nMaxX || t.nMinY > t.nMaxY)return; //off screen
+
+  //edge functions, positive inside
+  for(int i=0; i<3; i++){
+    const int j = (i + 1)%3;
+    const float dx = x[j] - x[i];
+    const float dy = y[j] - y[i];
+
+    t.fEdgeA[i] = -dy;
+    t.fEdgeB[i] = dx;
+    t.fEdgeC[i] = dy*x[i] - dx*y[i];
+    t.bTopLeft[i] = dy < 0.0f || (dy == 0.0f && dx > 0.0f);
+  } //for
+
+  //planes for 1/w, u/w, v/w, and z
+  float f[4][3];
+
+  for(int i=0; i<3; i++){
+    f[0][i] = oow[i];
+    f[1][i] = p[i][4]*oow[i];
+    f[2][i] = p[i][5]*oow[i];
+    f[3][i] = p[i][2]*oow[i];
+  } //for
+
+  for(int k=0; k<4; k++){
+    const float d1 = f[k][1] - f[k][0];
+    const float d2 = f[k][2] - f[k][0];
+    const float a = (d1*(y[2] - y[0]) - d2*(y[1] - y[0]))/area;
+    const float b = (d2*(x[1] - x[0]) - d1*(x[2] - x[0]))/area;
+
+    t.fPlane[k][0] = a;
+    t.fPlane[k][1] = b;
+    t.fPlane[k][2] = f[k][0] - a*x[0] - b*y[0];
+  } //for
+
+  //bin it
+  const int index = (int)m_vTriangles.size();
+  m_vTriangles.push_back(t);
+
+  for(int ty=t.nMinY/TILE_SIZE; ty<=t.nMaxY/TILE_SIZE; ty++)
+    for(int tx=t.nMinX/TILE_SIZE; tx<=t.nMaxX/TILE_SIZE; tx++)
+      m_vBins[ty*m_nTilesX + tx].push_back(index);
+} //SetupTriangle
+
+/// Divide each 16-bit lane by 255, rounding.
+/// \param x Eight 16-bit values, at most 255*255.
+/// \return x/255 in each lane.
+
+static inline __m128i Div255(__m128i x){
+  x = _mm_add_epi16(x, _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+} //Div255
+
+/// Multiply two pixels' channels, widened to 16 bits, by their own alpha.
+/// \param p Two pixels, each channel in a 16-bit lane.
+/// \return p times alpha over 255.
+
+static inline __m128i MultiplyByAlpha(__m128i p){
+  __m128i a = _mm_shufflelo_epi16(p, _MM_SHUFFLE(3, 3, 3, 3));
+  a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+  return Div255(_mm_mullo_epi16(p, a));
+} //MultiplyByAlpha
+
+/// Blend two pixels' channels, widened to 16 bits, over two destination pixels.
+/// \param s Two source pixels.
+/// \param d Two destination pixels.
+/// \return s times alpha plus d times one minus alpha.
+
+static inline __m128i AlphaBlend(__m128i s, __m128i d){
+  __m128i a = _mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3));
+  a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+  const __m128i inva = _mm_sub_epi16(_mm_set1_epi16(255), a);
+  return Div255(_mm_add_epi16(_mm_mullo_epi16(s, a), _mm_mullo_epi16(d, inva)));
+} //AlphaBlend
+
+/// Fetch four texels.
+/// \param texels Texture.
+/// \param index Index of each texel.
+/// \return The four texels.
+
+static inline __m128i FetchTexels(const uint32_t* texels, __m128i index){
+  #ifdef __AVX2__
+    return _mm_i32gather_epi32((const int*)texels, index, 4);
+  #else
+    alignas(16) int i[4];
+    _mm_store_si128((__m128i*)i, index);
+    return _mm_set_epi32(texels[i[3]], texels[i[2]], texels[i[1]], texels[i[0]]);
+  #endif //__AVX2__
+} //FetchTexels
+
+/// Draw the triangles binned in a tile, in order, four pixels at a time.
+/// \param tile Tile index.
+
+void CSoftRasterizer::RasterizeTile(int tile){
+  const int x0 = (tile%m_nTilesX)*TILE_SIZE;
+  const int y0 = (tile/m_nTilesX)*TILE_SIZE;
+  const int x1 = min(x0 + TILE_SIZE, m_nStride) - 1;
+  const int y1 = min(y0 + TILE_SIZE, m_nHeight) - 1;
+
+  if(m_bClear)
+    for(int y=y0; y<=y1; y++){
+      fill(&m_vColor[y*m_nStride + x0], &m_vColor[y*m_nStride + x1 + 1], m_nClearColor);
+      fill(&m_vDepth[y*m_nStride + x0], &m_vDepth[y*m_nStride + x1 + 1], m_fClearDepth);
+    } //for
+
+  const vector<int>& bin = m_vBins[tile];
+  const __m128 lane = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f); //pixel centers
+  const __m128i alphamask = _mm_set1_epi32(0x00ffffff);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i width = _mm_set1_epi32(m_nWidth);
+
+  for(int n=0; n<(int)bin.size(); n++){
+    const SoftTriangle& t = m_vTriangles[bin[n]];
+    const SoftTexture& tex = *t.pTexture;
+    const uint32_t* texels = tex.vTexels.data();
+    const __m128 texw = _mm_set1_ps((float)tex.nWidth);
+    const __m128 texh = _mm_set1_ps((float)tex.nHeight);
+    const __m128 texmaxu = _mm_set1_ps(tex.nWidth - 1.0f);
+    const __m128 texmaxv = _mm_set1_ps(tex.nHeight - 1.0f);
+
+    //clip bounding box to tile, starting on a multiple of 4
+    const int xmin = max(x0, t.nMinX) & ~3;
+    const int xmax = min(x1, t.nMaxX);
+    const int ymin = max(y0, t.nMinY);
+    const int ymax = min(y1, t.nMaxY);
+
+    //edge steps, and masks for edges that include their boundary
+    __m128 ea[3], estep[3], tl[3];
+    for(int i=0; i<3; i++){
+      ea[i] = _mm_set1_ps(t.fEdgeA[i]);
+      estep[i] = _mm_set1_ps(4.0f*t.fEdgeA[i]);
+      tl[i] = t.bTopLeft[i]? _mm_castsi128_ps(_mm_set1_epi32(-1)): _mm_setzero_ps();
+    } //for
+
+    __m128 pa[4], pstep[4];
+    for(int k=0; k<4; k++){
+      pa[k] = _mm_set1_ps(t.fPlane[k][0]);
+      pstep[k] = _mm_set1_ps(4.0f*t.fPlane[k][0]);
+    } //for
+
+    for(int y=ymin; y<=ymax; y++){
+      const float py = y + 0.5f;
+
+      //narrow the row to the span inside all three edges, widened by a pixel
+      //each way so that rounding never loses a covered pixel
+      int xlo = xmin, xhi = xmax;
+      for(int i=0; i<3 && xlo<=xhi; i++){
+        const float a = t.fEdgeA[i];
+        const float c = t.fEdgeB[i]*py + t.fEdgeC[i];
+
+        if(a == 0.0f){ //horizontal edge, all in or all out
+          if(c < 0.0f)xhi = xlo - 1;
+        } //if
+
+        else{
+          const float edge = -c/a - 0.5f; //where the edge crosses the row
+
+          if(a > 0.0f){ //inside is to the right
+            if(edge > xhi)xhi = xlo - 1;
+            else if(edge > xlo)xlo = (int)edge - 1;
+          } //if
+
+          else{ //inside is to the left
+            if(edge < xlo)xhi = xlo - 1;
+            else if(edge < xhi)xhi = (int)edge + 1;
+          } //else
+        } //else
+      } //for
+
+      if(xlo > xhi)continue;
+      xlo = max(xlo, xmin) & ~3;
+
+      const __m128 px = _mm_add_ps(_mm_set1_ps((float)xlo), lane);
+
+      __m128 e[3], f[4];
+      for(int i=0; i<3; i++)
+        e[i] = _mm_add_ps(_mm_mul_ps(ea[i], px), _mm_set1_ps(t.fEdgeB[i]*py + t.fEdgeC[i]));
+      for(int k=0; k<4; k++)
+        f[k] = _mm_add_ps(_mm_mul_ps(pa[k], px), _mm_set1_ps(t.fPlane[k][1]*py + t.fPlane[k][2]));
+
+      uint32_t* colorrow = &m_vColor[y*m_nStride];
+      float* depthrow = &m_vDepth[y*m_nStride];
+
+      for(int x=xlo; x<=xhi; x+=4){
+        //coverage
+        __m128 mask = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for(int i=0; i<3; i++){
+          const __m128 inside = _mm_or_ps(_mm_cmpgt_ps(e[i], _mm_setzero_ps()),
+            _mm_and_ps(tl[i], _mm_cmpeq_ps(e[i], _mm_setzero_ps())));
+          mask = _mm_and_ps(mask, inside);
+        } //for
+
+        //pixels off the right edge of the screen are in the row padding
+        const __m128i column = _mm_add_epi32(_mm_set1_epi32(x), _mm_set_epi32(3, 2, 1, 0));
+        mask = _mm_and_ps(mask, _mm_castsi128_ps(_mm_cmplt_epi32(column, width)));
+
+        if(_mm_movemask_ps(mask)){
+          //depth test
+          const __m128 z = f[3];
+          const __m128 oldz = _mm_loadu_ps(depthrow + x);
+          mask = _mm_and_ps(mask, _mm_cmplt_ps(z, oldz));
+
+          if(_mm_movemask_ps(mask)){
+            _mm_storeu_ps(depthrow + x, _mm_or_ps(_mm_and_ps(mask, z), _mm_andnot_ps(mask, oldz)));
+
+            //perspective correct texture coordinates, one Newton step on 1/(1/w)
+            const __m128 r = _mm_rcp_ps(f[0]);
+            const __m128 w = _mm_sub_ps(_mm_add_ps(r, r), _mm_mul_ps(f[0], _mm_mul_ps(r, r)));
+            __m128 u = _mm_mul_ps(_mm_mul_ps(f[1], w), texw);
+            __m128 v = _mm_mul_ps(_mm_mul_ps(f[2], w), texh);
+            u = _mm_min_ps(_mm_max_ps(u, _mm_setzero_ps()), texmaxu);
+            v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), texmaxv);
+
+            const __m128 row = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+            const __m128i index = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(row, texw), u));
+            const __m128i src = FetchTexels(texels, index);
+
+            //opaque pixels covering all four need no blending
+            if(t.nBlend == SOFT_NO_BLEND && _mm_movemask_ps(mask) == 15)
+              _mm_storeu_si128((__m128i*)(colorrow + x), src);
+
+            else{
+              //blend
+              const __m128i dst = _mm_loadu_si128((const __m128i*)(colorrow + x));
+              __m128i out;
+
+              if(t.nBlend == SOFT_ALPHA_BLEND){
+                const __m128i lo = AlphaBlend(_mm_unpacklo_epi8(src, zero), _mm_unpacklo_epi8(dst, zero));
+                const __m128i hi = AlphaBlend(_mm_unpackhi_epi8(src, zero), _mm_unpackhi_epi8(dst, zero));
+                out = _mm_and_si128(_mm_packus_epi16(lo, hi), alphamask); //alpha blends to zero
+              } //if
+
+              else if(t.nBlend == SOFT_ADDITIVE_BLEND){
+                const __m128i lo = MultiplyByAlpha(_mm_unpacklo_epi8(src, zero));
+                const __m128i hi = MultiplyByAlpha(_mm_unpackhi_epi8(src, zero));
+                out = _mm_and_si128(_mm_adds_epu8(_mm_packus_epi16(lo, hi), dst), alphamask);
+              } //else if
+
+              else out = src;
+
+              const __m128i m = _mm_castps_si128(mask);
+              out = _mm_or_si128(_mm_and_si128(m, out), _mm_andnot_si128(m, dst));
+              _mm_storeu_si128((__m128i*)(colorrow + x), out);
+            } //else
+          } //if
+        } //if
+
+        for(int i=0; i<3; i++)
+          e[i] = _mm_add_ps(e[i], estep[i]);
+        for(int k=0; k<4; k++)
+          f[k] = _mm_add_ps(f[k], pstep[k]);
+      } //for
+    } //for
+  } //for
+} //RasterizeTile
+
+/// Rasterize tiles until there are none left. Called by each thread.
+
+void CSoftRasterizer::WorkOnTiles(){
+  const int n = m_nTilesX*m_nTilesY;
+
+  for(int tile=m_nNextTile++; tile<n; tile=m_nNextTile++)
+    RasterizeTile(tile);
+} //WorkOnTiles
+
+/// Worker thread. Wait for a flush, help with it, and repeat until told to quit.
+
+void CSoftRasterizer::WorkerThread(){
+  int generation = 0;
+
+  while(true){
+    {
+      unique_lock<mutex> lock(m_mutex);
+      m_cvWork.wait(lock, [&]{return m_bQuit || m_nGeneration != generation;});
+      if(m_bQuit)break;
+      generation = m_nGeneration;
+    }
+
+    WorkOnTiles();
+
+    {
+      lock_guard<mutex> lock(m_mutex);
+      m_nBusyWorkers--;
+    }
+
+    m_cvDone.notify_one();
+  } //while
+} //WorkerThread
+
+/// Rasterize every triangle submitted since the last flush, and do any
+/// pending clear, using all of the threads. Returns when the framebuffer
+/// is complete.
+
+void CSoftRasterizer::Flush(){
+  if(m_vTriangles.empty() && !m_bClear)return; //nothing to do
+
+  {
+    lock_guard<mutex> lock(m_mutex);
+    m_nNextTile = 0;
+    m_nBusyWorkers = (int)m_vWorkers.size();
+    m_nGeneration++;
+  }
+
+  m_cvWork.notify_all();
+  WorkOnTiles();
+
+  {
+    unique_lock<mutex> lock(m_mutex);
+    m_cvDone.wait(lock, [this]{return m_nBusyWorkers == 0;});
+  }
+
+  m_vTriangles.clear();
+  for(int i=0; i<(int)m_vBins.size(); i++)
+    m_vBins[i].clear(); //keeps its capacity, so no allocation next frame
+  m_bClear = false;
+} //Flush
+
+/// Get the framebuffer width.
+/// \return Width in pixels.
+
+int CSoftRasterizer::GetWidth() const{
+  return m_nWidth;
+} //GetWidth
+
+/// Get the framebuffer height.
+/// \return Height in pixels.
+
+int CSoftRasterizer::GetHeight() const{
+  return m_nHeight;
+} //GetHeight
+
+/// Copy the color buffer out, without the row padding. Call Flush first.
+/// \param pixels Receives width times height pixels, top row first.
+
+void CSoftRasterizer::GetPixels(vector<uint32_t>& pixels) const{
+  pixels.resize(m_nWidth*m_nHeight);
+
+  for(int y=0; y<m_nHeight; y++)
+    memcpy(&pixels[y*m_nWidth], &m_vColor[y*m_nStride], m_nWidth*sizeof(uint32_t));
+} //GetPixels
@@ -0,0 +1,126 @@
+/// \file SoftRasterizer.h
+/// \brief Interface for the software rasterizer class CSoftRasterizer.
+///
+/// The software rasterizer draws the game's textured quads on the CPU, the
+/// way the GPU draws them with the game's render state, so that frames can be
+/// rendered and compared on machines without a GPU. It knows nothing about
+/// Direct3D.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "SpriteBatch.h"
+
+using namespace std;
+
+/// Blend modes that the software rasterizer supports.
+
+enum SoftBlendMode{
+  SOFT_NO_BLEND, ///< Overwrite, as for the background.
+  SOFT_ALPHA_BLEND, ///< Source alpha, inverse source alpha.
+  SOFT_ADDITIVE_BLEND ///< Source alpha, one.
+}; //SoftBlendMode
+
+/// \brief A vertex.
+///
+/// This has the same layout as BILLBOARDVERTEX, so vertex data made for the
+/// GPU can be drawn as is.
+
+struct SoftVertex{
+  float fX, fY, fZ; ///< Position.
+  float fU, fV; ///< Texture coordinates.
+}; //SoftVertex
+
+/// \brief A texture in CPU memory.
+///
+/// Texels are 32-bit RGBA, red in the low byte, top row first.
+
+struct SoftTexture{
+  int nWidth; ///< Width in texels.
+  int nHeight; ///< Height in texels.
+  vector<uint32_t> vTexels; ///< Texels.
+}; //SoftTexture
+
+/// \brief A triangle that has been set up for rasterization.
+///
+/// Everything is in screen space, in pixels. A pixel is inside the triangle
+/// if all three edge functions are positive at its center, or zero on a top
+/// or left edge. The interpolated quantities are planes in screen space.
+
+struct SoftTriangle{
+  float fEdgeA[3], fEdgeB[3], fEdgeC[3]; ///< Edge functions Ax + By + C.
+  bool bTopLeft[3]; ///< Whether each edge is a top or left edge.
+  float fPlane[4][3]; ///< 1/w, u/w, v/w, and z as ax + by + c.
+  int nMinX, nMinY, nMaxX, nMaxY; ///< Bounding box in pixels, inclusive.
+  const SoftTexture* pTexture; ///< Texture.
+  SoftBlendMode nBlend; ///< Blend mode.
+}; //SoftTriangle
+
+/// \brief The software rasterizer.
+///
+/// Triangles are transformed and set up as they are submitted, and sorted
+/// into bins by the 64 by 64 pixel screen tiles that they touch. Flush then
+/// rasterizes the tiles in parallel, each tile drawing its triangles in
+/// submission order, so blending comes out just as it would on the GPU.
+/// Each row of a triangle is trimmed to the span between its edges, and
+/// pixels are processed four at a time with SSE. Texels are fetched
+/// with AVX2 gathers when built for AVX2. Like the game's render state,
+/// back faces (counterclockwise on screen) are culled, depth is tested
+/// with less-than and written, and textures are sampled with clamping.
+/// Unlike the GPU, sampling is point rather than bilinear, and triangles
+/// are not clipped, so they must be in front of the camera.
+
+class CSoftRasterizer{
+  private:
+    int m_nWidth; ///< Framebuffer width in pixels.
+    int m_nHeight; ///< Framebuffer height in pixels.
+    int m_nStride; ///< Framebuffer row length, a multiple of 4.
+    vector<uint32_t> m_vColor; ///< Color buffer.
+    vector<float> m_vDepth; ///< Depth buffer.
+
+    int m_nTilesX; ///< Number of tiles across.
+    int m_nTilesY; ///< Number of tiles down.
+    vector<SoftTriangle> m_vTriangles; ///< Triangles waiting to be rasterized.
+    vector<vector<int>> m_vBins; ///< Triangles touching each tile, in order.
+
+    bool m_bClear; ///< Whether tiles are to be cleared before drawing.
+    uint32_t m_nClearColor; ///< Color to clear to.
+    float m_fClearDepth; ///< Depth to clear to.
+
+    vector<thread> m_vWorkers; ///< Worker threads, in addition to the caller.
+    mutex m_mutex; ///< Guards the fields below.
+    condition_variable m_cvWork; ///< Signalled when there are tiles to do.
+    condition_variable m_cvDone; ///< Signalled when a worker has finished.
+    int m_nGeneration; ///< Incremented for each flush.
+    int m_nBusyWorkers; ///< Workers still working on this flush.
+    bool m_bQuit; ///< Whether workers are to exit.
+    atomic<int> m_nNextTile; ///< Next tile to be rasterized.
+
+    void SetupTriangle(const float* p0, const float* p1, const float* p2,
+      const SoftTexture* texture, SoftBlendMode blend); ///< Set up and bin a triangle.
+    void RasterizeTile(int tile); ///< Draw the triangles in a tile.
+    void WorkOnTiles(); ///< Rasterize tiles until there are none left.
+    void WorkerThread(); ///< Worker thread body.
+
+  public:
+    CSoftRasterizer(int w, int h, int threads=0); ///< Constructor.
+    ~CSoftRasterizer(); ///< Destructor.
+
+    void Clear(uint32_t color, float depth=1.0f); ///< Clear color and depth.
+    void DrawStrip(const SoftVertex* v, int n, const float m[16],
+      const SoftTexture* texture, SoftBlendMode blend); ///< Draw a triangle strip.
+    void DrawSprites(const SpriteInstance* s, int n, const float m[16],
+      const SoftTexture* texture, SoftBlendMode blend); ///< Draw sprites.
+    void Flush(); ///< Rasterize everything submitted.
+
+    int GetWidth() const; ///< Framebuffer width.
+    int GetHeight() const; ///< Framebuffer height.
+    void GetPixels(vector<uint32_t>& pixels) const; ///< Copy out the color buffer.
+}; //CSoftRasterizer
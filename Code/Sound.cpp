@@ -5,6 +5,7 @@
 
 #include "sound.h"
 #include "Defines.h"
+#include "Profiler.h"
 
 /// Set member variables to sensible values and initialize the XAudio Engine using DirectXTK.
 
@@ -89,6 +90,7 @@ int CSoundManager::getNextInstance(int index){
 /// \param index index of sound to be played
 
 int CSoundManager::play(int index){
+  PROFILE_ZONE("CSoundManager::play");
   if(index < 0 || index >= m_nCount)return -1; //bail if bad index
 
   int instance = getNextInstance(index);
@@ -127,6 +129,23 @@ void CSoundManager::Load(char* filename, int n){
   m_nCount++;
 } //Load
 
+/// Load a sound from a WAV file that has already been read into memory
+/// and parsed. The sound effect takes ownership of the data.
+/// \param wavData Contents of WAV file
+/// \param wfx Pointer to the wave format, within wavData
+/// \param startAudio Pointer to the samples, within wavData
+/// \param audioBytes Size of the samples in bytes
+/// \param n Number of instances of sound wanted
+
+void CSoundManager::Load(unique_ptr<uint8_t[]>& wavData, const WAVEFORMATEX* wfx,
+  const uint8_t* startAudio, size_t audioBytes, int n)
+{
+  m_pSoundEffects.push_back(new SoundEffect(m_pAudioEngine, wavData, wfx, startAudio, audioBytes));
+  createInstances((int)m_pSoundEffects.size() - 1, n,
+    SoundEffectInstance_Use3D | SoundEffectInstance_ReverbUseFilters);
+  m_nCount++;
+} //Load
+
 /// Set the position of a sound instance.
 /// If the index or instance are -1, it uses the ones in
 /// m_nLastPlayedSound and m_nLastPlayedInstance, respectively.
@@ -35,7 +35,9 @@ class CSoundManager{
   public:
     CSoundManager(int count); ///< Constructor.
     ~CSoundManager(); ///< Destructor.
-    void Load(char* filename, int n); 
+    void Load(char* filename, int n); ///< Load sound from file.
+    void Load(unique_ptr<uint8_t[]>& wavData, const WAVEFORMATEX* wfx,
+      const uint8_t* startAudio, size_t audioBytes, int n); ///< Load sound from memory.
 
     int play(int index); ///< Play a sound.
     int loop(int index); ///< Play a sound looped.
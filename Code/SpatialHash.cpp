@@ -0,0 +1,146 @@
+/// \file SpatialHash.cpp
+/// \brief Code for the spatial hash class CSpatialHash.
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "SpatialHash.h"
+
+/// The cells are at least twice the collision radius across, so that
+/// objects that touch are never more than one cell apart, even allowing
+/// for rounding.
+/// \param radius Collision radius.
+/// \param buckets Number of buckets, rounded up to a power of 2.
+
+CSpatialHash::CSpatialHash(float radius, int buckets):
+  m_fWorldWidth(0.0f), m_fCellSize(2.0f*radius), m_nColumns(1)
+{
+  unsigned n = 1;
+  while(n < (unsigned)buckets)n <<= 1;
+  m_nMask = n - 1;
+  m_vStart.assign(n + 1, 0);
+} //constructor
+
+/// Make room for n objects, so that inserting them doesn't allocate memory.
+/// \param n Most objects there will be at once.
+
+void CSpatialHash::Reserve(int n){
+  m_vId.reserve(n);
+  m_vBucket.reserve(n);
+  m_vSorted.reserve(n);
+} //Reserve
+
+/// Remove all objects, and set the width of the world, which may have
+/// changed since last time. The columns are made as narrow as they can be
+/// while fitting exactly across the world and being no narrower than a
+/// cell is high. If the world is too narrow for that, there is only one
+/// column, and every object is in it.
+/// \param width Width of the world.
+
+void CSpatialHash::Clear(float width){
+  m_vId.clear();
+  m_vBucket.clear();
+
+  m_fWorldWidth = width;
+  m_nColumns = max(1, (int)(width/m_fCellSize));
+} //Clear
+
+/// Get the cell that a point is in.
+/// \param x X coordinate, which may be anywhere, since it wraps.
+/// \param y Y coordinate.
+/// \param cx [out] Column, from 0 to m_nColumns - 1.
+/// \param cy [out] Row.
+
+void CSpatialHash::GetCell(float x, float y, int& cx, int& cy) const{
+  cx = 0;
+
+  if(m_nColumns > 1){
+    cx = (int)floorf(x*m_nColumns/m_fWorldWidth)%m_nColumns;
+    if(cx < 0)cx += m_nColumns;
+  } //if
+
+  cy = (int)floorf(y/m_fCellSize);
+} //GetCell
+
+/// Hash a cell to a bucket. Different cells may share a bucket, which
+/// costs a little time but doesn't matter otherwise, since the caller
+/// checks every object it is given.
+/// \param cx Column.
+/// \param cy Row.
+/// \return Bucket.
+
+unsigned CSpatialHash::GetBucket(int cx, int cy) const{
+  return ((unsigned)cx*73856093u ^ (unsigned)cy*19349663u) & m_nMask;
+} //GetBucket
+
+/// Insert an object. Nothing can be found until Build() is called.
+/// \param id Identifier for the object, returned by Query().
+/// \param x X coordinate.
+/// \param y Y coordinate.
+
+void CSpatialHash::Insert(int id, float x, float y){
+  int cx, cy;
+  GetCell(x, y, cx, cy);
+  m_vId.push_back(id);
+  m_vBucket.push_back(GetBucket(cx, cy));
+} //Insert
+
+/// Sort the objects inserted into buckets with a counting sort. This is
+/// stable, so objects in a bucket stay in the order they were inserted.
+
+void CSpatialHash::Build(){
+  const int n = (int)m_vId.size();
+  fill(m_vStart.begin(), m_vStart.end(), 0);
+
+  for(int i=0; i<n; i++) //count objects in each bucket
+    m_vStart[m_vBucket[i] + 1]++;
+
+  for(size_t b=1; b<m_vStart.size(); b++) //make counts into starts
+    m_vStart[b] += m_vStart[b - 1];
+
+  m_vSorted.resize(n);
+  for(int i=0; i<n; i++) //place objects, using the start of each bucket as a cursor
+    m_vSorted[m_vStart[m_vBucket[i]]++] = m_vId[i];
+
+  for(size_t b=m_vStart.size() - 1; b>0; b--) //each cursor is now at the next bucket's start, so shift them back
+    m_vStart[b] = m_vStart[b - 1];
+  m_vStart[0] = 0;
+} //Build
+
+/// Get the objects in the cell containing a point and the cells around it,
+/// which includes every object within the collision radius of the point.
+/// Each is given once, in increasing order of identifier, so that the
+/// caller can visit them in the same order as it would without the hash.
+/// \param x X coordinate.
+/// \param y Y coordinate.
+/// \param result [out] Identifiers of objects near the point.
+
+void CSpatialHash::Query(float x, float y, vector<int>& result) const{
+  result.clear();
+  int cx, cy;
+  GetCell(x, y, cx, cy);
+
+  unsigned bucket[9]; //buckets to look in, each once
+  int nBuckets = 0;
+
+  for(int dx=-1; dx<=1; dx++){
+    const int col = (cx + dx + m_nColumns)%m_nColumns; //wrap around the world
+
+    for(int dy=-1; dy<=1; dy++){
+      const unsigned b = GetBucket(col, cy + dy);
+      if(find(bucket, bucket + nBuckets, b) == bucket + nBuckets) //a narrow world or a hash collision can repeat one
+        bucket[nBuckets++] = b;
+    } //for
+  } //for
+
+  for(int k=0; k<nBuckets; k++)
+    result.insert(result.end(),
+      m_vSorted.begin() + m_vStart[bucket[k]], m_vSorted.begin() + m_vStart[bucket[k] + 1]);
+
+  if(nBuckets > 1)
+    sort(result.begin(), result.end());
+} //Query
+
+int CSpatialHash::GetCount() const{return (int)m_vId.size();}
+int CSpatialHash::GetColumns() const{return m_nColumns;}
@@ -0,0 +1,59 @@
+/// \file SpatialHash.h
+/// \brief Interface for the spatial hash class CSpatialHash.
+
+#pragma once
+
+#include <vector>
+
+using namespace std;
+
+/// \brief A broadphase for collision detection in a world that wraps.
+///
+/// The spatial hash divides the plane into square cells, and puts the
+/// identifier of each object inserted into the bucket for the cell that it
+/// is in. Asking for the objects near a point returns those in its cell and
+/// the eight around it, which includes every object within the collision
+/// radius of it, and usually not many more. The world wraps around in X,
+/// so the columns of cells wrap too: the cell width is chosen so that a
+/// whole number of columns fits exactly across the world, and the column
+/// to the right of the last is the first.
+///
+/// The hash is meant to be rebuilt from scratch every tick. Objects are
+/// inserted one by one, and then Build() sorts them by bucket into one
+/// contiguous array with a counting sort, so that nothing is allocated
+/// once the hash has reached its working size.
+///
+/// Only CObjectManager uses it, for bullets, and ObjMan.cpp isn't compiled
+/// in this tree, so the game doesn't use it. The speedup that CollisionBench
+/// measures is for thousands of bullets and targets. The fight's own hit pass
+/// has eight fighters at most. CHitBoxes tests every pair of their boxes with
+/// SSE, in fixed point. Building a hash of eight fighters and querying it once
+/// for each takes about as long as the whole tick, so it isn't used there.
+
+class CSpatialHash{
+  private:
+    float m_fWorldWidth; ///< Width of the world, after which X wraps.
+    float m_fCellSize; ///< Width and height of a cell.
+    int m_nColumns; ///< Number of columns of cells across the world.
+    unsigned m_nMask; ///< Number of buckets less one, a power of 2 less one.
+
+    vector<int> m_vId; ///< Identifiers of objects inserted.
+    vector<unsigned> m_vBucket; ///< Bucket of each object inserted.
+    vector<int> m_vStart; ///< Where each bucket starts in m_vSorted, and one past the last.
+    vector<int> m_vSorted; ///< Identifiers of objects sorted by bucket.
+
+    void GetCell(float x, float y, int& cx, int& cy) const; ///< Cell containing a point.
+    unsigned GetBucket(int cx, int cy) const; ///< Bucket for a cell.
+
+  public:
+    CSpatialHash(float radius, int buckets); ///< Constructor.
+
+    void Reserve(int n); ///< Make room for n objects.
+    void Clear(float width); ///< Remove all objects and set world width.
+    void Insert(int id, float x, float y); ///< Insert an object.
+    void Build(); ///< Sort inserted objects into buckets.
+    void Query(float x, float y, vector<int>& result) const; ///< Get objects near a point.
+
+    int GetCount() const; ///< Number of objects inserted.
+    int GetColumns() const; ///< Number of columns across the world.
+}; //CSpatialHash
@@ -7,31 +7,33 @@
 #include <windowsx.h>
 
 #include "defines.h"
-#include "Shader.h"
 
 using namespace DirectX;
 
 /// \brief The base sprite. 
 ///
 /// The base sprite contains basic information for managing and drawing a
-/// billboard sprite in a 3D world.
+/// billboard sprite in a 3D world. Sprites don't draw themselves directly,
+/// they submit themselves to the game renderer's sprite batch, which draws
+/// all of the sprites in a frame together.
 
 class C3DSprite{
   private:
     ID3D11ShaderResourceView* m_pTexture; ///< Pointer to texture containing the sprite image.
+    int m_nWidth; ///< Width of sprite image in pixels.
+    int m_nHeight; ///< Height of sprite image in pixels.
+    float m_fU0, m_fV0; ///< Texture coordinates of top left corner of sprite image.
+    float m_fU1, m_fV1; ///< Texture coordinates of bottom right corner of sprite image.
+    BOOL m_bOwnsFrame; ///< TRUE if texture was loaded by this sprite, not the frame cache.
+    int m_nFrame; ///< Index of current frame in the frame cache, -1 if none.
 
-    ID3D11Buffer* m_pVertexBuffer; ///< Vertex buffer.
-    BILLBOARDVERTEX* m_pVertexBufferData; ///< Vertex buffer data.
-    D3D11_BUFFER_DESC m_VertexBufferDesc; ///< Vertex buffer descriptor.
-    ID3D11Buffer* m_pConstantBuffer; ///< Constant buffer.
-    ID3D11BlendState1* m_pBlendState; ///< Blend state.
-    ID3D11RasterizerState1* m_pRasterizerState; ///< Rasterizer state.
-    CShader* m_pShader; ///< Pointer to an instance of the shader class.
+    void ReleaseFrame(); ///< Release texture if owned.
 
   public:
     C3DSprite(); ///< Constructor.
     C3DSprite::~C3DSprite(); ///< Destructor.
     BOOL Load(char* filename); ///< Load texture image from file.
+    BOOL SetFrame(int index); ///< Use a frame from the frame cache.
     void Draw(const Vector3& p); ///< Draw sprite at point p in 3D space.
     void Release(); ///< Release sprite.
 }; //C3DSprite
\ No newline at end of file
@@ -0,0 +1,89 @@
+/// \file SpriteBatch.cpp
+/// \brief Code for the sprite batch class CSpriteBatch.
+
+#include <algorithm>
+#include <functional>
+
+#include "SpriteBatch.h"
+
+/// Clear out the previous frame's sprites, keeping the memory for reuse.
+
+void CSpriteBatch::Begin(){
+  m_vSubmissions.clear();
+  m_vSubmitted.clear();
+  m_vInstances.clear();
+  m_vRuns.clear();
+} //Begin
+
+/// Add a sprite to the batch.
+/// \param texture Texture that the sprite is drawn from.
+/// \param instance Position, size, and texture coordinates of sprite.
+/// \param blend Blend mode.
+/// \param layer Draw layer, lower layers are drawn first.
+
+void CSpriteBatch::Submit(const void* texture, const SpriteInstance& instance,
+  SpriteBlendMode blend, int layer)
+{
+  Submission s;
+  s.nLayer = layer;
+  s.nBlend = blend;
+  s.pTexture = texture;
+  s.nOrder = (int)m_vSubmissions.size();
+
+  m_vSubmissions.push_back(s);
+  m_vSubmitted.push_back(instance);
+} //Submit
+
+/// Sort the sprites by layer, then blend mode, then texture, and pack
+/// their instance data into draw order. Consecutive sprites with the same
+/// layer, blend mode, and texture make up a run.
+
+void CSpriteBatch::End(){
+  sort(m_vSubmissions.begin(), m_vSubmissions.end(),
+    [](const Submission& a, const Submission& b){
+      if(a.nLayer != b.nLayer)return a.nLayer < b.nLayer;
+      if(a.nBlend != b.nBlend)return a.nBlend < b.nBlend;
+      if(a.pTexture != b.pTexture)return less<const void*>()(a.pTexture, b.pTexture);
+      return a.nOrder < b.nOrder; //keep submission order within a run
+    });
+
+  m_vInstances.resize(m_vSubmissions.size());
+  m_vRuns.clear();
+
+  for(int i=0; i<(int)m_vSubmissions.size(); i++){
+    const Submission& s = m_vSubmissions[i];
+    m_vInstances[i] = m_vSubmitted[s.nOrder];
+
+    if(i > 0){ //same state as previous sprite extends the run
+      const Submission& prev = m_vSubmissions[i - 1];
+      if(s.nLayer == prev.nLayer && s.nBlend == prev.nBlend && s.pTexture == prev.pTexture){
+        m_vRuns.back().nCount++;
+        continue;
+      } //if
+    } //if
+
+    SpriteBatchRun run = {s.pTexture, s.nBlend, i, 1};
+    m_vRuns.push_back(run);
+  } //for
+} //End
+
+/// Get the instance data in draw order. Only valid after End.
+/// \return Reference to the instance array.
+
+const vector<SpriteInstance>& CSpriteBatch::GetInstances() const{
+  return m_vInstances;
+} //GetInstances
+
+/// Get the runs, one per draw call, in draw order. Only valid after End.
+/// \return Reference to the run array.
+
+const vector<SpriteBatchRun>& CSpriteBatch::GetRuns() const{
+  return m_vRuns;
+} //GetRuns
+
+/// Get the number of sprites submitted since Begin.
+/// \return Number of sprites.
+
+int CSpriteBatch::GetSpriteCount() const{
+  return (int)m_vSubmissions.size();
+} //GetSpriteCount
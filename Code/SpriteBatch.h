@@ -0,0 +1,78 @@
+/// \file SpriteBatch.h
+/// \brief Interface for the sprite batch class CSpriteBatch.
+
+#pragma once
+
+#include <vector>
+
+using namespace std;
+
+/// Blend modes that a sprite can be drawn with.
+
+enum SpriteBlendMode{
+  ALPHA_BLEND, ///< Source alpha, inverse source alpha.
+  ADDITIVE_BLEND, ///< Source alpha, one.
+  NUM_BLEND_MODES ///< Number of blend modes.
+}; //SpriteBlendMode
+
+/// \brief Per-instance sprite data.
+///
+/// This is exactly what the instanced sprite vertex shader reads from the
+/// instance buffer for each sprite, so the layout must match the input
+/// element descriptors set up in CGameRenderer::InitSpriteBatch.
+
+struct SpriteInstance{
+  float fX, fY, fZ; ///< Position of sprite center in world space.
+  float fWidth, fHeight; ///< Size of sprite in world space.
+  float fU0, fV0; ///< Texture coordinates of top left corner.
+  float fU1, fV1; ///< Texture coordinates of bottom right corner.
+}; //SpriteInstance
+
+/// \brief A run of sprite instances that share all render state.
+///
+/// Each run is drawn with a single instanced draw call.
+
+struct SpriteBatchRun{
+  const void* pTexture; ///< Texture shared by all sprites in run.
+  SpriteBlendMode nBlend; ///< Blend mode shared by all sprites in run.
+  int nFirst; ///< Index of first instance of run in the instance array.
+  int nCount; ///< Number of instances in run.
+}; //SpriteBatchRun
+
+/// \brief The sprite batch.
+///
+/// The sprite batch collects the sprites submitted during a frame, sorts them
+/// so that sprites sharing a layer, blend mode, and texture are adjacent, and
+/// packs their per-instance data into one contiguous array together with a
+/// list of runs, one per draw call. Within a run, sprites keep the order
+/// in which they were submitted. Layers are drawn in increasing order, so
+/// use them to keep translucent sprites in back to front order where it
+/// matters. The batch knows nothing about Direct3D - textures are opaque
+/// pointers - so it can be exercised without a GPU.
+
+class CSpriteBatch{
+  private:
+    /// A submitted sprite, waiting to be sorted.
+
+    struct Submission{
+      int nLayer; ///< Draw layer.
+      SpriteBlendMode nBlend; ///< Blend mode.
+      const void* pTexture; ///< Texture.
+      int nOrder; ///< Submission order, for stable sorting.
+    }; //Submission
+
+    vector<Submission> m_vSubmissions; ///< Sprites submitted this frame.
+    vector<SpriteInstance> m_vSubmitted; ///< Instance data in submission order.
+    vector<SpriteInstance> m_vInstances; ///< Instance data in draw order.
+    vector<SpriteBatchRun> m_vRuns; ///< Draw calls.
+
+  public:
+    void Begin(); ///< Start a new frame.
+    void Submit(const void* texture, const SpriteInstance& instance,
+      SpriteBlendMode blend=ALPHA_BLEND, int layer=0); ///< Add a sprite.
+    void End(); ///< Sort sprites and build runs.
+
+    const vector<SpriteInstance>& GetInstances() const; ///< Instances in draw order.
+    const vector<SpriteBatchRun>& GetRuns() const; ///< Runs in draw order.
+    int GetSpriteCount() const; ///< Number of sprites submitted this frame.
+}; //CSpriteBatch
@@ -0,0 +1,14 @@
+/// \file SpritePS.hlsl
+/// \brief Pixel shader for instanced sprites drawn by the sprite batch.
+
+Texture2D spriteTexture: register(t0);
+SamplerState spriteSampler: register(s0);
+
+struct PSInput{
+  float4 pos: SV_POSITION;
+  float2 tex: TEXCOORD0;
+}; //PSInput
+
+float4 main(PSInput input): SV_TARGET{
+  return spriteTexture.Sample(spriteSampler, input.tex);
+} //main
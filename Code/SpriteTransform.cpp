@@ -0,0 +1,61 @@
+/// \file SpriteTransform.cpp
+/// \brief Code for transforming sprite instances to clip space.
+
+#include "SpriteTransform.h"
+
+/// Transform the centers of a frame's worth of sprites to clip space in one
+/// pass. Sprites are taken four at a time and transposed so that each vector
+/// holds one coordinate of four sprites, then each clip space coordinate of
+/// all four is a chain of three multiply-adds, and the result is transposed
+/// back. Any sprites left over are done one at a time.
+/// \param in Sprite instances, in world space.
+/// \param n Number of sprite instances.
+/// \param vp View projection matrix, not transposed.
+/// \param out Receives n instances in clip space.
+
+void TransformSprites(const SpriteInstance* in, int n, FXMMATRIX vp, SpriteClipInstance* out){
+  //m[c][k] is row k, column c of the matrix, in every lane
+  const XMMATRIX t = XMMatrixTranspose(vp);
+  XMVECTOR m[4][4];
+
+  for(int c=0; c<4; c++){
+    m[c][0] = XMVectorSplatX(t.r[c]);
+    m[c][1] = XMVectorSplatY(t.r[c]);
+    m[c][2] = XMVectorSplatZ(t.r[c]);
+    m[c][3] = XMVectorSplatW(t.r[c]);
+  } //for
+
+  int i = 0;
+
+  for(; i+4<=n; i+=4){
+    //x, y, z, and width of four sprites, transposed into one coordinate per vector
+    XMMATRIX p(
+      XMLoadFloat4((const XMFLOAT4*)&in[i].fX),
+      XMLoadFloat4((const XMFLOAT4*)&in[i + 1].fX),
+      XMLoadFloat4((const XMFLOAT4*)&in[i + 2].fX),
+      XMLoadFloat4((const XMFLOAT4*)&in[i + 3].fX));
+    p = XMMatrixTranspose(p);
+
+    XMMATRIX clip;
+    for(int c=0; c<4; c++)
+      clip.r[c] = XMVectorMultiplyAdd(p.r[0], m[c][0],
+        XMVectorMultiplyAdd(p.r[1], m[c][1], XMVectorMultiplyAdd(p.r[2], m[c][2], m[c][3])));
+    clip = XMMatrixTranspose(clip);
+
+    for(int j=0; j<4; j++){
+      const SpriteInstance& s = in[i + j];
+      SpriteClipInstance& d = out[i + j];
+      XMStoreFloat4(&d.vCenter, clip.r[j]);
+      d.vSize = XMFLOAT2(s.fWidth, s.fHeight);
+      d.vUV = XMFLOAT4(s.fU0, s.fV0, s.fU1, s.fV1);
+    } //for
+  } //for
+
+  for(; i<n; i++){ //leftovers
+    const SpriteInstance& s = in[i];
+    SpriteClipInstance& d = out[i];
+    XMStoreFloat4(&d.vCenter, XMVector3Transform(XMLoadFloat3((const XMFLOAT3*)&s.fX), vp));
+    d.vSize = XMFLOAT2(s.fWidth, s.fHeight);
+    d.vUV = XMFLOAT4(s.fU0, s.fV0, s.fU1, s.fV1);
+  } //for
+} //TransformSprites
@@ -0,0 +1,30 @@
+/// \file SpriteTransform.h
+/// \brief Interface for transforming sprite instances to clip space.
+///
+/// This needs only DirectXMath, not Direct3D, so it can be benchmarked
+/// on its own.
+
+#pragma once
+
+#include <DirectXMath.h>
+
+#include "SpriteBatch.h"
+
+using namespace DirectX;
+
+/// \brief Per-instance sprite data in clip space.
+///
+/// This is what the instanced sprite vertex shader reads from the instance
+/// buffer for each sprite, so the layout must match the input element
+/// descriptors set up in CGameRenderer::InitSpriteBatch. The sprite center
+/// has already been transformed, so the shader only has to offset it by
+/// the corner of the quad along the view projection matrix's x and y axes.
+
+struct SpriteClipInstance{
+  XMFLOAT4 vCenter; ///< Sprite center in clip space.
+  XMFLOAT2 vSize; ///< Size of sprite in world space.
+  XMFLOAT4 vUV; ///< Texture rectangle, top left in xy and bottom right in zw.
+}; //SpriteClipInstance
+
+void TransformSprites(const SpriteInstance* in, int n, FXMMATRIX vp,
+  SpriteClipInstance* out); ///< Transform sprite centers to clip space.
@@ -0,0 +1,32 @@
+/// \file SpriteVS.hlsl
+/// \brief Vertex shader for instanced sprites drawn by the sprite batch.
+
+cbuffer ConstantBuffer: register(b0){
+  float4x4 vp; ///< View projection matrix.
+}; //ConstantBuffer
+
+/// Vertex of the unit quad, plus the per-instance sprite data.
+
+struct VSInput{
+  float3 corner: POSITION; ///< Corner of unit quad centered on origin.
+  float2 tex: TEXCOORD; ///< Corner of texture rectangle, 0 or 1 in each coordinate.
+  float4 pos: INSTANCEPOS; ///< Position of sprite center, already in clip space.
+  float2 size: INSTANCESIZE; ///< Size of sprite.
+  float4 uv: INSTANCEUV; ///< Texture rectangle, top left in xy and bottom right in zw.
+}; //VSInput
+
+struct VSOutput{
+  float4 pos: SV_POSITION;
+  float2 tex: TEXCOORD0;
+}; //VSOutput
+
+/// The quad is parallel to the xy plane, so its corners are offset from the
+/// center in clip space along the first two rows of the matrix.
+
+VSOutput main(VSInput input){
+  VSOutput output;
+  float2 offset = input.corner.xy*input.size;
+  output.pos = input.pos + offset.x*vp[0] + offset.y*vp[1];
+  output.tex = lerp(input.uv.xy, input.uv.zw, input.tex);
+  return output;
+} //main
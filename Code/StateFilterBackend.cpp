@@ -0,0 +1,212 @@
+/// \file StateFilterBackend.cpp
+/// \brief Code for the state filtering render backend class CStateFilterBackend.
+
+#include "StateFilterBackend.h"
+
+/// \param backend Backend to pass calls on to, which the filter takes ownership of.
+
+CStateFilterBackend::CStateFilterBackend(CRenderBackend* backend): m_pBackend(backend){
+  m_cElided.Clear();
+  m_cLastElided.Clear();
+  Invalidate();
+} //constructor
+
+CStateFilterBackend::~CStateFilterBackend(){
+  delete m_pBackend;
+} //destructor
+
+/// Forget everything that is bound, so that the next call of each kind
+/// gets through.
+
+void CStateFilterBackend::Invalidate(){
+  m_bRenderTarget = false;
+  m_bShaders = false;
+  m_hLayout = m_hVertexShader = m_hPixelShader = nullptr;
+  m_nTopology = -1;
+  m_nVertexBuffers = -1;
+  m_bBlendState = false;
+  m_hBlendState = nullptr;
+  m_bRasterizerState = false;
+  m_hRasterizerState = nullptr;
+
+  for(int i=0; i<MAX_FILTERED_VERTEX_BUFFERS; i++){
+    m_hVertexBuffer[i] = nullptr;
+    m_nStride[i] = 0;
+  } //for
+
+  for(int i=0; i<MAX_FILTERED_SLOTS; i++){
+    m_bConstantBuffer[i] = m_bTexture[i] = false;
+    m_hConstantBuffer[i] = m_hTexture[i] = nullptr;
+  } //for
+} //Invalidate
+
+/// Get the backend that calls are passed on to.
+/// \return Pointer to the backend.
+
+CRenderBackend* CStateFilterBackend::GetBackend(){
+  return m_pBackend;
+} //GetBackend
+
+/// Get the number of calls of each kind dropped in the last frame presented.
+/// \return Counts of dropped calls.
+
+const RenderFrameStats& CStateFilterBackend::GetLastFrameElided() const{
+  return m_cLastElided;
+} //GetLastFrameElided
+
+/// Count a dropped call.
+/// \param t Command type.
+
+void CStateFilterBackend::Elide(RenderCommandType t){
+  m_cElided.nCommands[t]++;
+} //Elide
+
+void CStateFilterBackend::SetRenderTarget(){
+  Count(SET_RENDER_TARGET_COMMAND);
+  if(m_bRenderTarget){Elide(SET_RENDER_TARGET_COMMAND); return;}
+
+  m_bRenderTarget = true;
+  m_pBackend->SetRenderTarget();
+} //SetRenderTarget
+
+void CStateFilterBackend::Clear(const float color[4]){
+  Count(CLEAR_COMMAND);
+  m_pBackend->Clear(color);
+} //Clear
+
+/// Set shaders, unless all three are already bound.
+
+void CStateFilterBackend::SetShaders(RenderHandle layout, RenderHandle vs, RenderHandle ps){
+  Count(SET_SHADERS_COMMAND);
+
+  if(m_bShaders && layout == m_hLayout && vs == m_hVertexShader && ps == m_hPixelShader){
+    Elide(SET_SHADERS_COMMAND); return;
+  } //if
+
+  m_bShaders = true;
+  m_hLayout = layout;
+  m_hVertexShader = vs;
+  m_hPixelShader = ps;
+  m_pBackend->SetShaders(layout, vs, ps);
+} //SetShaders
+
+void CStateFilterBackend::SetTopology(RenderTopology t){
+  Count(SET_TOPOLOGY_COMMAND);
+  if(m_nTopology == t){Elide(SET_TOPOLOGY_COMMAND); return;}
+
+  m_nTopology = t;
+  m_pBackend->SetTopology(t);
+} //SetTopology
+
+/// Set vertex buffers, unless the same buffers with the same strides are
+/// already bound. Binding more buffers than are tracked is always passed on.
+
+void CStateFilterBackend::SetVertexBuffers(int n, const RenderHandle* buffers, const unsigned* strides){
+  Count(SET_VERTEX_BUFFERS_COMMAND);
+
+  bool same = n == m_nVertexBuffers;
+  for(int i=0; i<n && same; i++)
+    same = buffers[i] == m_hVertexBuffer[i] && strides[i] == m_nStride[i];
+
+  if(same){Elide(SET_VERTEX_BUFFERS_COMMAND); return;}
+
+  if(n <= MAX_FILTERED_VERTEX_BUFFERS){
+    m_nVertexBuffers = n;
+    for(int i=0; i<n; i++){
+      m_hVertexBuffer[i] = buffers[i];
+      m_nStride[i] = strides[i];
+    } //for
+  } //if
+  else m_nVertexBuffers = -1; //too many to track
+
+  m_pBackend->SetVertexBuffers(n, buffers, strides);
+} //SetVertexBuffers
+
+/// Update a buffer. This changes its contents, not what is bound,
+/// so it is always passed on.
+
+void CStateFilterBackend::UpdateBuffer(RenderHandle buffer, const void* data, size_t bytes){
+  Count(UPDATE_BUFFER_COMMAND, bytes);
+  m_pBackend->UpdateBuffer(buffer, data, bytes);
+} //UpdateBuffer
+
+/// Overwrite a buffer. This changes its contents, not what is bound,
+/// so it is always passed on.
+
+bool CStateFilterBackend::WriteBuffer(RenderHandle buffer, const void* data, size_t bytes){
+  Count(WRITE_BUFFER_COMMAND, bytes);
+  return m_pBackend->WriteBuffer(buffer, data, bytes);
+} //WriteBuffer
+
+void CStateFilterBackend::SetConstantBuffer(int slot, RenderHandle buffer){
+  Count(SET_CONSTANT_BUFFER_COMMAND);
+  const bool tracked = slot >= 0 && slot < MAX_FILTERED_SLOTS;
+
+  if(tracked && m_bConstantBuffer[slot] && m_hConstantBuffer[slot] == buffer){
+    Elide(SET_CONSTANT_BUFFER_COMMAND); return;
+  } //if
+
+  if(tracked){
+    m_bConstantBuffer[slot] = true;
+    m_hConstantBuffer[slot] = buffer;
+  } //if
+
+  m_pBackend->SetConstantBuffer(slot, buffer);
+} //SetConstantBuffer
+
+void CStateFilterBackend::SetTexture(int slot, RenderHandle texture){
+  Count(SET_TEXTURE_COMMAND);
+  const bool tracked = slot >= 0 && slot < MAX_FILTERED_SLOTS;
+
+  if(tracked && m_bTexture[slot] && m_hTexture[slot] == texture){
+    Elide(SET_TEXTURE_COMMAND); return;
+  } //if
+
+  if(tracked){
+    m_bTexture[slot] = true;
+    m_hTexture[slot] = texture;
+  } //if
+
+  m_pBackend->SetTexture(slot, texture);
+} //SetTexture
+
+void CStateFilterBackend::SetBlendState(RenderHandle state){
+  Count(SET_BLEND_STATE_COMMAND);
+  if(m_bBlendState && m_hBlendState == state){Elide(SET_BLEND_STATE_COMMAND); return;}
+
+  m_bBlendState = true;
+  m_hBlendState = state;
+  m_pBackend->SetBlendState(state);
+} //SetBlendState
+
+void CStateFilterBackend::SetRasterizerState(RenderHandle state){
+  Count(SET_RASTERIZER_STATE_COMMAND);
+  if(m_bRasterizerState && m_hRasterizerState == state){Elide(SET_RASTERIZER_STATE_COMMAND); return;}
+
+  m_bRasterizerState = true;
+  m_hRasterizerState = state;
+  m_pBackend->SetRasterizerState(state);
+} //SetRasterizerState
+
+void CStateFilterBackend::Draw(int vertices, int first){
+  Count(DRAW_COMMAND);
+  m_pBackend->Draw(vertices, first);
+} //Draw
+
+void CStateFilterBackend::DrawInstanced(int vertices, int instances, int firstvertex, int firstinstance){
+  Count(DRAW_INSTANCED_COMMAND);
+  m_pBackend->DrawInstanced(vertices, instances, firstvertex, firstinstance);
+} //DrawInstanced
+
+/// Present the frame. Presenting may unbind the back buffer, so the
+/// render target is forgotten; everything else stays bound.
+
+void CStateFilterBackend::Present(int interval){
+  Count(PRESENT_COMMAND);
+  m_pBackend->Present(interval);
+  m_bRenderTarget = false;
+
+  m_cLastElided = m_cElided;
+  m_cElided.Clear();
+  EndFrame();
+} //Present
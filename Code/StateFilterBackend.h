@@ -0,0 +1,71 @@
+/// \file StateFilterBackend.h
+/// \brief Interface for the state filtering render backend class CStateFilterBackend.
+
+#pragma once
+
+#include "RenderBackend.h"
+
+const int MAX_FILTERED_SLOTS = 8; ///< Texture and constant buffer slots tracked.
+const int MAX_FILTERED_VERTEX_BUFFERS = 4; ///< Vertex buffer slots tracked.
+
+/// \brief The state filtering render backend.
+///
+/// The state filtering backend sits in front of another backend and
+/// remembers what is currently bound: render target, shaders, topology,
+/// vertex buffers, constant buffers, textures, blend state, and rasterizer
+/// state. Calls that
+/// would bind what is already bound are dropped instead of being passed on.
+/// Its own frame stats count every call it is given, the backend behind it
+/// counts the ones that got through, and it counts the ones it dropped.
+/// Anything that changes bindings behind its back must call Invalidate.
+
+class CStateFilterBackend: public CRenderBackend{
+  private:
+    CRenderBackend* m_pBackend; ///< Backend that calls are passed on to, owned.
+
+    bool m_bRenderTarget; ///< Whether the render target is known to be bound.
+    bool m_bShaders; ///< Whether the shaders are known.
+    RenderHandle m_hLayout; ///< Bound input layout.
+    RenderHandle m_hVertexShader; ///< Bound vertex shader.
+    RenderHandle m_hPixelShader; ///< Bound pixel shader.
+    int m_nTopology; ///< Bound topology, -1 if unknown.
+    int m_nVertexBuffers; ///< Number of bound vertex buffers, -1 if unknown.
+    RenderHandle m_hVertexBuffer[MAX_FILTERED_VERTEX_BUFFERS]; ///< Bound vertex buffers.
+    unsigned m_nStride[MAX_FILTERED_VERTEX_BUFFERS]; ///< Bound vertex buffer strides.
+    bool m_bConstantBuffer[MAX_FILTERED_SLOTS]; ///< Whether each constant buffer slot is known.
+    RenderHandle m_hConstantBuffer[MAX_FILTERED_SLOTS]; ///< Bound constant buffers.
+    bool m_bTexture[MAX_FILTERED_SLOTS]; ///< Whether each texture slot is known.
+    RenderHandle m_hTexture[MAX_FILTERED_SLOTS]; ///< Bound textures.
+    bool m_bBlendState; ///< Whether the blend state is known.
+    RenderHandle m_hBlendState; ///< Bound blend state.
+    bool m_bRasterizerState; ///< Whether the rasterizer state is known.
+    RenderHandle m_hRasterizerState; ///< Bound rasterizer state.
+
+    RenderFrameStats m_cElided; ///< Calls dropped in the frame in progress.
+    RenderFrameStats m_cLastElided; ///< Calls dropped in the last complete frame.
+
+    void Elide(RenderCommandType t); ///< Count a dropped call.
+
+  public:
+    CStateFilterBackend(CRenderBackend* backend); ///< Constructor.
+    virtual ~CStateFilterBackend(); ///< Destructor.
+
+    void Invalidate(); ///< Forget what is bound.
+    CRenderBackend* GetBackend(); ///< Get the backend behind the filter.
+    const RenderFrameStats& GetLastFrameElided() const; ///< Calls dropped last frame.
+
+    virtual void SetRenderTarget(); ///< Bind the back buffer and depth buffer.
+    virtual void Clear(const float color[4]); ///< Clear the back buffer and depth buffer.
+    virtual void SetShaders(RenderHandle layout, RenderHandle vs, RenderHandle ps); ///< Set shaders.
+    virtual void SetTopology(RenderTopology t); ///< Set primitive topology.
+    virtual void SetVertexBuffers(int n, const RenderHandle* buffers, const unsigned* strides); ///< Set vertex buffers.
+    virtual void UpdateBuffer(RenderHandle buffer, const void* data, size_t bytes); ///< Update a default buffer.
+    virtual bool WriteBuffer(RenderHandle buffer, const void* data, size_t bytes); ///< Overwrite a dynamic buffer.
+    virtual void SetConstantBuffer(int slot, RenderHandle buffer); ///< Set constant buffer.
+    virtual void SetTexture(int slot, RenderHandle texture); ///< Set texture.
+    virtual void SetBlendState(RenderHandle state); ///< Set blend state.
+    virtual void SetRasterizerState(RenderHandle state); ///< Set rasterizer state.
+    virtual void Draw(int vertices, int first); ///< Draw.
+    virtual void DrawInstanced(int vertices, int instances, int firstvertex, int firstinstance); ///< Draw instanced.
+    virtual void Present(int interval); ///< Present the frame.
+}; //CStateFilterBackend
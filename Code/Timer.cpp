@@ -1,27 +1,167 @@
 /// \file timer.cpp
 /// \brief Code for timer class CTimer.
 
-#include "timer.h"
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <time.h>
+#endif
+
+#include "Timer.h"
 #include "debug.h"
 
-CTimer::CTimer(): m_nStartTime(0){ 
+CTimeHistogram::CTimeHistogram(){
+  Clear();
 } //constructor
 
+/// Get the bucket that a duration falls in. Durations below 16 have a
+/// bucket each. Above that, each power of two is split into 16 buckets,
+/// indexed by the 4 bits below the leading one.
+/// \param t Duration in microseconds.
+/// \return Bucket index.
+
+int CTimeHistogram::GetBucket(long long t){
+  if(t < SUB_BUCKETS)return t < 0? 0: (int)t;
+
+  int e = 0; //position of leading one
+  for(unsigned long long v=t; v>1; v>>=1)e++;
+
+  return (e - SUB_BUCKET_BITS + 1)*SUB_BUCKETS +
+    (int)((t >> (e - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+} //GetBucket
+
+/// Get the longest duration that falls in a bucket.
+/// \param b Bucket index.
+/// \return Duration in microseconds.
+
+long long CTimeHistogram::GetBucketTop(int b){
+  if(b < SUB_BUCKETS)return b;
+
+  const int e = b/SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+  const long long sub = b%SUB_BUCKETS;
+  return ((SUB_BUCKETS + sub + 1) << (e - SUB_BUCKET_BITS)) - 1;
+} //GetBucketTop
+
+/// Record a duration. This can be called from any thread.
+/// \param t Duration in microseconds.
+
+void CTimeHistogram::Record(long long t){
+  m_nBucket[GetBucket(t)].fetch_add(1, memory_order_relaxed);
+  m_nCount.fetch_add(1, memory_order_relaxed);
+  m_nTotal.fetch_add(t, memory_order_relaxed);
+
+  long long m = m_nMax.load(memory_order_relaxed);
+  while(t > m && !m_nMax.compare_exchange_weak(m, t, memory_order_relaxed));
+} //Record
+
+/// Forget all durations. Durations recorded by other threads while this
+/// is going on may be partly forgotten.
+
+void CTimeHistogram::Clear(){
+  for(int i=0; i<NUM_BUCKETS; i++)
+    m_nBucket[i].store(0, memory_order_relaxed);
+
+  m_nCount.store(0, memory_order_relaxed);
+  m_nTotal.store(0, memory_order_relaxed);
+  m_nMax.store(0, memory_order_relaxed);
+} //Clear
+
+/// Get the number of durations recorded.
+/// \return Number of durations.
+
+long long CTimeHistogram::GetCount() const{
+  return m_nCount.load(memory_order_relaxed);
+} //GetCount
+
+/// Get the mean duration.
+/// \return Mean duration in microseconds, 0 if there are none.
+
+double CTimeHistogram::GetMean() const{
+  const long long n = GetCount();
+  return n > 0? (double)m_nTotal.load(memory_order_relaxed)/n: 0.0;
+} //GetMean
+
+/// Get the longest duration.
+/// \return Longest duration in microseconds.
+
+long long CTimeHistogram::GetMax() const{
+  return m_nMax.load(memory_order_relaxed);
+} //GetMax
+
+/// Get a percentile. The answer is the top of the bucket that the
+/// percentile falls in, so it errs on the long side, but never by more
+/// than the longest duration recorded.
+/// \param p Percentile, from 0 to 100.
+/// \return Duration in microseconds that p percent of durations are no longer than.
+
+long long CTimeHistogram::GetPercentile(double p) const{
+  long long total = 0;
+  for(int i=0; i<NUM_BUCKETS; i++)
+    total += m_nBucket[i].load(memory_order_relaxed);
+  if(total == 0)return 0;
+
+  long long rank = (long long)(p/100.0*total + 0.5); //durations at or below answer
+  if(rank < 1)rank = 1;
+
+  long long count = 0;
+  for(int i=0; i<NUM_BUCKETS; i++){
+    count += m_nBucket[i].load(memory_order_relaxed);
+    if(count >= rank){
+      const long long top = GetBucketTop(i);
+      const long long m = GetMax();
+      return top < m? top: m;
+    } //if
+  } //for
+
+  return GetMax();
+} //GetPercentile
+
+CTimer::CTimer(): m_nStartTime(0){
+} //constructor
+
+/// Read the monotonic clock.
+/// \return Microseconds since some arbitrary time.
+
+long long CTimer::clock(){
+#ifdef _WIN32
+  static LARGE_INTEGER freq = {0};
+  if(freq.QuadPart == 0)
+    QueryPerformanceFrequency(&freq); //fixed at boot
+
+  LARGE_INTEGER t;
+  QueryPerformanceCounter(&t);
+
+  //whole seconds and remainder separately, so as not to overflow
+  return t.QuadPart/freq.QuadPart*1000000 + t.QuadPart%freq.QuadPart*1000000/freq.QuadPart;
+#else
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (long long)t.tv_sec*1000000 + t.tv_nsec/1000;
+#endif
+} //clock
+
 /// Start the timer from zero.
 
 void CTimer::start(){
-  m_nStartTime = timeGetTime();
+  m_nStartTime = clock();
 } //start
 
 /// Get the time.
 /// \return The time in milliseconds.
 
-int CTimer::time(){ 
-  return timeGetTime() - m_nStartTime;
+int CTimer::time(){
+  return (int)(microseconds()/1000);
 } //time
 
-/// The elapsed function is a useful function for measuring repeating time 
-/// intervals. Given the start and duration times, this function returns TRUE 
+/// Get the time in microseconds.
+/// \return The time in microseconds.
+
+long long CTimer::microseconds(){
+  return clock() - m_nStartTime;
+} //microseconds
+
+/// The elapsed function is a useful function for measuring repeating time
+/// intervals. Given the start and duration times, this function returns TRUE
 /// if the interval is over, and has the side-effect of resetting the start
 /// time when that happens, thus setting things up for the next interval.
 /// \param start Start of time interval
@@ -32,9 +172,24 @@ bool CTimer::elapsed(int &start, int interval){
   int curtime = time(); //current time
 
   if(curtime >= start + interval){ //if interval is over
-    start = curtime; //reset the start 
+    start = curtime; //reset the start
     return true; //succeed
   } //if
 
   else return false; //otherwise, fail
-} //elapsed
\ No newline at end of file
+} //elapsed
+
+/// Get the histogram of frame durations, the time from the start of one
+/// frame to the start of the next, for the game loop to record into.
+/// \return Frame duration histogram.
+
+CTimeHistogram& CTimer::frames(){
+  return m_cFrameTimes;
+} //frames
+
+/// Get the histogram of simulation tick durations.
+/// \return Tick duration histogram.
+
+CTimeHistogram& CTimer::ticks(){
+  return m_cTickTimes;
+} //ticks
@@ -3,23 +3,68 @@
 
 #pragma once
 
-#include <windows.h> //needed for BOOL
+#include <atomic>
 
-/// The \brief The timer. 
+using namespace std;
+
+/// \brief A histogram of durations.
+///
+/// The histogram counts durations in microseconds in buckets whose width
+/// grows with the duration, 16 buckets to each power of two, so that any
+/// duration is recorded to within about 6 percent. Recording is lock-free,
+/// so any number of threads can record into the same histogram while
+/// another reads percentiles from it.
+
+class CTimeHistogram{
+  private:
+    static const int SUB_BUCKET_BITS = 4; ///< Log of buckets per power of two.
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS; ///< Buckets per power of two.
+    static const int NUM_BUCKETS = (64 - SUB_BUCKET_BITS + 1)*SUB_BUCKETS; ///< Number of buckets.
+
+    atomic<unsigned> m_nBucket[NUM_BUCKETS]; ///< Count in each bucket.
+    atomic<long long> m_nCount; ///< Number of durations recorded.
+    atomic<long long> m_nTotal; ///< Sum of durations recorded.
+    atomic<long long> m_nMax; ///< Longest duration recorded.
+
+    static int GetBucket(long long t); ///< Bucket that a duration falls in.
+    static long long GetBucketTop(int b); ///< Longest duration in a bucket.
+
+  public:
+    CTimeHistogram(); ///< Constructor.
+
+    void Record(long long t); ///< Record a duration.
+    void Clear(); ///< Forget all durations.
+
+    long long GetCount() const; ///< Number of durations recorded.
+    double GetMean() const; ///< Mean duration.
+    long long GetMax() const; ///< Longest duration.
+    long long GetPercentile(double p) const; ///< Duration that p percent are no longer than.
+}; //CTimeHistogram
+
+/// The \brief The timer.
 ///
 /// The timer allows you to manage game events by duration, rather than
-/// on a frame-by-frame basis. This simple version of the timer is based on
-/// the Windows API function timeGetTime, which is notoriously inaccurate
-/// but perfectly adequate for a simple game demo.
+/// on a frame-by-frame basis. It reads a monotonic clock with microsecond
+/// resolution, QueryPerformanceCounter on Windows and clock_gettime
+/// elsewhere, and keeps time in 64 bits so that it never wraps. It also
+/// keeps histograms of frame and simulation tick durations.
 
 class CTimer{
   private:
-    int m_nStartTime; ///< Time that timer was started.
+    long long m_nStartTime; ///< Time that timer was started, in microseconds.
+
+    CTimeHistogram m_cFrameTimes; ///< Time from the start of one frame to the next.
+    CTimeHistogram m_cTickTimes; ///< Time taken by each simulation tick.
+
+    static long long clock(); ///< Read the monotonic clock in microseconds.
 
   public:
     CTimer(); ///< Constructor.
     void start(); ///< Start the timer.
     int time(); ///< Return the time in ms.
+    long long microseconds(); ///< Return the time in microseconds.
     bool elapsed(int &start, int interval); ///< Has interval ms elapsed since start?
-}; //CTimer
 
+    CTimeHistogram& frames(); ///< Histogram of frame durations.
+    CTimeHistogram& ticks(); ///< Histogram of tick durations.
+}; //CTimer
@@ -0,0 +1,183 @@
+/// \file Win32Platform.cpp
+/// \brief Code for the Win32 platform class CWin32Platform.
+
+#include "Win32Platform.h"
+
+#include "..\resource.h" //for IDI_ICON1, the red plane icon
+
+/// \brief Window procedure.
+///
+/// Handler for messages from the Windows API. Messages for a window that
+/// belongs to a platform are passed on to it.
+/// \param hwnd Window handle
+/// \param message Message code
+/// \param wParam Parameter for message
+/// \param lParam Second parameter for message
+/// \return 0 if message is handled
+
+LRESULT CALLBACK WindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam){
+  CWin32Platform* pPlatform = (CWin32Platform*)GetWindowLongPtr(hwnd, GWLP_USERDATA);
+  if(pPlatform)return pPlatform->HandleMessage(message, wParam, lParam);
+  return DefWindowProc(hwnd, message, wParam, lParam);
+} //WindowProc
+
+/// \param hInstance Handle to the current instance of this application.
+/// \param nShow Specifies how the window is to be shown.
+
+CWin32Platform::CWin32Platform(HINSTANCE hInstance, int nShow):
+  m_hInstance(hInstance), m_nShow(nShow), m_hWnd(nullptr)
+{
+  m_cClock.start();
+} //constructor
+
+/// Register and create a window. It takes some shenanigans
+/// to make sure that the client area of the window is exactly width
+/// by height since Windows usually includes the banner and border
+/// when specifying window size. The window is centered on the desktop too.
+/// \param name The name of this application.
+/// \param width Width of client area in pixels.
+/// \param height Height of client area in pixels.
+/// \return true if the window was created.
+
+bool CWin32Platform::CreateGameWindow(const char* name, int width, int height){
+  WNDCLASS wc; //window registration info
+
+  //fill in registration information wc
+  wc.style = CS_HREDRAW | CS_VREDRAW; //style
+  wc.lpfnWndProc = WindowProc; //window message handler
+  wc.cbClsExtra = wc.cbWndExtra = 0;
+  wc.hInstance = m_hInstance; //instance handle
+  wc.hIcon = LoadIcon(m_hInstance, MAKEINTRESOURCE(IDI_ICON1));
+  wc.hCursor = nullptr; //no cursor
+  wc.hbrBackground = nullptr; //we will draw background
+  wc.lpszMenuName = nullptr; //no menu
+  wc.lpszClassName = name; //app name provided as parameter
+
+  RegisterClass(&wc); //register window
+
+  //get resolution that user's monitor is currently set at
+  int nDevScreenWidth = GetSystemMetrics(SM_CXSCREEN);
+  int nDevScreenHeight = GetSystemMetrics(SM_CYSCREEN);
+
+  RECT r; //desired window rectangle
+
+  //initialize r to size of client area in window
+  r.left = 0; r.right = width;
+  r.top = 0; r.bottom = height;
+
+  //adjust r to include Windows border and stuff
+  AdjustWindowRectEx(&r, WS_POPUP | WS_CLIPCHILDREN | WS_OVERLAPPEDWINDOW,
+    FALSE, WS_EX_APPWINDOW | WS_EX_DLGMODALFRAME);
+
+  int w = r.right - r.left, h = r.bottom - r.top;
+
+  //create window
+  m_hWnd = CreateWindowEx(WS_EX_APPWINDOW | WS_EX_DLGMODALFRAME, name, name,
+    WS_DLGFRAME | WS_SYSMENU | WS_MINIMIZEBOX, 0, 0,
+    w, h, nullptr, nullptr, m_hInstance, nullptr);
+  if(!m_hWnd)return false; //bail if problem creating window
+
+  //messages go to this platform from now on
+  SetWindowLongPtr(m_hWnd, GWLP_USERDATA, (LONG_PTR)this);
+
+  //center window on screen
+  int x = (nDevScreenWidth - width)/2;
+  int y = (nDevScreenHeight - height)/2;
+  ::SetWindowPos(m_hWnd, nullptr, x, y, w, h, SWP_NOZORDER | SWP_SHOWWINDOW);
+
+  ShowWindow(m_hWnd, m_nShow); UpdateWindow(m_hWnd); //show and update
+  SetFocus(m_hWnd); //get input from keyboard
+
+  return true;
+} //CreateGameWindow
+
+/// Destroy the window. Its messages stop coming here first, since there's
+/// nobody left to deliver events to.
+
+void CWin32Platform::DestroyGameWindow(){
+  if(m_hWnd){
+    SetWindowLongPtr(m_hWnd, GWLP_USERDATA, 0);
+    DestroyWindow(m_hWnd);
+    m_hWnd = nullptr;
+  } //if
+} //DestroyGameWindow
+
+/// \param title Title text.
+
+void CWin32Platform::SetTitle(const char* title){
+  if(m_hWnd)SetWindowText(m_hWnd, title);
+} //SetTitle
+
+/// Dispatch every message that is waiting, which the window procedure
+/// turns into events.
+
+void CWin32Platform::Pump(){
+  MSG msg; //current message
+
+  while(PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)){
+    if(msg.message == WM_QUIT){
+      Post(QUIT_EVENT, 0, Now());
+      break;
+    } //if
+
+    TranslateMessage(&msg); DispatchMessage(&msg);
+  } //while
+} //Pump
+
+/// Sleep until a time, but wake at once for any message, so that keys are
+/// handled as soon as they are pressed. Waits of under a millisecond
+/// aren't worth sleeping for.
+/// \param t Time to wait until in microseconds, or -1 to wait for a message.
+
+void CWin32Platform::WaitForEvent(long long t){
+  if(t < 0){
+    WaitMessage();
+    return;
+  } //if
+
+  const long long wait = t - Now(); //microseconds to wait
+  if(wait >= 1000)
+    MsgWaitForMultipleObjects(0, nullptr, FALSE, (DWORD)(wait/1000), QS_ALLINPUT);
+} //WaitForEvent
+
+/// Get the time from the performance counter, which any thread can do.
+/// \return Time in microseconds since the platform was created.
+
+long long CWin32Platform::Now(){
+  return m_cClock.microseconds();
+} //Now
+
+/// \return Window handle, null if there is no window.
+
+HWND CWin32Platform::GetWindow() const{
+  return m_hWnd;
+} //GetWindow
+
+/// Turn a message sent to the window into events. Closing the window
+/// only asks the game loop to quit, so that the game can shut down with
+/// the window still there, and destroy it when it is done.
+/// \param message Message code
+/// \param wParam Parameter for message
+/// \param lParam Second parameter for message
+/// \return 0 if message is handled
+
+LRESULT CWin32Platform::HandleMessage(UINT message, WPARAM wParam, LPARAM lParam){
+  switch(message){ //handle message
+    case WM_ACTIVATEAPP: //iconize
+      Post(wParam? ACTIVATE_EVENT: DEACTIVATE_EVENT, 0, Now());
+      break;
+
+    case WM_KEYDOWN: //keyboard hit, stamped on arrival
+      Post(KEY_DOWN_EVENT, (int)wParam, Now());
+      break;
+
+    case WM_CLOSE: //on exit
+      Post(QUIT_EVENT, 0, Now());
+      break;
+
+    default: //default window procedure
+      return DefWindowProc(m_hWnd, message, wParam, lParam);
+  } //switch(message)
+
+  return 0;
+} //HandleMessage
@@ -0,0 +1,39 @@
+/// \file Win32Platform.h
+/// \brief Interface for the Win32 platform class CWin32Platform.
+
+#pragma once
+
+#include <windows.h>
+
+#include "Platform.h"
+#include "timer.h"
+
+/// \brief The Win32 platform.
+///
+/// The Win32 platform makes a real window, turns the messages sent to it
+/// into events, and keeps time with the performance counter. Key presses
+/// are stamped with the time they arrive at the window procedure, which is
+/// as close as Windows lets us get to the time the key went down.
+
+class CWin32Platform: public CPlatform{
+  private:
+    HINSTANCE m_hInstance; ///< Application instance handle.
+    int m_nShow; ///< How the window is to be shown.
+    HWND m_hWnd; ///< Window handle, null if there is no window.
+    CTimer m_cClock; ///< Platform clock.
+
+  protected:
+    void Pump(); ///< Dispatch waiting messages.
+
+  public:
+    CWin32Platform(HINSTANCE hInstance, int nShow); ///< Constructor.
+
+    bool CreateGameWindow(const char* name, int width, int height); ///< Make the game window.
+    void DestroyGameWindow(); ///< Get rid of the game window.
+    void SetTitle(const char* title); ///< Set the window title.
+    void WaitForEvent(long long t); ///< Wait for a message or a time.
+    long long Now(); ///< Current time in microseconds.
+
+    HWND GetWindow() const; ///< Window handle.
+    LRESULT HandleMessage(UINT message, WPARAM wParam, LPARAM lParam); ///< Turn a message into events.
+}; //CWin32Platform
@@ -0,0 +1,357 @@
+/// \file AtlasPacker.cpp
+/// \brief Offline sprite atlas packer.
+///
+/// Reads the image list from the game's settings file, packs the sprite
+/// frames into one or more atlases, and writes an XML manifest giving the
+/// rectangle of each frame within its atlas. The packer only needs the
+/// image dimensions, which it reads from the PNG or BMP file headers, so it
+/// runs anywhere. The game composes the atlas textures itself at load time
+/// from the manifest, see CFrameCache::LoadAtlases.
+///
+/// Build with, for example:
+///
+///     g++ -O2 -I../../Code AtlasPacker.cpp ../../Code/tinyxml2.cpp -o atlaspacker
+///
+/// Usage:
+///
+///     atlaspacker [-first n] [-last n] [-max size] [-pad n] [-align n] [-root dir] settings.xml atlas.xml
+///
+/// Images first through last (default 3 through the end of the list, that is,
+/// everything except the background) are packed into atlases no larger than
+/// size by size pixels (default 2048), with pad pixels (default 2) between
+/// frames. Frames are placed at multiples of align pixels (default 1); use
+/// 4 if the frames have been block compressed by the texture compressor,
+/// since compressed frames can only be copied into the atlas a whole block
+/// at a time. Image file names in the settings file are taken relative to
+/// dir (default the directory containing the settings file).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "tinyxml2.h"
+
+using namespace std;
+using namespace tinyxml2;
+
+/// A frame to be packed.
+
+struct PackFrame{
+  int nIndex; ///< Index of image in the settings file image list.
+  string strFileName; ///< Image file name as given in the settings file.
+  int nWidth; ///< Image width in pixels.
+  int nHeight; ///< Image height in pixels.
+  int nAtlas; ///< Atlas that the frame was placed in.
+  int nX; ///< Left edge of frame in atlas.
+  int nY; ///< Top edge of frame in atlas.
+}; //PackFrame
+
+/// An atlas under construction.
+
+struct PackAtlas{
+  int nWidth; ///< Atlas width in pixels.
+  int nHeight; ///< Atlas height in pixels.
+  int nShelfX; ///< Next free X coordinate on current shelf.
+  int nShelfY; ///< Top of current shelf.
+  int nShelfHeight; ///< Height of current shelf.
+}; //PackAtlas
+
+/// Read a big-endian 32-bit unsigned integer.
+/// \param p Pointer to first byte.
+/// \return The integer.
+
+static unsigned int ReadBE32(const unsigned char* p){
+  return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) |
+    ((unsigned int)p[2] << 8) | (unsigned int)p[3];
+} //ReadBE32
+
+/// Read a little-endian 32-bit signed integer.
+/// \param p Pointer to first byte.
+/// \return The integer.
+
+static int ReadLE32(const unsigned char* p){
+  return (int)((unsigned int)p[0] | ((unsigned int)p[1] << 8) |
+    ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24));
+} //ReadLE32
+
+/// Get the width and height of a PNG or BMP image from its header.
+/// \param fname Image file name.
+/// \param w Receives the width.
+/// \param h Receives the height.
+/// \return true if the header was recognized.
+
+static bool GetImageSize(const string& fname, int& w, int& h){
+  FILE* f = fopen(fname.c_str(), "rb");
+  if(f == nullptr)return false;
+
+  unsigned char header[32];
+  size_t n = fread(header, 1, sizeof(header), f);
+  fclose(f);
+
+  const unsigned char pngsig[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+  if(n >= 24 && memcmp(header, pngsig, 8) == 0 && memcmp(header + 12, "IHDR", 4) == 0){
+    w = (int)ReadBE32(header + 16);
+    h = (int)ReadBE32(header + 20);
+    return true;
+  } //if
+
+  if(n >= 26 && header[0] == 'B' && header[1] == 'M'){
+    w = ReadLE32(header + 18);
+    h = abs(ReadLE32(header + 22)); //negative for top-down bitmaps
+    return true;
+  } //if
+
+  return false;
+} //GetImageSize
+
+/// Convert a Windows path from the settings file to a path on this machine.
+/// \param root Directory that the path is relative to.
+/// \param fname File name from the settings file.
+/// \return Path to the file.
+
+static string MakePath(const string& root, const char* fname){
+  string s = fname;
+#ifndef _WIN32
+  replace(s.begin(), s.end(), '\\', '/');
+#endif
+  if(root.empty())return s;
+  return root + "/" + s;
+} //MakePath
+
+/// Place frames into atlases of a given width using shelf packing. Frames
+/// are assumed to be sorted by decreasing height, so each shelf is as tall
+/// as the first frame placed on it.
+/// \param frames Frames to be placed.
+/// \param width Atlas width.
+/// \param maxsize Maximum atlas height.
+/// \param pad Padding between frames.
+/// \param align Frame positions are multiples of this.
+/// \param atlases Receives the atlases.
+/// \return false if some frame can't fit in an atlas of this width.
+
+static bool Pack(vector<PackFrame>& frames, int width, int maxsize, int pad, int align,
+  vector<PackAtlas>& atlases)
+{
+  atlases.clear();
+
+  for(PackFrame& f: frames){
+    const int w = (f.nWidth + pad + align - 1)/align*align;
+    const int h = (f.nHeight + pad + align - 1)/align*align;
+    if(w > width || h > maxsize)return false; //will never fit
+
+    if(atlases.empty()){ //first atlas
+      PackAtlas a = {width, 0, 0, 0, 0};
+      atlases.push_back(a);
+    } //if
+
+    PackAtlas* a = &atlases.back();
+
+    if(a->nShelfX + w > width){ //new shelf
+      a->nShelfY += a->nShelfHeight;
+      a->nShelfX = 0;
+      a->nShelfHeight = 0;
+    } //if
+
+    if(a->nShelfY + h > maxsize){ //new atlas
+      PackAtlas b = {width, 0, 0, 0, 0};
+      atlases.push_back(b);
+      a = &atlases.back();
+    } //if
+
+    f.nAtlas = (int)atlases.size() - 1;
+    f.nX = a->nShelfX;
+    f.nY = a->nShelfY;
+
+    a->nShelfX += w;
+    a->nShelfHeight = max(a->nShelfHeight, h);
+    a->nHeight = max(a->nHeight, a->nShelfY + a->nShelfHeight);
+  } //for
+
+  //round heights up to a multiple of 4 so that block compression works
+  for(PackAtlas& a: atlases)
+    a.nHeight = (a.nHeight + 3) & ~3;
+
+  return true;
+} //Pack
+
+/// Write the atlas manifest.
+/// \param fname Manifest file name.
+/// \param frames Packed frames.
+/// \param atlases Atlases.
+/// \return true if the file was written.
+
+static bool WriteManifest(const char* fname, const vector<PackFrame>& frames,
+  const vector<PackAtlas>& atlases)
+{
+  XMLDocument doc;
+  XMLElement* root = doc.NewElement("atlases");
+  doc.InsertEndChild(root);
+
+  for(int i=0; i<(int)atlases.size(); i++){
+    XMLElement* atlas = doc.NewElement("atlas");
+    atlas->SetAttribute("width", atlases[i].nWidth);
+    atlas->SetAttribute("height", atlases[i].nHeight);
+    root->InsertEndChild(atlas);
+
+    for(const PackFrame& f: frames)
+      if(f.nAtlas == i){
+        XMLElement* frame = doc.NewElement("frame");
+        frame->SetAttribute("index", f.nIndex);
+        frame->SetAttribute("src", f.strFileName.c_str());
+        frame->SetAttribute("x", f.nX);
+        frame->SetAttribute("y", f.nY);
+        frame->SetAttribute("width", f.nWidth);
+        frame->SetAttribute("height", f.nHeight);
+        atlas->InsertEndChild(frame);
+      } //if
+  } //for
+
+  return doc.SaveFile(fname) == XML_SUCCESS;
+} //WriteManifest
+
+/// Print usage and exit.
+
+static void Usage(){
+  fprintf(stderr, "Usage: atlaspacker [-first n] [-last n] [-max size] [-pad n] "
+    "[-align n] [-root dir] settings.xml atlas.xml\n");
+  exit(1);
+} //Usage
+
+int main(int argc, char* argv[]){
+  int first = 3; //first image, skipping the background
+  int last = -1; //last image, -1 for end of list
+  int maxsize = 2048; //maximum atlas size
+  int pad = 2; //padding between frames
+  int align = 1; //frame positions are multiples of this
+  string root; //directory that image names are relative to
+  bool rootset = false;
+  const char* settingsname = nullptr;
+  const char* manifestname = nullptr;
+
+  //parse command line
+  for(int i=1; i<argc; i++){
+    if(!strcmp(argv[i], "-first") && i + 1 < argc)first = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-last") && i + 1 < argc)last = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-max") && i + 1 < argc)maxsize = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-pad") && i + 1 < argc)pad = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-align") && i + 1 < argc)align = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-root") && i + 1 < argc){root = argv[++i]; rootset = true;}
+    else if(argv[i][0] == '-')Usage();
+    else if(!settingsname)settingsname = argv[i];
+    else if(!manifestname)manifestname = argv[i];
+    else Usage();
+  } //for
+
+  if(!settingsname || !manifestname || maxsize <= 0 || pad < 0 || align <= 0)Usage();
+
+  if(!rootset){ //default to directory containing settings file
+    root = settingsname;
+    size_t slash = root.find_last_of("/\\");
+    root = slash == string::npos? "": root.substr(0, slash);
+  } //if
+
+  auto t0 = chrono::steady_clock::now();
+
+  //load settings file
+  XMLDocument doc;
+  if(doc.LoadFile(settingsname) != XML_SUCCESS){
+    fprintf(stderr, "Cannot load settings file %s.\n", settingsname);
+    return 1;
+  } //if
+
+  XMLElement* settings = doc.FirstChildElement("settings");
+  XMLElement* images = settings? settings->FirstChildElement("images"): nullptr;
+  if(images == nullptr){
+    fprintf(stderr, "Cannot find <images> tag in %s.\n", settingsname);
+    return 1;
+  } //if
+
+  //read image sizes
+  vector<PackFrame> frames;
+  int index = 0;
+  long long framearea = 0;
+
+  for(XMLElement* img = images->FirstChildElement("image"); img;
+    img = img->NextSiblingElement("image"), index++)
+  {
+    if(index < first || (last >= 0 && index > last))continue;
+
+    const char* src = img->Attribute("src");
+    if(src == nullptr)continue;
+
+    PackFrame f = {index, src, 0, 0, 0, 0, 0};
+    if(!GetImageSize(MakePath(root, src), f.nWidth, f.nHeight)){
+      fprintf(stderr, "Cannot read image %s.\n", src);
+      return 1;
+    } //if
+
+    framearea += (long long)f.nWidth*f.nHeight;
+    frames.push_back(f);
+  } //for
+
+  if(frames.empty()){
+    fprintf(stderr, "No images to pack.\n");
+    return 1;
+  } //if
+
+  //tallest first, widest first among equals, for tight shelves
+  stable_sort(frames.begin(), frames.end(), [](const PackFrame& a, const PackFrame& b){
+    return a.nHeight != b.nHeight? a.nHeight > b.nHeight: a.nWidth > b.nWidth;
+  });
+
+  //try widths in steps of 64 pixels and keep the smallest total area
+  vector<PackFrame> best;
+  vector<PackAtlas> bestatlases;
+  long long bestarea = -1;
+
+  for(int width=64; width<=maxsize; width+=64){
+    vector<PackFrame> trial = frames;
+    vector<PackAtlas> atlases;
+    if(!Pack(trial, width, maxsize, pad, align, atlases))continue;
+
+    long long area = 0;
+    for(const PackAtlas& a: atlases)
+      area += (long long)a.nWidth*a.nHeight;
+
+    //prefer fewer atlases, then less area
+    if(bestarea < 0 || atlases.size() < bestatlases.size() ||
+      (atlases.size() == bestatlases.size() && area < bestarea))
+    {
+      best = trial; bestatlases = atlases; bestarea = area;
+    } //if
+  } //for
+
+  if(bestarea < 0){
+    fprintf(stderr, "Some image is larger than %d pixels.\n", maxsize);
+    return 1;
+  } //if
+
+  //back into settings file order for a readable manifest
+  sort(best.begin(), best.end(), [](const PackFrame& a, const PackFrame& b){
+    return a.nIndex < b.nIndex;
+  });
+
+  if(!WriteManifest(manifestname, best, bestatlases)){
+    fprintf(stderr, "Cannot write manifest %s.\n", manifestname);
+    return 1;
+  } //if
+
+  auto t1 = chrono::steady_clock::now();
+  const double ms = chrono::duration<double, milli>(t1 - t0).count();
+
+  //report
+  printf("Packed %d frames into %d atlas(es):\n", (int)best.size(), (int)bestatlases.size());
+  for(int i=0; i<(int)bestatlases.size(); i++)
+    printf("  atlas %d: %d x %d\n", i, bestatlases[i].nWidth, bestatlases[i].nHeight);
+  printf("Density %.1f%% (%lld of %lld pixels used)\n",
+    100.0*framearea/bestarea, framearea, bestarea);
+  printf("Packed in %.2f ms\n", ms);
+
+  return 0;
+} //main
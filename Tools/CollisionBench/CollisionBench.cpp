@@ -0,0 +1,282 @@
+/// \file CollisionBench.cpp
+/// \brief Compares brute force collision detection with a spatial hash.
+///
+/// Does the object manager's collision detection two ways, the way it used
+/// to, checking every bullet against every object, and with CSpatialHash,
+/// checking each bullet only against the vulnerable objects near it. The
+/// world wraps around in X, and distances are measured with a copy of the
+/// object manager's distance(), wrap and all. Every collision, and the
+/// order they happen in, must be the same both ways, since the order
+/// decides the order that the next incarnations are created in.
+///
+/// First a fuzz test runs many small random worlds of random widths,
+/// including ones narrower than a cell, with objects scattered well past
+/// the edges of the world, piled up on cell boundaries, and placed a
+/// world width apart. Then the benchmark times one tick of 1000 bullets
+/// and 5000 targets both ways. The speedup it reports is for that many
+/// objects. The fight's hit pass, with at most eight fighters, doesn't use
+/// a spatial hash.
+///
+/// Build with, for example:
+///
+///     g++ -O2 -I../../Code CollisionBench.cpp ../../Code/SpatialHash.cpp -o collisionbench
+///
+/// Usage:
+///
+///     collisionbench [-bullets n] [-targets n] [-ticks n] [-trials n]
+///
+/// Times n ticks (default 50) with n bullets (default 1000) and n targets
+/// (default 5000), after n fuzz trials (default 2000).
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "SpatialHash.h"
+
+using namespace std;
+
+static const float RADIUS = 15.0f; ///< Distance at which objects collide.
+
+/// \brief A stand-in for a game object.
+
+struct CBenchObject{
+  float m_fX; ///< X coordinate.
+  float m_fY; ///< Y coordinate.
+  bool m_bBullet; ///< Whether this is a bullet.
+  bool m_bVulnerable; ///< Whether bullets can hit it.
+}; //CBenchObject
+
+/// \brief A collision, by position in the object list.
+
+struct CHit{
+  int m_nBullet; ///< The bullet.
+  int m_nTarget; ///< What it hit.
+
+  bool operator==(const CHit& h) const{
+    return m_nBullet == h.m_nBullet && m_nTarget == h.m_nTarget;
+  } //operator==
+}; //CHit
+
+static unsigned int g_nSeed = 1; ///< Pseudo-random number seed.
+
+/// \return A pseudo-random number from 0 to 32767.
+
+static int Random(){
+  g_nSeed = g_nSeed*1103515245 + 12345;
+  return (g_nSeed >> 16) & 0x7FFF;
+} //Random
+
+/// \return A pseudo-random float from 0 to 1.
+
+static float RandomFloat(){
+  return Random()/32768.0f;
+} //RandomFloat
+
+/// Distance between objects, exactly as the object manager measures it.
+/// \param g0 First object.
+/// \param g1 Second object.
+/// \param w World width.
+/// \return Distance between the two objects.
+
+static float Distance(const CBenchObject& g0, const CBenchObject& g1, float w){
+  float x = (float)fabs(g0.m_fX - g1.m_fX);
+  float y = (float)fabs(g0.m_fY - g1.m_fY);
+  if(x > w) x -= w;
+  return sqrtf(x*x + y*y);
+} //Distance
+
+/// Check every bullet against every object, as the object manager used to.
+/// \param v Objects.
+/// \param w World width.
+/// \param hits [out] Collisions in the order they happen.
+
+static void BruteForce(const vector<CBenchObject>& v, float w, vector<CHit>& hits){
+  hits.clear();
+  const int n = (int)v.size();
+
+  for(int i=0; i<n; i++)
+    if(v[i].m_bBullet)
+      for(int j=0; j<n; j++)
+        if(v[j].m_bVulnerable && Distance(v[i], v[j], w) < RADIUS){
+          CHit h = {i, j};
+          hits.push_back(h);
+        } //if
+} //BruteForce
+
+/// Check every bullet against the objects near it, as the object manager
+/// does now.
+/// \param v Objects.
+/// \param w World width.
+/// \param hash Spatial hash to use.
+/// \param nearby Space for the objects near a bullet.
+/// \param hits [out] Collisions in the order they happen.
+
+static void Broadphase(const vector<CBenchObject>& v, float w, CSpatialHash& hash,
+  vector<int>& nearby, vector<CHit>& hits)
+{
+  hits.clear();
+  const int n = (int)v.size();
+
+  hash.Clear(w);
+  for(int i=0; i<n; i++)
+    if(v[i].m_bVulnerable)
+      hash.Insert(i, v[i].m_fX, v[i].m_fY);
+  hash.Build();
+
+  for(int i=0; i<n; i++)
+    if(v[i].m_bBullet){
+      hash.Query(v[i].m_fX, v[i].m_fY, nearby);
+
+      for(size_t k=0; k<nearby.size(); k++){
+        const int j = nearby[k];
+        if(v[j].m_bVulnerable && Distance(v[i], v[j], w) < RADIUS){
+          CHit h = {i, j};
+          hits.push_back(h);
+        } //if
+      } //for
+    } //if
+} //Broadphase
+
+/// Make a small random world that is hard on the spatial hash.
+/// \param v [out] Objects.
+/// \return World width.
+
+static float MakeFuzzWorld(vector<CBenchObject>& v){
+  const float w = (Random()%4 == 0)? 1.0f + RandomFloat()*40.0f: 30.0f + RandomFloat()*2000.0f;
+  const int n = 2 + Random()%60;
+  const float cell = w/max(1, (int)(w/(2.0f*RADIUS))); //cell width, as the hash makes it
+  v.resize(n);
+
+  for(int i=0; i<n; i++){
+    CBenchObject& o = v[i];
+    o.m_bBullet = Random()%3 == 0;
+    o.m_bVulnerable = Random()%4 != 0;
+    o.m_fY = (RandomFloat() - 0.5f)*100.0f;
+
+    switch(Random()%4){
+      case 0: //anywhere, including well outside the world
+        o.m_fX = (RandomFloat()*4.0f - 1.5f)*w;
+        break;
+
+      case 1: //on or next to a cell boundary
+        o.m_fX = cell*(Random()%20 - 10) + (Random()%3 - 1)*0.001f;
+        o.m_fY = 2.0f*RADIUS*(Random()%4 - 2);
+        break;
+
+      case 2: //a world width or two from another object, give or take
+        if(i > 0){
+          const CBenchObject& p = v[Random()%i];
+          o.m_fX = p.m_fX + w*(Random()%5 - 2) + (RandomFloat() - 0.5f)*2.0f*RADIUS;
+          o.m_fY = p.m_fY + (RandomFloat() - 0.5f)*2.0f*RADIUS;
+        } //if
+        else o.m_fX = RandomFloat()*w;
+        break;
+
+      default: //close to another object
+        if(i > 0){
+          const CBenchObject& p = v[Random()%i];
+          o.m_fX = p.m_fX + (RandomFloat() - 0.5f)*3.0f*RADIUS;
+          o.m_fY = p.m_fY + (RandomFloat() - 0.5f)*3.0f*RADIUS;
+        } //if
+        else o.m_fX = RandomFloat()*w;
+        break;
+    } //switch
+  } //for
+
+  return w;
+} //MakeFuzzWorld
+
+int main(int argc, char* argv[]){
+  int bullets = 1000, targets = 5000, ticks = 50, trials = 2000;
+
+  for(int i=1; i<argc; i++){
+    const bool more = i + 1 < argc;
+    if(!strcmp(argv[i], "-bullets") && more)bullets = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-targets") && more)targets = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-ticks") && more)ticks = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-trials") && more)trials = atoi(argv[++i]);
+    else{
+      fprintf(stderr, "Unknown option %s.\n", argv[i]);
+      return 2;
+    } //else
+  } //for
+
+  if(bullets < 0 || targets < 0 || ticks <= 0 || trials < 0){
+    fprintf(stderr, "Bad number of bullets, targets, ticks or trials.\n");
+    return 2;
+  } //if
+
+  vector<CBenchObject> v;
+  vector<CHit> vBrute, vHashed;
+  vector<int> vNearby;
+  bool ok = true;
+
+  //fuzz test
+  int nFailures = 0, nHits = 0;
+
+  for(int t=0; t<trials; t++){
+    const float w = MakeFuzzWorld(v);
+    CSpatialHash cHash(RADIUS, 64);
+    BruteForce(v, w, vBrute);
+    Broadphase(v, w, cHash, vNearby, vHashed);
+    nHits += (int)vBrute.size();
+
+    if(vBrute != vHashed){
+      if(nFailures++ == 0)
+        printf("Trial %d, world width %0.2f: %d hits brute force, %d with the hash.\n",
+          t, w, (int)vBrute.size(), (int)vHashed.size());
+      ok = false;
+    } //if
+  } //for
+
+  printf("Fuzz: %d trials, %d hits, %d mismatches.\n", trials, nHits, nFailures);
+
+  //benchmark, in a world the size of the game's with the screen 1024 wide
+  const float w = 2.0f*1024.0f;
+  const int n = bullets + targets;
+  v.resize(n);
+
+  for(int i=0; i<n; i++){
+    v[i].m_fX = (RandomFloat() - 0.5f)*w;
+    v[i].m_fY = RandomFloat()*768.0f;
+    v[i].m_bBullet = (long long)i*bullets/n != (long long)(i + 1)*bullets/n; //spread evenly
+    v[i].m_bVulnerable = !v[i].m_bBullet;
+  } //for
+
+  int nBullets = 0;
+  for(int i=0; i<n; i++)
+    nBullets += v[i].m_bBullet;
+
+  CSpatialHash cHash(RADIUS, 2*n);
+  cHash.Reserve(n);
+  vNearby.reserve(n);
+  double fBruteBest = 1e9, fHashBest = 1e9; //fastest tick in microseconds
+
+  for(int t=0; t<ticks; t++){
+    for(int i=0; i<n; i++) //everything moves a little
+      v[i].m_fX += (RandomFloat() - 0.5f)*4.0f;
+
+    auto t0 = chrono::steady_clock::now();
+    BruteForce(v, w, vBrute);
+    auto t1 = chrono::steady_clock::now();
+    Broadphase(v, w, cHash, vNearby, vHashed);
+    auto t2 = chrono::steady_clock::now();
+
+    fBruteBest = min(fBruteBest, chrono::duration<double, micro>(t1 - t0).count());
+    fHashBest = min(fHashBest, chrono::duration<double, micro>(t2 - t1).count());
+    if(vBrute != vHashed)ok = false;
+  } //for
+
+  printf("%d bullets, %d targets, %d hits a tick.\n", nBullets, n - nBullets, (int)vBrute.size());
+  printf("Brute force %0.1f us, spatial hash %0.1f us, speedup %0.1fx.\n",
+    fBruteBest, fHashBest, fHashBest > 0.0? fBruteBest/fHashBest: 0.0);
+
+  if(!ok)printf("Failed.\n");
+  return ok? 0: 1;
+} //main
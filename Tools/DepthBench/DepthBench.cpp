@@ -0,0 +1,194 @@
+/// \file DepthBench.cpp
+/// \brief Compares ways of putting objects in draw order each frame.
+///
+/// Times a frame's depth sort two ways: the way the object manager used
+/// to, sorting a list of object pointers on Z every frame, and with
+/// CDepthOrder, which keeps last frame's order and fixes it up. Each is
+/// run for 100, 1000 and 10000 objects, in three kinds of scene: one where
+/// nothing moves in depth, one where a few objects drift a little each
+/// frame, as they do in a game, and one where every object jumps to a
+/// random depth each frame, which makes CDepthOrder fall back to its
+/// radix sort. Both sorts are stable, so both must produce exactly the
+/// same order every frame, or the benchmark fails.
+///
+/// Build with, for example:
+///
+///     g++ -O2 -I../../Code DepthBench.cpp ../../Code/DepthOrder.cpp -o depthbench
+///
+/// Usage:
+///
+///     depthbench [-frames n]
+///
+/// Runs n frames (default 300) of each scene. The fastest frame is
+/// reported, since it is the one least disturbed by whatever else the
+/// machine is doing.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "DepthOrder.h"
+
+using namespace std;
+
+/// \brief A stand-in for a game object.
+
+struct CBenchObject{
+  float m_fZ; ///< Depth.
+  ObjectHandle m_nHandle; ///< Which object this is.
+}; //CBenchObject
+
+/// Comparison for depth sorting, as the object manager had.
+/// \param p0 Pointer to object 0.
+/// \param p1 Pointer to object 1.
+/// \return true If object 0 is behind object 1.
+
+static bool ZCompare(const CBenchObject* p0, const CBenchObject* p1){
+  return p0->m_fZ > p1->m_fZ;
+} //ZCompare
+
+/// Kinds of scene.
+
+enum SceneType{
+  STILL_SCENE, DRIFT_SCENE, SHUFFLE_SCENE, NUM_SCENES
+}; //SceneType
+
+static const char* g_szSceneName[NUM_SCENES] = {"still", "drift", "shuffle"}; ///< Names of scenes.
+
+static unsigned int g_nSeed = 1; ///< Pseudo-random number seed.
+
+/// \return A pseudo-random number from 0 to 32767.
+
+static int Random(){
+  g_nSeed = g_nSeed*1103515245 + 12345;
+  return (g_nSeed >> 16) & 0x7FFF;
+} //Random
+
+/// Change the depths of objects for the next frame. In a drift scene 2%
+/// of the objects move a step forward or back. Depths are whole numbers
+/// from a small range, so that there are plenty of ties to test stability.
+/// \param v Objects.
+/// \param scene Kind of scene.
+
+static void MoveObjects(vector<CBenchObject>& v, SceneType scene){
+  const int n = (int)v.size();
+
+  switch(scene){
+    case STILL_SCENE: break;
+
+    case DRIFT_SCENE:
+      for(int k=0; k<n/50 + 1; k++){
+        float& z = v[Random()*n/32768].m_fZ;
+        z += (Random() & 1)? 1.0f: -1.0f;
+      } //for
+      break;
+
+    case SHUFFLE_SCENE:
+      for(int i=0; i<n; i++)
+        v[i].m_fZ = (float)(Random()%1000 - 500);
+      break;
+
+    default: break;
+  } //switch
+} //MoveObjects
+
+/// Run one scene with one number of objects.
+/// \param n Number of objects.
+/// \param scene Kind of scene.
+/// \param frames Number of frames.
+/// \return true if both ways agreed on every frame.
+
+static bool RunScene(int n, SceneType scene, int frames){
+  vector<CBenchObject> vObject(n);
+  for(int i=0; i<n; i++){
+    vObject[i].m_fZ = (float)(Random()%1000 - 500);
+    vObject[i].m_nHandle = (ObjectHandle)(i + 1);
+  } //for
+
+  list<CBenchObject*> stlList; //the old way
+  CDepthOrder cOrder; //the new way
+  cOrder.Reserve(n);
+
+  for(int i=0; i<n; i++){
+    stlList.push_front(&vObject[i]);
+    cOrder.Insert(vObject[i].m_nHandle, vObject[i].m_fZ);
+  } //for
+
+  double fListBest = 1e9, fOrderBest = 1e9; //fastest frame in microseconds
+  double fListTime = 0.0, fOrderTime = 0.0; //in microseconds
+  bool ok = true;
+
+  for(int f=0; f<frames; f++){
+    MoveObjects(vObject, scene);
+
+    auto t0 = chrono::steady_clock::now();
+    stlList.sort(ZCompare);
+    auto t1 = chrono::steady_clock::now();
+
+    //objects are found by handle, as the object manager does
+    for(int i=0; i<n; i++)
+      cOrder.SetDepth(i, vObject[cOrder.GetHandle(i) - 1].m_fZ);
+    cOrder.Sort();
+    auto t2 = chrono::steady_clock::now();
+
+    const double fList = chrono::duration<double, micro>(t1 - t0).count();
+    const double fOrder = chrono::duration<double, micro>(t2 - t1).count();
+    fListTime += fList; fListBest = min(fListBest, fList);
+    fOrderTime += fOrder; fOrderBest = min(fOrderBest, fOrder);
+
+    int i = 0;
+    for(auto p: stlList)
+      if(p->m_nHandle != cOrder.GetHandle(i++))
+        ok = false;
+  } //for
+
+  printf("%6d %-8s list %9.1f us %9.1f us   order %9.1f us %9.1f us   %5.1fx   %d/%d radix\n",
+    n, g_szSceneName[scene], fListBest, fListTime/frames, fOrderBest, fOrderTime/frames,
+    fOrderBest > 0.0? fListBest/fOrderBest: 0.0, cOrder.GetRadixSorts(), cOrder.GetSorts());
+
+  return ok;
+} //RunScene
+
+int main(int argc, char* argv[]){
+  int frames = 300;
+
+  for(int i=1; i<argc; i++){
+    const bool more = i + 1 < argc;
+    if(!strcmp(argv[i], "-frames") && more)frames = atoi(argv[++i]);
+    else{
+      fprintf(stderr, "Unknown option %s.\n", argv[i]);
+      return 2;
+    } //else
+  } //for
+
+  if(frames <= 0){
+    fprintf(stderr, "Bad number of frames.\n");
+    return 2;
+  } //if
+
+  printf("     n scene           best frame, mean           best frame, mean   speedup\n");
+  bool ok = true;
+
+  for(int n=100; n<=10000; n*=10)
+    for(int s=0; s<NUM_SCENES; s++)
+      if(!RunScene(n, (SceneType)s, frames)){
+        printf("%d objects, %s scene: the two orders differ.\n", n, g_szSceneName[s]);
+        ok = false;
+      } //if
+
+  //keys must order far to near, with -0 and +0 the same
+  const float z[] = {1e30f, 500.0f, 1.0f, 0.5f, 0.0f, -0.5f, -1.0f, -500.0f, -1e30f};
+  for(size_t i=1; i<sizeof(z)/sizeof(z[0]); i++)
+    if(CDepthOrder::GetKey(z[i - 1]) >= CDepthOrder::GetKey(z[i]))
+      ok = false;
+  if(CDepthOrder::GetKey(0.0f) != CDepthOrder::GetKey(-0.0f))ok = false;
+
+  if(!ok)printf("Failed.\n");
+  return ok? 0: 1;
+} //main
@@ -0,0 +1,190 @@
+/// \file DeterminismCheck.cpp
+/// \brief Checks that the simulation gives the same result in every build.
+///
+/// Plays out fights between two teams of four in the game's own fight
+/// simulation, CSimulation, with the game's arena, frames and default
+/// hitboxes, and keys pressed for both teams from a pseudo-random script:
+/// walking, jumping, punching, kicking and tagging. One fight is in
+/// tag-team mode and one has every fighter in play at once. The state is
+/// checksummed after every tick, and the checksum after the last tick of
+/// each fight must match the one this check was written with, so any
+/// change to the compiler, its flags, or the machine that changes even one
+/// bit of the simulation fails it. It also checks a few properties of the
+/// fixed-point arithmetic that the simulation relies on.
+///
+/// Build with, for example:
+///
+///     g++ -O2 -I../../Code DeterminismCheck.cpp ../../Code/Simulation.cpp
+///       ../../Code/EntityStore.cpp ../../Code/FighterAnimator.cpp ../../Code/HitBoxes.cpp
+///       ../../Code/Fixed.cpp ../../Code/Checksum.cpp ../../Code/tinyxml2.cpp -o determinismcheck
+///
+/// and again with other flags, such as -O0, -O3 -march=native -ffast-math,
+/// or -mfpmath=387 on x86, and with other compilers. Every build must pass,
+/// and their logs must be identical.
+///
+/// Usage:
+///
+///     determinismcheck [-ticks n] [-log file]
+///
+/// Runs n ticks of each fight (default 36000, ten minutes of play). The
+/// expected checksums are only known for the default. With -log, the
+/// checksum after every tick is written to a file, one "fight,tick,checksum"
+/// line per tick, so that diffing the logs of two builds finds the first
+/// tick they differ.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Simulation.h"
+
+using namespace std;
+
+static const int DEFAULT_TICKS = 36000; ///< Ticks run by default.
+
+/// \brief A fight to play out, and its checksum after the default number of ticks.
+
+struct Fight{
+  const char* szName; ///< Name to print.
+  bool bTagTeam; ///< Whether one fighter per team is in play at a time.
+  unsigned nGolden; ///< Checksum after the default number of ticks.
+}; //Fight
+
+static const Fight g_pFights[] = {
+  {"tag-team", true, 0x1ed669f7},
+  {"all-in", false, 0x629d634a},
+}; //g_pFights
+
+static const int TEAM_SIZE = 4; ///< Fighters on each team.
+
+static unsigned int g_nSeed = 1; ///< Pseudo-random number seed.
+
+/// \return A pseudo-random number from 0 to 32767.
+
+static int Random(){
+  g_nSeed = g_nSeed*1103515245 + 12345;
+  return (g_nSeed >> 16) & 0x7FFF;
+} //Random
+
+/// Make up the keys a team presses for a tick, as the game's keyboard
+/// handler would take them.
+/// \return Keys pressed, FighterInput bits.
+
+static NetInput RandomInput(){
+  const int r = Random();
+
+  switch(r%8){
+    case 0: case 1: case 2: return r & 8? RIGHT_INPUT: LEFT_INPUT;
+    case 3: return JUMP_INPUT;
+    case 4: return PUNCH_INPUT;
+    case 5: return KICK_INPUT;
+    case 6: return (r & 0x70) == 0? TAG_INPUT: 0; //tag now and then
+    default: return 0; //no key this tick
+  } //switch
+} //RandomInput
+
+/// Play out a fight.
+/// \param boxes Hitboxes.
+/// \param fight Fight to play out.
+/// \param ticks Number of ticks to run.
+/// \param output Log file, nullptr for none.
+/// \param hits [out] Number of hits landed.
+/// \return Checksum after the last tick.
+
+static unsigned PlayFight(CHitBoxes& boxes, const Fight& fight, int ticks, FILE* output,
+  long long& hits)
+{
+  g_nSeed = 1;
+  hits = 0;
+
+  CSimulation cFight;
+  cFight.Create(boxes, TEAM_SIZE, fight.bTagTeam);
+
+  for(int t=1; t<=ticks; t++){
+    NetInput input[NUM_TEAMS];
+    for(int team=0; team<NUM_TEAMS; team++)
+      input[team] = RandomInput();
+
+    cFight.Tick(input);
+    hits += cFight.GetHitsLanded();
+
+    if(output)fprintf(output, "%s,%d,%08x\n", fight.szName, t, cFight.GetChecksum());
+  } //for
+
+  return cFight.GetChecksum();
+} //PlayFight
+
+/// Check the fixed-point arithmetic.
+/// \return true if it behaves as the simulation expects.
+
+static bool CheckArithmetic(){
+  bool ok = FixedSin(0) == 0 && FixedSin(ANGLE_TURN/4) == FIXED_ONE;
+  ok = ok && FixedCos(0) == FIXED_ONE && FixedSin(ANGLE_TURN/2) == 0;
+  ok = ok && FixedSin(3*ANGLE_TURN/4) == -FIXED_ONE && FixedCos(ANGLE_TURN/2) == -FIXED_ONE;
+
+  for(int a=-ANGLE_TURN; a<=ANGLE_TURN && ok; a+=7){
+    const fixed s = FixedSin(a), c = FixedCos(a);
+    const fixed r = FixedMul(s, s) + FixedMul(c, c); //should be 1
+    ok = FixedSin(-a) == -s && FixedCos(-a) == c && FixedSin(a + ANGLE_TURN) == s;
+    ok = ok && abs(r - FIXED_ONE) <= 16 && abs(s) <= FIXED_ONE && abs(c) <= FIXED_ONE;
+  } //for
+
+  ok = ok && FixedMul(IntToFixed(3), FIXED_ONE/2) == 3*FIXED_ONE/2;
+  ok = ok && FixedMul(-1, FIXED_ONE/2) == -1 && FixedMul(1, FIXED_ONE/2) == 0; //rounds down
+  ok = ok && FixedDiv(IntToFixed(3), IntToFixed(2)) == 3*FIXED_ONE/2;
+  ok = ok && FloatToFixed(0.5f) == FIXED_ONE/2 && FloatToFixed(-20.25f) == -81*FIXED_ONE/4;
+  ok = ok && FixedToFloat(3*FIXED_ONE/4) == 0.75f;
+  return ok;
+} //CheckArithmetic
+
+int main(int argc, char* argv[]){
+  int ticks = DEFAULT_TICKS;
+  const char* log = nullptr;
+
+  for(int i=1; i<argc; i++){
+    const bool more = i + 1 < argc;
+    if(!strcmp(argv[i], "-ticks") && more)ticks = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-log") && more)log = argv[++i];
+    else{
+      fprintf(stderr, "Unknown option %s.\n", argv[i]);
+      return 2;
+    } //else
+  } //for
+
+  if(ticks <= 0){
+    fprintf(stderr, "Bad number of ticks.\n");
+    return 2;
+  } //if
+
+  FILE* output = nullptr;
+  if(log && (output = fopen(log, "wt")) == nullptr){
+    fprintf(stderr, "Cannot open %s.\n", log);
+    return 2;
+  } //if
+
+  bool ok = CheckArithmetic();
+  if(!ok)printf("Fixed-point arithmetic is wrong.\n");
+
+  CHitBoxes cBoxes; //empty, so the fight gets the game's default hitboxes
+
+  for(const Fight& f: g_pFights){
+    long long nHits = 0;
+    const unsigned nChecksum = PlayFight(cBoxes, f, ticks, output, nHits);
+    printf("%s: %d ticks, %lld hits landed, checksum %08x.\n", f.szName, ticks, nHits, nChecksum);
+
+    if(ticks == DEFAULT_TICKS && nChecksum != f.nGolden){
+      printf("Expected checksum %08x.\n", f.nGolden);
+      ok = false;
+    } //if
+
+    if(nHits == 0){ //then hits aren't being checked at all
+      printf("No hits were landed.\n");
+      ok = false;
+    } //if
+  } //for
+
+  if(output)fclose(output);
+
+  if(!ok)printf("Failed.\n");
+  return ok? 0: 1;
+} //main
@@ -0,0 +1,237 @@
+/// \file EntityBench.cpp
+/// \brief Measures the cost of a simulation tick in the entity store.
+///
+/// Simulates the same fighters two ways and times a tick of each: in
+/// CEntityStore, with a column per component, and the way CGameObject used
+/// to, with a heap object per fighter that remembers its location, jumps
+/// and animates itself one object at a time. Fighters start jumps at
+/// pseudo-random times, the same ones both ways, and the two must end up
+/// in exactly the same place, state and frame, or the benchmark fails.
+///
+/// Build with, for example:
+///
+///     g++ -O3 -I../../Code EntityBench.cpp ../../Code/EntityStore.cpp
+///       ../../Code/FighterAnimator.cpp ../../Code/Checksum.cpp -o entitybench
+///
+/// Usage:
+///
+///     entitybench [-entities n] [-ticks n]
+///
+/// Runs n entities (default 10000) for n ticks (default 600). The mean and
+/// the fastest tick are both reported, since the fastest is the one least
+/// disturbed by whatever else the machine is doing. It also checks that a
+/// fighter jumps all the way up twice in a row.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+
+#include "EntityStore.h"
+
+using namespace std;
+
+static const fixed GROUND = IntToFixed(300); ///< Height of the floor.
+static const fixed APEX = IntToFixed(350); ///< Height at which a jump starts to fall.
+
+/// \brief A fighter as a heap object, the way CGameObject was.
+
+struct CObjectFighter{
+  fixed m_vPos[3]; ///< Current location.
+  fixed m_vLastPos[3]; ///< Location at the start of the last tick.
+  fixed m_vVelocity[3]; ///< Current velocity, unused but carried along.
+  int m_nLastMoveTime; ///< Last time moved, likewise.
+  fixed m_nJumpSpeed; ///< Vertical speed while jumping, per tick.
+  CFighterAnimator m_cAnimator; ///< Animation state machine.
+
+  void beginTick(){
+    memcpy(m_vLastPos, m_vPos, sizeof(m_vPos));
+  } //beginTick
+
+  void jump(){
+    if(m_vPos[1] <= APEX && m_vPos[1] >= GROUND){
+      m_nJumpSpeed += FIXED_ONE;
+      m_vPos[1] += m_nJumpSpeed;
+    } //if
+    if(m_vPos[1] > APEX){
+      m_nJumpSpeed -= FIXED_ONE;
+      m_vPos[1] += m_nJumpSpeed;
+    } //if
+    if(m_vPos[1] <= GROUND){ //landed
+      m_vPos[1] = GROUND;
+      m_nJumpSpeed = 0;
+    } //if
+  } //jump
+
+  void animate(){
+    m_cAnimator.Tick(m_vPos[1] - GROUND);
+  } //animate
+}; //CObjectFighter
+
+/// Check that a fighter can jump twice in a row. It jumps, and as soon as
+/// it is back on the floor and may jump again, it does. Both jumps must get
+/// above the apex and come back down to the floor.
+/// \param frames Frame numbers for the fighter's animations.
+/// \param arena Floor and walls.
+/// \return true if both jumps went all the way up.
+
+static bool TwoJumps(const FighterFrames& frames, const ArenaDesc& arena){
+  CEntityStore cStore;
+  cStore.SetArena(arena);
+
+  EntityDesc d;
+  d.nX = IntToFixed(100); d.nY = GROUND; d.nZ = 0;
+  d.nFacing = 1;
+  d.nSprite = 0;
+  d.bActive = true;
+  d.cFrames = frames;
+  const EntityHandle h = cStore.Create(d);
+
+  for(int j=0; j<2; j++){
+    int t = 0; //ticks waited for the jump to start
+
+    while(!cStore.Jump(h) && t++ < 100) //may be refused while landing
+      cStore.Simulate();
+
+    fixed top = GROUND; //highest point of this jump
+
+    for(t=0; t<1000 && (t == 0 || cStore.GetPosY()[cStore.GetRow(h)] != GROUND); t++){
+      cStore.Simulate();
+      top = max(top, cStore.GetPosY()[cStore.GetRow(h)]);
+    } //for
+
+    if(top <= APEX || cStore.GetPosY()[cStore.GetRow(h)] != GROUND){
+      printf("Jump %d reached %d and ended at %d.\n", j + 1,
+        top >> FIXED_SHIFT, cStore.GetPosY()[cStore.GetRow(h)] >> FIXED_SHIFT);
+      return false;
+    } //if
+  } //for
+
+  return true;
+} //TwoJumps
+
+int main(int argc, char* argv[]){
+  int entities = 10000, ticks = 600;
+
+  for(int i=1; i<argc; i++){
+    const bool more = i + 1 < argc;
+    if(!strcmp(argv[i], "-entities") && more)entities = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-ticks") && more)ticks = atoi(argv[++i]);
+    else{
+      fprintf(stderr, "Unknown option %s.\n", argv[i]);
+      return 2;
+    } //else
+  } //for
+
+  if(entities <= 0 || entities > 65535 || ticks <= 0){
+    fprintf(stderr, "Bad number of entities or ticks.\n");
+    return 2;
+  } //if
+
+  const FighterFrames cFrames = {3, {3, 3}, 3, 16, 14, 15, 12, 13};
+  const ArenaDesc cArena = {0, IntToFixed(30000), IntToFixed(35), GROUND, APEX};
+
+  CEntityStore cStore;
+  cStore.SetArena(cArena);
+  vector<EntityHandle> vHandle;
+  vector<unique_ptr<CObjectFighter>> vObject;
+
+  for(int i=0; i<entities; i++){
+    EntityDesc d;
+    d.nX = IntToFixed(10*(i%3000)); d.nY = GROUND; d.nZ = 0;
+    d.nFacing = i%2? 1: -1;
+    d.nSprite = i%2;
+    d.bActive = true;
+    d.cFrames = cFrames;
+    vHandle.push_back(cStore.Create(d));
+
+    CObjectFighter* p = new CObjectFighter;
+    p->m_vPos[0] = d.nX; p->m_vPos[1] = d.nY; p->m_vPos[2] = d.nZ;
+    memcpy(p->m_vLastPos, p->m_vPos, sizeof(p->m_vPos));
+    p->m_vVelocity[0] = p->m_vVelocity[2] = 0; p->m_vVelocity[1] = IntToFixed(2);
+    p->m_nLastMoveTime = 0;
+    p->m_nJumpSpeed = 0;
+    p->m_cAnimator.SetFrames(cFrames);
+    vObject.push_back(unique_ptr<CObjectFighter>(p));
+  } //for
+
+  double fStoreTime = 0.0, fObjectTime = 0.0; //in microseconds
+  double fStoreBest = 1e9, fObjectBest = 1e9; //fastest tick in microseconds
+  unsigned int seed = 1;
+
+  for(int t=0; t<ticks; t++){
+    //about 1% of fighters try to start a jump each tick, between ticks as keys would
+    for(int k=0; k<entities/100 + 1; k++){
+      seed = seed*1103515245 + 12345;
+      const int i = (seed >> 8)%entities;
+
+      cStore.Jump(vHandle[i]);
+
+      CObjectFighter* p = vObject[i].get();
+      if(p->m_cAnimator.Jump())p->jump();
+    } //for
+
+    auto t0 = chrono::steady_clock::now();
+    cStore.Simulate();
+    auto t1 = chrono::steady_clock::now();
+
+    for(auto& p: vObject){
+      p->beginTick();
+      if(p->m_vPos[1] != GROUND)
+        p->jump();
+      p->animate();
+    } //for
+
+    auto t2 = chrono::steady_clock::now();
+    const double fStore = chrono::duration<double, micro>(t1 - t0).count();
+    const double fObject = chrono::duration<double, micro>(t2 - t1).count();
+    fStoreTime += fStore; fStoreBest = min(fStoreBest, fStore);
+    fObjectTime += fObject; fObjectBest = min(fObjectBest, fObject);
+  } //for
+
+  //both ways must agree exactly
+  int nMismatches = 0, nAirborne = 0;
+  const fixed* y = cStore.GetPosY();
+  const fixed* lasty = cStore.GetLastY();
+  const int* frame = cStore.GetFrame();
+  const unsigned char* state = cStore.GetState();
+
+  for(int i=0; i<entities; i++){
+    const int r = cStore.GetRow(vHandle[i]);
+    const CObjectFighter* p = vObject[i].get();
+    if(y[r] != GROUND)nAirborne++;
+
+    if(y[r] != p->m_vPos[1] || lasty[r] != p->m_vLastPos[1] ||
+      frame[r] != p->m_cAnimator.GetFrame() || state[r] != p->m_cAnimator.GetState())
+      nMismatches++;
+  } //for
+
+  const double n = (double)entities*ticks;
+  printf("%d entities, %d ticks, %d airborne at the end.\n", entities, ticks, nAirborne);
+  printf("Entity store: mean %0.1f us a tick, %0.2f ns an entity, best %0.1f us.\n",
+    fStoreTime/ticks, fStoreTime*1000.0/n, fStoreBest);
+  printf("Heap objects: mean %0.1f us a tick, %0.2f ns an entity, best %0.1f us.\n",
+    fObjectTime/ticks, fObjectTime*1000.0/n, fObjectBest);
+  printf("Speedup %0.2fx mean, %0.2fx best.\n",
+    fStoreTime > 0.0? fObjectTime/fStoreTime: 0.0, fStoreBest > 0.0? fObjectBest/fStoreBest: 0.0);
+
+  //handles to destroyed entities must go stale, and rows stay packed
+  bool ok = nMismatches == 0;
+  cStore.Destroy(vHandle[0]);
+  if(cStore.IsValid(vHandle[0]) || cStore.GetCount() != entities - 1)ok = false;
+  if(entities > 1 && cStore.GetRow(vHandle[entities - 1]) != 0)ok = false;
+  cStore.Clear();
+  if(cStore.GetCount() != 0 || cStore.IsValid(vHandle[entities - 1]))ok = false;
+
+  //a fighter that has landed must be able to jump again
+  if(!TwoJumps(cFrames, cArena))ok = false;
+
+  if(nMismatches > 0)
+    printf("%d entities differ between the two.\n", nMismatches);
+  if(!ok)printf("Failed.\n");
+
+  return ok? 0: 1;
+} //main
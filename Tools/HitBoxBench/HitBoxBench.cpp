@@ -0,0 +1,268 @@
+/// \file HitBoxBench.cpp
+/// \brief Measures the throughput of the hitbox tester.
+///
+/// Loads hitboxes and hurtboxes for a few frames from XML, the way the game
+/// does from its settings, and checks that they were compiled correctly.
+/// Then plays out ticks with 8 fighters, four a side, punching and kicking
+/// at random, and 500 projectiles flying back and forth through them, and
+/// times CHitBoxes finding the hits. The same hits are found by a plain
+/// scalar loop over every pair of boxes, which is timed too, and the two
+/// must agree exactly, event for event, or the benchmark fails.
+///
+/// Build with, for example:
+///
+///     g++ -O2 -I../../Code HitBoxBench.cpp ../../Code/HitBoxes.cpp
+///       ../../Code/tinyxml2.cpp -o hitboxbench
+///
+/// Usage:
+///
+///     hitboxbench [-ticks n] [-projectiles n]
+///
+/// Runs n ticks (default 2000) with n projectiles (default 500). The mean
+/// and the fastest tick are both reported.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "HitBoxes.h"
+
+using namespace std;
+
+/// Frames, as they would be in the frame cache.
+
+enum BenchFrame{
+  IDLE_FRAME, PUNCH_FRAME, KICK_FRAME, PROJECTILE_FRAME, NUM_FRAMES
+}; //BenchFrame
+
+/// Boxes for each frame, in the same form as in the game's settings.
+
+static const char* g_szSettings =
+  "<settings>"
+  "  <hitboxes>"
+  "    <frame index=\"0\">"
+  "      <hurtbox back=\"-20\" front=\"20.5\" bottom=\"-64\" top=\"48\"/>"
+  "      <hurtbox back=\"-12\" front=\"12\" bottom=\"48\" top=\"64\"/>"
+  "    </frame>"
+  "    <frame index=\"1\">"
+  "      <hurtbox back=\"-20\" front=\"20\" bottom=\"-64\" top=\"48\"/>"
+  "      <hitbox back=\"0\" front=\"30\" bottom=\"0\" top=\"40\"/>"
+  "      <hitbox back=\"20\" front=\"40\" bottom=\"20\" top=\"30\"/>"
+  "    </frame>"
+  "    <frame index=\"2\">"
+  "      <hurtbox back=\"-20\" front=\"20\" bottom=\"-64\" top=\"48\"/>"
+  "      <hitbox back=\"0\" front=\"35\" bottom=\"-50\" top=\"0\"/>"
+  "      <hitbox back=\"1\" front=\"1\" bottom=\"0\" top=\"9\"/>"
+  "    </frame>"
+  "    <frame index=\"3\">"
+  "      <hitbox back=\"-4\" front=\"8\" bottom=\"-4\" top=\"4\"/>"
+  "      <hurtbox back=\"-4\" front=\"4\" bottom=\"-4\" top=\"4\"/>"
+  "    </frame>"
+  "  </hitboxes>"
+  "</settings>";
+
+/// \brief A fighter or projectile.
+
+struct CBenchBody{
+  unsigned nId; ///< Identifier.
+  int nTeam; ///< Team.
+  int nFrame; ///< Frame showing.
+  fixed nX, nY; ///< Location.
+  int nFacing; ///< 1 for right, -1 for left.
+  bool bStriking; ///< Whether its hitboxes are live.
+}; //CBenchBody
+
+static unsigned int g_nSeed = 1; ///< Pseudo-random number seed.
+
+/// \return A pseudo-random number from 0 to 32767.
+
+static int Random(){
+  g_nSeed = g_nSeed*1103515245 + 12345;
+  return (g_nSeed >> 16) & 0x7FFF;
+} //Random
+
+/// Get the edges of a box in the world, as CHitBoxes does.
+/// \param b Box.
+/// \param o Body showing it.
+/// \param edge [out] Left, bottom, right and top.
+
+static void GetEdges(const HitBox& b, const CBenchBody& o, fixed edge[4]){
+  edge[0] = o.nFacing > 0? o.nX + b.nBack: o.nX - b.nFront;
+  edge[1] = o.nY + b.nBottom;
+  edge[2] = o.nFacing > 0? o.nX + b.nFront: o.nX - b.nBack;
+  edge[3] = o.nY + b.nTop;
+} //GetEdges
+
+/// Find hits the plain way, checking every hitbox against every hurtbox.
+/// \param boxes Compiled boxes.
+/// \param v Bodies.
+/// \param events [out] Hit events, one per attacker and defender.
+
+static void FindHitsScalar(const CHitBoxes& boxes, const vector<CBenchBody>& v,
+  vector<HitEvent>& events)
+{
+  events.clear();
+
+  for(const CBenchBody& a: v){
+    if(!a.bStriking)continue;
+    const size_t start = events.size();
+    const HitBox* hit = boxes.GetBoxes(a.nFrame, HIT_BOX);
+
+    for(int i=0; i<boxes.GetBoxCount(a.nFrame, HIT_BOX); i++){
+      fixed h[4];
+      GetEdges(hit[i], a, h);
+
+      for(const CBenchBody& d: v){
+        if(d.nTeam == a.nTeam)continue;
+        const HitBox* hurt = boxes.GetBoxes(d.nFrame, HURT_BOX);
+
+        for(int j=0; j<boxes.GetBoxCount(d.nFrame, HURT_BOX); j++){
+          fixed e[4];
+          GetEdges(hurt[j], d, e);
+          if(!(h[0] < e[2] && e[0] < h[2] && h[1] < e[3] && e[1] < h[3]))continue;
+
+          bool seen = false;
+          for(size_t k=start; k<events.size(); k++)
+            seen = seen || events[k].nDefender == d.nId;
+
+          if(!seen){
+            HitEvent ev = {a.nId, d.nId, i};
+            events.push_back(ev);
+          } //if
+        } //for
+      } //for
+    } //for
+  } //for
+} //FindHitsScalar
+
+/// Check that the boxes were compiled as written.
+/// \param boxes Compiled boxes.
+/// \return true if they were.
+
+static bool CheckLoad(const CHitBoxes& boxes){
+  bool ok = boxes.GetBoxCount(HIT_BOX) == 4 && boxes.GetBoxCount(HURT_BOX) == 5;
+  ok = ok && boxes.GetBoxCount(IDLE_FRAME, HURT_BOX) == 2;
+  ok = ok && boxes.GetBoxCount(IDLE_FRAME, HIT_BOX) == 0;
+  ok = ok && boxes.GetBoxCount(PUNCH_FRAME, HIT_BOX) == 2;
+  ok = ok && boxes.GetBoxCount(KICK_FRAME, HIT_BOX) == 1; //the empty one is dropped
+  ok = ok && boxes.GetBoxCount(NUM_FRAMES, HURT_BOX) == 0 && boxes.GetBoxCount(-1, HIT_BOX) == 0;
+
+  const HitBox* b = boxes.GetBoxes(PUNCH_FRAME, HIT_BOX);
+  ok = ok && b && b[0].nFront == IntToFixed(30) && b[1].nBack == IntToFixed(20) &&
+    b[1].nTop == IntToFixed(30);
+  b = boxes.GetBoxes(IDLE_FRAME, HURT_BOX);
+  ok = ok && b && b[1].nBottom == IntToFixed(48) && b[0].nFront == FloatToFixed(20.5f);
+  return ok;
+} //CheckLoad
+
+int main(int argc, char* argv[]){
+  int ticks = 2000, projectiles = 500;
+
+  for(int i=1; i<argc; i++){
+    const bool more = i + 1 < argc;
+    if(!strcmp(argv[i], "-ticks") && more)ticks = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-projectiles") && more)projectiles = atoi(argv[++i]);
+    else{
+      fprintf(stderr, "Unknown option %s.\n", argv[i]);
+      return 2;
+    } //else
+  } //for
+
+  if(ticks <= 0 || projectiles < 0){
+    fprintf(stderr, "Bad number of ticks or projectiles.\n");
+    return 2;
+  } //if
+
+  XMLDocument doc;
+  if(doc.Parse(g_szSettings) != 0){
+    printf("Cannot parse settings.\n");
+    return 1;
+  } //if
+
+  CHitBoxes cBoxes;
+  bool ok = cBoxes.Load(doc.FirstChildElement("settings"));
+  if(!CheckLoad(cBoxes)){
+    printf("Boxes were not loaded correctly.\n");
+    ok = false;
+  } //if
+
+  //four fighters a side in an arena 400 wide, and projectiles all over it
+  vector<CBenchBody> v;
+
+  for(int i=0; i<8; i++){
+    const int team = i%2;
+    CBenchBody b = {(unsigned)i + 1, team, IDLE_FRAME,
+      IntToFixed(team? 500 + 20*(i/2): 460 - 20*(i/2)), IntToFixed(300), team? -1: 1, false};
+    v.push_back(b);
+  } //for
+
+  for(int i=0; i<projectiles; i++){
+    const int team = i%2;
+    CBenchBody b = {(unsigned)(1000 + i), team, PROJECTILE_FRAME,
+      IntToFixed(300 + Random()%400), IntToFixed(240 + Random()%120), team? -1: 1, true};
+    v.push_back(b);
+  } //for
+
+  vector<HitEvent> vSimd, vScalar;
+  double fSimdTime = 0.0, fScalarTime = 0.0; //in microseconds
+  double fSimdBest = 1e9, fScalarBest = 1e9; //fastest tick in microseconds
+  long long nEvents = 0;
+  int nMismatches = 0;
+
+  for(int t=0; t<ticks; t++){
+    for(size_t i=0; i<v.size(); i++){
+      CBenchBody& b = v[i];
+
+      if(b.nFrame == PROJECTILE_FRAME){ //fly, wrapping around the arena
+        b.nX += 3*FIXED_ONE*b.nFacing;
+        if(b.nX > IntToFixed(700))b.nX -= IntToFixed(400);
+        if(b.nX < IntToFixed(300))b.nX += IntToFixed(400);
+      } //if
+
+      else if(Random()%16 == 0){ //fighters attack, stop, and shuffle about
+        b.nFrame = Random()%3;
+        b.bStriking = b.nFrame != IDLE_FRAME;
+        b.nX += (Random()%5 - 2)*FIXED_ONE/2;
+      } //else if
+    } //for
+
+    auto t0 = chrono::steady_clock::now();
+    cBoxes.BeginTick();
+    for(const CBenchBody& b: v)
+      cBoxes.AddBody(b.nId, b.nTeam, b.nFrame, b.nX, b.nY, b.nFacing, b.bStriking);
+    cBoxes.FindHits(vSimd);
+    auto t1 = chrono::steady_clock::now();
+    FindHitsScalar(cBoxes, v, vScalar);
+    auto t2 = chrono::steady_clock::now();
+
+    const double fSimd = chrono::duration<double, micro>(t1 - t0).count();
+    const double fScalar = chrono::duration<double, micro>(t2 - t1).count();
+    fSimdTime += fSimd; fSimdBest = min(fSimdBest, fSimd);
+    fScalarTime += fScalar; fScalarBest = min(fScalarBest, fScalar);
+    nEvents += vSimd.size();
+
+    bool same = vSimd.size() == vScalar.size();
+    for(size_t i=0; same && i<vSimd.size(); i++)
+      same = vSimd[i].nAttacker == vScalar[i].nAttacker &&
+        vSimd[i].nDefender == vScalar[i].nDefender && vSimd[i].nBox == vScalar[i].nBox;
+    if(!same)nMismatches++;
+  } //for
+
+  printf("%d bodies, %d ticks, %0.1f hits a tick.\n", (int)v.size(), ticks, (double)nEvents/ticks);
+  printf("Hitbox tester: mean %0.1f us a tick, best %0.1f us.\n", fSimdTime/ticks, fSimdBest);
+  printf("Scalar loop: mean %0.1f us a tick, best %0.1f us.\n", fScalarTime/ticks, fScalarBest);
+  printf("Speedup %0.2fx mean, %0.2fx best.\n",
+    fSimdTime > 0.0? fScalarTime/fSimdTime: 0.0, fSimdBest > 0.0? fScalarBest/fSimdBest: 0.0);
+
+  if(nMismatches > 0){
+    printf("%d ticks had different hits.\n", nMismatches);
+    ok = false;
+  } //if
+
+  if(!ok)printf("Failed.\n");
+  return ok? 0: 1;
+} //main
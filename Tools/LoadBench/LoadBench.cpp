@@ -0,0 +1,154 @@
+/// \file LoadBench.cpp
+/// \brief Benchmark for the game's startup asset loading.
+///
+/// Loads the images and sounds that the game loads at startup with the
+/// game's own asset loader, CAssetLoader, but without a window or a device,
+/// and prints for each asset how long it took to read and to decode and
+/// when it reached the main thread. The assets are loaded once with a single
+/// worker thread, which is as good as loading them one after another, and
+/// once with the given number of workers, so that the two totals show how
+/// much the pool overlaps reading with decoding. Images that the texture
+/// compressor has made DDS files for are read from those, as the game does.
+///
+/// The asset loader decodes images with WIC, so this is a Windows program.
+/// Build it from a Visual Studio command prompt with, for example:
+///
+///     cl /O2 /EHsc /I..\..\Code /I<DirectXTK>\Inc LoadBench.cpp ..\..\Code\AssetLoader.cpp
+///       ..\..\Code\ImageFileNameList.cpp ..\..\Code\tinyxml2.cpp ole32.lib windowscodecs.lib
+///
+/// and run it from the game's directory.
+///
+/// Usage:
+///
+///     loadbench [-settings file.xml] [-textures file.xml] [-threads n]
+///
+/// The settings file (default gamesettings.xml) lists the images, and the
+/// texture manifest (default textures.xml) the DDS files made from them.
+/// The pool has n workers (default 0, one per hardware thread). The first
+/// run may be slower to read than the second, since the second finds the
+/// files in the operating system's cache; run it twice to see both.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+
+#include "AssetLoader.h"
+#include "ImageFileNameList.h"
+
+/// Sound files, as loaded in WinMain.
+
+static const char* g_szSoundFile[] = {
+  "Sounds\\PUNCH.wav", "Sounds\\kick.wav", "Sounds\\theme.wav", "Sounds\\jump.wav"};
+
+static const int NUMSOUNDS = sizeof(g_szSoundFile)/sizeof(g_szSoundFile[0]); ///< Number of sounds.
+
+/// Read the texture compressor's manifest, as CRenderer::LoadTextureManifest does.
+/// \param fname Manifest file name.
+/// \param dds Receives the DDS file name for each image file name.
+
+static void ReadTextureManifest(const char* fname, map<string, string>& dds){
+  tinyxml2::XMLDocument doc;
+  if(doc.LoadFile(fname) != 0)return; //no manifest, no compressed textures
+
+  XMLElement* root = doc.FirstChildElement("textures");
+  if(root == nullptr)return;
+
+  for(XMLElement* tag = root->FirstChildElement("texture"); tag;
+    tag = tag->NextSiblingElement("texture"))
+  {
+    const char* src = tag->Attribute("src");
+    const char* file = tag->Attribute("dds");
+    if(src && file)
+      dds[src] = file;
+  } //for
+} //ReadTextureManifest
+
+/// Load every asset with an asset loader, printing a line for each.
+/// \param images Image file name list.
+/// \param dds DDS file name for each image that has one.
+/// \param threads Number of worker threads.
+/// \return Number of assets that failed to load.
+
+static int LoadAll(CImageFileNameList& images, const map<string, string>& dds, int threads){
+  static const char* kind[] = {"image", "dds", "sound"};
+
+  auto t0 = chrono::steady_clock::now();
+  CAssetLoader loader(threads);
+
+  for(int i=0; i<images.GetCount(); i++){
+    auto it = dds.find(images[i]);
+    if(it != dds.end())loader.QueueDDS(i, it->second.c_str());
+    else loader.QueueImage(i, images[i]);
+  } //for
+  for(int i=0; i<NUMSOUNDS; i++)
+    loader.QueueSound(i, g_szSoundFile[i]);
+
+  int failed = 0;
+  double read = 0.0, decode = 0.0;
+
+  loader.Finish([&](LoadedAsset& asset){
+    const double ready = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    printf("  %-5s %-40s %9u bytes  read %7.2f ms  decode %7.2f ms  ready at %8.2f ms%s\n",
+      kind[asset.nType], asset.strFileName.c_str(), (unsigned)asset.nDataBytes,
+      asset.fReadTime, asset.fDecodeTime, ready, asset.bSucceeded? "": "  FAILED");
+
+    read += asset.fReadTime;
+    decode += asset.fDecodeTime;
+    if(!asset.bSucceeded)failed++;
+  });
+
+  const double total = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+  printf("%d assets with %d threads in %0.2f ms (reads %0.2f ms, decodes %0.2f ms, %d failed).\n",
+    images.GetCount() + NUMSOUNDS, threads, total, read, decode, failed);
+
+  return failed;
+} //LoadAll
+
+int main(int argc, char* argv[]){
+  const char* settingsfile = "gamesettings.xml";
+  const char* texturefile = "textures.xml";
+  int threads = 0;
+
+  for(int i=1; i<argc; i++){
+    const bool more = i + 1 < argc;
+    if(!strcmp(argv[i], "-settings") && more)settingsfile = argv[++i];
+    else if(!strcmp(argv[i], "-textures") && more)texturefile = argv[++i];
+    else if(!strcmp(argv[i], "-threads") && more)threads = atoi(argv[++i]);
+    else{
+      fprintf(stderr, "Unknown option %s.\n", argv[i]);
+      return 2;
+    } //else
+  } //for
+
+  if(threads <= 0)
+    threads = max(1, (int)thread::hardware_concurrency());
+
+  tinyxml2::XMLDocument settings;
+  XMLElement* root = nullptr;
+  if(settings.LoadFile(settingsfile) == 0)
+    root = settings.FirstChildElement("settings");
+
+  if(root == nullptr){
+    fprintf(stderr, "Cannot load settings from %s.\n", settingsfile);
+    return 2;
+  } //if
+
+  CImageFileNameList images;
+  images.GetImageFileNames(root);
+
+  map<string, string> dds;
+  ReadTextureManifest(texturefile, dds);
+
+  printf("One at a time:\n");
+  const int failed = LoadAll(images, dds, 1);
+
+  printf("Pool:\n");
+  LoadAll(images, dds, threads);
+
+  return failed > 0? 1: 0;
+} //main
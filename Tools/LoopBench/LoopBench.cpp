@@ -0,0 +1,171 @@
+/// \file LoopBench.cpp
+/// \brief Runs the game loop on the headless platform, without Windows.
+///
+/// Drives CGameLoop on CHeadlessPlatform with a key script, handling keys
+/// the way the game does for its two fighters' animation state machines,
+/// and checks that the loop's timing is exact: every key is delivered at
+/// the time the script gives, every tick runs when it is due, and no
+/// frame ever has to catch up. Then reports how long it all took in real
+/// time. The fighters' positions aren't simulated, since CGameObject needs
+/// Direct3D, but everything between the platform and the fighters'
+/// animators is the game's own code.
+///
+/// Build with, for example:
+///
+///     g++ -O2 -I../../Code LoopBench.cpp ../../Code/GameLoop.cpp ../../Code/Platform.cpp
+///       ../../Code/HeadlessPlatform.cpp ../../Code/FixedTimestep.cpp ../../Code/Timer.cpp
+///       ../../Code/FighterAnimator.cpp -o loopbench
+///
+/// Usage:
+///
+///     loopbench [-seconds n] [-keys n] [-script file]
+///
+/// Runs n seconds of simulated time (default 600), with n keys pressed at
+/// pseudo-random times (default 10 a second), or with the keys in a script
+/// file, one "time key" pair per line with the time in microseconds.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "GameLoop.h"
+#include "HeadlessPlatform.h"
+#include "FighterAnimator.h"
+
+using namespace std;
+
+static CFighterAnimator g_cRight; ///< Right fighter, on the arrow keys, K and L.
+static CFighterAnimator g_cLeft; ///< Left fighter, on W, A, D, F and G.
+
+/// Handle a key as the game's keyboard handler does, as far as the
+/// fighters' animators go. Both fighters are taken to be in reach.
+/// \param key Key code.
+/// \return true if the game is to exit.
+
+static bool HandleKey(int key){
+  switch(key){
+    case KEY_ESCAPE: return true;
+
+    case KEY_LEFT: case KEY_RIGHT: g_cRight.Walk(); break;
+    case KEY_UP: g_cRight.Jump(); break;
+    case 'K': if(g_cRight.Kick())g_cLeft.Hit(KICK_STATE); break;
+    case 'L': if(g_cRight.Punch())g_cLeft.Hit(PUNCH_STATE); break;
+
+    case 'A': case 'D': g_cLeft.Walk(); break;
+    case 'W': g_cLeft.Jump(); break;
+    case 'G': if(g_cLeft.Kick())g_cRight.Hit(KICK_STATE); break;
+    case 'F': if(g_cLeft.Punch())g_cRight.Hit(PUNCH_STATE); break;
+  } //switch
+
+  return false;
+} //HandleKey
+
+int main(int argc, char* argv[]){
+  int seconds = 600, keys = -1;
+  const char* script = nullptr;
+
+  for(int i=1; i<argc; i++){
+    const bool more = i + 1 < argc;
+    if(!strcmp(argv[i], "-seconds") && more)seconds = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-keys") && more)keys = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-script") && more)script = argv[++i];
+    else{
+      fprintf(stderr, "Unknown option %s.\n", argv[i]);
+      return 2;
+    } //else
+  } //for
+
+  if(seconds <= 0){
+    fprintf(stderr, "Bad number of seconds.\n");
+    return 2;
+  } //if
+
+  const long long END = seconds*1000000LL; //simulated time to quit
+  if(keys < 0)keys = seconds*10;
+
+  CHeadlessPlatform cPlatform;
+  CFixedTimestep cTimestep(60);
+  CTimer cTimer;
+  cTimer.start();
+
+  if(script){
+    if(!cPlatform.LoadScript(script)){
+      fprintf(stderr, "Cannot load script %s.\n", script);
+      return 2;
+    } //if
+  } //if
+
+  else{ //keys the game knows, pressed at pseudo-random times
+    const int cKey[] = {KEY_LEFT, KEY_RIGHT, KEY_UP, 'K', 'L', 'A', 'D', 'W', 'F', 'G'};
+    const int n = sizeof(cKey)/sizeof(cKey[0]);
+    unsigned int seed = 1;
+
+    for(int i=0; i<keys; i++){
+      seed = seed*1103515245 + 12345;
+      const long long t = (long long)((seed >> 8)/(double)(1 << 24)*END);
+      cPlatform.AddKey(t, cKey[(seed >> 4)%n]);
+    } //for
+  } //else
+
+  cPlatform.SetEndTime(END);
+  cPlatform.CreateGameWindow("LoopBench", 1024, 768);
+
+  const long long TICK = cTimestep.GetTickLength();
+  int nTicks = 0, nKeys = 0, nLateKeys = 0, nLateTicks = 0;
+  long long nLastTick = 0; //time last tick was due
+
+  CGameLoop cLoop(cPlatform, cTimestep, cTimer);
+  auto t0 = chrono::steady_clock::now();
+
+  cLoop.Run(
+    [&](int key, long long t){
+      nKeys++;
+      if(cPlatform.Now() != t)nLateKeys++;
+      return HandleKey(key);
+    },
+
+    [&](){
+      nTicks++;
+      g_cRight.Tick(0);
+      g_cLeft.Tick(0);
+    },
+
+    [&](int ticks, long long t){
+      if(ticks == 0)return;
+      if(t != nLastTick + ticks*TICK || t != cPlatform.Now())nLateTicks++;
+      nLastTick = t;
+    });
+
+  const double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+
+  const int expected = (int)((cPlatform.Now() - 1)/TICK); //every tick due before quitting
+  const TimestepStats& s = cTimestep.GetStats();
+  CTimeHistogram& k = cLoop.GetKeyTimes();
+  CTimeHistogram& f = cTimer.ticks();
+
+  printf("%d ticks and %d keys in %0.1f s simulated, %0.1f ms real, %0.0fx real time.\n",
+    nTicks, nKeys, cPlatform.Now()/1e6, elapsed, elapsed > 0? cPlatform.Now()/1e3/elapsed: 0.0);
+  printf("%d passes through the loop, %d catch-up frames.\n", cLoop.GetFrameCount(), s.nCatchUpFrames);
+  printf("Tick p50 %lld p99 %lld max %lld us, key p50 %lld p99 %lld max %lld us.\n",
+    f.GetPercentile(50), f.GetPercentile(99), f.GetMax(),
+    k.GetPercentile(50), k.GetPercentile(99), k.GetMax());
+  printf("Right fighter %s, left fighter %s.\n",
+    CFighterAnimator::GetStateName(g_cRight.GetState()),
+    CFighterAnimator::GetStateName(g_cLeft.GetState()));
+
+  bool ok = true;
+
+  if(nTicks != expected){
+    printf("Ran %d ticks, expected %d.\n", nTicks, expected);
+    ok = false;
+  } //if
+
+  if(nLateKeys > 0 || nLateTicks > 0 || s.nCatchUpFrames > 0){
+    printf("%d keys and %d ticks were late.\n", nLateKeys, nLateTicks);
+    ok = false;
+  } //if
+
+  return ok? 0: 1;
+} //main
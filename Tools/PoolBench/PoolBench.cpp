@@ -0,0 +1,395 @@
+/// \file PoolBench.cpp
+/// \brief Checks that nothing touches the heap during a match.
+///
+/// First it plays a fight with the game's own CSimulation, saving the
+/// state on every tick and rolling back now and then as a network session
+/// does, and counts every call to operator new. The fighters live in the
+/// rows of an entity store and the saves are copies of the simulation, so
+/// once the first few seconds have warmed them up the count must not
+/// change, or the benchmark fails. This is everything the game allocates
+/// while a fight is on.
+///
+/// Then it plays out a match's worth of bullets and explosions with a
+/// CObjectPool for each type, the way the object manager would, and checks
+/// the same of it. The owner of the pools keeps a pointer beside each
+/// handle in its list of live objects, since an object never moves in its
+/// pool, so only handles that come from elsewhere are checked. Looking up
+/// every handle on every use made the pooled match twice as slow as new
+/// and delete; with the pointers the two take about the same time. It also
+/// checks that handles to dead objects are caught as stale, even after
+/// their slots have been reused, and that a full pool fails cleanly. Then
+/// it plays the same match with new and delete for comparison, and reports
+/// both times.
+///
+/// Build with, for example:
+///
+///     g++ -O2 -I../../Code PoolBench.cpp ../../Code/ObjectPool.cpp ../../Code/Simulation.cpp
+///       ../../Code/EntityStore.cpp ../../Code/FighterAnimator.cpp ../../Code/HitBoxes.cpp
+///       ../../Code/Fixed.cpp ../../Code/Checksum.cpp ../../Code/tinyxml2.cpp -o poolbench
+///
+/// Usage:
+///
+///     poolbench [-ticks n] [-rate n]
+///
+/// Runs n ticks (default 36000, ten minutes at 60 Hz), firing n bullets a
+/// tick (default 4).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+
+#include "ObjectPool.h"
+#include "Simulation.h"
+
+using namespace std;
+
+static long long g_nAllocations = 0; ///< Number of calls to operator new.
+
+void* operator new(size_t size){
+  g_nAllocations++;
+  void* p = malloc(size? size: 1);
+  if(p == nullptr)throw bad_alloc();
+  return p;
+} //operator new
+
+void operator delete(void* p) noexcept{
+  free(p);
+} //operator delete
+
+void operator delete(void* p, size_t) noexcept{
+  free(p);
+} //operator delete
+
+/// Types of object, as the object manager has.
+
+enum BenchObjectType{
+  BULLET_OBJECT, EXPLOSION_OBJECT, NUM_OBJECT_TYPES
+}; //BenchObjectType
+
+/// \brief A stand-in for a game object.
+
+struct CBenchObject{
+  int m_nObjectType; ///< Bullet or explosion.
+  float m_vPos[3]; ///< Location.
+  float m_vVelocity[3]; ///< Velocity.
+  int m_nBirthTime; ///< Tick it was made.
+  int m_nLifeTime; ///< Ticks it lives for.
+  bool m_bIsDead; ///< Whether it is to be collected.
+
+  CBenchObject(int type, float x, float v, int t, int life):
+    m_nObjectType(type), m_nBirthTime(t), m_nLifeTime(life), m_bIsDead(false)
+  {
+    m_vPos[0] = x; m_vPos[1] = m_vPos[2] = 0.0f;
+    m_vVelocity[0] = v; m_vVelocity[1] = m_vVelocity[2] = 0.0f;
+  } //constructor
+}; //CBenchObject
+
+const int BULLET_LIFE = 90; ///< Ticks a bullet flies for if it hits nothing.
+const int EXPLOSION_LIFE = 24; ///< Ticks an explosion lasts.
+const int CAPACITY[NUM_OBJECT_TYPES] = {512, 256}; ///< Pool sizes.
+
+const int TEAM_SIZE = 4; ///< Fighters on each team.
+const int STATE_SLOTS = 9; ///< Saved states, one for each tick a rollback can go back.
+const int WARM_UP = 600; ///< Ticks before allocations are counted, ten seconds at 60 Hz.
+
+static unsigned int g_nSeed = 1; ///< Pseudo-random number seed.
+
+/// \return A pseudo-random number from 0 to 32767.
+
+static int Random(){
+  g_nSeed = g_nSeed*1103515245 + 12345;
+  return (g_nSeed >> 16) & 0x7FFF;
+} //Random
+
+/// Make up the keys a team presses for a tick.
+/// \return Keys pressed, FighterInput bits.
+
+static NetInput RandomInput(){
+  const int r = Random();
+
+  switch(r%8){
+    case 0: case 1: case 2: return r & 8? RIGHT_INPUT: LEFT_INPUT;
+    case 3: return JUMP_INPUT;
+    case 4: return PUNCH_INPUT;
+    case 5: return KICK_INPUT;
+    case 6: return (r & 0x70) == 0? TAG_INPUT: 0; //tag now and then
+    default: return 0; //no key this tick
+  } //switch
+} //RandomInput
+
+/// Play a tag-team fight on the game's simulation, saving the state on
+/// every tick and now and then loading one saved a few ticks back and
+/// running on from there, as a rollback does.
+/// \param ticks Number of ticks.
+/// \return Number of heap allocations after the warm-up.
+
+static long long PlayFight(int ticks){
+  CHitBoxes cBoxes;
+  CSimulation cFight;
+  cFight.Create(cBoxes, TEAM_SIZE, true);
+
+  vector<CSimulation> vSaved(STATE_SLOTS);
+  vector<bool> bSaved(STATE_SLOTS, false);
+  long long nBefore = g_nAllocations;
+
+  for(int t=0; t<ticks; t++){
+    if(t == WARM_UP)nBefore = g_nAllocations;
+
+    const int slot = cFight.GetTick()%STATE_SLOTS;
+    vSaved[slot] = cFight;
+    bSaved[slot] = true;
+
+    NetInput input[NUM_TEAMS];
+    for(int team=0; team<NUM_TEAMS; team++)
+      input[team] = RandomInput();
+    cFight.Tick(input);
+
+    const int back = (cFight.GetTick() + STATE_SLOTS - 4)%STATE_SLOTS; //4 ticks back
+    if(t%7 == 0 && bSaved[back])
+      cFight = vSaved[back]; //roll back
+  } //for
+
+  return g_nAllocations - nBefore;
+} //PlayFight
+
+/// \brief A live object, as its owner keeps it.
+
+struct LiveObject{
+  ObjectHandle m_hObject; ///< Handle, for freeing it and for handing out.
+  CBenchObject* m_pObject; ///< Where it is in its pool, which never moves.
+}; //LiveObject
+
+/// \brief A match played with object pools and handles.
+
+class CPooledMatch{
+  private:
+    CObjectPool* m_pPool[NUM_OBJECT_TYPES]; ///< Pool for each object type.
+    vector<LiveObject> m_vObjects; ///< Live objects.
+
+  public:
+    int m_nCreated = 0; ///< Objects made.
+    int m_nRefused = 0; ///< Objects not made because a pool was full.
+
+    CPooledMatch(){
+      for(int i=0; i<NUM_OBJECT_TYPES; i++)
+        m_pPool[i] = new CObjectPool(i, CAPACITY[i], sizeof(CBenchObject));
+      m_vObjects.reserve(CAPACITY[BULLET_OBJECT] + CAPACITY[EXPLOSION_OBJECT]);
+    } //constructor
+
+    ~CPooledMatch(){
+      for(auto& l: m_vObjects)Destroy(l.m_hObject);
+      for(int i=0; i<NUM_OBJECT_TYPES; i++)
+        delete m_pPool[i];
+    } //destructor
+
+    CBenchObject* Get(ObjectHandle h){
+      const int t = CObjectPool::GetHandleType(h);
+      return t < NUM_OBJECT_TYPES? (CBenchObject*)m_pPool[t]->Get(h): nullptr;
+    } //Get
+
+    ObjectHandle Create(int type, float x, float v, int t, int life){
+      ObjectHandle h;
+      void* p = m_pPool[type]->Allocate(h);
+      if(p == nullptr){m_nRefused++; return NULL_OBJECT;}
+      m_vObjects.push_back({h, new(p) CBenchObject(type, x, v, t, life)});
+      m_nCreated++;
+      return h;
+    } //Create
+
+    void Destroy(ObjectHandle h){
+      CBenchObject* p = Get(h);
+      if(p == nullptr)return;
+      p->~CBenchObject();
+      m_pPool[CObjectPool::GetHandleType(h)]->Free(h);
+    } //Destroy
+
+    void Tick(int t){
+      const size_t n = m_vObjects.size(); //not the ones made as we go
+      size_t kept = 0; //live objects moved down so far
+
+      for(size_t i=0; i<n; i++){
+        const LiveObject l = m_vObjects[i];
+        CBenchObject* p = l.m_pObject; //its own list, so no need to check the handle
+        p->m_vPos[0] += p->m_vVelocity[0];
+
+        if(t - p->m_nBirthTime >= p->m_nLifeTime || //died of old age, or...
+          (p->m_nObjectType == BULLET_OBJECT && p->m_vPos[0] > 1000.0f)){ //...hit the target
+          if(p->m_nObjectType == BULLET_OBJECT) //next incarnation
+            Create(EXPLOSION_OBJECT, p->m_vPos[0], 0.0f, t, EXPLOSION_LIFE);
+          p->~CBenchObject();
+          m_pPool[p->m_nObjectType]->Free(l.m_hObject);
+        } //if
+
+        else m_vObjects[kept++] = l;
+      } //for
+
+      m_vObjects.erase(m_vObjects.begin() + kept, m_vObjects.begin() + n);
+    } //Tick
+
+    int GetCount() const{return (int)m_vObjects.size();}
+    CObjectPool* GetPool(int type){return m_pPool[type];}
+}; //CPooledMatch
+
+/// \brief The same match played with new and delete, as the object manager used to.
+
+class CHeapMatch{
+  private:
+    vector<CBenchObject*> m_vObjects; ///< Live objects.
+
+  public:
+    ~CHeapMatch(){
+      for(auto p: m_vObjects)delete p;
+    } //destructor
+
+    void Create(int type, float x, float v, int t, int life){
+      m_vObjects.push_back(new CBenchObject(type, x, v, t, life));
+    } //Create
+
+    void Tick(int t){
+      const size_t n = m_vObjects.size();
+      size_t kept = 0;
+
+      for(size_t i=0; i<n; i++){
+        CBenchObject* p = m_vObjects[i];
+        p->m_vPos[0] += p->m_vVelocity[0];
+
+        if(t - p->m_nBirthTime >= p->m_nLifeTime ||
+          (p->m_nObjectType == BULLET_OBJECT && p->m_vPos[0] > 1000.0f)){
+          if(p->m_nObjectType == BULLET_OBJECT)
+            Create(EXPLOSION_OBJECT, p->m_vPos[0], 0.0f, t, EXPLOSION_LIFE);
+          delete p;
+        } //if
+
+        else m_vObjects[kept++] = p;
+      } //for
+
+      m_vObjects.erase(m_vObjects.begin() + kept, m_vObjects.begin() + n);
+    } //Tick
+}; //CHeapMatch
+
+/// Check that stale handles are caught, including after the generation of
+/// a slot wraps around.
+/// \return true if they all were.
+
+static bool CheckHandles(){
+  CObjectPool cPool(3, 2, sizeof(CBenchObject));
+  bool ok = true;
+
+  ObjectHandle a, b, c;
+  cPool.Allocate(a);
+  cPool.Allocate(b);
+  if(cPool.Allocate(c) != nullptr || c != NULL_OBJECT || cPool.GetFailures() != 1)
+    ok = false; //full pool must fail cleanly
+
+  if(CObjectPool::GetHandleType(a) != 3 || a == b || !cPool.IsValid(a))ok = false;
+
+  cPool.Free(a);
+  if(cPool.IsValid(a) || cPool.Get(a) != nullptr || cPool.Free(a))
+    ok = false; //stale handle, freed twice
+
+  ObjectHandle d;
+  cPool.Allocate(d); //reuses a's slot
+  if(d == a || cPool.IsValid(a) || !cPool.IsValid(d) || cPool.Get(d) == nullptr)
+    ok = false;
+
+  //reuse one slot until its generation wraps, which must never make a null handle
+  for(int i=0; i<70000; i++){
+    cPool.Free(d);
+    cPool.Allocate(d);
+    if(d == NULL_OBJECT)ok = false;
+  } //for
+
+  if(cPool.IsValid(NULL_OBJECT) || cPool.IsValid(b + 1))ok = false;
+  return ok;
+} //CheckHandles
+
+int main(int argc, char* argv[]){
+  int ticks = 36000, rate = 4;
+
+  for(int i=1; i<argc; i++){
+    const bool more = i + 1 < argc;
+    if(!strcmp(argv[i], "-ticks") && more)ticks = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-rate") && more)rate = atoi(argv[++i]);
+    else{
+      fprintf(stderr, "Unknown option %s.\n", argv[i]);
+      return 2;
+    } //else
+  } //for
+
+  if(ticks <= 0 || rate <= 0){
+    fprintf(stderr, "Bad number of ticks or bullets.\n");
+    return 2;
+  } //if
+
+  bool ok = CheckHandles();
+  if(!ok)printf("Stale handles were not caught.\n");
+
+  //the game's own fight, with rollbacks
+  const long long nFight = PlayFight(ticks);
+  printf("Fight: %lld heap allocations after the first %d ticks.\n", nFight, WARM_UP);
+
+  if(nFight != 0){
+    printf("Fight allocated from the heap.\n");
+    ok = false;
+  } //if
+
+  //pooled match, counting allocations from the first tick on
+  long long nDuring = 0, nHeap = 0;
+  chrono::steady_clock::time_point t0, t1, t2, t3;
+
+  {
+    CPooledMatch cPooled;
+    const long long nBefore = g_nAllocations;
+    int nMax = 0; //most objects at once
+    t0 = chrono::steady_clock::now();
+
+    for(int t=0; t<ticks; t++){
+      for(int k=0; k<rate; k++)
+        cPooled.Create(BULLET_OBJECT, 0.0f, 5.0f + (t*7 + k*3)%11, t, BULLET_LIFE);
+      cPooled.Tick(t);
+      nMax = max(nMax, cPooled.GetCount());
+    } //for
+
+    t1 = chrono::steady_clock::now();
+    nDuring = g_nAllocations - nBefore;
+
+    printf("Pooled: %d objects made, %d refused, at most %d at once, "
+      "high water %d bullets and %d explosions.\n",
+      cPooled.m_nCreated, cPooled.m_nRefused, nMax,
+      cPooled.GetPool(BULLET_OBJECT)->GetHighWater(),
+      cPooled.GetPool(EXPLOSION_OBJECT)->GetHighWater());
+    printf("Pooled: %lld heap allocations during the match.\n", nDuring);
+  }
+
+  //the same match on the heap
+  {
+    CHeapMatch cHeap;
+    const long long nBefore = g_nAllocations;
+    t2 = chrono::steady_clock::now();
+
+    for(int t=0; t<ticks; t++){
+      for(int k=0; k<rate; k++)
+        cHeap.Create(BULLET_OBJECT, 0.0f, 5.0f + (t*7 + k*3)%11, t, BULLET_LIFE);
+      cHeap.Tick(t);
+    } //for
+
+    t3 = chrono::steady_clock::now();
+    nHeap = g_nAllocations - nBefore;
+    printf("Heap: %lld heap allocations during the match.\n", nHeap);
+  }
+
+  const double fPooled = chrono::duration<double, milli>(t1 - t0).count();
+  const double fHeap = chrono::duration<double, milli>(t3 - t2).count();
+  printf("%d ticks: pooled %0.2f ms, heap %0.2f ms.\n", ticks, fPooled, fHeap);
+
+  if(nDuring != 0){ //the point of the exercise
+    printf("Pooled match allocated from the heap.\n");
+    ok = false;
+  } //if
+
+  return ok? 0: 1;
+} //main
@@ -0,0 +1,138 @@
+/// \file ProfileBench.cpp
+/// \brief Microbenchmark for the cost of a profiling zone.
+///
+/// Times an empty loop, a loop with a PROFILE_ZONE in it while profiling is
+/// off, and the same loop while profiling is on, nested two deep so that
+/// the ring buffer wraps and every zone has a parent. The difference from
+/// the empty loop is the cost of a zone. Fails if a zone costs 50 ns or
+/// more when recording, or 5 ns or more when not.
+///
+/// Build with, for example:
+///
+///     g++ -O2 -I../../Code ProfileBench.cpp ../../Code/Profiler.cpp -o profilebench -pthread
+///
+/// Usage:
+///
+///     profilebench [-zones n] [-threads n] [-trace file]
+///
+/// Times n zones (default 10000000) on each of the given number of threads
+/// (default 1), and writes the last of them to a Chrome trace file if asked.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "Profiler.h"
+
+using namespace std;
+
+static volatile int g_nSink = 0; ///< Keeps the loops from being optimized away.
+
+/// The loop body, the same in all three loops.
+/// \param i Loop counter.
+
+static inline void Work(int i){
+  g_nSink = i;
+} //Work
+
+/// Time a loop with nothing in it but the work.
+/// \param n Number of iterations.
+/// \return Time taken in nanoseconds.
+
+static double EmptyLoop(int n){
+  auto t0 = chrono::steady_clock::now();
+  for(int i=0; i<n; i++)
+    Work(i);
+  return chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count();
+} //EmptyLoop
+
+/// Time a loop with a zone around the work, nested in an outer zone every
+/// 16 iterations.
+/// \param n Number of iterations.
+/// \return Time taken in nanoseconds.
+
+static double ZoneLoop(int n){
+  auto t0 = chrono::steady_clock::now();
+  for(int i=0; i<n; i+=16){
+    PROFILE_ZONE("Outer");
+    for(int j=i; j<i+16 && j<n; j++){
+      PROFILE_ZONE("Inner");
+      Work(j);
+    } //for
+  } //for
+  return chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count();
+} //ZoneLoop
+
+/// Run a loop on several threads at once.
+/// \param loop Loop to run.
+/// \param threads Number of threads.
+/// \param n Number of iterations on each thread.
+/// \return Mean time taken by a thread in nanoseconds.
+
+static double RunThreads(double (*loop)(int), int threads, int n){
+  vector<double> t(threads);
+  vector<thread> workers;
+
+  for(int i=0; i<threads; i++)
+    workers.push_back(thread([&, i](){t[i] = loop(n);}));
+  for(int i=0; i<threads; i++)
+    workers[i].join();
+
+  double total = 0.0;
+  for(int i=0; i<threads; i++)
+    total += t[i];
+  return total/threads;
+} //RunThreads
+
+int main(int argc, char* argv[]){
+  int zones = 10000000, threads = 1;
+  const char* trace = nullptr;
+
+  for(int i=1; i<argc; i++){
+    const bool more = i + 1 < argc;
+    if(!strcmp(argv[i], "-zones") && more)zones = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-threads") && more)threads = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-trace") && more)trace = argv[++i];
+    else{
+      fprintf(stderr, "Unknown option %s.\n", argv[i]);
+      return 2;
+    } //else
+  } //for
+
+  if(zones <= 0 || threads <= 0){
+    fprintf(stderr, "Bad zone or thread count.\n");
+    return 2;
+  } //if
+
+  //a zone and a sixteenth of an outer zone per iteration
+  const double perzone = 1.0 + 1.0/16.0;
+
+  RunThreads(ZoneLoop, threads, zones/10 + 1); //warm up, and make the thread buffers
+
+  const double empty = RunThreads(EmptyLoop, threads, zones);
+
+  g_cProfiler.Enable(false);
+  const double off = RunThreads(ZoneLoop, threads, zones);
+
+  g_cProfiler.Enable(true);
+  const double on = RunThreads(ZoneLoop, threads, zones);
+  g_cProfiler.Enable(false);
+
+  const double offcost = (off - empty)/zones/perzone;
+  const double oncost = (on - empty)/zones/perzone;
+
+  printf("%d zones on %d thread%s: empty loop %0.2f ns, zone off %0.2f ns, zone on %0.2f ns.\n",
+    zones, threads, threads > 1? "s": "", empty/zones, offcost, oncost);
+
+  if(trace){
+    if(g_cProfiler.WriteTrace(trace))
+      printf("Wrote %s.\n", trace);
+    else fprintf(stderr, "Cannot write %s.\n", trace);
+  } //if
+
+  return oncost < 50.0 && offcost < 5.0? 0: 1;
+} //main
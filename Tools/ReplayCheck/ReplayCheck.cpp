@@ -0,0 +1,259 @@
+/// \file ReplayCheck.cpp
+/// \brief Checks replays and replays them as fast as they will go.
+///
+/// Runs the fight in the game's own fight simulation, CSimulation, which
+/// needs no Windows, so that replays recorded by the game with -record can
+/// be played on any machine. Given a replay, it plays it
+/// a number of times, checks the state against every checksum in it, and
+/// reports the number of ticks run a second on the fastest pass, which is
+/// the benchmark for a change to the simulation.
+///
+/// Given no replay, it plays a match from a pseudo-random script of keys,
+/// records it with CReplayWriter, and checks that CReplayReader reads back
+/// exactly the keys that were pressed and a checksum for every second
+/// that matches the one the match had. It checks that a replay cut short,
+/// as by a crash, is read as far as its last whole record. Then it replays
+/// the match as fast as it will go, and must end with the same checksum.
+///
+/// Build with, for example:
+///
+///     g++ -O2 -I../../Code ReplayCheck.cpp ../../Code/Replay.cpp ../../Code/Simulation.cpp
+///       ../../Code/EntityStore.cpp ../../Code/FighterAnimator.cpp ../../Code/HitBoxes.cpp
+///       ../../Code/Fixed.cpp ../../Code/Checksum.cpp ../../Code/tinyxml2.cpp -o replaycheck
+///
+/// Usage:
+///
+///     replaycheck [-ticks n] [-passes n] [-settings file] [replay]
+///
+/// Plays the replay, or records and plays n ticks (default 36000, ten
+/// minutes of play) to replaycheck.rpl, n times (default 5). The hitboxes
+/// come from the settings file if it has any, as in the game, and are the
+/// game's default ones if not.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "Replay.h"
+#include "Simulation.h"
+#include "tinyxml2.h"
+
+using namespace std;
+using namespace tinyxml2;
+
+static const int DEFAULT_TICKS = 36000; ///< Ticks recorded by default.
+static const int SCRIPT_TEAM_SIZE = 4; ///< Fighters on each team in the scripted match.
+static const char* RECORD_FILE = "replaycheck.rpl"; ///< Replay of the scripted match.
+
+static CHitBoxes g_cBoxes; ///< Hitboxes and hurtboxes for each frame.
+
+/// Script of keys pressed. A key is pressed on about one tick in three,
+/// now and then two at once.
+/// \param team Team.
+/// \param tick Tick.
+/// \return Keys pressed by the team for the tick.
+
+static NetInput Script(int team, int tick){
+  unsigned h = (unsigned)tick*2654435761u ^ (unsigned)(team + 1)*40503u;
+  h ^= h >> 15; h *= 2246822519u; h ^= h >> 13;
+
+  if(h%3 != 0)return 0;
+
+  static const NetInput key[] = {LEFT_INPUT, LEFT_INPUT, RIGHT_INPUT, RIGHT_INPUT,
+    JUMP_INPUT, PUNCH_INPUT, KICK_INPUT, PUNCH_INPUT | LEFT_INPUT};
+  const int n = sizeof(key)/sizeof(key[0]);
+
+  NetInput input = key[(h >> 8)%n];
+  if((h >> 16)%64 == 0)input = TAG_INPUT;
+  return input;
+} //Script
+
+/// Play a replay as fast as it will go, a number of times.
+/// \param replay Replay.
+/// \param passes Number of times to play it.
+/// \param checksum [out] Checksum after the last tick.
+/// \return Number of checksums in the replay that didn't match.
+
+static int Play(const CReplayReader& replay, int passes, unsigned& checksum){
+  const int ticks = replay.GetTickCount();
+  const vector<ReplayChecksum>& checksums = replay.GetChecksums();
+  int nMismatches = 0, nFirstMismatch = -1;
+  double best = 0.0; //fastest pass, in ticks a second
+
+  CSimulation cFight;
+
+  for(int pass=0; pass<passes; pass++){
+    cFight.Create(g_cBoxes, replay.GetTeamSize(), replay.IsTagTeam());
+    size_t next = 0; //next checksum to check
+
+    const chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+
+    for(int t=0; t<ticks; t++){
+      cFight.Tick(replay.GetInput(t));
+
+      if(next < checksums.size() && checksums[next].nTick == cFight.GetTick()){
+        if(pass == 0 && checksums[next].nChecksum != cFight.GetChecksum()){
+          if(nMismatches++ == 0)nFirstMismatch = cFight.GetTick();
+        } //if
+
+        next++;
+      } //if
+    } //for
+
+    const double seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    const double rate = seconds > 0.0? ticks/seconds: 0.0;
+    best = max(best, rate);
+    printf("Pass %d: %d ticks in %0.3f s, %0.0f ticks a second.\n", pass, ticks, seconds, rate);
+  } //for
+
+  printf("%d ticks from %u bytes (%0.2f bytes a tick), %d fighters a team%s.\n",
+    ticks, (unsigned)replay.GetSize(), (double)replay.GetSize()/max(ticks, 1),
+    cFight.GetTeamSize(), cFight.IsTagTeam()? ", tag team": "");
+  printf("Best %0.0f ticks a second, %0.0f times real time at 60 Hz.\n", best, best/60.0);
+  printf("Final checksum %08x, %d of %d checksums matched.\n", cFight.GetChecksum(),
+    (int)checksums.size() - nMismatches, (int)checksums.size());
+  if(nMismatches > 0)
+    printf("Out of step with the recording by tick %d.\n", nFirstMismatch);
+
+  checksum = cFight.GetChecksum();
+  return nMismatches;
+} //Play
+
+/// Play the scripted match, record it, and check that the replay reads
+/// back as it was recorded, whole and cut short.
+/// \param ticks Number of ticks to play.
+/// \param checksum [out] Checksum after the last tick.
+/// \return true if the replay read back right.
+
+static bool Record(int ticks, unsigned& checksum){
+  CReplayWriter cWriter;
+  if(!cWriter.Open(RECORD_FILE, SCRIPT_TEAM_SIZE, true)){
+    printf("Cannot open %s.\n", RECORD_FILE);
+    return false;
+  } //if
+
+  CSimulation cFight;
+  cFight.Create(g_cBoxes, SCRIPT_TEAM_SIZE, true);
+  vector<unsigned> vChecksum; //after each tick
+
+  for(int t=0; t<ticks; t++){
+    const NetInput input[NUM_TEAMS] = {Script(RIGHT_TEAM, t), Script(LEFT_TEAM, t)};
+    cFight.Tick(input);
+    cWriter.Record(input, cFight.GetChecksum());
+    vChecksum.push_back(cFight.GetChecksum());
+  } //for
+
+  cWriter.Close();
+  checksum = cFight.GetChecksum();
+
+  CReplayReader cReader;
+  bool ok = cReader.Load(RECORD_FILE) && !cReader.IsTruncated();
+  ok = ok && cReader.GetTickCount() == ticks && cReader.GetTeamSize() == SCRIPT_TEAM_SIZE;
+  ok = ok && cReader.IsTagTeam();
+
+  for(int t=0; t<ticks && ok; t++)
+    ok = cReader.GetInput(t)[RIGHT_TEAM] == Script(RIGHT_TEAM, t) &&
+      cReader.GetInput(t)[LEFT_TEAM] == Script(LEFT_TEAM, t);
+
+  const vector<ReplayChecksum>& checksums = cReader.GetChecksums();
+  ok = ok && (int)checksums.size() == ticks/REPLAY_CHECKSUM_INTERVAL;
+  for(size_t i=0; i<checksums.size() && ok; i++)
+    ok = checksums[i].nTick == (int)(i + 1)*REPLAY_CHECKSUM_INTERVAL &&
+      checksums[i].nChecksum == vChecksum[checksums[i].nTick - 1];
+
+  if(!ok){
+    printf("The replay didn't read back as it was recorded.\n");
+    return false;
+  } //if
+
+  //cut it short part way through, as a crash would
+  FILE* input = fopen(RECORD_FILE, "rb");
+  vector<unsigned char> data(cReader.GetSize());
+  ok = input && fread(data.data(), 1, data.size(), input) == data.size();
+  if(input)fclose(input);
+
+  const char* cut = "replaycheck_cut.rpl";
+  FILE* output = ok? fopen(cut, "wb"): nullptr;
+  ok = output && fwrite(data.data(), 1, data.size()*2/3 + 1, output) == data.size()*2/3 + 1;
+  if(output)fclose(output);
+
+  CReplayReader cCut;
+  ok = ok && cCut.Load(cut) && cCut.GetTickCount() > 0 && cCut.GetTickCount() < ticks;
+  for(int t=0; t<cCut.GetTickCount() && ok; t++)
+    ok = cCut.GetInput(t)[RIGHT_TEAM] == Script(RIGHT_TEAM, t) &&
+      cCut.GetInput(t)[LEFT_TEAM] == Script(LEFT_TEAM, t);
+  remove(cut);
+
+  if(!ok)printf("A replay cut short didn't read back as far as it went.\n");
+  else printf("Recorded %d ticks to %s, cut short it reads back %d ticks%s.\n",
+    ticks, RECORD_FILE, cCut.GetTickCount(), cCut.IsTruncated()? ", part of a record dropped": "");
+  return ok;
+} //Record
+
+int main(int argc, char* argv[]){
+  int ticks = DEFAULT_TICKS;
+  int passes = 5;
+  const char* settings = nullptr;
+  const char* fname = nullptr;
+
+  for(int i=1; i<argc; i++){
+    const bool more = i + 1 < argc;
+    if(!strcmp(argv[i], "-ticks") && more)ticks = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-passes") && more)passes = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-settings") && more)settings = argv[++i];
+    else if(argv[i][0] != '-' && fname == nullptr)fname = argv[i];
+    else{
+      fprintf(stderr, "Unknown option %s.\n", argv[i]);
+      return 2;
+    } //else
+  } //for
+
+  if(ticks <= 0 || passes <= 0){
+    fprintf(stderr, "Bad option.\n");
+    return 2;
+  } //if
+
+  if(settings){
+    XMLDocument doc;
+    XMLElement* e = doc.LoadFile(settings) == 0? doc.FirstChildElement("settings"): nullptr;
+    if(e == nullptr){
+      fprintf(stderr, "Cannot load settings file %s.\n", settings);
+      return 2;
+    } //if
+
+    g_cBoxes.Load(e);
+  } //if
+
+  bool ok = true;
+  unsigned recorded = 0; //checksum the scripted match ended with
+
+  if(fname == nullptr){
+    ok = Record(ticks, recorded);
+    fname = RECORD_FILE;
+  } //if
+
+  CReplayReader cReplay;
+  if(ok && !cReplay.Load(fname)){
+    fprintf(stderr, "Cannot load replay %s.\n", fname);
+    return 2;
+  } //if
+
+  if(ok){
+    if(cReplay.IsTruncated())printf("%s was cut short, playing what there is.\n", fname);
+
+    unsigned checksum = 0;
+    ok = Play(cReplay, passes, checksum) == 0;
+
+    if(fname == RECORD_FILE && checksum != recorded){
+      printf("Expected final checksum %08x.\n", recorded);
+      ok = false;
+    } //if
+  } //if
+
+  if(!ok)printf("Failed.\n");
+  return ok? 0: 1;
+} //main
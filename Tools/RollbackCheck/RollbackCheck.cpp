@@ -0,0 +1,459 @@
+/// \file RollbackCheck.cpp
+/// \brief Checks rollback netcode between two peers over loopback UDP.
+///
+/// Runs two CNetSession peers in one process, one for each team, each
+/// with its own copy of the fight in the game's own fight simulation,
+/// CSimulation, with the game's arena, frames and default hitboxes and two
+/// teams of four in tag-team mode. The peers talk over real UDP sockets on 127.0.0.1,
+/// through a link that delays, reorders and drops datagrams to order, and
+/// each presses its team's keys from a script that depends only on the team
+/// and the tick. Neither peer knows the other's keys until they arrive,
+/// so it has to predict them and roll back when it's wrong.
+///
+/// When both peers have run every tick and heard every input, the checksum
+/// of each one's state must match that of a run of the same script
+/// offline, with no net session at all, and the peers must have compared
+/// the checksums for every tick along the way without finding a desync.
+/// Some rollbacks must also have happened, or nothing was checked.
+///
+/// Then the peers are run again for each of a range of ticks, from the
+/// first to the last, with one peer's fight nudged at that tick, and both
+/// peers must find that their checksums first differ at that tick. The
+/// nudge puts a fighter from the bench into play, rather than moving one,
+/// since a fighter in the middle of a move or up against a wall might not
+/// move.
+///
+/// Build with, for example:
+///
+///     g++ -O2 -I../../Code RollbackCheck.cpp ../../Code/NetSession.cpp
+///       ../../Code/Simulation.cpp ../../Code/EntityStore.cpp ../../Code/FighterAnimator.cpp ../../Code/HitBoxes.cpp
+///       ../../Code/Fixed.cpp ../../Code/Checksum.cpp ../../Code/Timer.cpp
+///       ../../Code/tinyxml2.cpp -o rollbackcheck
+///
+/// This uses BSD sockets, so it builds on Linux and macOS. The game itself
+/// uses IPManager, which is a CNetLink over Winsock.
+///
+/// Usage:
+///
+///     rollbackcheck [-ticks n] [-window n] [-latency n] [-jitter n] [-loss n]
+///       [-port n] [-desync n]
+///
+/// Runs n ticks (default 36000, ten minutes of play) with a window of n
+/// ticks (default 8). Each datagram is held back for the latency plus up to
+/// the jitter, in steps of the loop that advances both peers by a tick
+/// (defaults 3 and 2), and n percent of datagrams are dropped (default 5).
+/// The peers use ports n and n + 1 (default 7970). With -desync n, only
+/// the run with the second peer's fight nudged at tick n is made.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "NetSession.h"
+#include "Simulation.h"
+
+using namespace std;
+
+static const int TEAM_SIZE = 4; ///< Fighters on each team.
+static const int SETTLE_STEPS = 1000; ///< Most steps to wait for the last inputs.
+
+/// \brief A link over a UDP socket on the loopback address.
+
+class CUdpLink: public CNetLink{
+  private:
+    int m_nSocket; ///< Socket, -1 if it couldn't be opened.
+
+  public:
+    CUdpLink(int port, int peer); ///< Constructor.
+    ~CUdpLink(); ///< Destructor.
+
+    bool IsOpen() const; ///< Whether the socket is open.
+    bool Send(const unsigned char* p, int n) override; ///< Send a datagram.
+    int Receive(unsigned char* p, int size) override; ///< Receive a datagram, if one is waiting.
+}; //CUdpLink
+
+/// Open a non-blocking socket on a port, connected to the peer's port, so
+/// that it only receives the peer's datagrams.
+/// \param port Port to receive on.
+/// \param peer Port the peer receives on.
+
+CUdpLink::CUdpLink(int port, int peer){
+  m_nSocket = socket(AF_INET, SOCK_DGRAM, 0);
+  if(m_nSocket < 0)return;
+
+  sockaddr_in a;
+  memset(&a, 0, sizeof(a));
+  a.sin_family = AF_INET;
+  a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  a.sin_port = htons((unsigned short)port);
+  const bool bound = bind(m_nSocket, (sockaddr*)&a, sizeof(a)) == 0;
+
+  a.sin_port = htons((unsigned short)peer);
+  const bool connected = bound && connect(m_nSocket, (sockaddr*)&a, sizeof(a)) == 0;
+
+  if(!connected || fcntl(m_nSocket, F_SETFL, O_NONBLOCK) != 0){
+    close(m_nSocket);
+    m_nSocket = -1;
+  } //if
+} //constructor
+
+CUdpLink::~CUdpLink(){
+  if(m_nSocket >= 0)close(m_nSocket);
+} //destructor
+
+/// \return true if the socket is open.
+
+bool CUdpLink::IsOpen() const{
+  return m_nSocket >= 0;
+} //IsOpen
+
+/// \param p Datagram.
+/// \param n Size of datagram in bytes.
+/// \return true if it was sent.
+
+bool CUdpLink::Send(const unsigned char* p, int n){
+  return send(m_nSocket, p, n, 0) == n;
+} //Send
+
+/// An error from an earlier datagram sent while the peer's port was
+/// closed is skipped, as IPManager does.
+/// \param p Buffer for the datagram.
+/// \param size Size of buffer in bytes.
+/// \return Size of the datagram, 0 if none is waiting, or -1 if it was
+/// too big for the buffer.
+
+int CUdpLink::Receive(unsigned char* p, int size){
+  for(;;){
+    const int n = (int)recv(m_nSocket, p, size, MSG_TRUNC);
+    if(n > size)return -1;
+    if(n >= 0)return n;
+    if(errno != ECONNREFUSED && errno != EINTR)return 0;
+  } //for
+} //Receive
+
+/// \brief A link that delays, reorders and drops datagrams sent through another.
+
+class CLossyLink: public CNetLink{
+  private:
+    /// \brief A datagram being held back.
+    struct Datagram{
+      int nDue; ///< Step it is to be sent on.
+      vector<unsigned char> vData; ///< Contents.
+    }; //Datagram
+
+    CNetLink& m_cLink; ///< Link it is sent over.
+    int m_nLatency; ///< Steps each datagram is held back.
+    int m_nJitter; ///< Most extra steps a datagram is held back.
+    int m_nLoss; ///< Percentage of datagrams dropped.
+    unsigned m_nSeed; ///< Pseudo-random number seed.
+    int m_nStep; ///< Current step.
+    vector<Datagram> m_vHeld; ///< Datagrams held back.
+
+    int Random(); ///< Pseudo-random number.
+
+  public:
+    CLossyLink(CNetLink& link, int latency, int jitter, int loss, unsigned seed); ///< Constructor.
+
+    bool Send(const unsigned char* p, int n) override; ///< Send a datagram, later or never.
+    int Receive(unsigned char* p, int size) override; ///< Receive a datagram, if one is waiting.
+    void Step(); ///< Send the datagrams that are due.
+}; //CLossyLink
+
+/// \param link Link to send over.
+/// \param latency Steps each datagram is held back.
+/// \param jitter Most extra steps a datagram is held back, so that
+/// datagrams arrive out of order.
+/// \param loss Percentage of datagrams dropped.
+/// \param seed Pseudo-random number seed.
+
+CLossyLink::CLossyLink(CNetLink& link, int latency, int jitter, int loss, unsigned seed):
+  m_cLink(link), m_nLatency(latency), m_nJitter(jitter), m_nLoss(loss),
+  m_nSeed(seed), m_nStep(0){}
+
+/// \return A pseudo-random number from 0 to 32767.
+
+int CLossyLink::Random(){
+  m_nSeed = m_nSeed*1103515245 + 12345;
+  return (m_nSeed >> 16) & 0x7FFF;
+} //Random
+
+/// \param p Datagram.
+/// \param n Size of datagram in bytes.
+/// \return true, since a real link can't tell whether it will arrive either.
+
+bool CLossyLink::Send(const unsigned char* p, int n){
+  if(Random()%100 < m_nLoss)return true;
+
+  Datagram d;
+  d.nDue = m_nStep + m_nLatency + Random()%(m_nJitter + 1);
+  d.vData.assign(p, p + n);
+  m_vHeld.push_back(d);
+  return true;
+} //Send
+
+/// \param p Buffer for the datagram.
+/// \param size Size of buffer in bytes.
+/// \return Whatever the link underneath returns.
+
+int CLossyLink::Receive(unsigned char* p, int size){
+  return m_cLink.Receive(p, size);
+} //Receive
+
+/// Move on a step and send the datagrams due by then, in the order they fall due.
+
+void CLossyLink::Step(){
+  m_nStep++;
+
+  stable_sort(m_vHeld.begin(), m_vHeld.end(),
+    [](const Datagram& a, const Datagram& b){return a.nDue < b.nDue;});
+
+  size_t n = 0; //datagrams sent
+  while(n < m_vHeld.size() && m_vHeld[n].nDue <= m_nStep){
+    m_cLink.Send(m_vHeld[n].vData.data(), (int)m_vHeld[n].vData.size());
+    n++;
+  } //while
+
+  m_vHeld.erase(m_vHeld.begin(), m_vHeld.begin() + n);
+} //Step
+
+static CHitBoxes g_cBoxes; ///< The game's default hitboxes, shared by every fight.
+
+/// Script of keys pressed. A key is pressed on about one tick in six, so
+/// that predicting no key is usually right, but not always.
+/// \param team Team.
+/// \param tick Tick.
+/// \return Keys pressed by the team for the tick.
+
+static NetInput Script(int team, int tick){
+  unsigned h = (unsigned)tick*2654435761u ^ (unsigned)(team + 1)*40503u;
+  h ^= h >> 15; h *= 2246822519u; h ^= h >> 13;
+
+  if(h%6 != 0)return 0;
+
+  static const NetInput key[] = {LEFT_INPUT, LEFT_INPUT, RIGHT_INPUT, RIGHT_INPUT,
+    JUMP_INPUT, PUNCH_INPUT, KICK_INPUT, PUNCH_INPUT | LEFT_INPUT};
+  const int n = sizeof(key)/sizeof(key[0]);
+
+  NetInput input = key[(h >> 8)%n];
+  if((h >> 16)%64 == 0)input = TAG_INPUT;
+  return input;
+} //Script
+
+/// \brief A peer: a fight, its saved states, and its net session.
+
+struct Peer{
+  CSimulation cFight; ///< Fight.
+  vector<CSimulation> vSaved; ///< Saved states, one per slot.
+  CUdpLink* pSocket; ///< Socket.
+  CLossyLink* pLink; ///< Lossy link over the socket.
+  CNetSession* pSession; ///< Net session.
+}; //Peer
+
+/// Print a peer's statistics.
+/// \param name Name of peer.
+/// \param peer Peer.
+
+static void PrintStats(const char* name, Peer& peer){
+  const NetStats& s = peer.pSession->GetStats();
+  CTimeHistogram& h = peer.pSession->GetRollbackTimes();
+  const double total = h.GetMean()*h.GetCount(); //microseconds spent in rollbacks
+
+  printf("%s: %d ticks, %d stalls, %d rollbacks (%.1f%% of ticks), %d ticks run again, most %d\n",
+    name, s.nTicks, s.nStalls, s.nRollbacks, 100.0*s.nRollbacks/max(s.nTicks, 1),
+    s.nResimulated, s.nMaxRollback);
+  printf("  rollback time: mean %.1f p50 %lld p99 %lld max %lld us, %.2f us per tick run again\n",
+    h.GetMean(), h.GetPercentile(50), h.GetPercentile(99), h.GetMax(),
+    total/max(s.nResimulated, 1));
+  printf("  packets: %d sent, %d received, %d bad; checksums: %d compared, %d desyncs",
+    s.nPacketsSent, s.nPacketsReceived, s.nBadPackets, s.nChecksums, s.nDesyncs);
+  if(s.nFirstDesync >= 0)printf(", first at tick %d", s.nFirstDesync);
+  printf("\n");
+} //PrintStats
+
+/// Run the two peers over loopback until both have run every tick, check
+/// what they found, and print their statistics.
+/// \param ticks Ticks to run.
+/// \param window Net session window.
+/// \param latency Steps each datagram is held back.
+/// \param jitter Most extra steps a datagram is held back.
+/// \param loss Percentage of datagrams dropped.
+/// \param port Port of the first peer, the second being the next one.
+/// \param desync Tick at which the second peer's fight is nudged, -1 for none.
+/// \param reference Checksum of the offline run.
+/// \return 1 if the check passed, 0 if it failed, 2 if the ports couldn't be opened.
+
+static int RunPeers(int ticks, int window, int latency, int jitter, int loss, int port,
+  int desync, unsigned reference)
+{
+  //the peers, each on its own socket, each other's peer
+  Peer peer[2];
+  for(int i=0; i<2; i++){
+    Peer& p = peer[i];
+    p.cFight.Create(g_cBoxes, TEAM_SIZE, true);
+    p.pSocket = new CUdpLink(port + i, port + 1 - i);
+
+    if(!p.pSocket->IsOpen()){
+      fprintf(stderr, "Cannot open port %d.\n", port + i);
+      return 2;
+    } //if
+
+    p.pLink = new CLossyLink(*p.pSocket, latency, jitter, loss, 1 + i);
+    p.pSession = new CNetSession(*p.pLink, i, window);
+    p.vSaved.resize(p.pSession->GetStateSlots());
+
+    p.pSession->SetCallbacks(
+      [&p, i, desync](const NetInput* input){
+        if(i == 1 && p.cFight.GetTick() == desync){ //put a benched left fighter into play, which always shows
+          const int k = (p.cFight.GetPoint(LEFT_TEAM) + TEAM_SIZE - 1)%TEAM_SIZE;
+          p.cFight.GetFighters().SetActive(p.cFight.GetFighter(LEFT_TEAM, k), true);
+        } //if
+        p.cFight.Tick(input);
+      },
+      [&p](int slot){p.vSaved[slot] = p.cFight;},
+      [&p](int slot){p.cFight = p.vSaved[slot];},
+      [&p](){return p.cFight.GetChecksum();});
+  } //for
+
+  //advance both peers a tick a step, until both have run every tick
+  CTimer cTimer;
+  cTimer.start();
+  int steps = 0;
+
+  while(peer[0].pSession->GetTick() < ticks || peer[1].pSession->GetTick() < ticks){
+    for(int i=0; i<2; i++){
+      CNetSession* s = peer[i].pSession;
+      if(s->GetTick() < ticks)s->Advance(Script(i, s->GetTick()));
+      else s->Idle();
+      peer[i].pLink->Step();
+    } //for
+
+    steps++;
+  } //while
+
+  //let the last inputs and checksums arrive
+  for(int n=0; n<SETTLE_STEPS; n++)
+    for(int i=0; i<2; i++){
+      peer[i].pSession->Idle();
+      peer[i].pLink->Step();
+    } //for
+
+  const long long elapsed = cTimer.microseconds();
+
+  printf("%d ticks in %d steps, %.2f s, window %d, latency %d, jitter %d, loss %d%%",
+    ticks, steps, elapsed/1000000.0, window, latency, jitter, loss);
+  if(desync >= 0)printf(", desync at tick %d", desync);
+  printf("\n");
+  PrintStats("Left peer", peer[0]);
+  PrintStats("Right peer", peer[1]);
+  printf("Offline checksum %08x, left peer %08x, right peer %08x\n", reference,
+    peer[0].cFight.GetChecksum(), peer[1].cFight.GetChecksum());
+
+  bool ok = true;
+
+  if(desync < 0){
+    for(int i=0; i<2; i++){
+      const NetStats& s = peer[i].pSession->GetStats();
+
+      if(peer[i].cFight.GetChecksum() != reference){
+        printf("Peer %d doesn't match the offline run.\n", i);
+        ok = false;
+      } //if
+
+      if(s.nDesyncs > 0 || s.nChecksums != ticks){
+        printf("Peer %d compared %d checksums and found %d desyncs.\n", i, s.nChecksums, s.nDesyncs);
+        ok = false;
+      } //if
+    } //for
+
+    //with no latency, one peer may always have the other's keys in time
+    if(peer[0].pSession->GetStats().nRollbacks + peer[1].pSession->GetStats().nRollbacks == 0){
+      printf("Neither peer rolled back, so nothing was checked.\n");
+      ok = false;
+    } //if
+  } //if
+
+  else{
+    for(int i=0; i<2; i++){
+      const NetStats& s = peer[i].pSession->GetStats();
+
+      if(s.nFirstDesync != desync){
+        printf("Peer %d should have found the desync at tick %d.\n", i, desync);
+        ok = false;
+      } //if
+    } //for
+  } //else
+
+  for(int i=0; i<2; i++){
+    delete peer[i].pSession;
+    delete peer[i].pLink;
+    delete peer[i].pSocket;
+  } //for
+
+  return ok? 1: 0;
+} //RunPeers
+
+int main(int argc, char* argv[]){
+  int ticks = 36000;
+  int window = 8;
+  int latency = 3;
+  int jitter = 2;
+  int loss = 5;
+  int port = 7970;
+  int desync = -1;
+
+  for(int i=1; i<argc; i++){
+    const bool more = i + 1 < argc;
+    if(!strcmp(argv[i], "-ticks") && more)ticks = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-window") && more)window = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-latency") && more)latency = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-jitter") && more)jitter = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-loss") && more)loss = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-port") && more)port = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-desync") && more)desync = atoi(argv[++i]);
+    else{
+      fprintf(stderr, "Unknown option %s.\n", argv[i]);
+      return 2;
+    } //else
+  } //for
+
+  if(ticks <= 0 || window < 1 || window > CNetSession::MAX_WINDOW ||
+    latency < 0 || jitter < 0 || loss < 0 || loss >= 100 || desync >= ticks)
+  {
+    fprintf(stderr, "Bad option.\n");
+    return 2;
+  } //if
+
+  //the reference, run offline with both teams' keys known
+  CSimulation cReference;
+  cReference.Create(g_cBoxes, TEAM_SIZE, true);
+  for(int t=0; t<ticks; t++){
+    const NetInput input[NUM_TEAMS] = {Script(0, t), Script(1, t)};
+    cReference.Tick(input);
+  } //for
+
+  //a run with no desync, then desyncs from the first tick to the last
+  vector<int> vDesync = {-1, 0, 1, 10, 50, 500, 5000, ticks/2, ticks - 1};
+  if(desync >= 0)vDesync.assign(1, desync); //just the one
+
+  bool ok = true;
+
+  for(size_t i=0; i<vDesync.size(); i++)
+    if(vDesync[i] < ticks && find(vDesync.begin(), vDesync.begin() + i, vDesync[i]) == vDesync.begin() + i){
+      const int result = RunPeers(ticks, window, latency, jitter, loss, port, vDesync[i], cReference.GetChecksum());
+      if(result == 2)return 2;
+      ok = ok && result == 1;
+    } //if
+
+  if(!ok)printf("Failed.\n");
+  return ok? 0: 1;
+} //main
@@ -0,0 +1,420 @@
+/// \file SoftRender.cpp
+/// \brief Software renderer for frames of the game.
+///
+/// Renders the game's background floor and wall, and a number of sprites,
+/// with the software rasterizer, exactly as CGameRenderer lays them out with
+/// the default camera. It times the frames, can save the last one, and can
+/// compare it with a golden image, so that rendering can be checked on
+/// machines without a GPU. Textures are read from TGA files if given, and
+/// are otherwise generated.
+///
+/// Build with, for example:
+///
+///     g++ -O2 -mavx2 -pthread -I../../Code SoftRender.cpp ../../Code/SoftRasterizer.cpp ../../Code/SoftImage.cpp -o softrender
+///
+/// Usage:
+///
+///     softrender [-width n] [-height n] [-frames n] [-sprites n] [-threads n]
+///       [-floor file.tga] [-wall file.tga] [-sprite file.tga]
+///       [-out file.tga] [-golden file.tga] [-tolerance n] [-maxpixels n]
+///     softrender -check dir [-update] [-tolerance n] [-maxpixels n]
+///
+/// The screen is width by height pixels (default 1024 by 768). The frame is
+/// rendered frames times (default 100) with the given number of sprites
+/// (default 2, the two fighters). With a golden image, the exit code is 1
+/// if more than maxpixels pixels (default 0) differ from it in some channel
+/// by more than tolerance (default 0).
+///
+/// With -check, the reference frames listed in g_pReferences are rendered
+/// with generated textures and compared with the golden images in dir, and
+/// the exit code is 1 if any differs. The golden images are checked in under
+/// Tools/SoftRender/Golden, so run
+///
+///     softrender -check Golden
+///
+/// after any change to the rasterizer. Add -update to write new golden images
+/// instead, and only after checking the new frames by eye.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "SoftRasterizer.h"
+#include "SoftImage.h"
+
+/// A 4 by 4 matrix, used with row vectors as DirectXMath does.
+
+struct Matrix{
+  float m[4][4]; ///< Entries, row by row.
+}; //Matrix
+
+/// Multiply two matrices.
+/// \param a First matrix.
+/// \param b Second matrix.
+/// \return a times b.
+
+static Matrix Multiply(const Matrix& a, const Matrix& b){
+  Matrix c;
+
+  for(int i=0; i<4; i++)
+    for(int j=0; j<4; j++){
+      c.m[i][j] = 0.0f;
+      for(int k=0; k<4; k++)
+        c.m[i][j] += a.m[i][k]*b.m[k][j];
+    } //for
+
+  return c;
+} //Multiply
+
+/// Left-handed look-at view matrix with y up, as XMMatrixLookAtLH.
+/// \param eye Camera position.
+/// \param at Look-at point.
+/// \return View matrix.
+
+static Matrix LookAtLH(const float eye[3], const float at[3]){
+  float z[3] = {at[0] - eye[0], at[1] - eye[1], at[2] - eye[2]};
+  float len = sqrtf(z[0]*z[0] + z[1]*z[1] + z[2]*z[2]);
+  for(int i=0; i<3; i++)z[i] /= len;
+
+  const float up[3] = {0.0f, 1.0f, 0.0f};
+  float x[3] = {up[1]*z[2] - up[2]*z[1], up[2]*z[0] - up[0]*z[2], up[0]*z[1] - up[1]*z[0]};
+  len = sqrtf(x[0]*x[0] + x[1]*x[1] + x[2]*x[2]);
+  for(int i=0; i<3; i++)x[i] /= len;
+
+  const float y[3] = {z[1]*x[2] - z[2]*x[1], z[2]*x[0] - z[0]*x[2], z[0]*x[1] - z[1]*x[0]};
+
+  Matrix v;
+  for(int i=0; i<3; i++){
+    v.m[i][0] = x[i];
+    v.m[i][1] = y[i];
+    v.m[i][2] = z[i];
+    v.m[i][3] = 0.0f;
+  } //for
+
+  v.m[3][0] = -(x[0]*eye[0] + x[1]*eye[1] + x[2]*eye[2]);
+  v.m[3][1] = -(y[0]*eye[0] + y[1]*eye[1] + y[2]*eye[2]);
+  v.m[3][2] = -(z[0]*eye[0] + z[1]*eye[1] + z[2]*eye[2]);
+  v.m[3][3] = 1.0f;
+
+  return v;
+} //LookAtLH
+
+/// Left-handed perspective projection matrix, as XMMatrixPerspectiveFovLH.
+/// \param fov Vertical field of view in radians.
+/// \param aspect Width over height.
+/// \param zn Near plane.
+/// \param zf Far plane.
+/// \return Projection matrix.
+
+static Matrix PerspectiveFovLH(float fov, float aspect, float zn, float zf){
+  const float h = 1.0f/tanf(0.5f*fov);
+  const float r = zf/(zf - zn);
+
+  Matrix p;
+  memset(&p, 0, sizeof(p));
+  p.m[0][0] = h/aspect;
+  p.m[1][1] = h;
+  p.m[2][2] = r;
+  p.m[2][3] = 1.0f;
+  p.m[3][2] = -r*zn;
+
+  return p;
+} //PerspectiveFovLH
+
+/// Lay a matrix out as the game's shader constant buffer does, transposed.
+/// \param a Matrix.
+/// \param out Receives the 16 entries.
+
+static void StoreTransposed(const Matrix& a, float out[16]){
+  for(int i=0; i<4; i++)
+    for(int j=0; j<4; j++)
+      out[4*i + j] = a.m[j][i];
+} //StoreTransposed
+
+/// Load a texture from a TGA file, or failing that, generate one.
+/// \param fname TGA file name, or nullptr.
+/// \param kind 0 for a checkerboard, 1 for a gradient, 2 for a round sprite.
+/// \param tex Receives the texture.
+
+static void MakeTexture(const char* fname, int kind, SoftTexture& tex){
+  if(fname){
+    if(ReadTGA(fname, tex.vTexels, tex.nWidth, tex.nHeight))return;
+    fprintf(stderr, "Cannot read %s, using a generated texture.\n", fname);
+  } //if
+
+  const int n = kind == 2? 128: 256;
+  tex.nWidth = tex.nHeight = n;
+  tex.vTexels.resize(n*n);
+
+  for(int y=0; y<n; y++)
+    for(int x=0; x<n; x++){
+      uint32_t p;
+
+      if(kind == 0) //checkerboard
+        p = ((x/32 + y/32) & 1)? 0xff404040: 0xffc0c0c0;
+
+      else if(kind == 1) //gradient
+        p = 0xff000000 | (uint32_t)(255*y/n) << 16 | (uint32_t)(255*x/n);
+
+      else{ //round sprite, opaque in the middle and fading out at the edge
+        const float dx = x - n/2 + 0.5f, dy = y - n/2 + 0.5f;
+        const float r = sqrtf(dx*dx + dy*dy)/(n/2);
+        const uint32_t a = r >= 1.0f? 0: r < 0.75f? 255: (uint32_t)(255*(1.0f - r)/0.25f);
+        p = a << 24 | 0x2040e0;
+      } //else
+
+      tex.vTexels[y*n + x] = p;
+    } //for
+} //MakeTexture
+
+/// Textures and camera shared by every frame.
+
+struct Scene{
+  SoftTexture cFloor; ///< Floor texture.
+  SoftTexture cWall; ///< Wall texture.
+  SoftTexture cSprite; ///< Sprite texture.
+}; //Scene
+
+/// A reference frame checked in as a golden image.
+
+struct Reference{
+  const char* szName; ///< Golden file name, without the directory.
+  int nWidth; ///< Screen width.
+  int nHeight; ///< Screen height.
+  int nSprites; ///< Number of sprites.
+}; //Reference
+
+/// Reference frames for -check and -update, rendered with generated
+/// textures and laid out for the game's 1024 by 768 screen. The second is not a whole number of tiles in either direction,
+/// and its sprites overlap so that alpha blending order matters.
+
+static const Reference g_pReferences[] = {
+  {"fighters.tga", 256, 192, 2},
+  {"crowd.tga", 200, 150, 40},
+}; //g_pReferences
+
+/// Render frames of the game with the software rasterizer. The scene is laid
+/// out for a screen of layoutwidth by layoutheight pixels, as the game lays it
+/// out for g_nScreenWidth by g_nScreenHeight, and drawn into a viewport of
+/// width by height pixels.
+/// \param scene Textures.
+/// \param layoutwidth Screen width the scene is laid out for.
+/// \param layoutheight Screen height the scene is laid out for.
+/// \param width Viewport width.
+/// \param height Viewport height.
+/// \param sprites Number of sprites.
+/// \param threads Number of rasterizer threads, 0 for one per core.
+/// \param frames Number of times to render the frame.
+/// \param pixels Receives the last frame.
+/// \param times Receives the time taken by each frame in milliseconds.
+
+static void Render(const Scene& scene, int layoutwidth, int layoutheight, int width, int height,
+  int sprites, int threads, int frames, vector<uint32_t>& pixels, vector<double>& times)
+{
+  //background, as in CGameRenderer::InitBackground
+  const float w = 2.0f*layoutwidth, h = 2.0f*layoutheight;
+  const SoftVertex background[6] = {
+    {w, 0, 0, 1, 0}, {0, 0, 0, 0, 0}, {w, 0, 1500, 1, 1},
+    {0, 0, 1500, 0, 1}, {w, h, 1500, 1, 0}, {0, h, 1500, 0, 0}
+  }; //background
+
+  //sprites where the fighters stand, as C3DSprite::Draw places them
+  vector<SpriteInstance> instances(sprites);
+  for(int i=0; i<sprites; i++){
+    SpriteInstance& s = instances[i];
+    s.fX = 338.0f + (sprites > 1? 350.0f*i/(sprites - 1): 0.0f) + layoutwidth/2;
+    s.fY = 300.0f;
+    s.fZ = -10.0f*(i & 1);
+    s.fWidth = s.fHeight = 128.0f;
+    s.fU0 = s.fV0 = 0.0f;
+    s.fU1 = s.fV1 = 1.0f;
+  } //for
+
+  //default camera, as in CRenderer::InitD3D
+  const float eye[3] = {1024.0f, 384.0f, -350.0f};
+  const float at[3] = {1024.0f, 384.0f, 1000.0f};
+  const Matrix vp = Multiply(LookAtLH(eye, at),
+    PerspectiveFovLH(3.14159265f/4.0f, (float)width/height, 1.0f, 10000.0f));
+  float m[16];
+  StoreTransposed(vp, m);
+
+  CSoftRasterizer rasterizer(width, height, threads);
+  times.resize(frames);
+
+  for(int i=0; i<frames; i++){
+    auto t0 = chrono::steady_clock::now();
+
+    rasterizer.Clear(0x00ffffff); //white, as in CGameRenderer::ComposeFrame
+    rasterizer.DrawStrip(background, 4, m, &scene.cFloor, SOFT_NO_BLEND);
+    rasterizer.DrawStrip(background + 2, 4, m, &scene.cWall, SOFT_NO_BLEND);
+    rasterizer.DrawSprites(instances.data(), sprites, m, &scene.cSprite, SOFT_ALPHA_BLEND);
+    rasterizer.Flush();
+
+    times[i] = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+  } //for
+
+  rasterizer.GetPixels(pixels);
+} //Render
+
+/// Compare a frame with a golden image.
+/// \param pixels Frame.
+/// \param width Frame width.
+/// \param height Frame height.
+/// \param goldenfile Golden image file name.
+/// \param tolerance Largest channel difference that does not count.
+/// \param maxpixels Largest number of differing pixels that passes.
+/// \return 0 if the frame matches, 1 if not, 2 if the golden image cannot be read.
+
+static int CompareWithGolden(const vector<uint32_t>& pixels, int width, int height,
+  const char* goldenfile, int tolerance, int maxpixels)
+{
+  vector<uint32_t> golden;
+  int gw, gh;
+
+  if(!ReadTGA(goldenfile, golden, gw, gh)){
+    fprintf(stderr, "Cannot read %s.\n", goldenfile);
+    return 2;
+  } //if
+
+  if(gw != width || gh != height){
+    printf("Golden image %s is %dx%d, frame is %dx%d.\n", goldenfile, gw, gh, width, height);
+    return 1;
+  } //if
+
+  const ImageDifference d = CompareImages(pixels.data(), golden.data(), width*height, tolerance);
+  printf("%d pixels differ from %s, by at most %d.\n", d.nDifferentPixels, goldenfile, d.nMaxDifference);
+  return d.nDifferentPixels > maxpixels? 1: 0;
+} //CompareWithGolden
+
+/// Render the reference frames and compare each with its golden image, or
+/// write the golden images. Each frame is checked with one rasterizer thread
+/// and with several, since tiles must come out the same whichever thread
+/// draws them.
+/// \param scene Generated textures.
+/// \param dir Directory holding the golden images.
+/// \param update Whether to write the golden images instead of checking.
+/// \param tolerance Largest channel difference that does not count.
+/// \param maxpixels Largest number of differing pixels that passes.
+/// \return 0 if every frame matches, 1 if not, 2 on a file error.
+
+static int CheckReferences(const Scene& scene, const char* dir, bool update,
+  int tolerance, int maxpixels)
+{
+  const int threadcounts[] = {1, 4};
+  int result = 0;
+
+  for(const Reference& r: g_pReferences){
+    char fname[1024];
+    snprintf(fname, sizeof(fname), "%s/%s", dir, r.szName);
+
+    for(int threads: threadcounts){
+      vector<uint32_t> pixels;
+      vector<double> times;
+      Render(scene, 1024, 768, r.nWidth, r.nHeight, r.nSprites, threads, 1, pixels, times);
+
+      if(update){
+        if(!WriteTGA(fname, pixels.data(), r.nWidth, r.nHeight)){
+          fprintf(stderr, "Cannot write %s.\n", fname);
+          return 2;
+        } //if
+
+        printf("Wrote %s.\n", fname);
+        break;
+      } //if
+
+      printf("%d threads: ", threads);
+      const int n = CompareWithGolden(pixels, r.nWidth, r.nHeight, fname, tolerance, maxpixels);
+      if(n > result)result = n;
+    } //for
+  } //for
+
+  return result;
+} //CheckReferences
+
+int main(int argc, char* argv[]){
+  int width = 1024, height = 768;
+  int frames = 100, sprites = 2, threads = 0;
+  int tolerance = 0, maxpixels = 0;
+  bool update = false;
+  const char* floorfile = nullptr;
+  const char* wallfile = nullptr;
+  const char* spritefile = nullptr;
+  const char* outfile = nullptr;
+  const char* goldenfile = nullptr;
+  const char* checkdir = nullptr;
+
+  for(int i=1; i<argc; i++){
+    const bool more = i + 1 < argc;
+    if(!strcmp(argv[i], "-width") && more)width = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-height") && more)height = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-frames") && more)frames = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-sprites") && more)sprites = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-threads") && more)threads = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-floor") && more)floorfile = argv[++i];
+    else if(!strcmp(argv[i], "-wall") && more)wallfile = argv[++i];
+    else if(!strcmp(argv[i], "-sprite") && more)spritefile = argv[++i];
+    else if(!strcmp(argv[i], "-out") && more)outfile = argv[++i];
+    else if(!strcmp(argv[i], "-golden") && more)goldenfile = argv[++i];
+    else if(!strcmp(argv[i], "-tolerance") && more)tolerance = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-maxpixels") && more)maxpixels = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-check") && more)checkdir = argv[++i];
+    else if(!strcmp(argv[i], "-update"))update = true;
+    else{
+      fprintf(stderr, "Unknown option %s.\n", argv[i]);
+      return 2;
+    } //else
+  } //for
+
+  if(width <= 0 || height <= 0 || frames <= 0 || sprites < 0){
+    fprintf(stderr, "Bad size, frame count, or sprite count.\n");
+    return 2;
+  } //if
+
+  if(update && !checkdir){
+    fprintf(stderr, "-update needs -check.\n");
+    return 2;
+  } //if
+
+  Scene scene;
+
+  if(checkdir){ //reference frames always use generated textures
+    MakeTexture(nullptr, 0, scene.cFloor);
+    MakeTexture(nullptr, 1, scene.cWall);
+    MakeTexture(nullptr, 2, scene.cSprite);
+    return CheckReferences(scene, checkdir, update, tolerance, maxpixels);
+  } //if
+
+  MakeTexture(floorfile, 0, scene.cFloor);
+  MakeTexture(wallfile, 1, scene.cWall);
+  MakeTexture(spritefile, 2, scene.cSprite);
+
+  vector<uint32_t> pixels;
+  vector<double> times;
+  Render(scene, width, height, width, height, sprites, threads, frames, pixels, times);
+
+  double total = 0.0;
+  for(double t: times)total += t;
+
+  vector<double> sorted(times);
+  sort(sorted.begin(), sorted.end());
+  const double median = sorted[frames/2];
+  const double p99 = sorted[(99*(frames - 1))/100];
+
+  printf("%d frames at %dx%d with %d sprites: mean %0.3f ms (%0.0f fps), median %0.3f ms, "
+    "99th percentile %0.3f ms, worst %0.3f ms.\n", frames, width, height, sprites,
+    total/frames, 1000.0*frames/total, median, p99, sorted.back());
+
+  if(outfile && !WriteTGA(outfile, pixels.data(), width, height)){
+    fprintf(stderr, "Cannot write %s.\n", outfile);
+    return 2;
+  } //if
+
+  if(goldenfile)
+    return CompareWithGolden(pixels, width, height, goldenfile, tolerance, maxpixels);
+
+  return 0;
+} //main
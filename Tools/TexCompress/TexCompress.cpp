@@ -0,0 +1,1296 @@
+/// \file TexCompress.cpp
+/// \brief Offline texture compressor.
+///
+/// Reads the image list from the game's settings file, decodes each PNG or
+/// BMP image, builds a full mip chain, block compresses it, and writes it
+/// out as a DDS file next to the source image. Opaque images become BC1,
+/// images with alpha become BC3, and images whose width or height is not
+/// a multiple of 4, which Direct3D can't block compress, are stored as
+/// uncompressed RGBA with their mips so that at least the decode and mip
+/// generation are done offline. An XML manifest maps each source image to
+/// its DDS file, see CRenderer::LoadTextureManifest. Images are compressed
+/// in parallel, one per thread, largest first.
+///
+/// Build with, for example:
+///
+///     g++ -O2 -pthread -I../../Code TexCompress.cpp ../../Code/tinyxml2.cpp -o texcompress
+///
+/// Usage:
+///
+///     texcompress [-first n] [-last n] [-format f] [-threads n] [-root dir] settings.xml textures.xml
+///
+/// Images first through last (default all of them) are compressed. The
+/// format f is one of auto (the default, as above), bc1, bc3, or rgba.
+/// Image file names in the settings file are taken relative to dir
+/// (default the directory containing the settings file).
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tinyxml2.h"
+
+using namespace std;
+using namespace tinyxml2;
+
+/// Compressed texture formats.
+
+enum TextureFormat{
+  AUTO_FORMAT, ///< BC1 if opaque, BC3 otherwise, RGBA if it can't be compressed.
+  BC1_FORMAT, ///< BC1, 4 bits per pixel, 1-bit alpha at most.
+  BC3_FORMAT, ///< BC3, 8 bits per pixel, with alpha.
+  RGBA_FORMAT ///< Uncompressed, 32 bits per pixel.
+}; //TextureFormat
+
+static const char* g_szFormatName[] = {"auto", "bc1", "bc3", "rgba"}; ///< Format names.
+
+/// An image in memory.
+
+struct Image{
+  int nWidth; ///< Width in pixels.
+  int nHeight; ///< Height in pixels.
+  vector<uint8_t> vPixels; ///< RGBA pixels, 4 bytes each, top row first.
+}; //Image
+
+/// An image to be compressed, and what became of it.
+
+struct TextureJob{
+  int nIndex; ///< Index of image in the settings file image list.
+  string strSrc; ///< Image file name as given in the settings file.
+  string strDDS; ///< DDS file name in the same form.
+  int nWidth; ///< Image width in pixels.
+  int nHeight; ///< Image height in pixels.
+  int nMips; ///< Number of mip levels.
+  TextureFormat nFormat; ///< Format chosen.
+  size_t nSourceBytes; ///< Bytes the game used for it as RGBA with mips.
+  size_t nBytes; ///< Bytes of texture data in the DDS file.
+  double fPSNR; ///< Peak signal to noise ratio of top mip, in dB.
+  double fTime; ///< Time taken, in ms.
+  string strError; ///< Error message, empty on success.
+}; //TextureJob
+
+/// Read a big-endian 32-bit unsigned integer.
+/// \param p Pointer to first byte.
+/// \return The integer.
+
+static uint32_t ReadBE32(const uint8_t* p){
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+} //ReadBE32
+
+/// Read a little-endian 32-bit unsigned integer.
+/// \param p Pointer to first byte.
+/// \return The integer.
+
+static uint32_t ReadLE32(const uint8_t* p){
+  return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+} //ReadLE32
+
+/// Read a little-endian 16-bit unsigned integer.
+/// \param p Pointer to first byte.
+/// \return The integer.
+
+static uint32_t ReadLE16(const uint8_t* p){
+  return p[0] | ((uint32_t)p[1] << 8);
+} //ReadLE16
+
+/// Read a whole file into memory.
+/// \param fname File name.
+/// \param data Receives the file contents.
+/// \return true if the file was read.
+
+static bool ReadFile(const string& fname, vector<uint8_t>& data){
+  FILE* f = fopen(fname.c_str(), "rb");
+  if(f == nullptr)return false;
+
+  fseek(f, 0, SEEK_END);
+  const long n = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  data.resize(n > 0? n: 0);
+  const bool ok = n > 0 && fread(data.data(), 1, n, f) == (size_t)n;
+  fclose(f);
+  return ok;
+} //ReadFile
+
+/// A canonical Huffman code.
+
+struct Huffman{
+  uint16_t nCount[16]; ///< Number of codes of each length.
+  uint16_t nSymbol[288]; ///< Symbols in canonical order.
+}; //Huffman
+
+/// State of a decompression in progress.
+
+struct Inflater{
+  const uint8_t* pIn; ///< Compressed data.
+  size_t nInSize; ///< Size of compressed data.
+  size_t nPos; ///< Next byte of compressed data.
+  uint32_t nBitBuf; ///< Bits read but not used.
+  int nBitCount; ///< Number of bits in bit buffer.
+  bool bError; ///< Whether the data ran out or was bad.
+  vector<uint8_t>* pOut; ///< Decompressed data.
+}; //Inflater
+
+/// Take bits from the compressed data.
+/// \param s Decompression state.
+/// \param n Number of bits, at most 16.
+/// \return The bits, first bit in the least significant place.
+
+static uint32_t Bits(Inflater& s, int n){
+  while(s.nBitCount < n){
+    if(s.nPos >= s.nInSize){s.bError = true; return 0;}
+    s.nBitBuf |= (uint32_t)s.pIn[s.nPos++] << s.nBitCount;
+    s.nBitCount += 8;
+  } //while
+
+  const uint32_t v = s.nBitBuf & ((1u << n) - 1);
+  s.nBitBuf >>= n;
+  s.nBitCount -= n;
+  return v;
+} //Bits
+
+/// Build a canonical Huffman code from code lengths.
+/// \param h Receives the code.
+/// \param length Code length of each symbol, 0 if unused.
+/// \param n Number of symbols.
+
+static void BuildHuffman(Huffman& h, const uint8_t* length, int n){
+  memset(h.nCount, 0, sizeof(h.nCount));
+  for(int i=0; i<n; i++)
+    h.nCount[length[i]]++;
+  h.nCount[0] = 0;
+
+  uint16_t offset[16];
+  offset[1] = 0;
+  for(int len=1; len<15; len++)
+    offset[len + 1] = offset[len] + h.nCount[len];
+
+  for(int i=0; i<n; i++)
+    if(length[i])
+      h.nSymbol[offset[length[i]]++] = (uint16_t)i;
+} //BuildHuffman
+
+/// Decode one symbol, a bit at a time.
+/// \param s Decompression state.
+/// \param h Huffman code.
+/// \return The symbol, -1 on error.
+
+static int Decode(Inflater& s, const Huffman& h){
+  int code = 0, first = 0, index = 0;
+
+  for(int len=1; len<16; len++){
+    code |= Bits(s, 1);
+    const int count = h.nCount[len];
+    if(code - count < first)return h.nSymbol[index + code - first];
+    index += count;
+    first = (first + count) << 1;
+    code <<= 1;
+  } //for
+
+  s.bError = true;
+  return -1;
+} //Decode
+
+/// Decompress one block of Huffman coded data.
+/// \param s Decompression state.
+/// \param lencode Literal and length code.
+/// \param distcode Distance code.
+
+static void InflateCodes(Inflater& s, const Huffman& lencode, const Huffman& distcode){
+  static const uint16_t lbase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+  static const uint8_t lext[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3,
+    3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+  static const uint16_t dbase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+    193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+  static const uint8_t dext[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7,
+    8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+  vector<uint8_t>& out = *s.pOut;
+
+  while(!s.bError){
+    int symbol = Decode(s, lencode);
+    if(symbol < 256){ //literal
+      if(symbol >= 0)out.push_back((uint8_t)symbol);
+      continue;
+    } //if
+
+    if(symbol == 256)return; //end of block
+
+    symbol -= 257;
+    if(symbol >= 29){s.bError = true; return;}
+    const size_t len = lbase[symbol] + Bits(s, lext[symbol]);
+
+    symbol = Decode(s, distcode);
+    if(symbol < 0 || symbol >= 30){s.bError = true; return;}
+    const size_t dist = dbase[symbol] + Bits(s, dext[symbol]);
+    if(dist > out.size()){s.bError = true; return;}
+
+    const size_t from = out.size() - dist;
+    for(size_t i=0; i<len; i++) //may overlap, so one at a time
+      out.push_back(out[from + i]);
+  } //while
+} //InflateCodes
+
+/// Decompress zlib data.
+/// \param in Compressed data, with zlib header.
+/// \param n Size of compressed data.
+/// \param out Receives the decompressed data.
+/// \return true if it succeeded.
+
+static bool Inflate(const uint8_t* in, size_t n, vector<uint8_t>& out){
+  if(n < 2 || (in[0] & 0x0F) != 8 || ((in[0] << 8) | in[1]) % 31 != 0)
+    return false; //not deflate
+
+  Inflater s = {in, n, 2, 0, 0, false, &out};
+  int last = 0;
+
+  while(!last && !s.bError){
+    last = Bits(s, 1);
+    const int type = Bits(s, 2);
+
+    if(type == 0){ //stored
+      s.nBitBuf = 0; s.nBitCount = 0;
+      if(s.nPos + 4 > n)return false;
+      const size_t len = ReadLE16(in + s.nPos);
+      s.nPos += 4; //and the complement
+      if(s.nPos + len > n)return false;
+      out.insert(out.end(), in + s.nPos, in + s.nPos + len);
+      s.nPos += len;
+    } //if
+
+    else if(type == 1){ //fixed codes
+      static Huffman lencode, distcode;
+      static bool built = false;
+
+      if(!built){ //racy, but every thread builds the same thing
+        uint8_t length[288];
+        int i = 0;
+        for(; i<144; i++)length[i] = 8;
+        for(; i<256; i++)length[i] = 9;
+        for(; i<280; i++)length[i] = 7;
+        for(; i<288; i++)length[i] = 8;
+        BuildHuffman(lencode, length, 288);
+        for(i=0; i<30; i++)length[i] = 5;
+        BuildHuffman(distcode, length, 30);
+        built = true;
+      } //if
+
+      InflateCodes(s, lencode, distcode);
+    } //else if
+
+    else if(type == 2){ //dynamic codes
+      static const uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+      const int nlen = Bits(s, 5) + 257;
+      const int ndist = Bits(s, 5) + 1;
+      const int ncode = Bits(s, 4) + 4;
+      if(nlen > 286 || ndist > 30)return false;
+
+      uint8_t length[320] = {0};
+      for(int i=0; i<ncode; i++)
+        length[order[i]] = (uint8_t)Bits(s, 3);
+
+      Huffman lencode, distcode;
+      BuildHuffman(lencode, length, 19);
+
+      //code lengths of the literal, length, and distance codes
+      int i = 0;
+      while(i < nlen + ndist && !s.bError){
+        int symbol = Decode(s, lencode);
+        if(symbol < 16){
+          if(symbol >= 0)length[i++] = (uint8_t)symbol;
+          continue;
+        } //if
+
+        uint8_t value = 0;
+        int repeat;
+        if(symbol == 16){
+          if(i == 0)return false;
+          value = length[i - 1];
+          repeat = 3 + Bits(s, 2);
+        } //if
+        else if(symbol == 17)repeat = 3 + Bits(s, 3);
+        else repeat = 11 + Bits(s, 7);
+
+        if(i + repeat > nlen + ndist)return false;
+        while(repeat--)length[i++] = value;
+      } //while
+
+      BuildHuffman(lencode, length, nlen);
+      BuildHuffman(distcode, length + nlen, ndist);
+      InflateCodes(s, lencode, distcode);
+    } //else if
+
+    else return false; //bad block type
+  } //while
+
+  return !s.bError;
+} //Inflate
+
+/// Get a sample from a PNG scanline.
+/// \param row Scanline, without its filter byte.
+/// \param i Index of sample in the scanline.
+/// \param depth Bits per sample.
+/// \return The sample.
+
+static int Sample(const uint8_t* row, int i, int depth){
+  switch(depth){
+    case 16: return (row[2*i] << 8) | row[2*i + 1];
+    case 8: return row[i];
+    default:{
+      const int bit = i*depth;
+      return (row[bit >> 3] >> (8 - depth - (bit & 7))) & ((1 << depth) - 1);
+    } //default
+  } //switch
+} //Sample
+
+/// Scale a sample to 8 bits.
+/// \param v Sample.
+/// \param depth Bits per sample.
+/// \return Sample scaled to 0..255.
+
+static uint8_t Scale8(int v, int depth){
+  if(depth == 16)return (uint8_t)(v >> 8);
+  if(depth == 8)return (uint8_t)v;
+  return (uint8_t)(v*255/((1 << depth) - 1));
+} //Scale8
+
+/// Decode a PNG file. Interlaced images are not supported.
+/// \param data File contents.
+/// \param img Receives the image.
+/// \return Error message, nullptr on success.
+
+static const char* DecodePNG(const vector<uint8_t>& data, Image& img){
+  const uint8_t* p = data.data();
+  const size_t n = data.size();
+  size_t pos = 8;
+
+  int depth = 0, colortype = -1, interlace = 0;
+  uint8_t palette[256][4];
+  int palettesize = 0;
+  int trns[3] = {-1, -1, -1}; //transparent color for gray and RGB
+  vector<uint8_t> idat;
+
+  for(int i=0; i<256; i++){
+    palette[i][0] = palette[i][1] = palette[i][2] = 0;
+    palette[i][3] = 255;
+  } //for
+
+  while(pos + 8 <= n){
+    const uint32_t len = ReadBE32(p + pos);
+    const uint8_t* type = p + pos + 4;
+    const uint8_t* chunk = p + pos + 8;
+    if(len > n - pos - 12)return "truncated PNG";
+
+    if(!memcmp(type, "IHDR", 4) && len >= 13){
+      img.nWidth = (int)ReadBE32(chunk);
+      img.nHeight = (int)ReadBE32(chunk + 4);
+      depth = chunk[8];
+      colortype = chunk[9];
+      interlace = chunk[12];
+    } //if
+
+    else if(!memcmp(type, "PLTE", 4)){
+      palettesize = min(256, (int)len/3);
+      for(int i=0; i<palettesize; i++)
+        for(int j=0; j<3; j++)
+          palette[i][j] = chunk[3*i + j];
+    } //else if
+
+    else if(!memcmp(type, "tRNS", 4)){
+      if(colortype == 3)
+        for(int i=0; i<(int)len && i<256; i++)
+          palette[i][3] = chunk[i];
+      else if(colortype == 0 && len >= 2)
+        trns[0] = (chunk[0] << 8) | chunk[1];
+      else if(colortype == 2 && len >= 6)
+        for(int j=0; j<3; j++)
+          trns[j] = (chunk[2*j] << 8) | chunk[2*j + 1];
+    } //else if
+
+    else if(!memcmp(type, "IDAT", 4))
+      idat.insert(idat.end(), chunk, chunk + len);
+
+    else if(!memcmp(type, "IEND", 4))
+      break;
+
+    pos += 12 + len;
+  } //while
+
+  static const int channelcount[7] = {1, 0, 3, 1, 2, 0, 4};
+  if(colortype < 0 || colortype > 6 || channelcount[colortype] == 0)return "bad PNG color type";
+  if(depth != 1 && depth != 2 && depth != 4 && depth != 8 && depth != 16)return "bad PNG bit depth";
+  if(interlace)return "interlaced PNG";
+  if(img.nWidth <= 0 || img.nHeight <= 0)return "bad PNG size";
+
+  vector<uint8_t> raw;
+  if(!Inflate(idat.data(), idat.size(), raw))return "bad PNG data";
+
+  const int channels = channelcount[colortype];
+  const int bpp = max(1, channels*depth/8); //bytes per pixel, for filters
+  const size_t stride = ((size_t)img.nWidth*channels*depth + 7)/8;
+  if(raw.size() < (stride + 1)*img.nHeight)return "truncated PNG data";
+
+  //undo the filters in place
+  for(int y=0; y<img.nHeight; y++){
+    uint8_t* row = &raw[y*(stride + 1) + 1];
+    const uint8_t* prev = y > 0? row - (stride + 1): nullptr;
+    const int filter = row[-1];
+
+    for(size_t x=0; x<stride; x++){
+      const int a = x >= (size_t)bpp? row[x - bpp]: 0;
+      const int b = prev? prev[x]: 0;
+      const int c = prev && x >= (size_t)bpp? prev[x - bpp]: 0;
+
+      switch(filter){
+        case 0: break;
+        case 1: row[x] += a; break;
+        case 2: row[x] += b; break;
+        case 3: row[x] += (a + b)/2; break;
+        case 4:{
+          const int pa = abs(b - c), pb = abs(a - c), pc = abs(a + b - 2*c);
+          row[x] += pa <= pb && pa <= pc? a: pb <= pc? b: c;
+        } break;
+        default: return "bad PNG filter";
+      } //switch
+    } //for
+  } //for
+
+  //convert to RGBA
+  img.vPixels.resize((size_t)img.nWidth*img.nHeight*4);
+
+  for(int y=0; y<img.nHeight; y++){
+    const uint8_t* row = &raw[y*(stride + 1) + 1];
+    uint8_t* out = &img.vPixels[(size_t)y*img.nWidth*4];
+
+    for(int x=0; x<img.nWidth; x++, out+=4){
+      switch(colortype){
+        case 0:{ //gray
+          const int v = Sample(row, x, depth);
+          out[0] = out[1] = out[2] = Scale8(v, depth);
+          out[3] = v == trns[0]? 0: 255;
+        } break;
+
+        case 2:{ //RGB
+          int v[3];
+          for(int j=0; j<3; j++){
+            v[j] = Sample(row, 3*x + j, depth);
+            out[j] = Scale8(v[j], depth);
+          } //for
+          out[3] = v[0] == trns[0] && v[1] == trns[1] && v[2] == trns[2]? 0: 255;
+        } break;
+
+        case 3: //palette
+          memcpy(out, palette[Sample(row, x, depth)], 4);
+          break;
+
+        case 4: //gray and alpha
+          out[0] = out[1] = out[2] = Scale8(Sample(row, 2*x, depth), depth);
+          out[3] = Scale8(Sample(row, 2*x + 1, depth), depth);
+          break;
+
+        case 6: //RGBA
+          for(int j=0; j<4; j++)
+            out[j] = Scale8(Sample(row, 4*x + j, depth), depth);
+          break;
+      } //switch
+    } //for
+  } //for
+
+  return nullptr;
+} //DecodePNG
+
+/// Decode an uncompressed 8, 24, or 32-bit BMP file. As with WIC, the
+/// fourth byte of a 32-bit pixel is only taken to be alpha if the header
+/// has an alpha mask.
+/// \param data File contents.
+/// \param img Receives the image.
+/// \return Error message, nullptr on success.
+
+static const char* DecodeBMP(const vector<uint8_t>& data, Image& img){
+  const uint8_t* p = data.data();
+  const size_t n = data.size();
+  if(n < 54)return "truncated BMP";
+
+  const uint32_t offset = ReadLE32(p + 10);
+  const uint32_t headersize = ReadLE32(p + 14);
+  const int w = (int)ReadLE32(p + 18);
+  const int h = (int)ReadLE32(p + 22);
+  const int bits = (int)ReadLE16(p + 28);
+  const uint32_t compression = ReadLE32(p + 30);
+
+  if(w <= 0 || h == 0)return "bad BMP size";
+  if(compression != 0 && compression != 3)return "compressed BMP";
+  if(bits != 8 && bits != 24 && bits != 32)return "unsupported BMP bit depth";
+
+  const bool alpha = bits == 32 && headersize >= 56 && ReadLE32(p + 54 + 12) != 0;
+  const bool topdown = h < 0;
+  img.nWidth = w;
+  img.nHeight = abs(h);
+
+  const size_t stride = (((size_t)w*bits + 31)/32)*4;
+  if(offset + stride*img.nHeight > n)return "truncated BMP";
+
+  const uint8_t* palette = p + 14 + headersize;
+  int palettesize = bits == 8? (int)ReadLE32(p + 46): 0;
+  if(bits == 8 && palettesize == 0)palettesize = 256;
+  if(bits == 8 && palette + 4*palettesize > p + n)return "truncated BMP";
+
+  img.vPixels.resize((size_t)img.nWidth*img.nHeight*4);
+
+  for(int y=0; y<img.nHeight; y++){
+    const uint8_t* row = p + offset + stride*(topdown? y: img.nHeight - 1 - y);
+    uint8_t* out = &img.vPixels[(size_t)y*w*4];
+
+    for(int x=0; x<w; x++, out+=4){
+      const uint8_t* bgr = bits == 8? palette + 4*min((int)row[x], palettesize - 1):
+        row + x*(bits/8);
+      out[0] = bgr[2];
+      out[1] = bgr[1];
+      out[2] = bgr[0];
+      out[3] = alpha? bgr[3]: 255;
+    } //for
+  } //for
+
+  return nullptr;
+} //DecodeBMP
+
+/// Read and decode a PNG or BMP file.
+/// \param fname File name.
+/// \param img Receives the image.
+/// \return Error message, nullptr on success.
+
+static const char* ReadImage(const string& fname, Image& img){
+  vector<uint8_t> data;
+  if(!ReadFile(fname, data))return "cannot read file";
+
+  const uint8_t pngsig[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  if(data.size() >= 8 && memcmp(data.data(), pngsig, 8) == 0)
+    return DecodePNG(data, img);
+  if(data.size() >= 2 && data[0] == 'B' && data[1] == 'M')
+    return DecodeBMP(data, img);
+
+  return "not a PNG or BMP file";
+} //ReadImage
+
+/// Halve an image with a box filter. Colors are weighted by alpha, so
+/// that the color of transparent pixels doesn't bleed into the edges of
+/// sprites.
+/// \param src Source image.
+/// \param dst Receives the image at half size, rounded down, at least 1.
+
+static void Downsample(const Image& src, Image& dst){
+  dst.nWidth = max(1, src.nWidth/2);
+  dst.nHeight = max(1, src.nHeight/2);
+  dst.vPixels.resize((size_t)dst.nWidth*dst.nHeight*4);
+
+  for(int y=0; y<dst.nHeight; y++)
+    for(int x=0; x<dst.nWidth; x++){
+      int sum[4] = {0}, plain[3] = {0};
+
+      for(int j=0; j<2; j++)
+        for(int i=0; i<2; i++){
+          const int sx = min(2*x + i, src.nWidth - 1);
+          const int sy = min(2*y + j, src.nHeight - 1);
+          const uint8_t* s = &src.vPixels[((size_t)sy*src.nWidth + sx)*4];
+          for(int c=0; c<3; c++){
+            sum[c] += s[c]*s[3];
+            plain[c] += s[c];
+          } //for
+          sum[3] += s[3];
+        } //for
+
+      uint8_t* d = &dst.vPixels[((size_t)y*dst.nWidth + x)*4];
+      for(int c=0; c<3; c++)
+        d[c] = (uint8_t)(sum[3] > 0? (sum[c] + sum[3]/2)/sum[3]: (plain[c] + 2)/4);
+      d[3] = (uint8_t)((sum[3] + 2)/4);
+    } //for
+} //Downsample
+
+/// Expand a 5:6:5 color to 8 bits per channel.
+/// \param c Color.
+/// \param rgb Receives red, green, and blue.
+
+static void Expand565(uint16_t c, int rgb[3]){
+  const int r = c >> 11, g = (c >> 5) & 63, b = c & 31;
+  rgb[0] = (r << 3) | (r >> 2);
+  rgb[1] = (g << 2) | (g >> 4);
+  rgb[2] = (b << 3) | (b >> 2);
+} //Expand565
+
+/// Quantize a color to 5:6:5.
+/// \param rgb Red, green, and blue, 0 to 255.
+/// \return Color.
+
+static uint16_t Quantize565(const float rgb[3]){
+  const int r = (int)(min(max(rgb[0], 0.0f), 255.0f)*31.0f/255.0f + 0.5f);
+  const int g = (int)(min(max(rgb[1], 0.0f), 255.0f)*63.0f/255.0f + 0.5f);
+  const int b = (int)(min(max(rgb[2], 0.0f), 255.0f)*31.0f/255.0f + 0.5f);
+  return (uint16_t)((r << 11) | (g << 5) | b);
+} //Quantize565
+
+/// Get the four colors of a BC1 block in four-color mode.
+/// \param c0 First endpoint.
+/// \param c1 Second endpoint.
+/// \param palette Receives the colors.
+
+static void ColorPalette(uint16_t c0, uint16_t c1, int palette[4][3]){
+  Expand565(c0, palette[0]);
+  Expand565(c1, palette[1]);
+
+  for(int k=0; k<3; k++){
+    palette[2][k] = (2*palette[0][k] + palette[1][k] + 1)/3;
+    palette[3][k] = (palette[0][k] + 2*palette[1][k] + 1)/3;
+  } //for
+} //ColorPalette
+
+/// Choose the nearest palette entry for each pixel of a block.
+/// \param c0 First endpoint.
+/// \param c1 Second endpoint.
+/// \param block Pixels, RGBA.
+/// \param weight Weight of each pixel.
+/// \param index Receives the index of each pixel.
+/// \return Weighted squared error.
+
+static float FitColors(uint16_t c0, uint16_t c1, const uint8_t block[16][4],
+  const float weight[16], uint8_t index[16])
+{
+  int palette[4][3];
+  ColorPalette(c0, c1, palette);
+  float error = 0.0f;
+
+  for(int i=0; i<16; i++){
+    int best = 0, besterror = 1 << 30;
+
+    for(int j=0; j<4; j++){
+      const int dr = block[i][0] - palette[j][0];
+      const int dg = block[i][1] - palette[j][1];
+      const int db = block[i][2] - palette[j][2];
+      const int e = dr*dr + dg*dg + db*db;
+      if(e < besterror){besterror = e; best = j;}
+    } //for
+
+    index[i] = (uint8_t)best;
+    error += weight[i]*besterror;
+  } //for
+
+  return error;
+} //FitColors
+
+/// Compress the colors of a block to BC1 in four-color mode. The endpoints
+/// start at the extremes of the pixels along their principal axis, and are
+/// then refined by least squares given the indices chosen.
+/// \param block Pixels, RGBA.
+/// \param weight Weight of each pixel in the fit.
+/// \param out Receives 8 bytes.
+
+static void CompressColorBlock(const uint8_t block[16][4], const float weight[16], uint8_t out[8]){
+  //weighted mean and covariance
+  float total = 0.0f, mean[3] = {0.0f};
+  for(int i=0; i<16; i++){
+    total += weight[i];
+    for(int k=0; k<3; k++)
+      mean[k] += weight[i]*block[i][k];
+  } //for
+
+  for(int k=0; k<3; k++)
+    mean[k] /= total;
+
+  float cov[6] = {0.0f}; //rr, rg, rb, gg, gb, bb
+  for(int i=0; i<16; i++){
+    const float r = block[i][0] - mean[0], g = block[i][1] - mean[1], b = block[i][2] - mean[2];
+    cov[0] += weight[i]*r*r; cov[1] += weight[i]*r*g; cov[2] += weight[i]*r*b;
+    cov[3] += weight[i]*g*g; cov[4] += weight[i]*g*b; cov[5] += weight[i]*b*b;
+  } //for
+
+  //principal axis by power iteration
+  float axis[3] = {1.0f, 1.0f, 1.0f};
+  for(int iter=0; iter<8; iter++){
+    const float x = cov[0]*axis[0] + cov[1]*axis[1] + cov[2]*axis[2];
+    const float y = cov[1]*axis[0] + cov[3]*axis[1] + cov[4]*axis[2];
+    const float z = cov[2]*axis[0] + cov[4]*axis[1] + cov[5]*axis[2];
+    const float m = max(fabsf(x), max(fabsf(y), fabsf(z)));
+    if(m < 1e-6f)break; //all one color
+    axis[0] = x/m; axis[1] = y/m; axis[2] = z/m;
+  } //for
+
+  //extremes along the axis
+  float lo = 1e30f, hi = -1e30f;
+  const float len2 = axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2];
+
+  for(int i=0; i<16; i++)
+    if(weight[i] > 0.0f){
+      const float t = ((block[i][0] - mean[0])*axis[0] + (block[i][1] - mean[1])*axis[1] +
+        (block[i][2] - mean[2])*axis[2])/len2;
+      lo = min(lo, t);
+      hi = max(hi, t);
+    } //if
+
+  float e0[3], e1[3];
+  for(int k=0; k<3; k++){
+    e0[k] = mean[k] + hi*axis[k];
+    e1[k] = mean[k] + lo*axis[k];
+  } //for
+
+  uint16_t c0 = Quantize565(e0), c1 = Quantize565(e1);
+  uint8_t index[16], trial[16];
+  float error = FitColors(c0, c1, block, weight, index);
+
+  //least squares refinement of the endpoints
+  static const float frac[4] = {1.0f, 0.0f, 2.0f/3.0f, 1.0f/3.0f}; //share of first endpoint
+
+  for(int iter=0; iter<2 && error > 0.0f; iter++){
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[3] = {0.0f}, bx[3] = {0.0f};
+
+    for(int i=0; i<16; i++){
+      const float a = frac[index[i]], b = 1.0f - a, w = weight[i];
+      aa += w*a*a; ab += w*a*b; bb += w*b*b;
+      for(int k=0; k<3; k++){
+        ax[k] += w*a*block[i][k];
+        bx[k] += w*b*block[i][k];
+      } //for
+    } //for
+
+    const float det = aa*bb - ab*ab;
+    if(fabsf(det) < 1e-6f)break; //all pixels on one index
+
+    for(int k=0; k<3; k++){
+      e0[k] = (bb*ax[k] - ab*bx[k])/det;
+      e1[k] = (aa*bx[k] - ab*ax[k])/det;
+    } //for
+
+    const uint16_t t0 = Quantize565(e0), t1 = Quantize565(e1);
+    const float e = FitColors(t0, t1, block, weight, trial);
+    if(e >= error)break; //no better
+
+    c0 = t0; c1 = t1; error = e;
+    memcpy(index, trial, 16);
+  } //for
+
+  //four-color mode needs c0 > c1
+  if(c0 < c1){
+    swap(c0, c1);
+    for(int i=0; i<16; i++)
+      index[i] ^= 1;
+  } //if
+  else if(c0 == c1)
+    memset(index, 0, 16);
+
+  out[0] = (uint8_t)c0; out[1] = (uint8_t)(c0 >> 8);
+  out[2] = (uint8_t)c1; out[3] = (uint8_t)(c1 >> 8);
+
+  uint32_t bits = 0;
+  for(int i=0; i<16; i++)
+    bits |= (uint32_t)index[i] << (2*i);
+
+  for(int i=0; i<4; i++)
+    out[4 + i] = (uint8_t)(bits >> (8*i));
+} //CompressColorBlock
+
+/// Get the eight alphas of a BC3 alpha block.
+/// \param a0 First endpoint.
+/// \param a1 Second endpoint.
+/// \param palette Receives the alphas.
+
+static void AlphaPalette(int a0, int a1, int palette[8]){
+  palette[0] = a0;
+  palette[1] = a1;
+
+  if(a0 > a1)
+    for(int i=1; i<7; i++)
+      palette[i + 1] = ((7 - i)*a0 + i*a1 + 3)/7;
+
+  else{
+    for(int i=1; i<5; i++)
+      palette[i + 1] = ((5 - i)*a0 + i*a1 + 2)/5;
+    palette[6] = 0;
+    palette[7] = 255;
+  } //else
+} //AlphaPalette
+
+/// Choose the nearest palette entry for each alpha of a block.
+/// \param a0 First endpoint.
+/// \param a1 Second endpoint.
+/// \param block Pixels, RGBA.
+/// \param index Receives the index of each pixel.
+/// \return Squared error.
+
+static int FitAlphas(int a0, int a1, const uint8_t block[16][4], uint8_t index[16]){
+  int palette[8];
+  AlphaPalette(a0, a1, palette);
+  int error = 0;
+
+  for(int i=0; i<16; i++){
+    int best = 0, besterror = 1 << 30;
+
+    for(int j=0; j<8; j++){
+      const int e = (block[i][3] - palette[j])*(block[i][3] - palette[j]);
+      if(e < besterror){besterror = e; best = j;}
+    } //for
+
+    index[i] = (uint8_t)best;
+    error += besterror;
+  } //for
+
+  return error;
+} //FitAlphas
+
+/// Compress the alphas of a block to a BC3 alpha block. Both the eight
+/// alpha mode and the six alpha mode with exact 0 and 255 are tried, and
+/// the better one is kept. The latter suits the hard edges of sprites.
+/// \param block Pixels, RGBA.
+/// \param out Receives 8 bytes.
+
+static void CompressAlphaBlock(const uint8_t block[16][4], uint8_t out[8]){
+  int lo = 255, hi = 0, lo6 = 255, hi6 = 0;
+
+  for(int i=0; i<16; i++){
+    const int a = block[i][3];
+    lo = min(lo, a); hi = max(hi, a);
+    if(a > 0 && a < 255){lo6 = min(lo6, a); hi6 = max(hi6, a);}
+  } //for
+
+  if(lo6 > hi6)lo6 = hi6 = 0; //only 0 and 255
+
+  uint8_t index[16], index6[16];
+  int a0 = hi, a1 = lo;
+  int error = FitAlphas(a0, a1, block, index);
+
+  if(error > 0 && FitAlphas(lo6, hi6, block, index6) < error){
+    a0 = lo6; a1 = hi6;
+    memcpy(index, index6, 16);
+  } //if
+
+  out[0] = (uint8_t)a0;
+  out[1] = (uint8_t)a1;
+
+  uint64_t bits = 0;
+  for(int i=0; i<16; i++)
+    bits |= (uint64_t)index[i] << (3*i);
+
+  for(int i=0; i<6; i++)
+    out[2 + i] = (uint8_t)(bits >> (8*i));
+} //CompressAlphaBlock
+
+/// Get a 4 by 4 block of pixels, repeating the edge pixels of images that
+/// are smaller than a block.
+/// \param img Image.
+/// \param bx Block column.
+/// \param by Block row.
+/// \param block Receives the pixels.
+
+static void GetBlock(const Image& img, int bx, int by, uint8_t block[16][4]){
+  for(int j=0; j<4; j++)
+    for(int i=0; i<4; i++){
+      const int x = min(4*bx + i, img.nWidth - 1);
+      const int y = min(4*by + j, img.nHeight - 1);
+      memcpy(block[4*j + i], &img.vPixels[((size_t)y*img.nWidth + x)*4], 4);
+    } //for
+} //GetBlock
+
+/// Compress an image.
+/// \param img Image.
+/// \param fmt BC1, BC3, or RGBA.
+/// \param out Compressed data is appended to this.
+
+static void CompressImage(const Image& img, TextureFormat fmt, vector<uint8_t>& out){
+  if(fmt == RGBA_FORMAT){
+    out.insert(out.end(), img.vPixels.begin(), img.vPixels.end());
+    return;
+  } //if
+
+  const int bw = (img.nWidth + 3)/4, bh = (img.nHeight + 3)/4;
+  const int blocksize = fmt == BC1_FORMAT? 8: 16;
+  size_t pos = out.size();
+  out.resize(pos + (size_t)bw*bh*blocksize);
+
+  for(int by=0; by<bh; by++)
+    for(int bx=0; bx<bw; bx++){
+      uint8_t block[16][4];
+      GetBlock(img, bx, by, block);
+
+      //opaque pixels count fully, transparent ones not at all,
+      //unless the whole block is transparent
+      float weight[16], total = 0.0f;
+      for(int i=0; i<16; i++)
+        total += weight[i] = fmt == BC1_FORMAT? 1.0f: block[i][3]/255.0f;
+      if(total <= 0.0f)
+        for(int i=0; i<16; i++)weight[i] = 1.0f;
+
+      if(fmt == BC3_FORMAT){
+        CompressAlphaBlock(block, &out[pos]);
+        pos += 8;
+      } //if
+
+      CompressColorBlock(block, weight, &out[pos]);
+      pos += 8;
+    } //for
+} //CompressImage
+
+/// Decompress the top mip level of a BC1 or BC3 image, to measure
+/// how much was lost.
+/// \param data Compressed data.
+/// \param fmt BC1 or BC3.
+/// \param w Width in pixels.
+/// \param h Height in pixels.
+/// \param img Receives the image.
+
+static void DecompressImage(const uint8_t* data, TextureFormat fmt, int w, int h, Image& img){
+  img.nWidth = w;
+  img.nHeight = h;
+  img.vPixels.resize((size_t)w*h*4);
+
+  const int bw = (w + 3)/4, bh = (h + 3)/4;
+
+  for(int by=0; by<bh; by++)
+    for(int bx=0; bx<bw; bx++){
+      int alpha[8];
+      uint64_t alphabits = 0;
+
+      if(fmt == BC3_FORMAT){
+        AlphaPalette(data[0], data[1], alpha);
+        for(int i=0; i<6; i++)
+          alphabits |= (uint64_t)data[2 + i] << (8*i);
+        data += 8;
+      } //if
+
+      int palette[4][3];
+      const uint16_t c0 = (uint16_t)ReadLE16(data), c1 = (uint16_t)ReadLE16(data + 2);
+      ColorPalette(c0, c1, palette);
+      const uint32_t bits = ReadLE32(data + 4);
+      data += 8;
+
+      for(int i=0; i<16; i++){
+        const int x = 4*bx + (i & 3), y = 4*by + (i >> 2);
+        if(x >= w || y >= h)continue;
+
+        uint8_t* p = &img.vPixels[((size_t)y*w + x)*4];
+        const int index = (bits >> (2*i)) & 3;
+        for(int k=0; k<3; k++)
+          p[k] = (uint8_t)palette[index][k];
+        p[3] = fmt == BC3_FORMAT? (uint8_t)alpha[(alphabits >> (3*i)) & 7]: 255;
+      } //for
+    } //for
+} //DecompressImage
+
+/// Peak signal to noise ratio between two images of the same size.
+/// \param a First image.
+/// \param b Second image.
+/// \return PSNR in dB, 99 if they are identical.
+
+static double PSNR(const Image& a, const Image& b){
+  double sum = 0.0;
+  for(size_t i=0; i<a.vPixels.size(); i++){
+    const double d = (double)a.vPixels[i] - b.vPixels[i];
+    sum += d*d;
+  } //for
+
+  const double mse = sum/a.vPixels.size();
+  return mse > 0.0? 10.0*log10(255.0*255.0/mse): 99.0;
+} //PSNR
+
+/// Append a little-endian 32-bit unsigned integer.
+/// \param out Buffer.
+/// \param v Value.
+
+static void Put32(vector<uint8_t>& out, uint32_t v){
+  for(int i=0; i<4; i++)
+    out.push_back((uint8_t)(v >> (8*i)));
+} //Put32
+
+/// Make the header of a DDS file.
+/// \param w Width of top mip in pixels.
+/// \param h Height of top mip in pixels.
+/// \param mips Number of mip levels.
+/// \param fmt BC1, BC3, or RGBA.
+/// \param out Receives the magic number and header, 128 bytes.
+
+static void MakeDDSHeader(int w, int h, int mips, TextureFormat fmt, vector<uint8_t>& out){
+  const bool compressed = fmt != RGBA_FORMAT;
+  const uint32_t pitch = compressed? ((w + 3)/4)*((h + 3)/4)*(fmt == BC1_FORMAT? 8: 16): w*4;
+
+  out.clear();
+  Put32(out, 0x20534444); //"DDS "
+  Put32(out, 124); //header size
+  Put32(out, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | (compressed? 0x80000: 0x8)); //caps, height, width, pixel format, mip count, linear size or pitch
+  Put32(out, h);
+  Put32(out, w);
+  Put32(out, pitch);
+  Put32(out, 0); //depth
+  Put32(out, mips);
+  for(int i=0; i<11; i++)Put32(out, 0); //reserved
+
+  //pixel format
+  Put32(out, 32); //size
+  if(compressed){
+    Put32(out, 0x4); //four CC
+    Put32(out, fmt == BC1_FORMAT? 0x31545844: 0x35545844); //"DXT1" or "DXT5"
+    for(int i=0; i<5; i++)Put32(out, 0);
+  } //if
+  else{
+    Put32(out, 0x40 | 0x1); //RGB with alpha
+    Put32(out, 0);
+    Put32(out, 32); //bits per pixel
+    Put32(out, 0x000000FF); Put32(out, 0x0000FF00); Put32(out, 0x00FF0000); Put32(out, 0xFF000000);
+  } //else
+
+  Put32(out, 0x1000 | 0x8 | 0x400000); //texture, complex, mipmap
+  for(int i=0; i<4; i++)Put32(out, 0); //caps2 to 4, reserved
+} //MakeDDSHeader
+
+/// Convert a Windows path from the settings file to a path on this machine.
+/// \param root Directory that the path is relative to.
+/// \param fname File name from the settings file.
+/// \return Path to the file.
+
+static string MakePath(const string& root, const string& fname){
+  string s = fname;
+#ifndef _WIN32
+  replace(s.begin(), s.end(), '\\', '/');
+#endif
+  if(root.empty())return s;
+  return root + "/" + s;
+} //MakePath
+
+/// Decode, compress, and write one image.
+/// \param job The image to compress, which receives the results.
+/// \param root Directory that file names are relative to.
+/// \param fmt Format wanted.
+
+static void CompressTexture(TextureJob& job, const string& root, TextureFormat fmt){
+  auto t0 = chrono::steady_clock::now();
+
+  Image img;
+  const char* err = ReadImage(MakePath(root, job.strSrc), img);
+  if(err){job.strError = err; return;}
+
+  job.nWidth = img.nWidth;
+  job.nHeight = img.nHeight;
+
+  bool opaque = true;
+  for(size_t i=3; i<img.vPixels.size() && opaque; i+=4)
+    opaque = img.vPixels[i] == 255;
+
+  //top mip must be whole blocks
+  const bool blocks = img.nWidth%4 == 0 && img.nHeight%4 == 0;
+  if(fmt == AUTO_FORMAT)fmt = !blocks? RGBA_FORMAT: opaque? BC1_FORMAT: BC3_FORMAT;
+  else if(fmt != RGBA_FORMAT && !blocks)fmt = RGBA_FORMAT;
+  job.nFormat = fmt;
+
+  //mip chain, compressed
+  vector<uint8_t> data;
+  Image mip = img, next;
+  job.nMips = 0;
+
+  while(true){
+    CompressImage(mip, fmt, data);
+    job.nSourceBytes += (size_t)mip.nWidth*mip.nHeight*4;
+    job.nMips++;
+    if(mip.nWidth == 1 && mip.nHeight == 1)break;
+    Downsample(mip, next);
+    swap(mip, next);
+  } //while
+
+  job.nBytes = data.size();
+
+  //quality of the top mip
+  if(fmt == RGBA_FORMAT)job.fPSNR = 99.0;
+  else{
+    Image decoded;
+    DecompressImage(data.data(), fmt, img.nWidth, img.nHeight, decoded);
+    job.fPSNR = PSNR(img, decoded);
+  } //else
+
+  vector<uint8_t> header;
+  MakeDDSHeader(img.nWidth, img.nHeight, job.nMips, fmt, header);
+
+  FILE* f = fopen(MakePath(root, job.strDDS).c_str(), "wb");
+  if(f == nullptr){job.strError = "cannot write DDS file"; return;}
+
+  bool ok = fwrite(header.data(), 1, header.size(), f) == header.size();
+  ok = ok && fwrite(data.data(), 1, data.size(), f) == data.size();
+  if(fclose(f) != 0 || !ok)job.strError = "cannot write DDS file";
+
+  job.fTime = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+} //CompressTexture
+
+/// Write the texture manifest.
+/// \param fname Manifest file name.
+/// \param jobs Compressed images.
+/// \return true if the file was written.
+
+static bool WriteManifest(const char* fname, const vector<TextureJob>& jobs){
+  XMLDocument doc;
+  XMLElement* root = doc.NewElement("textures");
+  doc.InsertEndChild(root);
+
+  for(const TextureJob& job: jobs){
+    if(!job.strError.empty())continue;
+
+    XMLElement* tex = doc.NewElement("texture");
+    tex->SetAttribute("index", job.nIndex);
+    tex->SetAttribute("src", job.strSrc.c_str());
+    tex->SetAttribute("dds", job.strDDS.c_str());
+    tex->SetAttribute("format", g_szFormatName[job.nFormat]);
+    tex->SetAttribute("width", job.nWidth);
+    tex->SetAttribute("height", job.nHeight);
+    tex->SetAttribute("mips", job.nMips);
+    root->InsertEndChild(tex);
+  } //for
+
+  return doc.SaveFile(fname) == XML_SUCCESS;
+} //WriteManifest
+
+/// Print usage and exit.
+
+static void Usage(){
+  fprintf(stderr, "Usage: texcompress [-first n] [-last n] [-format auto|bc1|bc3|rgba] "
+    "[-threads n] [-root dir] settings.xml textures.xml\n");
+  exit(1);
+} //Usage
+
+int main(int argc, char* argv[]){
+  int first = 0; //first image
+  int last = -1; //last image, -1 for end of list
+  int threads = 0; //0 for one per hardware thread
+  TextureFormat fmt = AUTO_FORMAT;
+  string root; //directory that image names are relative to
+  bool rootset = false;
+  const char* settingsname = nullptr;
+  const char* manifestname = nullptr;
+
+  //parse command line
+  for(int i=1; i<argc; i++){
+    if(!strcmp(argv[i], "-first") && i + 1 < argc)first = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-last") && i + 1 < argc)last = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-threads") && i + 1 < argc)threads = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-root") && i + 1 < argc){root = argv[++i]; rootset = true;}
+    else if(!strcmp(argv[i], "-format") && i + 1 < argc){
+      const char* name = argv[++i];
+      int f = 0;
+      while(f <= RGBA_FORMAT && strcmp(name, g_szFormatName[f]))f++;
+      if(f > RGBA_FORMAT)Usage();
+      fmt = (TextureFormat)f;
+    } //else if
+    else if(argv[i][0] == '-')Usage();
+    else if(!settingsname)settingsname = argv[i];
+    else if(!manifestname)manifestname = argv[i];
+    else Usage();
+  } //for
+
+  if(!settingsname || !manifestname)Usage();
+  if(threads <= 0)threads = max(1, (int)thread::hardware_concurrency());
+
+  if(!rootset){ //default to directory containing settings file
+    root = settingsname;
+    size_t slash = root.find_last_of("/\\");
+    root = slash == string::npos? "": root.substr(0, slash);
+  } //if
+
+  auto t0 = chrono::steady_clock::now();
+
+  //load settings file
+  XMLDocument doc;
+  if(doc.LoadFile(settingsname) != XML_SUCCESS){
+    fprintf(stderr, "Cannot load settings file %s.\n", settingsname);
+    return 1;
+  } //if
+
+  XMLElement* settings = doc.FirstChildElement("settings");
+  XMLElement* images = settings? settings->FirstChildElement("images"): nullptr;
+  if(images == nullptr){
+    fprintf(stderr, "Cannot find <images> tag in %s.\n", settingsname);
+    return 1;
+  } //if
+
+  vector<TextureJob> jobs;
+  int index = 0;
+
+  for(XMLElement* img = images->FirstChildElement("image"); img;
+    img = img->NextSiblingElement("image"), index++)
+  {
+    if(index < first || (last >= 0 && index > last))continue;
+
+    const char* src = img->Attribute("src");
+    if(src == nullptr)continue;
+
+    TextureJob job = {index, src, src, 0, 0, 0, AUTO_FORMAT, 0, 0, 0.0, 0.0, ""};
+    const size_t dot = job.strDDS.find_last_of('.');
+    const size_t slash = job.strDDS.find_last_of("/\\");
+    if(dot != string::npos && (slash == string::npos || dot > slash))
+      job.strDDS.erase(dot);
+    job.strDDS += ".dds";
+    jobs.push_back(job);
+  } //for
+
+  if(jobs.empty()){
+    fprintf(stderr, "No images to compress.\n");
+    return 1;
+  } //if
+
+  //biggest files first, so that the background isn't left until last
+  vector<int> order(jobs.size());
+  vector<long> filesize(jobs.size(), 0);
+
+  for(int i=0; i<(int)jobs.size(); i++){
+    order[i] = i;
+    FILE* f = fopen(MakePath(root, jobs[i].strSrc).c_str(), "rb");
+    if(f){
+      fseek(f, 0, SEEK_END);
+      filesize[i] = ftell(f);
+      fclose(f);
+    } //if
+  } //for
+
+  stable_sort(order.begin(), order.end(), [&](int a, int b){return filesize[a] > filesize[b];});
+
+  //one image per thread at a time
+  atomic<int> next(0);
+  vector<thread> workers;
+
+  for(int t=0; t<threads; t++)
+    workers.push_back(thread([&]{
+      for(int i=next++; i<(int)order.size(); i=next++)
+        CompressTexture(jobs[order[i]], root, fmt);
+    }));
+
+  for(thread& t: workers)
+    t.join();
+
+  //report
+  size_t sourcebytes = 0, bytes = 0;
+  int failed = 0;
+
+  for(const TextureJob& job: jobs){
+    if(!job.strError.empty()){
+      fprintf(stderr, "Cannot compress %s: %s.\n", job.strSrc.c_str(), job.strError.c_str());
+      failed++; continue;
+    } //if
+
+    printf("%s: %dx%d, %d mips, %s, %0.1f dB, %0.1f ms.\n", job.strDDS.c_str(), job.nWidth,
+      job.nHeight, job.nMips, g_szFormatName[job.nFormat], job.fPSNR, job.fTime);
+    sourcebytes += job.nSourceBytes;
+    bytes += job.nBytes;
+  } //for
+
+  if(!WriteManifest(manifestname, jobs)){
+    fprintf(stderr, "Cannot write manifest %s.\n", manifestname);
+    return 1;
+  } //if
+
+  const double t = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+  printf("%d textures, %0.1f MB as RGBA with mips, %0.1f MB compressed (%0.1fx), %0.0f ms on %d threads.\n",
+    (int)jobs.size() - failed, sourcebytes/1048576.0, bytes/1048576.0,
+    bytes? (double)sourcebytes/bytes: 0.0, t, threads);
+
+  return failed? 1: 0;
+} //main
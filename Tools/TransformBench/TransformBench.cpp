@@ -0,0 +1,116 @@
+/// \file TransformBench.cpp
+/// \brief Microbenchmark for transforming sprites to clip space.
+///
+/// Times TransformSprites, which the game uses to transform a frame's worth
+/// of sprite centers to clip space in one batched pass, against doing each
+/// sprite on its own with a full world view projection product as the game
+/// used to, and checks that the two agree.
+///
+/// Build with, for example:
+///
+///     g++ -O2 -I../../Code -I<DirectXMath>/Inc TransformBench.cpp ../../Code/SpriteTransform.cpp -o transformbench
+///
+/// Usage:
+///
+///     transformbench [-sprites n] [-reps n]
+///
+/// Transforms n sprites (default 10000) reps times (default 1000).
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "SpriteTransform.h"
+
+using namespace std;
+
+/// Transform each sprite on its own, the way the game did before it had
+/// TransformSprites: a world matrix per sprite, multiplied by view and
+/// projection, then the sprite center transformed by the product.
+/// \param in Sprite instances.
+/// \param n Number of sprite instances.
+/// \param view View matrix.
+/// \param proj Projection matrix.
+/// \param out Receives n instances in clip space.
+
+static void TransformSpritesOneByOne(const SpriteInstance* in, int n, FXMMATRIX view,
+  CXMMATRIX proj, SpriteClipInstance* out)
+{
+  for(int i=0; i<n; i++){
+    const SpriteInstance& s = in[i];
+    const XMMATRIX wvp = XMMatrixTranslation(s.fX, s.fY, s.fZ)*view*proj;
+    XMStoreFloat4(&out[i].vCenter, XMVector3Transform(XMVectorZero(), wvp));
+    out[i].vSize = XMFLOAT2(s.fWidth, s.fHeight);
+    out[i].vUV = XMFLOAT4(s.fU0, s.fV0, s.fU1, s.fV1);
+  } //for
+} //TransformSpritesOneByOne
+
+int main(int argc, char* argv[]){
+  int sprites = 10000, reps = 1000;
+
+  for(int i=1; i<argc; i++){
+    const bool more = i + 1 < argc;
+    if(!strcmp(argv[i], "-sprites") && more)sprites = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-reps") && more)reps = atoi(argv[++i]);
+    else{
+      fprintf(stderr, "Unknown option %s.\n", argv[i]);
+      return 2;
+    } //else
+  } //for
+
+  if(sprites <= 0 || reps <= 0){
+    fprintf(stderr, "Bad sprite or repetition count.\n");
+    return 2;
+  } //if
+
+  //sprites scattered over the play area
+  vector<SpriteInstance> in(sprites);
+  srand(1);
+
+  for(int i=0; i<sprites; i++){
+    SpriteInstance& s = in[i];
+    s.fX = 850.0f + rand()%700;
+    s.fY = 64.0f + rand()%600;
+    s.fZ = (float)(rand()%1000);
+    s.fWidth = s.fHeight = 128.0f;
+    s.fU0 = s.fV0 = 0.0f;
+    s.fU1 = s.fV1 = 1.0f;
+  } //for
+
+  //default camera, as in CRenderer::InitD3D
+  const XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(1024, 384, -350, 1),
+    XMVectorSet(1024, 384, 1000, 1), XMVectorSet(0, 1, 0, 0));
+  const XMMATRIX proj = XMMatrixPerspectiveFovLH(XM_PI/4.0f, 1024.0f/768.0f, 1.0f, 10000.0f);
+  const XMMATRIX vp = view*proj;
+
+  vector<SpriteClipInstance> batched(sprites), single(sprites);
+
+  auto t0 = chrono::steady_clock::now();
+  for(int r=0; r<reps; r++)
+    TransformSprites(in.data(), sprites, vp, batched.data());
+  const double tb = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count();
+
+  t0 = chrono::steady_clock::now();
+  for(int r=0; r<reps; r++)
+    TransformSpritesOneByOne(in.data(), sprites, view, proj, single.data());
+  const double ts = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count();
+
+  //they should agree to within rounding
+  float worst = 0.0f;
+  for(int i=0; i<sprites; i++){
+    const float* a = &batched[i].vCenter.x;
+    const float* b = &single[i].vCenter.x;
+    for(int j=0; j<4; j++)
+      worst = fmaxf(worst, fabsf(a[j] - b[j])/fmaxf(1.0f, fabsf(b[j])));
+  } //for
+
+  printf("%d sprites: batched %0.2f ns/sprite, one by one %0.2f ns/sprite, speedup %0.1fx.\n",
+    sprites, tb/reps/sprites, ts/reps/sprites, ts/tb);
+  printf("Largest relative difference %g.\n", worst);
+
+  return worst < 1e-4f? 0: 1;
+} //main